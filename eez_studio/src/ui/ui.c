@@ -66,14 +66,15 @@ const uint8_t assets[860] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
+#include "lcd_variables.h"
+
+// Native variables, generated from the LCD_VARIABLES table (the order must match the project global variables)
+#define NATIVE_VAR_ENTRY(name, type, eez_type, init, unit, precision) { NATIVE_VAR_TYPE_##eez_type, get_var_##name, set_var_##name },
 native_var_t native_vars[] = {
     { NATIVE_VAR_TYPE_NONE, 0, 0 },
-    { NATIVE_VAR_TYPE_BOOLEAN, get_var_is_station_connected, set_var_is_station_connected }, 
-    { NATIVE_VAR_TYPE_FLOAT, get_var_amb_temp_degc, set_var_amb_temp_degc }, 
-    { NATIVE_VAR_TYPE_FLOAT, get_var_amb_humid_pct, set_var_amb_humid_pct }, 
-    { NATIVE_VAR_TYPE_FLOAT, get_var_amb_press_kpa, set_var_amb_press_kpa }, 
-    { NATIVE_VAR_TYPE_BOOLEAN, get_var_is_amb_temp_negative, set_var_is_amb_temp_negative }, 
+    LCD_VARIABLES(NATIVE_VAR_ENTRY)
 };
+#undef NATIVE_VAR_ENTRY
 
 
 ActionExecFunc actions[] = {
@@ -20,16 +20,7 @@ enum FlowGlobalVariables {
 
 // Native global variables
 
-extern bool get_var_is_station_connected();
-extern void set_var_is_station_connected(bool value);
-extern float get_var_amb_temp_degc();
-extern void set_var_amb_temp_degc(float value);
-extern float get_var_amb_humid_pct();
-extern void set_var_amb_humid_pct(float value);
-extern float get_var_amb_press_kpa();
-extern void set_var_amb_press_kpa(float value);
-extern bool get_var_is_amb_temp_negative();
-extern void set_var_is_amb_temp_negative(bool value);
+#include "lcd_variables.h" // Getters and setters generated from the LCD_VARIABLES table
 
 
 #ifdef __cplusplus
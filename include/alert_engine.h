@@ -0,0 +1,99 @@
+#ifndef ALERT_ENGINE__H__
+#define ALERT_ENGINE__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meteo_frame.h"
+
+#define ALERT_DROP_N_REFS 13 //< Reference samples of a drop rule, one per 1/12 of its window
+
+typedef enum
+{
+    ALERT_RULE_BELOW, //< Set at or below the set threshold, cleared at or above the clear one
+    ALERT_RULE_ABOVE, //< Set at or above the set threshold, cleared at or below the clear one
+    ALERT_RULE_DROP,  //< Set when the value dropped by at least set over the window, cleared below clear
+} alert_rule_kind_t;
+
+typedef enum
+{
+    ALERT_INPUT_TEMPERATURE_DEGC,
+    ALERT_INPUT_HUMIDITY_PCT,
+    ALERT_INPUT_PRESSURE_KPA,
+} alert_input_t;
+
+// NOTE: Rule table, evaluated in order on each published frame. The hysteresis is the gap between the set and clear
+// thresholds, a transition also needs its condition to hold for debounce_s. The name is shown on the display.
+// X(id, name, kind, input, set, clear, debounce_s, window_s)
+#define ALERT_RULES(X)                                                                                                 \
+    X(ALERT_FROST,                                                                                                     \
+      "FROST",                                                                                                         \
+      ALERT_RULE_BELOW,                                                                                                \
+      ALERT_INPUT_TEMPERATURE_DEGC,                                                                                    \
+      ALERT_FROST_SET_DEGC,                                                                                            \
+      ALERT_FROST_SET_DEGC + 1.0f,                                                                                     \
+      60,                                                                                                              \
+      0)                                                                                                               \
+    X(ALERT_HIGH_HUMIDITY,                                                                                             \
+      "HUMID",                                                                                                         \
+      ALERT_RULE_ABOVE,                                                                                                \
+      ALERT_INPUT_HUMIDITY_PCT,                                                                                        \
+      ALERT_HUMIDITY_SET_PCT,                                                                                          \
+      ALERT_HUMIDITY_SET_PCT - 5.0f,                                                                                   \
+      60,                                                                                                              \
+      0)                                                                                                               \
+    X(ALERT_PRESSURE_DROP,                                                                                             \
+      "STORM",                                                                                                         \
+      ALERT_RULE_DROP,                                                                                                 \
+      ALERT_INPUT_PRESSURE_KPA,                                                                                        \
+      ALERT_PRESSURE_DROP_SET_KPA,                                                                                     \
+      ALERT_PRESSURE_DROP_SET_KPA * 0.5f,                                                                              \
+      300,                                                                                                             \
+      3 * 3600)
+
+#define ALERT_ENUM(id, name, kind, input, set, clear, debounce_s, window_s) id,
+typedef enum
+{
+    ALERT_RULES(ALERT_ENUM) ALERT_COUNT
+} alert_id_t;
+#undef ALERT_ENUM
+
+_Static_assert(ALERT_COUNT <= 8, "Alert masks are 8 bits");
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t input;
+    float   set;
+    float   clear;
+    int64_t debounce_us;
+    int64_t window_us; //< Drop rules only
+} alert_rule_t;
+
+typedef struct
+{
+    bool    is_pending; //< The condition of the transition holds since pending_since_us
+    int64_t pending_since_us;
+    // Drop rules: reference samples, the oldest one is about a window old once the ring is full
+    float   refs[ALERT_DROP_N_REFS];
+    int64_t last_ref_us;
+    uint8_t ref_head;
+    uint8_t n_refs;
+} alert_rule_state_t;
+
+typedef struct
+{
+    alert_rule_state_t rules[ALERT_COUNT];
+    uint8_t            active_mask;
+} alert_engine_t;
+
+extern const alert_rule_t alert_rules[ALERT_COUNT];
+
+void        alert_engine_init(alert_engine_t *engine);
+// Evaluate every rule on the frame, O(ALERT_COUNT). Returns the mask of the alerts which were set or cleared.
+uint8_t     alert_engine_eval(alert_engine_t *engine, const meteo_frame_t *frame);
+const char *alert_engine_name(alert_id_t id);
+// Name of the first active alert, NULL when none is
+const char *alert_engine_first_name(uint8_t active_mask);
+
+#endif // ALERT_ENGINE__H__
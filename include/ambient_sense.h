@@ -4,7 +4,26 @@
 #include "driver/i2c_master.h"
 #include "esp_err.h"
 
+#include "sense_optimizer.h"
+#include "sense_recovery.h"
+#include "tuning.h"
+
 esp_err_t ambient_sense_init(i2c_master_bus_handle_t i2c_bus_handle);
 void      ambient_sense_task(void *pvParameter);
+// Change the sensor noise and timing targets, the oversampling and filter are picked again before the next
+// measurement (the loop period is the one of ambient_sense_set_period_ms())
+void      ambient_sense_set_targets(const sense_targets_t *targets);
+// Tuning, applied before the next measurement: loop period (0: back to back), oversampling codes fixed instead of
+// picked for the targets (0: picked) and I2C clock of the sensor
+void      ambient_sense_set_period_ms(uint32_t period_ms);
+void      ambient_sense_set_oversampling(const uint8_t os_codes[SENSE_N_CHANNELS]);
+void      ambient_sense_set_i2c_speed(uint32_t scl_speed_hz);
+// Measurement and bus counters of the tuning perf command
+void      ambient_sense_get_perf(tuning_perf_counters_t *counters);
+void      ambient_sense_get_targets(sense_targets_t *targets);
+// Configuration picked for the current targets
+void      ambient_sense_get_config(sense_config_t *config);
+// Sensor faults and recoveries since boot
+void      ambient_sense_get_recovery_stats(sense_recovery_stats_t *stats);
 
 #endif // AMBIENT_SENSE__H__
\ No newline at end of file
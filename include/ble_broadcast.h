@@ -0,0 +1,100 @@
+#ifndef BLE_BROADCAST__H__
+#define BLE_BROADCAST__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "meteo_frame.h"
+
+// BTHome v2 advertising data (https://bthome.io/format/), all in one legacy advertising PDU:
+// | flags AD (3) | service data AD: len, 0x16, UUID 0xFCD2 (LE), device info, objects [, counter (4), MIC (4)] |
+// The objects are sorted by id: packet id (0x00), temperature (0x02, sint16 0.01 °C), humidity (0x03, uint16 0.01 %)
+// and pressure (0x04, uint24 0.01 hPa). Encrypted payloads are AES-CCM with a 4 byte MIC, the objects only.
+#define BTHOME_UUID                    0xFCD2
+#define BTHOME_DEVICE_INFO             0x40 //< BTHome v2, regular (not trigger based) advertising
+#define BTHOME_DEVICE_INFO_ENCRYPTED   0x01
+#define BTHOME_ID_PACKET_ID            0x00
+#define BTHOME_ID_TEMPERATURE          0x02
+#define BTHOME_ID_HUMIDITY             0x03
+#define BTHOME_ID_PRESSURE             0x04
+
+#define BLE_BROADCAST_ADV_MAX_SIZE     31U
+#define BLE_BROADCAST_OBJECTS_SIZE     12U
+#define BLE_BROADCAST_KEY_SIZE         16U
+#define BLE_BROADCAST_NONCE_SIZE       13U
+#define BLE_BROADCAST_MIC_SIZE         4U
+#define BLE_BROADCAST_ADV_SIZE         (3U + 5U + BLE_BROADCAST_OBJECTS_SIZE)
+#define BLE_BROADCAST_ADV_SIZE_ENCRYPT (BLE_BROADCAST_ADV_SIZE + 4U + BLE_BROADCAST_MIC_SIZE)
+
+// AES-CCM encryption of length bytes with a 4 byte MIC (in and out may alias), provided by the platform (mbedtls)
+typedef bool (*ble_broadcast_ccm_fn_t)(const uint8_t  key[BLE_BROADCAST_KEY_SIZE],
+                                       const uint8_t  nonce[BLE_BROADCAST_NONCE_SIZE],
+                                       const uint8_t *in,
+                                       size_t         length,
+                                       uint8_t       *out,
+                                       uint8_t        mic[BLE_BROADCAST_MIC_SIZE]);
+
+typedef struct
+{
+    const uint8_t         *key;     //< BTHome bind key, NULL: not encrypted
+    const uint8_t         *mac;     //< Advertiser address as shown (big endian), 6 bytes, part of the nonce
+    uint32_t               counter; //< Must increase on each encrypted advertising data
+    ble_broadcast_ccm_fn_t ccm;
+} ble_broadcast_crypto_t;
+
+// Payload refresh policy: a new advertising data only when a value moved by more than its threshold since the
+// advertised one, or after max_interval_ms (receivers mark the device unavailable when no new packet id comes)
+typedef struct
+{
+    float    temp_degc;
+    float    humid_pct;
+    float    press_pa;
+    uint32_t max_interval_ms;
+} ble_broadcast_thresholds_t;
+
+typedef struct
+{
+    ble_broadcast_thresholds_t thresholds;
+    bool                       is_sent;
+    float                      temp_degc; //< Advertised values
+    float                      humid_pct;
+    float                      press_pa;
+    int64_t                    sent_us;
+    uint8_t                    packet_id;
+    uint32_t                   n_frames;
+    uint32_t                   n_updates;
+} ble_broadcast_state_t;
+
+void ble_broadcast_init_state(ble_broadcast_state_t *state, const ble_broadcast_thresholds_t *thresholds);
+// True when the frame must be advertised, then the state takes its values and the next packet id
+bool ble_broadcast_update(ble_broadcast_state_t *state, const meteo_frame_t *frame);
+// Advertising data of the frame with the packet id, crypto NULL or without key: not encrypted. Returns its size, 0 on
+// error.
+size_t ble_broadcast_encode(const meteo_frame_t          *frame,
+                            uint8_t                       packet_id,
+                            const ble_broadcast_crypto_t *crypto,
+                            uint8_t                      *buffer,
+                            size_t                        buffer_size);
+// NOTE: Receivers drop encrypted advertising data whose counter does not increase, so the counter must not restart on
+// each boot. It is reserved in NVS by blocks: a boot resumes after the last reserved block, which skips at most
+// BLE_BROADCAST_COUNTER_BLOCK counters and costs one flash write per block.
+#define BLE_BROADCAST_COUNTER_BLOCK 256U
+
+// Next encryption counter, counters up to *reserved_end are reserved. Returns true when the block is used up, then
+// *reserved_end is the end of the next block, to persist before the counter is advertised.
+bool ble_broadcast_next_counter(uint32_t *counter, uint32_t *reserved_end);
+// Air time of an advertising PDU on the 1M PHY (preamble, access address, header, AdvA, data, CRC), sent on each of the
+// 3 advertising channels per advertising event
+uint32_t ble_broadcast_air_time_us(size_t adv_size);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+esp_err_t ble_broadcast_init(void);
+// Hands the frame to the NimBLE host task, which refreshes the advertising data if needed, never waits
+void      ble_broadcast_push(const meteo_frame_t *frame);
+void      ble_broadcast_get_state(ble_broadcast_state_t *state);
+#endif
+
+#endif // BLE_BROADCAST__H__
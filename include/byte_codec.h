@@ -0,0 +1,81 @@
+#ifndef BYTE_CODEC__H__
+#define BYTE_CODEC__H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// NOTE: Little endian field and LEB128 varint codec of the binary formats (stream frames, flash log records, station
+// link frames, I2C trace records). The put functions return the position after the written field.
+
+static inline uint8_t *put_u8(uint8_t *dst, uint8_t value)
+{
+    *dst = value;
+    return dst + 1;
+}
+
+static inline uint8_t *put_u16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+    return dst + 2;
+}
+
+static inline uint8_t *put_u32(uint8_t *dst, uint32_t value)
+{
+    dst = put_u16(dst, (uint16_t)value);
+    return put_u16(dst, (uint16_t)(value >> 16));
+}
+
+static inline uint8_t *put_u64(uint8_t *dst, uint64_t value)
+{
+    dst = put_u32(dst, (uint32_t)value);
+    return put_u32(dst, (uint32_t)(value >> 32));
+}
+
+static inline uint8_t *put_f32(uint8_t *dst, float value)
+{
+    uint32_t raw;
+    memcpy(&raw, &value, sizeof(raw));
+    return put_u32(dst, raw);
+}
+
+static inline uint16_t get_u16(const uint8_t *src)
+{
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *src)
+{
+    return (uint32_t)get_u16(src) | ((uint32_t)get_u16(&src[2]) << 16);
+}
+
+static inline uint64_t get_u64(const uint8_t *src)
+{
+    return (uint64_t)get_u32(src) | ((uint64_t)get_u32(&src[4]) << 32);
+}
+
+static inline uint8_t *put_varint(uint8_t *dst, uint64_t value)
+{
+    while (value >= 0x80U)
+    {
+        *dst++ = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    *dst++ = (uint8_t)value;
+    return dst;
+}
+
+// Returns the number of bytes read, 0 when the varint is truncated or too long
+static inline size_t get_varint(const uint8_t *src, size_t size, uint64_t *value)
+{
+    *value = 0;
+    for (size_t i = 0; i < size && i < 10; i++)
+    {
+        *value |= (uint64_t)(src[i] & 0x7FU) << (7 * i);
+        if ((src[i] & 0x80U) == 0) return i + 1;
+    }
+    return 0;
+}
+
+#endif // BYTE_CODEC__H__
@@ -0,0 +1,65 @@
+#ifndef DATA_STREAM__H__
+#define DATA_STREAM__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "meteo_frame.h"
+
+// Frame layout (little endian):
+// | 0xA5 | 0x5A | type (1) | payload length (1) | payload (n) | CRC-16/CCITT-FALSE of type..payload (2) |
+#define DATA_STREAM_SYNC_0              0xA5
+#define DATA_STREAM_SYNC_1              0x5A
+#define DATA_STREAM_TYPE_SAMPLE         0x01
+#define DATA_STREAM_TYPE_ALERT          0x02 //< Sent when an alert is set or cleared
+#define DATA_STREAM_TYPE_I2C_TRACE      0x03 //< One I2C transaction record, see i2c_trace.h
+#define DATA_STREAM_TYPE_STATION_BATCH  0x04 //< Samples of the ESP-NOW stations, see station_link.h
+#define DATA_STREAM_TYPE_TIME           0x05 //< Monotonic and UTC time of the same instant, see timebase.h
+
+#define DATA_STREAM_HEADER_SIZE         4U
+#define DATA_STREAM_CRC_SIZE            2U
+#define DATA_STREAM_MAX_PAYLOAD_SIZE    255U
+#define DATA_STREAM_SAMPLE_PAYLOAD_SIZE 42U
+#define DATA_STREAM_SAMPLE_FRAME_SIZE   (DATA_STREAM_HEADER_SIZE + DATA_STREAM_SAMPLE_PAYLOAD_SIZE + DATA_STREAM_CRC_SIZE)
+#define DATA_STREAM_ALERT_PAYLOAD_SIZE  14U
+#define DATA_STREAM_ALERT_FRAME_SIZE    (DATA_STREAM_HEADER_SIZE + DATA_STREAM_ALERT_PAYLOAD_SIZE + DATA_STREAM_CRC_SIZE)
+#define DATA_STREAM_TIME_PAYLOAD_SIZE   16U
+#define DATA_STREAM_TIME_FRAME_SIZE     (DATA_STREAM_HEADER_SIZE + DATA_STREAM_TIME_PAYLOAD_SIZE + DATA_STREAM_CRC_SIZE)
+
+// A buffer cut short by a host not reading counts its frames completely sent as sent, the rest as dropped
+typedef struct
+{
+    uint32_t frames_sent;
+    uint32_t frames_dropped;
+    uint32_t bytes_sent; //< Including the part of a frame cut short
+} data_stream_stats_t;
+
+uint16_t data_stream_crc16(const uint8_t *data, size_t length);
+size_t   data_stream_encode_sample(const meteo_frame_t *frame, uint8_t *buffer, size_t buffer_size);
+// Alert frame: sequence and timestamp of the frame which set or cleared alerts, active and changed alert masks
+size_t data_stream_encode_alert(
+    const meteo_frame_t *frame, uint8_t active_mask, uint8_t changed_mask, uint8_t *buffer, size_t buffer_size);
+// Time frame: monotonic stamp and its UTC time (us since the epoch). The samples, alerts and station batches keep
+// their monotonic stamps, the receiver converts them with the last time frame (sent every few seconds once the
+// timebase is synced).
+size_t data_stream_encode_time(int64_t mono_us, int64_t utc_us, uint8_t *buffer, size_t buffer_size);
+// Frame around an opaque payload of up to DATA_STREAM_MAX_PAYLOAD_SIZE bytes
+size_t data_stream_encode_frame(
+    uint8_t type, const uint8_t *payload, size_t payload_size, uint8_t *buffer, size_t buffer_size);
+// Frames which end within the first length bytes of back to back encoded frames
+uint32_t data_stream_count_frames(const uint8_t *data, size_t length);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+esp_err_t data_stream_init(void);
+bool      data_stream_push(const meteo_frame_t *frame);
+bool      data_stream_push_alert(const meteo_frame_t *frame, uint8_t active_mask, uint8_t changed_mask);
+bool      data_stream_push_i2c_trace(const uint8_t *record, size_t length);
+bool      data_stream_push_station_batch(const uint8_t *payload, size_t length);
+void      data_stream_get_stats(data_stream_stats_t *stats);
+void      data_stream_task(void *pvParameter);
+#endif
+
+#endif // DATA_STREAM__H__
@@ -0,0 +1,68 @@
+#ifndef DEFERRED_LOG__H__
+#define DEFERRED_LOG__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEFERRED_LOG_MAX_ARGS 4
+
+// NOTE: Format table, the record only carries the format id and the raw 32 bits arguments.
+// Supported conversions are %d/%i (int32), %u/%x/%X/%o/%c (uint32) and %f/%e/%g (float).
+// X(id, tag, format)
+#define DEFERRED_LOG_FORMATS(X)                                                                                        \
+    X(DLOG_FMT_AMBIENT_SAMPLE,                                                                                         \
+      "ambient_sense",                                                                                                 \
+      "Temperature: %.1f°C, Pressure: %.1fhPa, Humidity: %.1f%%, Gas Resistance: %.2fMOhms.")                        \
+    X(DLOG_FMT_AMBIENT_LOG_COST, "ambient_sense", "Sample log call cost: last %u, max %u, avg %u cycles")          \
+    X(DLOG_FMT_ALERTS, "alert_engine", "Alerts active 0x%x (changed 0x%x), Temperature: %.1f°C, Pressure: %.2fkPa")  \
+    X(DLOG_FMT_SENSE_NOISE, "ambient_sense", "Noise T %.4f°C, P %.2fPa, H %.3f%% measured at %u us/sample")
+
+#define DEFERRED_LOG_FMT_ENUM(id, tag, fmt) id,
+typedef enum
+{
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_FMT_ENUM) DLOG_FMT_COUNT
+} deferred_log_fmt_t;
+#undef DEFERRED_LOG_FMT_ENUM
+
+typedef struct
+{
+    uint32_t timestamp_ms;
+    uint16_t fmt_id;
+    uint8_t  n_args;
+    uint8_t  reserved;
+    uint32_t args[DEFERRED_LOG_MAX_ARGS];
+} deferred_log_record_t;
+
+static inline uint32_t deferred_log_arg_f32(float value)
+{
+    uint32_t raw;
+    memcpy(&raw, &value, sizeof(raw));
+    return raw;
+}
+
+#define DLOG_ARG_F(value) deferred_log_arg_f32((float)(value))
+#define DLOG_ARG_I(value) ((uint32_t)(int32_t)(value))
+#define DLOG_ARG_U(value) ((uint32_t)(value))
+
+// Hot path logging: copies the format id and the raw arguments in the ring, no formatting
+#define DLOG(fmt_id, ...)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        const uint32_t dlog_args_[] = {__VA_ARGS__};                                                                   \
+        deferred_log_write((fmt_id), (uint8_t)(sizeof(dlog_args_) / sizeof(dlog_args_[0])), dlog_args_);              \
+    } while (0)
+
+void        deferred_log_init(void);
+bool        deferred_log_write(uint16_t fmt_id, uint8_t n_args, const uint32_t *args);
+bool        deferred_log_read(deferred_log_record_t *record);
+size_t      deferred_log_format(const deferred_log_record_t *record, char *buffer, size_t buffer_size);
+const char *deferred_log_tag(uint16_t fmt_id);
+uint32_t    deferred_log_dropped_count(void);
+
+#ifdef ESP_PLATFORM
+void deferred_log_task(void *pvParameter);
+#endif
+
+#endif // DEFERRED_LOG__H__
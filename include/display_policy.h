@@ -0,0 +1,52 @@
+#ifndef DISPLAY_POLICY__H__
+#define DISPLAY_POLICY__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lcd_variables.h"
+
+#define DISPLAY_POLICY_CMD_CONTRAST  0x81 //< SSD1306 set contrast, then the contrast byte
+#define DISPLAY_POLICY_CONTRAST_FULL 0x7F //< SSD1306 reset value
+
+typedef enum
+{
+    DISPLAY_POLICY_ON,  //< Full contrast
+    DISPLAY_POLICY_DIM, //< Dim contrast
+    DISPLAY_POLICY_OFF, //< Panel off (sleep mode, its RAM is kept), no flush
+} display_policy_state_t;
+
+typedef struct
+{
+    int64_t dim_after_us; //< Without activity
+    int64_t off_after_us; //< Without activity, and no alert active
+    uint8_t dim_contrast;
+    // Change from the value shown at the last activity which is an activity
+    float   wake_temp_degc;
+    float   wake_humid_pct;
+    float   wake_press_kpa;
+} display_policy_config_t;
+
+// NOTE: There is no presence input on the board, the activity is what is worth a look: an alert raised, or a value
+// which moved by its wake threshold since the last activity (the first measurement too). The display dims, then turns
+// off and stops receiving frames after a time without activity, and comes back at full contrast on the next one.
+typedef struct
+{
+    display_policy_config_t config;
+    display_policy_state_t  state;
+    int64_t                 activity_us;
+    float                   ref_temp_degc; //< Values at the last activity
+    float                   ref_humid_pct;
+    float                   ref_press_kpa;
+    int32_t                 alerts;  //< Active at the last update
+    uint32_t                n_wakes; //< From off
+} display_policy_t;
+
+void                   display_policy_init(
+    display_policy_t *policy, const display_policy_config_t *config, int64_t now_us);
+// State for the values shown at now_us
+display_policy_state_t display_policy_update(display_policy_t *policy, int64_t now_us, const lcd_variables_t *vars);
+// Contrast of an on or dim state
+uint8_t                display_policy_contrast(const display_policy_t *policy, display_policy_state_t state);
+
+#endif // DISPLAY_POLICY__H__
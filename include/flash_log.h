@@ -0,0 +1,85 @@
+#ifndef FLASH_LOG__H__
+#define FLASH_LOG__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history_store.h"
+
+#define FLASH_LOG_SECTOR_SIZE     4096U
+#define FLASH_LOG_HEADER_SIZE     16U //< Magic, sequence number, start timestamp
+#define FLASH_LOG_FOOTER_SIZE     64U //< Magic, sample count, end timestamp, summaries, CRC
+#define FLASH_LOG_FOOTER_OFFSET   (FLASH_LOG_SECTOR_SIZE - FLASH_LOG_FOOTER_SIZE)
+#define FLASH_LOG_MAX_RECORD_SIZE (1U + 10U + HISTORY_N_CHANNELS * 3U)
+
+// NOR flash access, offsets and sizes in bytes from the start of the log area. A write only clears bits, an erase sets
+// a whole sector to 0xFF.
+typedef struct
+{
+    bool (*read)(void *ctx, uint32_t offset, void *data, size_t size);
+    bool (*write)(void *ctx, uint32_t offset, const void *data, size_t size);
+    bool (*erase)(void *ctx, uint32_t offset, size_t size);
+    void    *ctx;
+    uint32_t size; //< Multiple of FLASH_LOG_SECTOR_SIZE
+} flash_log_io_t;
+
+// NOTE: Append-only measurement log in a ring of flash sectors. Each sector starts with a header holding its sequence
+// number and the timestamp of its first sample, then the samples as delta encoded records (a length byte, then the
+// zigzag varint deltas of the time step and of the packed history_store values), and ends with a footer written when
+// it is full: sample count, last timestamp and a min/max/sum summary per channel. The headers are the sparse time
+// index: a seek is a binary search over the sector headers (log2 of the sector count flash reads), and an aggregate
+// reads the footers of the sectors fully in its range and only decodes the two sectors at its ends.
+typedef struct
+{
+    flash_log_io_t  io;
+    uint32_t        n_sectors;
+    uint32_t        oldest;     //< Sector of the oldest sample
+    uint32_t        n_used;     //< Sectors with a header, from oldest
+    uint32_t        next_seq;   //< Sequence number of the next opened sector
+    // Sector being filled, last of the used ones while is_open
+    bool            is_open;
+    uint32_t        write_offset;
+    int64_t         start_us;
+    int64_t         last_us;
+    int64_t         last_dt_us;
+    int16_t         last[HISTORY_N_CHANNELS];
+    uint32_t        n_samples;
+    history_block_t summary[HISTORY_N_CHANNELS];
+    // Flash access counters, for the seek benchmarks
+    uint32_t        n_reads;
+    uint32_t        n_bytes_read;
+    uint32_t        n_rejected; //< Samples older than the last one, the log stays sorted
+} flash_log_t;
+
+typedef void (*flash_log_sample_fn_t)(void *ctx, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS]);
+
+// Find the oldest and newest sectors and recover the sector being filled, an erased area is an empty log
+bool     flash_log_mount(flash_log_t *log, const flash_log_io_t *io);
+bool     flash_log_format(flash_log_t *log, const flash_log_io_t *io);
+bool     flash_log_append(flash_log_t *log, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS]);
+// Logical index (0: oldest) of the sector holding timestamp_us, the first one when it is older than the log
+bool     flash_log_seek(flash_log_t *log, int64_t timestamp_us, uint32_t *index);
+// Calls fn for each sample of [start_us, end_us), returns the number of samples
+uint32_t flash_log_read(
+    flash_log_t *log, int64_t start_us, int64_t end_us, flash_log_sample_fn_t fn, void *ctx);
+// Aggregate of [start_us, end_us), n_summaries counts the sector summaries used and n_scanned the decoded samples
+bool     flash_log_aggregate(flash_log_t         *log,
+                             history_channel_t    channel,
+                             int64_t              start_us,
+                             int64_t              end_us,
+                             history_aggregate_t *aggregate);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+    #include "meteo_frame.h"
+
+// Log in the "meteo_log" data partition, one sample every CONFIG_METEO_FLASH_LOG_PERIOD_S
+esp_err_t flash_log_init(void);
+void      flash_log_push(const meteo_frame_t *frame);
+// The samples are logged by the background task, the sensing task only hands them over
+void      flash_log_task(void *pvParameter);
+#endif
+
+#endif // FLASH_LOG__H__
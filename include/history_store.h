@@ -0,0 +1,103 @@
+#ifndef HISTORY_STORE__H__
+#define HISTORY_STORE__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "minmax_series.h"
+
+#define HISTORY_STORE_BLOCK_LEN 256U       //< Samples per block summary, 512 bytes of a column (16 cache lines of 32 B)
+#define HISTORY_STORE_INVALID   INT16_MIN //< Packed value of a period without sample
+
+typedef enum
+{
+    HISTORY_CH_TEMP,  //< 0.01 °C
+    HISTORY_CH_PRESS, //< 1 Pa from 100000 Pa
+    HISTORY_CH_HUMID, //< 0.01 %RH
+    HISTORY_N_CHANNELS,
+} history_channel_t;
+
+typedef struct
+{
+    int16_t  min;
+    int16_t  max;
+    int32_t  sum;
+    uint32_t n_valid;
+} history_block_t;
+
+// NOTE: Columnar history: one ring of packed int16 values per channel at a fixed period, each block of
+// HISTORY_STORE_BLOCK_LEN samples summarized (min, max, sum). The columns and summaries are the cold part, allocated
+// by the caller (PSRAM on the device, see history_store_memory_size()). A range query scans the samples of the partial
+// blocks at its ends only and the summaries of the blocks in between, so a week long aggregate reads a few KB instead
+// of 1.2 MB per channel. The hot part stays in the store itself (internal SRAM): the latest values, the samples of the
+// current period being averaged and the summary of the block being filled.
+typedef struct
+{
+    int16_t         *columns[HISTORY_N_CHANNELS];
+    history_block_t *blocks[HISTORY_N_CHANNELS];
+    uint32_t         capacity; //< Samples per column, a multiple of HISTORY_STORE_BLOCK_LEN
+    int64_t          period_us;
+
+    float           latest[HISTORY_N_CHANNELS];
+    int64_t         latest_us;
+    float           period_sum[HISTORY_N_CHANNELS];
+    uint32_t        period_n_samples;
+    int64_t         period_slot;   //< Slot (timestamp / period) being averaged
+    int64_t         first_slot;    //< First slot stored since init
+    int64_t         next_slot;     //< Slot of the next stored sample, nothing stored while equal to first_slot
+    history_block_t open_block[HISTORY_N_CHANNELS]; //< Summaries of the block being filled, not written yet
+} history_store_t;
+
+typedef struct
+{
+    float    min;
+    float    max;
+    float    mean;
+    uint32_t n_samples;   //< Valid samples in the range
+    uint32_t n_scanned;   //< Column values read, at the partial blocks
+    uint32_t n_summaries; //< Block summaries read
+} history_aggregate_t;
+
+// Bytes of cold storage for at least capacity samples per channel (rounded up to whole blocks)
+size_t history_store_memory_size(uint32_t capacity);
+// False when the memory is too small or misaligned for the capacity
+bool   history_store_init(history_store_t *store, int64_t period_us, uint32_t capacity, void *memory, size_t size);
+// Samples of a period are averaged, the average is stored when a sample of a later period comes. NaN values are
+// stored as missing, as the periods without sample.
+void   history_store_add(history_store_t *store, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS]);
+// Stored time range [first_us, end_us), false when empty
+bool   history_store_range(const history_store_t *store, int64_t *first_us, int64_t *end_us);
+// Aggregate of the stored samples of [start_us, end_us), false when there is none
+bool   history_store_aggregate(const history_store_t *store,
+                               history_channel_t      channel,
+                               int64_t                start_us,
+                               int64_t                end_us,
+                               history_aggregate_t   *aggregate);
+// Min/max of n_buckets equal time buckets over [start_us, end_us) for a chart, empty buckets as minmax_series ones.
+// Returns the number of values read (scanned and summaries).
+uint32_t history_store_decimate(const history_store_t *store,
+                                history_channel_t      channel,
+                                int64_t                start_us,
+                                int64_t                end_us,
+                                minmax_bucket_t       *buckets,
+                                uint32_t               n_buckets);
+// Fixed point value of the channel, NaN as HISTORY_STORE_INVALID and saturated to the int16 range
+int16_t  history_store_pack(history_channel_t channel, float value);
+float    history_store_unpack(history_channel_t channel, int16_t packed);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+    #include "meteo_frame.h"
+
+// Store of CONFIG_METEO_HISTORY_DAYS of 1 s samples in PSRAM
+esp_err_t history_init(void);
+void      history_push(const meteo_frame_t *frame);
+// Locked chart query of the device store, for the history screen. False when the store is not running (no PSRAM),
+// the buckets are then left as they are.
+bool      history_decimate(
+    history_channel_t channel, int64_t start_us, int64_t end_us, minmax_bucket_t *buckets, uint32_t n_buckets);
+#endif
+
+#endif // HISTORY_STORE__H__
@@ -0,0 +1,107 @@
+#ifndef I2C_TRACE__H__
+#define I2C_TRACE__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+#endif
+
+// NOTE: Compact binary trace of I2C transactions, recorded on the device and replayed on the host. A trace file is
+// the header followed by the records, each record is:
+// | kind and flags (1) | 7 bits address (1) | timestamp us (varint) | write length (varint) | read length (varint) |
+// | write bytes | read bytes |
+// The timestamps are absolute (esp_timer time), so a record stands alone (e.g. one per stream frame, a dropped frame
+// only loses its transaction).
+#define I2C_TRACE_MAGIC           "I2CT"
+#define I2C_TRACE_VERSION         1U
+#define I2C_TRACE_HEADER_SIZE     5U
+#define I2C_TRACE_MAX_DATA        200U //< Longer transfers are truncated, flagged I2C_TRACE_FLAG_TRUNCATED
+#define I2C_TRACE_MAX_RECORD_SIZE (2U + 10U + 2U + 2U + I2C_TRACE_MAX_DATA)
+
+typedef enum
+{
+    I2C_TRACE_WRITE,      //< Write only, e.g. a register write
+    I2C_TRACE_READ,       //< Read only
+    I2C_TRACE_WRITE_READ, //< Write then read with a repeated start, e.g. a register read
+} i2c_trace_kind_t;
+
+#define I2C_TRACE_KIND_MASK       0x03U
+#define I2C_TRACE_FLAG_TRUNCATED  0x40U
+#define I2C_TRACE_FLAG_ERROR      0x80U //< The transaction failed (NACK, timeout), its read bytes are not valid
+
+typedef struct
+{
+    int64_t        timestamp_us;
+    uint8_t        kind; //< i2c_trace_kind_t
+    uint8_t        flags;
+    uint8_t        address;
+    uint16_t       write_length;
+    uint16_t       read_length;
+    const uint8_t *write_data; //< Points in the trace buffer
+    const uint8_t *read_data;
+} i2c_trace_record_t;
+
+// Encode one record, returns its size or 0 when the buffer is too small
+size_t i2c_trace_encode(const i2c_trace_record_t *record, uint8_t *buffer, size_t buffer_size);
+// Decode the record at the start of the buffer, returns its size or 0 when it is truncated or invalid
+size_t i2c_trace_decode(const uint8_t *buffer, size_t buffer_size, i2c_trace_record_t *record);
+// Write the trace file header, returns I2C_TRACE_HEADER_SIZE or 0 when the buffer is too small
+size_t i2c_trace_encode_header(uint8_t *buffer, size_t buffer_size);
+
+// NOTE: Replay backend, serves the recorded read bytes back to a driver issuing the same transactions. Each device
+// (address) has its own cursor, so the sensor can be replayed alone from a trace with the display transactions too.
+// The clock is the timestamp of the last replayed record: delays return at once and a day of samples replays in the
+// time it takes to run the code on it.
+typedef struct
+{
+    const uint8_t *data; //< Records, after the header
+    size_t         size;
+    size_t         cursors[128];
+    int64_t        now_us;
+    uint32_t       n_replayed;
+    uint32_t       n_mismatches; //< Transactions which did not match the next record of their device
+} i2c_trace_replay_t;
+
+// Replay the trace file in buffer (kept by the caller), false when its header is not valid
+bool    i2c_trace_replay_init(i2c_trace_replay_t *replay, const uint8_t *buffer, size_t size);
+// Replay the next transaction of the device: its kind and write bytes must match the recorded ones. The recorded read
+// bytes are copied in read_data. Returns false on a mismatch, at the end of the trace or for a recorded failure.
+bool    i2c_trace_replay_transfer(i2c_trace_replay_t *replay,
+                                  uint8_t             address,
+                                  const uint8_t      *write_data,
+                                  size_t              write_length,
+                                  uint8_t            *read_data,
+                                  size_t              read_length);
+bool    i2c_trace_replay_is_done(const i2c_trace_replay_t *replay, uint8_t address);
+int64_t i2c_trace_replay_now_us(const i2c_trace_replay_t *replay);
+
+// BME68x API interface port over the replay (struct bme68x_dev read, write and delay_us), intf_ptr is an
+// i2c_trace_bme68x_intf_t. The return values are BME68X_OK (0) and BME68X_E_COM_FAIL (-2).
+typedef struct
+{
+    i2c_trace_replay_t *replay;
+    uint8_t             address;
+} i2c_trace_bme68x_intf_t;
+
+int8_t i2c_trace_bme68x_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr);
+int8_t i2c_trace_bme68x_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr);
+void   i2c_trace_bme68x_delay_us(uint32_t period, void *intf_ptr);
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_METEO_I2C_TRACE)
+// Record a transaction in the raw sample stream, never waits (dropped when the stream buffers are full)
+void i2c_trace_capture(uint8_t        kind,
+                       uint8_t        address,
+                       const uint8_t *write_data,
+                       size_t         write_length,
+                       const uint8_t *read_data,
+                       size_t         read_length,
+                       bool           is_ok);
+    #define I2C_TRACE_CAPTURE(...) i2c_trace_capture(__VA_ARGS__)
+#else
+    #define I2C_TRACE_CAPTURE(...) ((void)0)
+#endif
+
+#endif // I2C_TRACE__H__
@@ -3,8 +3,16 @@
 
 #include "driver/i2c_master.h"
 #include "esp_err.h"
+#include "tuning.h"
 
 esp_err_t lcd_manager_init(i2c_master_bus_handle_t s_i2c_bus);
-void      lcd_manager_task(void *pvParameter);
+void      lcd_manager_task(void *pvParameter); //< pvParameter is the I2C bus handle, the task inits the display
+
+// Tuning, applied by the task at its next tick. The I2C clock of the display only changes live with the minimal
+// renderer, with LVGL at the next restart.
+void      lcd_manager_set_period_ms(uint32_t period_ms);
+void      lcd_manager_set_i2c_speed(uint32_t scl_speed_hz);
+// UI tick and display bus counters of the tuning perf command
+void      lcd_manager_get_perf(tuning_perf_counters_t *counters);
 
 #endif // LCD_MANAGER__H__
@@ -1,22 +1,78 @@
 #ifndef LCD_VARIABLES__H__
 #define LCD_VARIABLES__H__
 
+#include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-#include "esp_err.h"
+#include "meteo_frame.h"
 
-esp_err_t lcd_variables_init(void);
+// NOTE: EEZ Studio native variables, each one is defined once here. The storage, getters, setters, change versions
+// and the EEZ native_vars[] table (ui.c template of the EEZ Studio project) are generated from this table. The order
+// is the EEZ variable index: keep it the same as the project global variables (checked by tools/test_lcd_variables.py).
+// X(name, type, eez_type, init, unit, precision)
+#define LCD_VARIABLES(X)                                                                                               \
+    X(is_station_connected, bool, BOOLEAN, false, "", 0)                                                               \
+    X(amb_temp_degc, float, FLOAT, NAN, "°C", 1)                                                                       \
+    X(amb_humid_pct, float, FLOAT, NAN, "%", 1)                                                                        \
+    X(amb_press_kpa, float, FLOAT, NAN, "kPa", 2)                                                                      \
+    X(is_amb_temp_negative, bool, BOOLEAN, false, "", 0)                                                               \
+    /* Sliding window statistics, NaN until the window holds a sample */                                               \
+    X(amb_temp_high_degc, float, FLOAT, NAN, "°C", 1)                                                                  \
+    X(amb_temp_low_degc, float, FLOAT, NAN, "°C", 1)                                                                   \
+    X(amb_temp_avg_degc, float, FLOAT, NAN, "°C", 1)                                                                   \
+    X(amb_humid_avg_pct, float, FLOAT, NAN, "%", 1)                                                                    \
+    X(amb_press_avg_kpa, float, FLOAT, NAN, "kPa", 2)                                                                  \
+    /* Mask of the active alerts, bit n is alert_id_t n */                                                             \
+    X(active_alerts, int32_t, INTEGER, 0, "", 0)
 
-bool  get_var_is_station_connected();
-void  set_var_is_station_connected(bool value);
-float get_var_amb_temp_degc();
-void  set_var_amb_temp_degc(float value);
-float get_var_amb_humid_pct();
-void  set_var_amb_humid_pct(float value);
-float get_var_amb_press_kpa();
-void  set_var_amb_press_kpa(float value);
-bool  get_var_is_amb_temp_negative();
-void  set_var_is_amb_temp_negative(bool value);
+#define LCD_VARIABLE_ID(name, type, eez_type, init, unit, precision) LCD_VAR_##name,
+typedef enum
+{
+    LCD_VARIABLES(LCD_VARIABLE_ID) LCD_VAR_COUNT
+} lcd_var_id_t;
+#undef LCD_VARIABLE_ID
 
-#endif // LCD_VARIABLES__H__
\ No newline at end of file
+typedef enum
+{
+    LCD_VAR_TYPE_BOOLEAN,
+    LCD_VAR_TYPE_INTEGER,
+    LCD_VAR_TYPE_FLOAT,
+} lcd_var_type_t;
+
+typedef struct
+{
+    const char *name;
+    const char *unit;
+    uint8_t     type; //< lcd_var_type_t
+    uint8_t     precision;
+} lcd_var_info_t;
+
+// Every variable, published as one frame: a reader sees the values of a single write (e.g. a whole measurement)
+#define LCD_VARIABLE_FIELD(name, type, eez_type, init, unit, precision) type name;
+typedef struct
+{
+    LCD_VARIABLES(LCD_VARIABLE_FIELD)
+} lcd_variables_t;
+#undef LCD_VARIABLE_FIELD
+
+extern const lcd_var_info_t lcd_var_infos[LCD_VAR_COUNT];
+
+// Getter/Setter for EEZ Studio functions, lock-free reads
+#define LCD_VARIABLE_DECL(name, type, eez_type, init, unit, precision)                                                \
+    type get_var_##name();                                                                                             \
+    void set_var_##name(type value);
+LCD_VARIABLES(LCD_VARIABLE_DECL)
+#undef LCD_VARIABLE_DECL
+
+// Publish the measurement values in a single write
+void     lcd_variables_set_frame(const meteo_frame_t *frame);
+// Consistent copy of every variable
+void     lcd_variables_snapshot(lcd_variables_t *snapshot);
+// Incremented each time the variable value changes, setting the same value again does not count
+uint32_t lcd_variables_version(lcd_var_id_t id);
+// Value and unit as text, e.g. "21.5 °C", returns the snprintf length
+int      lcd_variables_format(lcd_var_id_t id, char *text, size_t text_size);
+
+#endif // LCD_VARIABLES__H__
@@ -0,0 +1,50 @@
+#ifndef MEM_TELEMETRY__H__
+#define MEM_TELEMETRY__H__
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_err.h"
+
+#define MEM_TELEMETRY_MAX_TASKS 10
+
+typedef enum
+{
+    MEM_TELEMETRY_HEAP_INTERNAL = 0,
+    MEM_TELEMETRY_HEAP_DMA,
+    MEM_TELEMETRY_HEAP_SPIRAM,
+    MEM_TELEMETRY_HEAP_COUNT,
+} mem_telemetry_heap_id_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t    stack_size_bytes;
+    uint32_t    stack_high_water_mark_bytes; //< Minimum free stack since the task started
+} mem_telemetry_task_stats_t;
+
+typedef struct
+{
+    uint32_t total_bytes;
+    uint32_t free_bytes;
+    uint32_t min_free_bytes;
+    uint32_t largest_free_block_bytes;
+    uint8_t  fragmentation_pct; //< 100 - largest free block / free bytes
+} mem_telemetry_heap_stats_t;
+
+typedef struct
+{
+    int64_t                    timestamp_us;
+    uint8_t                    n_tasks;
+    mem_telemetry_task_stats_t tasks[MEM_TELEMETRY_MAX_TASKS];
+    mem_telemetry_heap_stats_t heaps[MEM_TELEMETRY_HEAP_COUNT];
+} mem_telemetry_snapshot_t;
+
+esp_err_t mem_telemetry_register_task(TaskHandle_t task_handle, uint32_t stack_size_bytes);
+void      mem_telemetry_sample(void);
+void      mem_telemetry_get_snapshot(mem_telemetry_snapshot_t *snapshot);
+void      mem_telemetry_task(void *pvParameter);
+
+#endif // MEM_TELEMETRY__H__
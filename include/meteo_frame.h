@@ -0,0 +1,43 @@
+#ifndef METEO_FRAME__H__
+#define METEO_FRAME__H__
+
+#include <stdint.h>
+
+// Raw BME68x ADC field values, before compensation
+typedef struct
+{
+    uint32_t temp_adc;
+    uint32_t press_adc;
+    uint16_t hum_adc;
+    uint16_t gas_adc;
+    uint8_t  gas_range;
+    uint8_t  status;
+} meteo_raw_t;
+
+// One measurement, as published by the ambient sensing loop
+typedef struct
+{
+    uint32_t    sequence;
+    int64_t     timestamp_us; //< Monotonic (esp_timer), converted to UTC when exported (timebase.h)
+    float       temperature_degc;
+    float       pressure_pa;
+    float       humidity_pct;
+    float       gas_resistance_ohm;
+    meteo_raw_t raw;
+} meteo_frame_t;
+
+#define METEO_RAW_FIELD_REGS_LEN 17U //< BME68x field data registers, BME68X_LEN_FIELD
+
+// Decode the raw ADC values from the BME688 field data registers, same layout as the BME68x API read_field_data()
+void meteo_raw_decode(const uint8_t *field_regs, meteo_raw_t *raw);
+// Next measurement in the frame: the compensated values from the BME68x API, and the raw ADC values of the field
+// data registers it read
+void meteo_frame_set_sample(meteo_frame_t *frame,
+                            int64_t        timestamp_us,
+                            float          temperature_degc,
+                            float          pressure_pa,
+                            float          humidity_pct,
+                            float          gas_resistance_ohm,
+                            const uint8_t *field_regs);
+
+#endif // METEO_FRAME__H__
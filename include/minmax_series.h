@@ -0,0 +1,45 @@
+#ifndef MINMAX_SERIES__H__
+#define MINMAX_SERIES__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// One bucket per chart column
+#define MINMAX_SERIES_LEN 128
+
+// NOTE: Fixed-size decimated series: the samples are reduced to the min and max of fixed time buckets, the last
+// MINMAX_SERIES_LEN buckets are kept in a ring. Buckets are identified by an absolute index (the number of buckets
+// started before them), the ring slot and the sweep chart column is index % MINMAX_SERIES_LEN.
+typedef struct
+{
+    float min;
+    float max;
+} minmax_bucket_t;
+
+typedef struct
+{
+    minmax_bucket_t buckets[MINMAX_SERIES_LEN];
+    int64_t         bucket_period_us;
+    int64_t         bucket_start_us; //< Start of the newest bucket
+    uint32_t        n_buckets;       //< Buckets started since init, the newest one is n_buckets - 1
+} minmax_series_t;
+
+void     minmax_series_init(minmax_series_t *series, int64_t bucket_period_us);
+// Add a sample, returns the number of buckets started by it (0 when it falls in the newest bucket)
+uint32_t minmax_series_add(minmax_series_t *series, int64_t timestamp_us, float value);
+// Bucket with the absolute index, false when it is not started yet or already overwritten
+bool     minmax_series_get(const minmax_series_t *series, uint32_t index, minmax_bucket_t *bucket);
+// Replace the buckets by n_buckets consecutive ones (oldest first, e.g. decimated from a longer store), the last one
+// is the newest with the absolute index newest_index and starts at newest_start_us. The older ring slots are emptied.
+void     minmax_series_load(minmax_series_t       *series,
+                            uint32_t               newest_index,
+                            int64_t                newest_start_us,
+                            const minmax_bucket_t *buckets,
+                            uint32_t               n_buckets);
+
+static inline bool minmax_bucket_is_empty(const minmax_bucket_t *bucket)
+{
+    return bucket->min > bucket->max; // No sample in the bucket, e.g. a gap in the data
+}
+
+#endif // MINMAX_SERIES__H__
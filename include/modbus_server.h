@@ -0,0 +1,170 @@
+#ifndef MODBUS_SERVER__H__
+#define MODBUS_SERVER__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lcd_variables.h"
+#include "meteo_frame.h"
+#include "sense_recovery.h"
+#include "seqlock.h"
+
+// Register map, read as input registers (function 0x04) or holding registers (0x03), addresses from 0. 32 bit values
+// take two registers, high word first. A missing value (NaN) reads as 0x8000 (int16), 0xFFFF (uint16) or 0xFFFFFFFF.
+typedef enum
+{
+    MODBUS_REG_SEQUENCE = 0,         //< uint32, measurement sequence number
+    MODBUS_REG_UPTIME_S = 2,         //< uint32, measurement time since boot (s)
+    MODBUS_REG_TEMP = 4,             //< int16, 0.01 °C
+    MODBUS_REG_HUMID = 5,            //< uint16, 0.01 %RH
+    MODBUS_REG_PRESS = 6,            //< uint32, Pa
+    MODBUS_REG_GAS = 8,              //< uint32, Ohm
+    // Derived metrics, sliding window statistics and dew point
+    MODBUS_REG_TEMP_HIGH = 10,       //< int16, 0.01 °C
+    MODBUS_REG_TEMP_LOW = 11,        //< int16, 0.01 °C
+    MODBUS_REG_TEMP_AVG = 12,        //< int16, 0.01 °C
+    MODBUS_REG_HUMID_AVG = 13,       //< uint16, 0.01 %RH
+    MODBUS_REG_PRESS_AVG = 14,       //< uint32, Pa
+    MODBUS_REG_DEW_POINT = 16,       //< int16, 0.01 °C
+    MODBUS_REG_ALERTS = 17,          //< uint16, bit n is alert_id_t n
+    // Health counters since boot
+    MODBUS_REG_N_FAULTS = 18,        //< uint32, sensor faults
+    MODBUS_REG_N_BUS_RESETS = 20,    //< uint32
+    MODBUS_REG_N_SAMPLES_LOST = 22,  //< uint32
+    MODBUS_REG_MAX_RECOVER_MS = 24,  //< uint32
+    // Sensor status, published by the recovery steps too
+    MODBUS_REG_SAMPLE_AGE_S = 26,    //< uint32, time from the measurement to the request (s)
+    MODBUS_REG_SENSOR_STATE = 28,    //< uint16, modbus_sensor_state_t
+    MODBUS_REG_UTC_S = 29,           //< uint32, measurement UTC time (s since the epoch), missing until the clock is set
+    MODBUS_N_REGISTERS = 31,
+} modbus_register_t;
+
+typedef enum
+{
+    MODBUS_SENSOR_MEASURING = 0,
+    MODBUS_SENSOR_RECOVERING = 1, //< Measurements failing, the last one is MODBUS_REG_SAMPLE_AGE_S old
+} modbus_sensor_state_t;
+
+#define MODBUS_FC_READ_HOLDING      0x03
+#define MODBUS_FC_READ_INPUT        0x04
+#define MODBUS_EX_ILLEGAL_FUNCTION  0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS   0x02
+#define MODBUS_EX_ILLEGAL_VALUE     0x03
+#define MODBUS_MAX_READ_REGISTERS   125U
+#define MODBUS_MAX_PDU_SIZE         253U
+#define MODBUS_RTU_MAX_ADU_SIZE     256U //< Address, PDU, CRC
+#define MODBUS_TCP_MBAP_SIZE        7U   //< Transaction id, protocol id, length, unit id
+#define MODBUS_TCP_MAX_ADU_SIZE     (MODBUS_TCP_MBAP_SIZE + MODBUS_MAX_PDU_SIZE)
+#define MODBUS_TCP_MAX_CLIENTS      4U
+
+// NOTE: The registers of a measurement are published as one snapshot with a seqlock (seqlock.h): a request copies the
+// whole map once, retrying when a publish happened meanwhile, and builds its response from that copy. A
+// multi-register read is never torn and a poll never waits on the sensing task.
+typedef struct
+{
+    seqlock_t lock;
+    uint16_t  registers[MODBUS_N_REGISTERS];
+} modbus_snapshot_t;
+
+typedef struct
+{
+    modbus_snapshot_t *snapshot;
+    int64_t (*clock_us)(void);       //< Time since boot of the sample age, NULL: the age of the publish (0)
+    uint8_t            unit_id;      //< RTU address, 1..247
+    uint32_t           n_requests;   //< Answered, exceptions included
+    uint32_t           n_exceptions;
+    uint32_t           n_crc_errors; //< RTU frames with a wrong CRC
+    uint32_t           n_other_unit; //< RTU frames for another address on the bus, or broadcast
+} modbus_server_t;
+
+// RTU request framing. A request of a known function code is complete as soon as its length is received with a valid
+// CRC, the others when the line stays silent for 3.5 characters.
+typedef struct
+{
+    uint8_t  buffer[MODBUS_RTU_MAX_ADU_SIZE];
+    size_t   length;
+    int64_t  last_byte_us;
+    uint32_t silence_us;
+    bool     is_overflow;
+} modbus_rtu_rx_t;
+
+// Serial line (a UART through the VFS on the device, a pseudo-terminal on the host)
+typedef struct
+{
+    modbus_server_t *server;
+    int              fd;
+    modbus_rtu_rx_t  rx;
+} modbus_rtu_port_t;
+
+// TCP listening socket and its clients (lwIP sockets on the device)
+typedef struct
+{
+    modbus_server_t *server;
+    int              listen_fd;
+    int              client_fds[MODBUS_TCP_MAX_CLIENTS];
+    uint8_t          rx[MODBUS_TCP_MAX_CLIENTS][MODBUS_TCP_MAX_ADU_SIZE];
+    size_t           rx_length[MODBUS_TCP_MAX_CLIENTS];
+} modbus_tcp_port_t;
+
+// Registers of a measurement, its sliding window statistics and alerts (variables) and the sensor health counters
+void     modbus_server_map(const meteo_frame_t          *frame,
+                           const lcd_variables_t        *variables,
+                           const sense_recovery_stats_t *recovery,
+                           uint16_t                      registers[MODBUS_N_REGISTERS]);
+// UTC time of the measurement from the timebase, NULL while it is unknown
+void     modbus_server_map_utc(const int64_t *utc_us, uint16_t registers[MODBUS_N_REGISTERS]);
+// Health counters and sensor state of a recovery step, the other registers are kept
+void     modbus_server_map_health(const sense_recovery_stats_t *recovery,
+                                  bool                          is_faulted,
+                                  uint16_t                      registers[MODBUS_N_REGISTERS]);
+// Every register missing until the first publish
+void     modbus_snapshot_init(modbus_snapshot_t *snapshot);
+void     modbus_snapshot_publish(modbus_snapshot_t *snapshot, const uint16_t registers[MODBUS_N_REGISTERS]);
+void     modbus_snapshot_read(modbus_snapshot_t *snapshot, uint16_t registers[MODBUS_N_REGISTERS]);
+
+void     modbus_server_init_state(modbus_server_t *server, modbus_snapshot_t *snapshot, uint8_t unit_id);
+// Response PDU to a request PDU (exception responses included), 0 when the buffer is too small
+size_t   modbus_server_handle_pdu(
+    modbus_server_t *server, const uint8_t *pdu, size_t length, uint8_t *response, size_t size);
+// Response ADU to a RTU request ADU, 0 when there is none to send (CRC error, other address, broadcast)
+size_t   modbus_server_handle_rtu(
+    modbus_server_t *server, const uint8_t *adu, size_t length, uint8_t *response, size_t size);
+// Response ADU to a TCP request ADU (one whole frame, see modbus_tcp_frame_length()), 0 when invalid
+size_t   modbus_server_handle_tcp(
+    modbus_server_t *server, const uint8_t *adu, size_t length, uint8_t *response, size_t size);
+// Size of the TCP frame at the start of the data, 0 while incomplete, -1 when it is not a Modbus frame
+int      modbus_tcp_frame_length(const uint8_t *data, size_t length);
+uint16_t modbus_crc16(const uint8_t *data, size_t length);
+
+// Inter-frame silence at the baud rate: 3.5 characters of 11 bits, 1750 us above 19200 baud
+uint32_t modbus_rtu_silence_us(uint32_t baud);
+void     modbus_rtu_rx_init(modbus_rtu_rx_t *rx, uint32_t baud);
+void     modbus_rtu_rx_feed(modbus_rtu_rx_t *rx, const uint8_t *data, size_t length, int64_t now_us);
+// Length of the complete request in rx->buffer, 0 when none; a returned request is dropped at the next call
+size_t   modbus_rtu_rx_poll(modbus_rtu_rx_t *rx, int64_t now_us);
+
+void     modbus_rtu_port_init(modbus_rtu_port_t *port, modbus_server_t *server, int fd, uint32_t baud);
+// Wait up to timeout_ms for bytes and answer a complete request, false when the line failed
+bool     modbus_rtu_port_poll(modbus_rtu_port_t *port, int timeout_ms);
+// Listen on the port of all the interfaces (0: any free port, see modbus_tcp_port_number())
+bool     modbus_tcp_port_open(modbus_tcp_port_t *port, modbus_server_t *server, uint16_t number);
+uint16_t modbus_tcp_port_number(const modbus_tcp_port_t *port);
+// Wait up to timeout_ms for connections and requests and answer them
+void     modbus_tcp_port_poll(modbus_tcp_port_t *port, int timeout_ms);
+void     modbus_tcp_port_close(modbus_tcp_port_t *port);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+// RTU on a UART and/or TCP over a Wi-Fi station connection, each served by its task
+esp_err_t modbus_server_init(void);
+// Publish the registers of a measurement, after its statistics and alerts were updated
+void      modbus_server_push(const meteo_frame_t *frame);
+// Publish the health counters and sensor state after a recovery step, so they are current during an outage
+void      modbus_server_push_health(bool is_faulted);
+void      modbus_server_rtu_task(void *pvParameter);
+void      modbus_server_tcp_task(void *pvParameter);
+#endif
+
+#endif // MODBUS_SERVER__H__
@@ -0,0 +1,62 @@
+#ifndef MONO_CHART__H__
+#define MONO_CHART__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "minmax_series.h"
+#include "mono_fb.h"
+
+_Static_assert(MINMAX_SERIES_LEN == MONO_FB_WIDTH, "One series bucket per chart column");
+
+// NOTE: Sparkline of a min/max series, one column per bucket drawn as a bar from the bucket min to its max.
+// The SSD1306 cannot shift its RAM by one column (its scroll commands scroll continuously at a frame rate), so a
+// scrolling chart re-sends the whole plot. The sweep mode writes each new bucket at a fixed column (index % width)
+// with a blank column in front of it: an update sends the new column and the gap only.
+typedef enum
+{
+    MONO_CHART_SWEEP = 0,
+    MONO_CHART_SCROLL, //< Newest bucket on the right, the plot shifts left by a column per bucket
+} mono_chart_mode_t;
+
+typedef struct
+{
+    uint8_t           page;    //< First page of the plot
+    uint8_t           n_pages; //< Plot height in pages
+    mono_chart_mode_t mode;
+    float             step; //< The scale bounds are multiples of step
+    float             scale_min;
+    float             scale_max;
+    uint32_t          n_drawn; //< Series n_buckets at the last draw, 0 when not drawn
+    uint32_t          n_redraws;
+} mono_chart_t;
+
+void mono_chart_init(mono_chart_t *chart, uint8_t page, uint8_t n_pages, float step, mono_chart_mode_t mode);
+// Fit the scale to the shown buckets and draw every column
+void mono_chart_redraw(mono_chart_t *chart, mono_fb_t *fb, const minmax_series_t *series);
+// Draw the buckets started since the last draw and the newest one (still filling), redraw when out of scale
+void mono_chart_update(mono_chart_t *chart, mono_fb_t *fb, const minmax_series_t *series);
+// Min and max of the shown buckets, false when they are all empty
+bool mono_chart_get_range(const mono_chart_t *chart, const minmax_series_t *series, float *min, float *max);
+
+// History screen: temperature and pressure charts, each under a header line with the shown range
+typedef struct
+{
+    mono_chart_t temp_chart;
+    mono_chart_t press_chart;
+    char         temp_text[24];
+    char         press_text[24];
+} mono_chart_screen_t;
+
+void mono_chart_screen_init(mono_chart_screen_t *screen, mono_chart_mode_t mode);
+// Full draw, e.g. when the screen is shown
+void mono_chart_screen_draw(mono_chart_screen_t   *screen,
+                            mono_fb_t             *fb,
+                            const minmax_series_t *temp_series,
+                            const minmax_series_t *press_series);
+void mono_chart_screen_update(mono_chart_screen_t   *screen,
+                              mono_fb_t             *fb,
+                              const minmax_series_t *temp_series,
+                              const minmax_series_t *press_series);
+
+#endif // MONO_CHART__H__
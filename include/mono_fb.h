@@ -0,0 +1,59 @@
+#ifndef MONO_FB__H__
+#define MONO_FB__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// NOTE: 1-bpp framebuffer in the SSD1306 GRAM layout: 8 pages of 8 pixel rows, one byte per column and page with
+// the top row in the LSB. A glyph (or a page aligned rectangle) is then a plain byte copy, and the panel is flushed
+// page by page, only over the columns changed since the last flush.
+#define MONO_FB_WIDTH   128
+#define MONO_FB_HEIGHT  64
+#define MONO_FB_N_PAGES (MONO_FB_HEIGHT / 8)
+#define MONO_FB_SIZE    (MONO_FB_WIDTH * MONO_FB_N_PAGES)
+
+typedef struct
+{
+    uint8_t  code;   //< Character code, Latin-1 (e.g. 0xB0 for the degree sign)
+    uint8_t  width;  //< Columns
+    uint16_t offset; //< Offset in the font bitmap, height_pages * width bytes, page after page
+} mono_glyph_t;
+
+typedef struct
+{
+    uint8_t             height_pages;
+    uint8_t             spacing;  //< Columns between glyphs
+    int8_t              y_offset; //< Rows from the text top to the first bitmap row (glyphs pre-shifted in the page)
+    uint8_t             n_glyphs;
+    const mono_glyph_t *glyphs;
+    const uint8_t      *bitmap;
+} mono_font_t;
+
+typedef struct
+{
+    uint8_t data[MONO_FB_SIZE];
+    uint8_t dirty_start[MONO_FB_N_PAGES]; //< First dirty column of each page
+    uint8_t dirty_end[MONO_FB_N_PAGES];   //< Last dirty column + 1 of each page, 0 when clean
+} mono_fb_t;
+
+// Write the columns [col_start, col_end) of a page to the panel, data is the first column byte
+typedef bool (*mono_fb_write_fn_t)(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data);
+
+void    mono_fb_clear(mono_fb_t *fb);
+void    mono_fb_mark_all_dirty(mono_fb_t *fb);
+void    mono_fb_fill_rect(mono_fb_t *fb, int16_t x, int16_t y, int16_t width, int16_t height, bool is_on);
+bool    mono_fb_get_pixel(const mono_fb_t *fb, int16_t x, int16_t y);
+// Write the n_pages bytes of column x from page, only the bytes which differ are marked dirty
+void    mono_fb_write_column(mono_fb_t *fb, int16_t x, uint8_t page, uint8_t n_pages, const uint8_t *bytes);
+// Shift the pages one column to the left, the last column is cleared
+void    mono_fb_scroll_left(mono_fb_t *fb, uint8_t page, uint8_t n_pages);
+int16_t mono_fb_text_width(const mono_font_t *font, const char *text);
+// Draw the text with its top left corner at (x, y), clipped to max_width columns, returns the drawn width.
+// Glyph cells and spacing are opaque, so redrawing a field only changes the bytes which differ.
+int16_t mono_fb_draw_text(
+    mono_fb_t *fb, const mono_font_t *font, int16_t x, int16_t y, int16_t max_width, const char *text);
+// Write the dirty column ranges and mark the framebuffer clean, returns the number of pixel bytes written
+size_t  mono_fb_flush(mono_fb_t *fb, mono_fb_write_fn_t write_fn, void *ctx);
+
+#endif // MONO_FB__H__
@@ -0,0 +1,9 @@
+#ifndef MONO_FONTS__H__
+#define MONO_FONTS__H__
+
+#include "mono_fb.h"
+
+extern const mono_font_t mono_font_5x7;   //< Labels, small values and alert names
+extern const mono_font_t mono_font_10x14; //< Temperature digits, '-', '.' and space only
+
+#endif // MONO_FONTS__H__
@@ -0,0 +1,48 @@
+#ifndef MONO_UI__H__
+#define MONO_UI__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mono_fb.h"
+
+// Minimal renderer of the EEZ Studio main screen (same layout), drawn straight in the SSD1306 framebuffer
+typedef struct
+{
+    float       amb_temp_degc;
+    float       amb_humid_pct;
+    float       amb_press_kpa;
+    bool        is_amb_temp_negative;
+    bool        is_station_connected;
+    const char *alert_name; //< First active alert, NULL when none is
+} mono_ui_values_t;
+
+typedef enum
+{
+    MONO_UI_FIELD_TEMP = (1U << 0),
+    MONO_UI_FIELD_TEMP_SIGN = (1U << 1),
+    MONO_UI_FIELD_HUMID = (1U << 2),
+    MONO_UI_FIELD_PRESS = (1U << 3),
+    MONO_UI_FIELD_LED = (1U << 4),
+    MONO_UI_FIELD_ALERT = (1U << 5),
+} mono_ui_field_t;
+
+#define MONO_UI_VALUE_TEXT_SIZE 12
+
+typedef struct
+{
+    mono_fb_t fb;
+    char      temp_text[MONO_UI_VALUE_TEXT_SIZE];
+    char      humid_text[MONO_UI_VALUE_TEXT_SIZE];
+    char      press_text[MONO_UI_VALUE_TEXT_SIZE];
+    char      alert_text[MONO_UI_VALUE_TEXT_SIZE];
+    bool      is_temp_negative;
+    bool      is_led_on;
+} mono_ui_t;
+
+// Draw the static labels and mark the whole framebuffer dirty, the values are drawn by the first update
+void    mono_ui_init(mono_ui_t *ui);
+// Redraw the fields whose displayed text or state changed, returns the mono_ui_field_t mask of the redrawn fields
+uint8_t mono_ui_update(mono_ui_t *ui, const mono_ui_values_t *values);
+
+#endif // MONO_UI__H__
@@ -0,0 +1,72 @@
+#ifndef SENSE_OPTIMIZER__H__
+#define SENSE_OPTIMIZER__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: BME688 oversampling and IIR filter selection from a model of the measurement duration and of the noise.
+// The duration is the BME68x API forced mode one (bme68x_get_meas_dur): 1963 us per oversampling cycle, plus the
+// TPH switching, gas and wake up times. The RMS noise of a channel at oversampling n is sqrt(floor^2 + white^2 / n)
+// (white noise averaged by the oversampling down to the ADC resolution floor), and the IIR filter (temperature and
+// pressure only) scales it by sqrt(1 / (2c + 1)) at the price of a slower step response.
+// The codes are the BME68x API ones: oversampling BME68X_OS_1X (1) to BME68X_OS_16X (5), filter BME68X_FILTER_OFF
+// (0) to BME68X_FILTER_SIZE_127 (7).
+typedef enum
+{
+    SENSE_CH_TEMP,  //< °C
+    SENSE_CH_PRESS, //< Pa
+    SENSE_CH_HUMID, //< %RH
+    SENSE_N_CHANNELS,
+} sense_channel_t;
+
+#define SENSE_OPTIMIZER_OS_MIN             1U
+#define SENSE_OPTIMIZER_OS_MAX             5U
+#define SENSE_OPTIMIZER_FILTER_MAX         7U
+#define SENSE_OPTIMIZER_READ_OVERHEAD_US   1000U //< Wait after the measurement duration before reading the data
+#define SENSE_OPTIMIZER_IIR_RESPONSE_LEVEL 0.75f //< Step response level of the IIR response time
+
+typedef struct
+{
+    float    noise[SENSE_N_CHANNELS]; //< Target RMS noise of each channel
+    uint32_t max_meas_us;             //< Measurement duration budget
+    uint32_t loop_period_us;          //< Sampling period, 0 for back to back measurements
+    uint32_t max_response_us;         //< IIR step response time budget
+} sense_targets_t;
+
+typedef struct
+{
+    uint8_t  os_codes[SENSE_N_CHANNELS];
+    uint8_t  filter_code;
+    uint32_t meas_us;
+    uint32_t response_us;             //< IIR step response time, one sample period without filter
+    float    noise[SENSE_N_CHANNELS]; //< Model RMS noise
+    bool     is_target_met;
+} sense_config_t;
+
+// Running noise estimate from the differences of consecutive samples, the slow signal changes cancel out
+typedef struct
+{
+    float    last[SENSE_N_CHANNELS];
+    double   sum_sq_diff[SENSE_N_CHANNELS];
+    uint32_t n_diffs;
+    uint32_t n_samples;
+    int64_t  total_sample_us;
+} sense_noise_meter_t;
+
+uint32_t sense_optimizer_meas_us(const uint8_t os_codes[SENSE_N_CHANNELS]);
+float    sense_optimizer_noise(sense_channel_t channel, uint8_t os_code, uint8_t filter_code);
+uint32_t sense_optimizer_response_us(uint8_t filter_code, uint32_t sample_period_us);
+// Shortest measurement meeting the noise targets within the budgets, the lowest noise for the same duration (i.e. the
+// largest filter the response budget allows). When no configuration meets the targets, the one closest to them within
+// the budgets is returned with is_target_met false.
+bool     sense_optimizer_pick(const sense_targets_t *targets, sense_config_t *config);
+
+void     sense_noise_meter_reset(sense_noise_meter_t *meter);
+// Add a sample and the time it took (e.g. from the measurement start to the data read)
+void     sense_noise_meter_add(sense_noise_meter_t *meter, const float values[SENSE_N_CHANNELS], uint32_t sample_us);
+// RMS noise estimate of the filtered channel output, NaN before two samples
+float    sense_noise_meter_rms(const sense_noise_meter_t *meter, sense_channel_t channel, uint8_t filter_code);
+// Average time per sample, 0 before the first one
+uint32_t sense_noise_meter_sample_us(const sense_noise_meter_t *meter);
+
+#endif // SENSE_OPTIMIZER__H__
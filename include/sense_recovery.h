@@ -0,0 +1,65 @@
+#ifndef SENSE_RECOVERY__H__
+#define SENSE_RECOVERY__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// NOTE: Sensor and bus recovery state machine, the caller runs the actions and reports their result. The first action
+// is the sensor setup (RESET_SENSOR), then measurements. A failed measurement is retried at once, then the bus is reset
+// (bus clear and controller reset) and the sensor soft reset and reconfigured before measuring again. While this fails
+// the cycle is repeated after an exponential back-off capped at max_backoff_ms, so a recovered sensor is measured again
+// within max_backoff_ms plus one cycle, and the task never gives up.
+typedef enum
+{
+    SENSE_RECOVERY_MEASURE,
+    SENSE_RECOVERY_RESET_BUS,    //< Bus clear (SCL pulses) and I2C controller reset
+    SENSE_RECOVERY_RESET_SENSOR, //< Soft reset, init and configuration
+} sense_recovery_action_t;
+
+typedef enum
+{
+    SENSE_RECOVERY_EVENT_NONE,
+    SENSE_RECOVERY_EVENT_FAULT,     //< First failure after measuring fine
+    SENSE_RECOVERY_EVENT_RECOVERED, //< First measurement after a fault, the stats hold its recovery
+} sense_recovery_event_t;
+
+typedef struct
+{
+    uint8_t  max_retries;        //< Measurement retries before resetting the bus
+    uint32_t initial_backoff_ms; //< Wait before the second recovery cycle, doubled after each failed one
+    uint32_t max_backoff_ms;
+    uint32_t sample_period_us;   //< Nominal time between samples, to count the lost ones
+} sense_recovery_config_t;
+
+typedef struct
+{
+    uint32_t n_faults;
+    uint32_t n_retries;
+    uint32_t n_bus_resets;
+    uint32_t n_sensor_resets;
+    uint32_t n_samples_lost;
+    uint32_t last_recover_ms; //< Time to recover, from the first failure to the next sample
+    uint32_t max_recover_ms;
+} sense_recovery_stats_t;
+
+typedef struct
+{
+    sense_recovery_config_t config;
+    uint8_t                 action; //< sense_recovery_action_t, the next one to run
+    bool                    is_faulted;
+    uint8_t                 n_retries;
+    uint32_t                backoff_ms;
+    int64_t                 fault_start_us;
+    sense_recovery_stats_t  stats;
+} sense_recovery_t;
+
+void                    sense_recovery_init(sense_recovery_t *recovery, const sense_recovery_config_t *config);
+sense_recovery_action_t sense_recovery_action(const sense_recovery_t *recovery);
+// Result of the action returned by sense_recovery_action(), sets the next one and the time to wait before it
+// (0: at once, or the next sample period after a measurement)
+sense_recovery_event_t  sense_recovery_report(sense_recovery_t *recovery,
+                                              int64_t           now_us,
+                                              bool              is_ok,
+                                              uint32_t         *wait_ms);
+
+#endif // SENSE_RECOVERY__H__
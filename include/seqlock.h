@@ -0,0 +1,26 @@
+#ifndef SEQLOCK__H__
+#define SEQLOCK__H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// NOTE: Seqlock, the sequence is odd while a write is in progress. Readers never block: they copy the data and retry
+// when the sequence changed meanwhile. The writers are serialized by a short critical section on the device (shared by
+// every seqlock, the writes are a few dozen bytes), which also keeps a writer from being preempted by a reader of its
+// own core. The host tests write from one thread.
+typedef struct
+{
+    atomic_uint_fast32_t sequence;
+} seqlock_t;
+
+#define SEQLOCK_INIT {0}
+
+void seqlock_init(seqlock_t *lock);
+// The data may only change between the begin and the end of a write
+void seqlock_write_begin(seqlock_t *lock);
+void seqlock_write_end(seqlock_t *lock);
+// Consistent copy of size bytes of the data at src, written by a single write
+void seqlock_read(seqlock_t *lock, void *dst, const void *src, size_t size);
+
+#endif // SEQLOCK__H__
@@ -0,0 +1,88 @@
+#ifndef SSD1306_EMU__H__
+#define SSD1306_EMU__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// NOTE: Host emulator of the SSD1306 I2C protocol, fed with the I2C write transactions sent to the panel (the bytes
+// after the address byte). It decodes the control bytes (Co and D/C bits), the fundamental, addressing, hardware
+// configuration and scrolling commands, and writes the data bytes in its 128x64 GRAM with the page, horizontal or
+// vertical addressing pointer. The displayed image (display on/off, invert, entire display on, segment remap, COM
+// scan direction, start line, offset and multiplex ratio) is dumped as PBM or PNG. Scrolling is decoded but not
+// animated and the alternative COM pins configuration is not modelled.
+#define SSD1306_EMU_WIDTH   128
+#define SSD1306_EMU_HEIGHT  64
+#define SSD1306_EMU_N_PAGES (SSD1306_EMU_HEIGHT / 8)
+
+#define SSD1306_EMU_CONTROL_CONTINUATION 0x80U //< Co: one command or data byte, then another control byte
+#define SSD1306_EMU_CONTROL_DATA         0x40U //< D/C: the bytes are GRAM data, commands when clear
+
+#define SSD1306_EMU_PBM_SIZE (10U + SSD1306_EMU_WIDTH * SSD1306_EMU_HEIGHT / 8)
+#define SSD1306_EMU_PNG_SIZE 1156U
+
+typedef enum
+{
+    SSD1306_EMU_ADDRESSING_HORIZONTAL = 0,
+    SSD1306_EMU_ADDRESSING_VERTICAL = 1,
+    SSD1306_EMU_ADDRESSING_PAGE = 2, //< Reset default
+} ssd1306_emu_addressing_t;
+
+// Bus cost, accumulated until taken (e.g. once per UI frame)
+typedef struct
+{
+    uint32_t n_transfers;
+    uint32_t n_control_bytes;
+    uint32_t n_command_bytes; //< Command and command argument bytes
+    uint32_t n_data_bytes;
+    uint32_t n_unknown_commands;
+} ssd1306_emu_stats_t;
+
+typedef struct
+{
+    uint8_t gram[SSD1306_EMU_WIDTH * SSD1306_EMU_N_PAGES]; //< Page after page, one byte per column, top row in the LSB
+    uint8_t addressing;                                      //< ssd1306_emu_addressing_t
+    uint8_t col, col_start, col_end;
+    uint8_t page, page_start, page_end;
+    uint8_t contrast;
+    uint8_t multiplex;    //< Number of rows - 1
+    uint8_t start_line;   //< GRAM row shown on COM0
+    uint8_t display_offset;
+    bool    is_on;
+    bool    is_inverted;
+    bool    is_entire_on; //< 0xA5, every pixel on whatever the GRAM
+    bool    is_seg_remapped;
+    bool    is_com_reversed;
+    bool    is_scrolling;
+    uint8_t command[8]; //< Command waiting for its arguments, command[0] is the opcode
+    uint8_t n_command_bytes;
+    uint8_t n_command_args;
+
+    ssd1306_emu_stats_t stats;
+} ssd1306_emu_t;
+
+// Reset state of the controller: display off, page addressing, GRAM cleared (unspecified on the real panel)
+void     ssd1306_emu_init(ssd1306_emu_t *emu);
+// One I2C write transaction to the panel, returns false when it has no control byte
+bool     ssd1306_emu_transfer(ssd1306_emu_t *emu, const uint8_t *bytes, size_t length);
+// Pixel as displayed, (0, 0) is the top left corner with the default segment and COM mapping
+bool     ssd1306_emu_get_pixel(const ssd1306_emu_t *emu, int16_t x, int16_t y);
+// Copy the bus cost counted since the last call and restart counting
+void     ssd1306_emu_take_stats(ssd1306_emu_t *emu, ssd1306_emu_stats_t *stats);
+// I2C time of the counted transfers in us: 9 clocks per byte with the address byte, start and stop conditions
+uint32_t ssd1306_emu_bus_time_us(const ssd1306_emu_stats_t *stats, uint32_t scl_hz);
+
+// Binary PBM (P4) and 1-bit grayscale PNG (stored deflate) of the displayed image, lit pixels white like the panel.
+// Return the size, or 0 when the buffer is smaller than SSD1306_EMU_PBM_SIZE or SSD1306_EMU_PNG_SIZE.
+size_t ssd1306_emu_encode_pbm(const ssd1306_emu_t *emu, uint8_t *buffer, size_t buffer_size);
+size_t ssd1306_emu_encode_png(const ssd1306_emu_t *emu, uint8_t *buffer, size_t buffer_size);
+
+// Send the init commands and the bitmap transfers as the esp_lcd SSD1306 driver does over esp_lcd_panel_io_i2c
+// (control_phase_bytes 1, dc_bit_offset 6): a transfer per command with its parameters, a transfer for the pixels.
+void ssd1306_emu_panel_init(ssd1306_emu_t *emu);
+void ssd1306_emu_panel_draw_bitmap(
+    ssd1306_emu_t *emu, uint8_t x_start, uint8_t y_start, uint8_t x_end, uint8_t y_end, const uint8_t *data);
+// mono_fb_write_fn_t over the panel driver model, ctx is the ssd1306_emu_t
+bool ssd1306_emu_write_page(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data);
+
+#endif // SSD1306_EMU__H__
@@ -0,0 +1,117 @@
+#ifndef STATION_LINK__H__
+#define STATION_LINK__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "history_store.h" //< Packed values
+#include "meteo_frame.h"
+
+// Leaf frame layout (little endian), one ESP-NOW payload per measurement:
+// | version (1) | node id (1) | sequence (2) | leaf time ms (4) | temperature, pressure, humidity packed (3 x 2) |
+#define STATION_LINK_VERSION    1U
+#define STATION_LINK_FRAME_SIZE 14U
+#define STATION_LINK_MAX_NODES  32U //< Node ids 1..31, 0 is the coordinator itself
+#define STATION_LINK_WINDOW     64U //< Sequence numbers remembered per node for the deduplication
+
+// Batch payload (data stream DATA_STREAM_TYPE_STATION_BATCH):
+// | base timestamp us (8) | record count (1) | records |
+// Record: | node id (1) | sequence (2) | ms from the base timestamp (4, signed) | values packed (3 x 2) |
+#define STATION_LINK_BATCH_HEADER_SIZE 9U
+#define STATION_LINK_RECORD_SIZE       13U
+#define STATION_LINK_BATCH_LEN         18U //< Records per batch, the payload fits a data stream frame
+
+#define STATION_LINK_BATCH_SIZE (STATION_LINK_BATCH_HEADER_SIZE + STATION_LINK_BATCH_LEN * STATION_LINK_RECORD_SIZE)
+
+// Relative drift between two crystals the time alignment follows, above the +/-40 ppm of the ESP32-S3 ones
+#define STATION_LINK_MAX_DRIFT_PPM 100
+
+typedef struct
+{
+    uint8_t  node_id;
+    uint16_t sequence;
+    uint32_t leaf_time_ms; //< Leaf monotonic clock, wraps after 49 days
+    int16_t  values[HISTORY_N_CHANNELS];
+} station_link_sample_t;
+
+// Sample on the coordinator time base, as merged and uplinked
+typedef struct
+{
+    uint8_t  node_id;
+    uint16_t sequence;
+    int64_t  timestamp_us;
+    int16_t  values[HISTORY_N_CHANNELS];
+} station_link_record_t;
+
+typedef struct
+{
+    uint32_t n_received;   //< Accepted samples
+    uint32_t n_duplicates; //< Retransmissions whose acknowledgement was lost, already received
+    uint32_t n_lost;       //< Sequence numbers never received (yet, a late one is taken back)
+    uint32_t n_late;       //< Received after a later sequence number
+    uint32_t n_restarts;   //< Leaf reboots: sequence or clock going back
+} station_link_node_stats_t;
+
+// NOTE: Per node receive state. Deduplication keeps a bitmap of the last STATION_LINK_WINDOW sequence numbers (bit n
+// is last_sequence - n). Time alignment: the offset from the leaf clock to the coordinator one is the minimum of
+// (receive time - leaf time) over the frames, the frame with the least radio and retry delay. The minimum may only
+// grow by the drift allowance over the time since the last frame, so it follows the leaf crystal drift.
+typedef struct
+{
+    bool                      is_active;
+    uint16_t                  last_sequence;
+    uint64_t                  window;
+    int64_t                   leaf_time_us; //< Unwrapped leaf time of the last frame
+    uint32_t                  last_leaf_time_ms;
+    int64_t                   offset_us;
+    int64_t                   last_rx_us;
+    station_link_node_stats_t stats;
+} station_link_node_t;
+
+typedef struct
+{
+    station_link_node_t   nodes[STATION_LINK_MAX_NODES];
+    station_link_record_t batch[STATION_LINK_BATCH_LEN];
+    uint8_t               n_records;
+    int64_t               batch_start_us; //< Coordinator time when the first record of the batch was added
+    int64_t               max_latency_us; //< A batch is sent at the latest this long after its first record
+    uint32_t              n_batches;
+} station_link_coordinator_t;
+
+typedef struct
+{
+    uint8_t  node_id;
+    uint16_t next_sequence;
+} station_link_leaf_t;
+
+// Leaf frame of a measurement, returns STATION_LINK_FRAME_SIZE or 0 when the buffer is too small
+size_t station_link_encode_frame(station_link_leaf_t *leaf, const meteo_frame_t *frame, uint8_t *buffer, size_t size);
+bool   station_link_decode_frame(const uint8_t *data, size_t length, station_link_sample_t *sample);
+
+void station_link_init_coordinator(station_link_coordinator_t *coordinator, int64_t max_latency_us);
+// Deduplicate and align a received leaf frame, false when it is not a new sample (duplicate, malformed)
+bool station_link_receive(station_link_coordinator_t *coordinator,
+                          const uint8_t              *data,
+                          size_t                      length,
+                          int64_t                     rx_us,
+                          station_link_record_t      *record);
+// Add a record to the batch (a remote one from station_link_receive() or the coordinator own sample as node 0)
+void station_link_add(station_link_coordinator_t *coordinator, const station_link_record_t *record, int64_t now_us);
+// The batch is full or its first record waited max_latency_us
+bool station_link_batch_ready(const station_link_coordinator_t *coordinator, int64_t now_us);
+// Batch payload of the pending records, then empty, returns 0 when there is none or the buffer is too small
+size_t station_link_encode_batch(station_link_coordinator_t *coordinator, uint8_t *buffer, size_t size);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+// Leaf: sends each frame to the coordinator. Coordinator: receives the leaf frames, batches them with its own samples
+// to the data stream.
+esp_err_t station_link_init(void);
+void      station_link_push(const meteo_frame_t *frame);
+bool      station_link_get_node_stats(uint8_t node_id, station_link_node_stats_t *stats);
+void      station_link_task(void *pvParameter);
+#endif
+
+#endif // STATION_LINK__H__
@@ -0,0 +1,54 @@
+#ifndef TASK_JITTER__H__
+#define TASK_JITTER__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t n_samples;
+    int32_t  min_us;
+    int32_t  max_us;
+    float    mean_us;
+    float    m2_us2; //< Sum of squared differences from the mean (Welford)
+} task_jitter_stats_t;
+
+// NOTE: Release jitter of a periodic task. The ideal release times are first release + n * period, the latency of each
+// actual release from its ideal time is accumulated. A release or an instrumented section later than the threshold
+// means the task was kept from running by another task or an interrupt, it is counted as a preemption. A period of 0
+// is a free running task: only the releases and the sections are checked.
+typedef struct
+{
+    const char         *name;
+    uint32_t            period_us;
+    uint32_t            preempt_threshold_us;
+    bool                is_started;
+    int64_t             first_release_us;
+    uint32_t            n_periods;
+    task_jitter_stats_t release; //< Release latency from the ideal release time
+    task_jitter_stats_t sample;  //< Sample timestamp offset from the ideal release time
+    int32_t             section_min_us;
+    uint32_t            preemptions;
+} task_jitter_t;
+
+// Before task_jitter_register(), task_jitter_set_period() afterwards
+void  task_jitter_init(task_jitter_t *jitter, const char *name, uint32_t period_us, uint32_t preempt_threshold_us);
+// New period of a running task, its statistics restart (locked against the report)
+void  task_jitter_set_period(task_jitter_t *jitter, uint32_t period_us);
+void  task_jitter_on_release(task_jitter_t *jitter, int64_t now_us);
+void  task_jitter_on_sample(task_jitter_t *jitter, int64_t sample_time_us);
+void  task_jitter_on_section(task_jitter_t *jitter, int32_t duration_us);
+void  task_jitter_stats_add(task_jitter_stats_t *stats, int32_t value_us);
+float task_jitter_stats_stddev(const task_jitter_stats_t *stats);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+esp_err_t task_jitter_register(task_jitter_t *jitter);
+// Period of a task delayed by pdMS_TO_TICKS(period_ms), which truncates to whole ticks
+uint32_t  task_jitter_tick_period_us(uint32_t period_ms);
+void      task_jitter_release_now(task_jitter_t *jitter);
+void      task_jitter_log_report(void);
+#endif
+
+#endif // TASK_JITTER__H__
@@ -0,0 +1,23 @@
+#ifndef TASK_PLAN__H__
+#define TASK_PLAN__H__
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// NOTE: Core affinity and priority plan. Sensing and I2C bus scheduling (bus interrupt) run on the sensing core, the
+// UI and the networking on the other one, which is core 0 by default as the Wi-Fi tasks are pinned to it.
+#ifdef CONFIG_METEO_TASK_PINNING
+    #define TASK_PLAN_SENSING_CORE CONFIG_METEO_SENSING_CORE
+    #define TASK_PLAN_UI_CORE      (1 - CONFIG_METEO_SENSING_CORE)
+#else
+    #define TASK_PLAN_SENSING_CORE tskNO_AFFINITY
+    #define TASK_PLAN_UI_CORE      tskNO_AFFINITY
+#endif
+
+#define TASK_PLAN_SENSING_PRIORITY    CONFIG_METEO_SENSING_TASK_PRIORITY
+#define TASK_PLAN_STREAM_PRIORITY     CONFIG_METEO_STREAM_TASK_PRIORITY
+#define TASK_PLAN_UI_PRIORITY         CONFIG_METEO_UI_TASK_PRIORITY
+#define TASK_PLAN_BLINK_PRIORITY      2
+#define TASK_PLAN_BACKGROUND_PRIORITY 1 //< Deferred log, telemetry
+
+#endif // TASK_PLAN__H__
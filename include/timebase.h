@@ -0,0 +1,70 @@
+#ifndef TIMEBASE__H__
+#define TIMEBASE__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMEBASE_STEP_THRESHOLD_US     128000LL   //< Larger sync errors step the model, smaller ones are slewed
+#define TIMEBASE_SLEW_RATIO            2000       //< Slew of 1 us per 2000 us (500 ppm)
+#define TIMEBASE_MAX_DRIFT_PPB         200000     //< +-200 ppm, 5 times the crystal tolerance
+#define TIMEBASE_MIN_DRIFT_INTERVAL_US 60000000LL //< Shorter SNTP intervals only correct the phase
+#define TIMEBASE_DRIFT_GAIN            2          //< The drift moves by 1/2 of the rate error measured
+
+typedef enum
+{
+    TIMEBASE_SOURCE_NONE,
+    TIMEBASE_SOURCE_RTC, //< System clock, kept across resets by the RTC, undisciplined
+    TIMEBASE_SOURCE_SNTP,
+} timebase_source_t;
+
+typedef enum
+{
+    TIMEBASE_STEPPED, //< First sync, or an error of TIMEBASE_STEP_THRESHOLD_US or more
+    TIMEBASE_SLEWED,
+    TIMEBASE_IGNORED,  //< RTC sync once disciplined by SNTP
+    TIMEBASE_REJECTED, //< RTC time before min_utc_us: a clock never set, restarted from the epoch
+} timebase_sync_result_t;
+
+// NOTE: The samples keep the monotonic microsecond stamp of esp_timer (meteo_frame_t.timestamp_us), this model converts
+// them to UTC only when they are exported. It is a line through the last sync point (anchor) with the drift of the UTC
+// rate from the monotonic one, estimated between two SNTP syncs. A small sync error is not applied at once: the anchor
+// is the prediction, and the error is slewed in at 500 ppm from it, so the stamps stay in order across a sync. A
+// larger one (first sync, clock set from elsewhere) steps the anchor to the reference.
+typedef struct
+{
+    timebase_source_t source; //< Of the last sync accepted
+    int64_t           anchor_mono_us;
+    int64_t           anchor_utc_us;
+    int32_t           drift_ppb;
+    int64_t           slew_us;       //< Error absorbed after the anchor
+    uint32_t          n_syncs;
+    uint32_t          n_steps;
+    int64_t           last_error_us; //< Of the last sync, against the prediction
+    int64_t           min_utc_us;    //< Earliest plausible RTC time (the build date), 0: any
+    uint32_t          n_rejected;
+} timebase_t;
+
+void                   timebase_reset(timebase_t *tb);
+// UTC time of the start of the day before a __DATE__ string ("Mmm dd yyyy"), the build time in any time zone; 0 when
+// malformed
+int64_t                timebase_date_utc_us(const char *date);
+bool                   timebase_is_valid(const timebase_t *tb);
+// UTC time (us since the epoch) of a monotonic stamp, false before the first sync
+bool                   timebase_to_utc_us(const timebase_t *tb, int64_t mono_us, int64_t *utc_us);
+// Time reference read at mono_us from a source
+timebase_sync_result_t timebase_sync(timebase_t *tb, int64_t mono_us, int64_t utc_us, timebase_source_t source);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+// Sync from the RTC and refresh it periodically, before the exporters start
+esp_err_t timebase_init(void);
+// Start the SNTP client once a network interface exists, its syncs discipline the model
+esp_err_t timebase_start_sntp(void);
+// Sync from the RTC now, after the system clock was set
+void      timebase_refresh(void);
+// UTC time of a monotonic stamp, false before the first sync
+bool      timebase_utc_us(int64_t mono_us, int64_t *utc_us);
+#endif
+
+#endif // TIMEBASE__H__
@@ -0,0 +1,138 @@
+#ifndef TUNING__H__
+#define TUNING__H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+#endif
+
+#ifdef CONFIG_METEO_STREAM
+    #define TUNING_DEFAULT_SENSE_PERIOD_MS 0 //< Back to back measurements when streaming raw samples
+#else
+    #define TUNING_DEFAULT_SENSE_PERIOD_MS 250
+#endif
+#define TUNING_DEFAULT_UI_PERIOD_MS 10
+// The task periods are whole FreeRTOS ticks
+#ifdef CONFIG_FREERTOS_HZ
+    #define TUNING_TICK_MS (1000U / CONFIG_FREERTOS_HZ)
+#else
+    #define TUNING_TICK_MS 10U
+#endif
+#define TUNING_DEFAULT_I2C_HZ       400000 //< Both devices, I2C fast mode
+
+// NOTE: Performance knobs changed at runtime (console "tune" command), each one is defined once here. The values are
+// kept in NVS under their name (15 characters at most) and applied at boot. Oversampling values are 1, 2, 4, 8 or 16,
+// 0 lets sense_optimizer.h pick it for the noise targets.
+// X(name, unit, min, max, init, help)
+#define TUNING_PARAMS(X)                                                                                               \
+    X(sense_period_ms, "ms", 0, 60000, TUNING_DEFAULT_SENSE_PERIOD_MS, "Sample period, 10 ms steps, 0: back to back")  \
+    X(ui_period_ms, "ms", 10, 1000, TUNING_DEFAULT_UI_PERIOD_MS, "UI task period, 10 ms steps")                        \
+    X(sense_i2c_hz, "Hz", 10000, 1000000, TUNING_DEFAULT_I2C_HZ, "BME688 I2C clock")                                   \
+    X(lcd_i2c_hz, "Hz", 10000, 1000000, TUNING_DEFAULT_I2C_HZ, "SSD1306 I2C clock (next restart with LVGL)")           \
+    X(os_temp, "x", 0, 16, 0, "Temperature oversampling, 0: picked for the noise targets")                             \
+    X(os_press, "x", 0, 16, 0, "Pressure oversampling, 0: picked for the noise targets")                               \
+    X(os_humid, "x", 0, 16, 0, "Humidity oversampling, 0: picked for the noise targets")
+
+#define TUNING_PARAM_ID(name, unit, min, max, init, help) TUNING_##name,
+typedef enum
+{
+    TUNING_PARAMS(TUNING_PARAM_ID) TUNING_N_PARAMS
+} tuning_param_t;
+#undef TUNING_PARAM_ID
+
+typedef struct
+{
+    const char *name;
+    const char *unit;
+    uint32_t    min;
+    uint32_t    max;
+    uint32_t    init;
+    const char *help;
+} tuning_param_info_t;
+
+extern const tuning_param_info_t tuning_param_infos[TUNING_N_PARAMS];
+
+typedef struct
+{
+    uint32_t values[TUNING_N_PARAMS];
+} tuning_values_t;
+
+typedef enum
+{
+    TUNING_OK,
+    TUNING_ERR_USAGE,         //< Malformed command
+    TUNING_ERR_UNKNOWN_PARAM,
+    TUNING_ERR_INVALID_VALUE, //< Not a number, not an oversampling value or a period between two ticks
+    TUNING_ERR_OUT_OF_RANGE,
+} tuning_status_t;
+
+void            tuning_defaults(tuning_values_t *values);
+// Parameter of that name, TUNING_N_PARAMS when there is none
+tuning_param_t  tuning_find(const char *name);
+// In the parameter range, a power of two for an oversampling and a whole number of ticks for a period
+bool            tuning_is_valid(tuning_param_t param, uint32_t value);
+// Decimal value with an optional k or M multiplier (e.g. "400k"), checked by tuning_is_valid()
+tuning_status_t tuning_parse_value(tuning_param_t param, const char *text, uint32_t *value);
+// Oversampling register code (BME68X_OS_1X is 1) of an oversampling value, 0 for 0
+uint8_t         tuning_os_code(uint32_t oversampling);
+
+// "tune" console command, argv[0] is the command name:
+//   tune                 every parameter with its value and range
+//   tune <name>          one parameter
+//   tune <name> <value>  set a parameter
+//   tune defaults        every parameter back to its default
+// The reply is written to out (truncated to size), changed_mask gets bit n set when parameter n changed.
+tuning_status_t tuning_command(
+    tuning_values_t *values, int argc, char **argv, char *out, size_t size, uint32_t *changed_mask);
+
+// Counters sampled at the start and the end of a "perf" window. The I2C bus time is modelled from the bytes sent at
+// the clock of each device: 9 clocks per byte (ACK included), plus the address byte, start and stop per transfer.
+typedef struct
+{
+    int64_t  time_us;
+    uint32_t n_samples;       //< Measurements
+    uint64_t sense_busy_us;   //< Measurement start to data read, summed
+    uint32_t sense_n_transfers;
+    uint64_t sense_n_bytes;   //< Register addresses and data, both ways
+    uint32_t n_ui_ticks;
+    uint64_t ui_busy_us;      //< UI task work per tick (render and flush with the minimal renderer), summed
+    uint32_t lcd_n_transfers;
+    uint64_t lcd_n_bytes;     //< 0 with LVGL, its flushes are not counted
+    bool     is_idle_known;   //< FreeRTOS run time stats enabled
+    uint32_t idle_us[2];      //< Idle task run time per core, wraps after 71 minutes
+} tuning_perf_counters_t;
+
+typedef struct
+{
+    float sample_rate_hz;
+    float sense_loop_us;   //< Average busy time per measurement
+    float ui_loop_us;      //< Average busy time per UI tick
+    float sense_bus_pct;   //< Share of the I2C bus time used by the sensor
+    float lcd_bus_pct;     //< By the display
+    float cpu_load_pct[2]; //< NaN when not known
+} tuning_perf_t;
+
+// "perf [<seconds>]" console command, window 2 s by default, 1 to 60 s
+tuning_status_t tuning_perf_parse(int argc, char **argv, uint32_t *window_ms);
+// Bus time of the transfers at that clock
+uint64_t tuning_i2c_busy_us(uint32_t n_transfers, uint64_t n_bytes, uint32_t scl_hz);
+void     tuning_perf_compute(const tuning_perf_counters_t *start,
+                             const tuning_perf_counters_t *end,
+                             const tuning_values_t        *values,
+                             tuning_perf_t                *perf);
+// Report of the perf command, returns the snprintf length
+int      tuning_perf_format(const tuning_perf_t *perf, const tuning_values_t *values, char *out, size_t size);
+
+#ifdef ESP_PLATFORM
+    #include "esp_err.h"
+
+// Load the NVS values and apply them, before the sensing and UI tasks start
+esp_err_t tuning_init(void);
+// Register the tune and perf commands and start the console REPL
+esp_err_t tuning_console_start(void);
+#endif
+
+#endif // TUNING__H__
@@ -0,0 +1,20 @@
+#ifndef WARM_BOOT__H__
+#define WARM_BOOT__H__
+
+#include <stdbool.h>
+
+#include "meteo_frame.h"
+
+typedef enum
+{
+    WARM_BOOT_PHASE_APP_START = 0,
+    WARM_BOOT_PHASE_FIRST_FRAME,  //< First frame flushed to the display
+    WARM_BOOT_PHASE_FRESH_SAMPLE, //< First sample measured since reset
+    WARM_BOOT_PHASE_COUNT,
+} warm_boot_phase_t;
+
+bool warm_boot_restore(meteo_frame_t *frame);
+void warm_boot_save_frame(const meteo_frame_t *frame);
+void warm_boot_mark_phase(warm_boot_phase_t phase);
+
+#endif // WARM_BOOT__H__
@@ -0,0 +1,60 @@
+#ifndef WINDOW_STATS__H__
+#define WINDOW_STATS__H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WINDOW_STATS_MAX_BUCKETS 48
+
+// NOTE: Min, max and mean of a sample stream over a sliding time window, with fixed memory. The window is split in
+// n_buckets time buckets: it holds the current bucket and the n_buckets - 1 closed ones before it, so it slides by a
+// bucket at a time and covers between (n_buckets - 1) and n_buckets bucket periods. A closed bucket is reduced to its
+// min, max, sum and count. The min and max are the fronts of monotonic deques of the closed bucket extremes (each
+// bucket is pushed and popped at most once) and the mean comes from running sums, so an update is amortised O(1).
+typedef struct
+{
+    uint32_t index; //< Absolute bucket index
+    float    value;
+} window_stats_entry_t;
+
+typedef struct
+{
+    window_stats_entry_t entries[WINDOW_STATS_MAX_BUCKETS];
+    uint8_t              head;
+    uint8_t              len;
+} window_stats_deque_t;
+
+typedef struct
+{
+    int64_t  bucket_period_us;
+    uint8_t  n_buckets;
+    bool     is_started;
+    int64_t  bucket_start_us; //< Start of the current bucket
+    uint32_t bucket_index;    //< Absolute index of the current bucket, from the first sample
+    // Current bucket
+    float    bucket_min;
+    float    bucket_max;
+    double   bucket_sum;
+    uint32_t bucket_count;
+    // Closed buckets of the window, slot index % n_buckets
+    double               sums[WINDOW_STATS_MAX_BUCKETS];
+    uint32_t             counts[WINDOW_STATS_MAX_BUCKETS];
+    double               window_sum;
+    uint32_t             window_count;
+    window_stats_deque_t min_deque; //< Increasing values from the oldest bucket
+    window_stats_deque_t max_deque; //< Decreasing values from the oldest bucket
+} window_stats_t;
+
+// Window of window_us split in n_buckets buckets (2 to WINDOW_STATS_MAX_BUCKETS)
+void     window_stats_init(window_stats_t *stats, int64_t window_us, uint8_t n_buckets);
+// Add a sample, NaN values are ignored. A sample older than the current bucket is counted in it.
+void     window_stats_add(window_stats_t *stats, int64_t timestamp_us, float value);
+// Slide the window to now without a sample, e.g. to expire old buckets while the sensor is silent
+void     window_stats_advance(window_stats_t *stats, int64_t now_us);
+// Statistics of the window, NaN when it holds no sample
+float    window_stats_min(const window_stats_t *stats);
+float    window_stats_max(const window_stats_t *stats);
+float    window_stats_mean(const window_stats_t *stats);
+uint32_t window_stats_count(const window_stats_t *stats);
+
+#endif // WINDOW_STATS__H__
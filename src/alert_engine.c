@@ -0,0 +1,136 @@
+#include "alert_engine.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+#endif
+
+#ifdef CONFIG_METEO_ALERT_FROST_DECI_DEGC
+    #define ALERT_FROST_SET_DEGC (CONFIG_METEO_ALERT_FROST_DECI_DEGC / 10.0f)
+#else
+    #define ALERT_FROST_SET_DEGC 2.0f // Ground frost is likely below 2 degC in the air
+#endif
+#ifdef CONFIG_METEO_ALERT_HUMIDITY_PCT
+    #define ALERT_HUMIDITY_SET_PCT ((float)CONFIG_METEO_ALERT_HUMIDITY_PCT)
+#else
+    #define ALERT_HUMIDITY_SET_PCT 80.0f
+#endif
+#ifdef CONFIG_METEO_ALERT_PRESSURE_DROP_PA
+    #define ALERT_PRESSURE_DROP_SET_KPA (CONFIG_METEO_ALERT_PRESSURE_DROP_PA / 1000.0f)
+#else
+    #define ALERT_PRESSURE_DROP_SET_KPA 0.3f // 3 hPa in 3 h
+#endif
+
+#define ALERT_RULE_ENTRY(id, name, kind, input, set, clear, debounce_s, window_s)                                      \
+    [id] = {kind, input, set, clear, (int64_t)(debounce_s) * 1000000, (int64_t)(window_s) * 1000000},
+const alert_rule_t alert_rules[ALERT_COUNT] = {ALERT_RULES(ALERT_RULE_ENTRY)};
+#undef ALERT_RULE_ENTRY
+
+#define ALERT_NAME_ENTRY(id, name, kind, input, set, clear, debounce_s, window_s) [id] = name,
+static const char *const s_alert_names[ALERT_COUNT] = {ALERT_RULES(ALERT_NAME_ENTRY)};
+#undef ALERT_NAME_ENTRY
+
+void alert_engine_init(alert_engine_t *engine)
+{
+    memset(engine, 0, sizeof(*engine));
+}
+
+static float alert_engine_input(const meteo_frame_t *frame, uint8_t input)
+{
+    switch (input)
+    {
+    case ALERT_INPUT_TEMPERATURE_DEGC:
+        return frame->temperature_degc;
+    case ALERT_INPUT_HUMIDITY_PCT:
+        return frame->humidity_pct;
+    case ALERT_INPUT_PRESSURE_KPA:
+        return frame->pressure_pa / 1000.0f;
+    default:
+        return NAN;
+    }
+}
+
+// Drop of the value since about a window ago, NaN until the references cover the window
+static float alert_engine_drop(const alert_rule_t *rule, alert_rule_state_t *state, int64_t now_us, float value)
+{
+    int64_t ref_period_us = rule->window_us / (ALERT_DROP_N_REFS - 1);
+    if (state->n_refs > 0 && now_us - state->last_ref_us > rule->window_us)
+    {
+        state->n_refs = 0; // The references are too old after a gap, start over
+    }
+    if (state->n_refs == 0 || now_us - state->last_ref_us >= ref_period_us)
+    {
+        // The oldest reference is overwritten once the ring is full
+        uint8_t slot = (uint8_t)((state->ref_head + state->n_refs) % ALERT_DROP_N_REFS);
+        state->refs[slot] = value;
+        if (state->n_refs < ALERT_DROP_N_REFS) state->n_refs++;
+        else state->ref_head = (uint8_t)((state->ref_head + 1) % ALERT_DROP_N_REFS);
+        state->last_ref_us = now_us;
+    }
+    if (state->n_refs < ALERT_DROP_N_REFS) return NAN;
+    return state->refs[state->ref_head] - value;
+}
+
+static bool alert_engine_condition(const alert_rule_t *rule, bool is_active, float value)
+{
+    // The condition of the transition out of the current state
+    switch (rule->kind)
+    {
+    case ALERT_RULE_BELOW:
+        return is_active ? (value >= rule->clear) : (value <= rule->set);
+    case ALERT_RULE_ABOVE:
+    case ALERT_RULE_DROP:
+        return is_active ? (value <= rule->clear) : (value >= rule->set);
+    default:
+        return false;
+    }
+}
+
+uint8_t alert_engine_eval(alert_engine_t *engine, const meteo_frame_t *frame)
+{
+    uint8_t changed = 0;
+    for (uint8_t id = 0; id < ALERT_COUNT; id++)
+    {
+        const alert_rule_t *rule = &alert_rules[id];
+        alert_rule_state_t *state = &engine->rules[id];
+        bool                is_active = (engine->active_mask >> id) & 1U;
+
+        float value = alert_engine_input(frame, rule->input);
+        if (isnan(value)) continue;
+        if (rule->kind == ALERT_RULE_DROP) value = alert_engine_drop(rule, state, frame->timestamp_us, value);
+        if (isnan(value) || !alert_engine_condition(rule, is_active, value))
+        {
+            state->is_pending = false;
+            continue;
+        }
+
+        if (!state->is_pending)
+        {
+            state->is_pending = true;
+            state->pending_since_us = frame->timestamp_us;
+        }
+        if (frame->timestamp_us - state->pending_since_us >= rule->debounce_us)
+        {
+            engine->active_mask ^= (uint8_t)(1U << id);
+            state->is_pending = false;
+            changed |= (uint8_t)(1U << id);
+        }
+    }
+    return changed;
+}
+
+const char *alert_engine_name(alert_id_t id)
+{
+    return (id < ALERT_COUNT) ? s_alert_names[id] : "";
+}
+
+const char *alert_engine_first_name(uint8_t active_mask)
+{
+    for (uint8_t id = 0; id < ALERT_COUNT; id++)
+    {
+        if ((active_mask >> id) & 1U) return s_alert_names[id];
+    }
+    return NULL;
+}
@@ -1,44 +1,169 @@
 #include "ambient_sense.h"
 
+#include <string.h>
+
 #include "driver/i2c.h" //< For BME688 I2C communication port
+#include "esp_cpu.h"     //< For log call cycles measurement
 #include "esp_log.h"
 #include "esp_rom_sys.h" //< For BME688 delay_us port
+#include "esp_timer.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "bme68x.h"
 
+#include "alert_engine.h"
+#include "ble_broadcast.h"
+#include "data_stream.h"
+#include "deferred_log.h"
+#include "flash_log.h"
+#include "history_store.h"
+#include "i2c_trace.h"
 #include "lcd_variables.h"
+#include "meteo_frame.h"
+#include "modbus_server.h"
+#include "sense_optimizer.h"
+#include "sense_recovery.h"
+#include "station_link.h"
+#include "task_jitter.h"
+#include "tuning.h"
+#include "warm_boot.h"
+#include "window_stats.h"
+
+#define AMBIENT_SENSE_LOG_COST_REPORT_N    64U  // Samples between each log call cost report
+#define AMBIENT_SENSE_NOISE_REPORT_N       240U // Samples between each noise report
+#define AMBIENT_SENSE_PREEMPT_THRESHOLD_US 500U // Release or data read later than this is counted as preempted
+
+#ifdef CONFIG_METEO_STATS_HIGH_LOW_HOURS
+    #define AMBIENT_SENSE_HIGH_LOW_WINDOW_US ((int64_t)CONFIG_METEO_STATS_HIGH_LOW_HOURS * 3600 * 1000000)
+#else
+    #define AMBIENT_SENSE_HIGH_LOW_WINDOW_US (24LL * 3600 * 1000000)
+#endif
+#ifdef CONFIG_METEO_STATS_AVG_MINUTES
+    #define AMBIENT_SENSE_AVG_WINDOW_US ((int64_t)CONFIG_METEO_STATS_AVG_MINUTES * 60 * 1000000)
+#else
+    #define AMBIENT_SENSE_AVG_WINDOW_US (60LL * 60 * 1000000)
+#endif
 
-#define AMBIENT_SENSE_MEAS_LOOP_PERIOD_MS 250
+#ifdef CONFIG_METEO_SENSE_MEAS_BUDGET_US
+    #define AMBIENT_SENSE_TARGET_NOISE_TEMP_DEGC (CONFIG_METEO_SENSE_TEMP_NOISE_MDEGC / 1000.0f)
+    #define AMBIENT_SENSE_TARGET_NOISE_PRESS_PA  (CONFIG_METEO_SENSE_PRESS_NOISE_CPA / 100.0f)
+    #define AMBIENT_SENSE_TARGET_NOISE_HUMID_PCT (CONFIG_METEO_SENSE_HUMID_NOISE_MPCT / 1000.0f)
+    #define AMBIENT_SENSE_TARGET_MEAS_US         CONFIG_METEO_SENSE_MEAS_BUDGET_US
+    #define AMBIENT_SENSE_TARGET_RESPONSE_US     ((uint32_t)CONFIG_METEO_SENSE_RESPONSE_MS * 1000U)
+#else
+    #define AMBIENT_SENSE_TARGET_NOISE_TEMP_DEGC 0.005f
+    #define AMBIENT_SENSE_TARGET_NOISE_PRESS_PA  1.5f
+    #define AMBIENT_SENSE_TARGET_NOISE_HUMID_PCT 0.02f
+    #define AMBIENT_SENSE_TARGET_MEAS_US         45000U
+    #define AMBIENT_SENSE_TARGET_RESPONSE_US     5000000U
+#endif
 
-#define BME688_I2C_ADDR                   0x76
-#define BME688_I2C_SPEED_HZ               400000
+// Recovery: one retry, then bus and sensor resets every 100 ms doubling up to 30 s while the sensor does not answer
+#define AMBIENT_SENSE_RECOVERY_RETRIES            1U
+#define AMBIENT_SENSE_RECOVERY_INITIAL_BACKOFF_MS 100U
+#define AMBIENT_SENSE_RECOVERY_MAX_BACKOFF_MS     30000U
+#define AMBIENT_SENSE_I2C_TIMEOUT_MS              20 // Bounded transactions, a stuck bus fails instead of blocking
+
+#define BME688_I2C_ADDR                    0x76
 
 static const char *LOG_TAG = "ambient_sense";
 
-static const i2c_device_config_t s_bme688_i2c_dev_config = {
+static i2c_device_config_t s_bme688_i2c_dev_config = {
     .dev_addr_length = I2C_ADDR_BIT_7,
     .device_address = BME688_I2C_ADDR,
-    .scl_speed_hz = BME688_I2C_SPEED_HZ,
+    .scl_speed_hz = TUNING_DEFAULT_I2C_HZ, // Changed at runtime by ambient_sense_set_i2c_speed()
     .scl_wait_us = 0,                 // 0 == Use the default reg value
     .flags.disable_ack_check = false, // False == Enable ACK check
 };
 
+static i2c_master_bus_handle_t s_i2c_bus_handle = NULL;
 static i2c_master_dev_handle_t s_bme688_i2c_dev_handle = NULL;
 
+// Last field data registers read by the BME68x API, snooped in the I2C read port to get the raw ADC values
+static uint8_t s_bme688_field_regs[BME68X_LEN_FIELD];
+_Static_assert(BME68X_LEN_FIELD == METEO_RAW_FIELD_REGS_LEN, "meteo_raw_decode() field registers layout");
+
+static task_jitter_t s_jitter;
+
+// Sliding window statistics shown next to the current values, fixed memory and O(1) per sample
+static window_stats_t s_temp_high_low_stats;
+static window_stats_t s_temp_avg_stats;
+static window_stats_t s_humid_avg_stats;
+static window_stats_t s_press_avg_stats;
+
+static alert_engine_t s_alerts;
+
+// Noise and timing targets of the sensor configuration, changed at runtime by ambient_sense_set_targets()
+static portMUX_TYPE        s_targets_lock = portMUX_INITIALIZER_UNLOCKED;
+static sense_targets_t     s_targets = {
+    .noise = {[SENSE_CH_TEMP] = AMBIENT_SENSE_TARGET_NOISE_TEMP_DEGC,
+              [SENSE_CH_PRESS] = AMBIENT_SENSE_TARGET_NOISE_PRESS_PA,
+              [SENSE_CH_HUMID] = AMBIENT_SENSE_TARGET_NOISE_HUMID_PCT},
+    .max_meas_us = AMBIENT_SENSE_TARGET_MEAS_US,
+    .loop_period_us = TUNING_DEFAULT_SENSE_PERIOD_MS * 1000U,
+    .max_response_us = AMBIENT_SENSE_TARGET_RESPONSE_US,
+};
+static bool                s_is_targets_changed = false;
+static uint8_t             s_os_codes[SENSE_N_CHANNELS]; //< Oversampling set by the tuning, 0: picked for the targets
+static uint32_t            s_i2c_speed_hz = TUNING_DEFAULT_I2C_HZ;
+static bool                s_is_i2c_speed_changed = false;
+static sense_config_t      s_sense_config;
+static sense_noise_meter_t s_noise_meter;
+
+// Loop period of the sensing task, from the targets when they are applied
+static uint32_t s_loop_period_ms = TUNING_DEFAULT_SENSE_PERIOD_MS;
+static bool     s_is_period_changed = false;
+
+// Measurements and bus traffic since boot for the tuning perf command, published under s_targets_lock
+typedef struct
+{
+    uint32_t n_samples;
+    uint64_t busy_us;
+    uint32_t n_transfers; //< A register read is two, the register address write and the data read
+    uint64_t n_bytes;
+} ambient_sense_perf_t;
+
+static ambient_sense_perf_t s_perf;
+static ambient_sense_perf_t s_bus_perf; //< Updated by the I2C ports, sensing task only
+
+static sense_recovery_t s_recovery;
+
+// Sample log call cost in CPU cycles
+static uint32_t s_log_cost_last_cycles = 0;
+static uint32_t s_log_cost_max_cycles = 0;
+static uint64_t s_log_cost_total_cycles = 0;
+static uint32_t s_log_cost_count = 0;
+
 static void                 bme68x_delay_us(uint32_t period, void *intf_ptr);
 static BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr);
 static BME68X_INTF_RET_TYPE bme68x_i2c_write(uint8_t        reg_addr,
                                              const uint8_t *reg_data,
                                              uint32_t       length,
                                              void          *intf_ptr);
+static void                 ambient_sense_log_sample(const struct bme68x_data *data);
+static void                 ambient_sense_update_stats(const meteo_frame_t *frame);
+static void                 ambient_sense_update_alerts(const meteo_frame_t *frame);
+static int8_t               ambient_sense_apply_targets(struct bme68x_conf *conf, struct bme68x_dev *bme688_handle);
+static void                 ambient_sense_update_noise(const meteo_frame_t *frame, uint32_t sample_us);
+static int8_t               ambient_sense_setup_sensor(struct bme68x_dev *bme688_handle, struct bme68x_conf *conf);
+static bool                 ambient_sense_reset_bus(void);
+static bool                 ambient_sense_measure(struct bme68x_dev  *bme688_handle,
+                                                  struct bme68x_conf *conf,
+                                                  meteo_frame_t      *frame);
+static void                 ambient_sense_log_recovery(sense_recovery_event_t event);
+static bool                 ambient_sense_update_i2c_speed(void);
 
 esp_err_t ambient_sense_init(i2c_master_bus_handle_t i2c_bus_handle)
 {
     if (i2c_bus_handle == NULL) return ESP_FAIL;
+    s_i2c_bus_handle = i2c_bus_handle;
 
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_bme688_i2c_dev_config.scl_speed_hz = s_i2c_speed_hz; // Tuned value loaded by tuning_init()
+    s_is_i2c_speed_changed = false;
+    taskEXIT_CRITICAL(&s_targets_lock);
     esp_err_t i2c_ret = i2c_master_bus_add_device(i2c_bus_handle, &s_bme688_i2c_dev_config, &s_bme688_i2c_dev_handle);
     if (i2c_ret != ESP_OK || s_bme688_i2c_dev_handle == NULL)
     {
@@ -48,6 +173,76 @@ esp_err_t ambient_sense_init(i2c_master_bus_handle_t i2c_bus_handle)
     return ESP_OK;
 }
 
+void ambient_sense_set_targets(const sense_targets_t *targets)
+{
+    if (targets == NULL) return;
+    taskENTER_CRITICAL(&s_targets_lock);
+    uint32_t loop_period_us = s_targets.loop_period_us; // Set by ambient_sense_set_period_ms()
+    s_targets = *targets;
+    s_targets.loop_period_us = loop_period_us;
+    s_is_targets_changed = true;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_set_period_ms(uint32_t period_ms)
+{
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_targets.loop_period_us = period_ms * 1000U;
+    s_is_targets_changed = true; // The IIR filter response time depends on the period
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_set_oversampling(const uint8_t os_codes[SENSE_N_CHANNELS])
+{
+    taskENTER_CRITICAL(&s_targets_lock);
+    memcpy(s_os_codes, os_codes, sizeof(s_os_codes));
+    s_is_targets_changed = true;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_set_i2c_speed(uint32_t scl_speed_hz)
+{
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_i2c_speed_hz = scl_speed_hz;
+    s_is_i2c_speed_changed = true;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_get_perf(tuning_perf_counters_t *counters)
+{
+    if (counters == NULL) return;
+    taskENTER_CRITICAL(&s_targets_lock);
+    counters->n_samples = s_perf.n_samples;
+    counters->sense_busy_us = s_perf.busy_us;
+    counters->sense_n_transfers = s_perf.n_transfers;
+    counters->sense_n_bytes = s_perf.n_bytes;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_get_targets(sense_targets_t *targets)
+{
+    if (targets == NULL) return;
+    taskENTER_CRITICAL(&s_targets_lock);
+    *targets = s_targets;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_get_config(sense_config_t *config)
+{
+    if (config == NULL) return;
+    taskENTER_CRITICAL(&s_targets_lock);
+    *config = s_sense_config;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
+void ambient_sense_get_recovery_stats(sense_recovery_stats_t *stats)
+{
+    if (stats == NULL) return;
+    taskENTER_CRITICAL(&s_targets_lock);
+    *stats = s_recovery.stats;
+    taskEXIT_CRITICAL(&s_targets_lock);
+}
+
 void ambient_sense_task(void *pvParameter)
 {
     struct bme68x_dev bme688_handle = {
@@ -59,38 +254,103 @@ void ambient_sense_task(void *pvParameter)
         .write = bme68x_i2c_write,
         .amb_temp = 25, // Ambient temperature in degrees Celsius
     };
+    // Sensor configuration, the oversampling and filter are picked for the noise and timing targets
+    struct bme68x_conf conf = {
+        .odr = BME68X_ODR_NONE,
+    };
+    meteo_frame_t frame = {0};
 
-    int8_t ret = bme68x_init(&bme688_handle);
-    if (ret != BME68X_OK)
+    window_stats_init(&s_temp_high_low_stats, AMBIENT_SENSE_HIGH_LOW_WINDOW_US, WINDOW_STATS_MAX_BUCKETS);
+    window_stats_init(&s_temp_avg_stats, AMBIENT_SENSE_AVG_WINDOW_US, WINDOW_STATS_MAX_BUCKETS);
+    window_stats_init(&s_humid_avg_stats, AMBIENT_SENSE_AVG_WINDOW_US, WINDOW_STATS_MAX_BUCKETS);
+    window_stats_init(&s_press_avg_stats, AMBIENT_SENSE_AVG_WINDOW_US, WINDOW_STATS_MAX_BUCKETS);
+    alert_engine_init(&s_alerts);
+
+    // The sensor setup is the first recovery action, a sensor missing at boot is retried like a lost one
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_loop_period_ms = s_targets.loop_period_us / 1000U; // Tuned before the task start
+    taskEXIT_CRITICAL(&s_targets_lock);
+    const sense_recovery_config_t recovery_config = {
+        .max_retries = AMBIENT_SENSE_RECOVERY_RETRIES,
+        .initial_backoff_ms = AMBIENT_SENSE_RECOVERY_INITIAL_BACKOFF_MS,
+        .max_backoff_ms = AMBIENT_SENSE_RECOVERY_MAX_BACKOFF_MS,
+        .sample_period_us = s_loop_period_ms * 1000U,
+    };
+    sense_recovery_init(&s_recovery, &recovery_config);
+
+    task_jitter_init(
+        &s_jitter, "ambient_sense", task_jitter_tick_period_us(s_loop_period_ms), AMBIENT_SENSE_PREEMPT_THRESHOLD_US);
+    task_jitter_register(&s_jitter);
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (1)
     {
-        ESP_LOGE(LOG_TAG, "BME68x initialization failed");
-        return;
+        sense_recovery_action_t action = sense_recovery_action(&s_recovery);
+        bool                    is_ok;
+        switch (action)
+        {
+        case SENSE_RECOVERY_RESET_BUS:
+            is_ok = ambient_sense_reset_bus();
+            break;
+        case SENSE_RECOVERY_RESET_SENSOR:
+            is_ok = ambient_sense_setup_sensor(&bme688_handle, &conf) == BME68X_OK;
+            break;
+        default:
+            is_ok = ambient_sense_measure(&bme688_handle, &conf, &frame);
+            break;
+        }
+
+        uint32_t               wait_ms;
+        int64_t                now_us = esp_timer_get_time();
+        taskENTER_CRITICAL(&s_targets_lock);
+        sense_recovery_event_t event = sense_recovery_report(&s_recovery, now_us, is_ok, &wait_ms);
+        bool                   is_faulted = s_recovery.is_faulted;
+        taskEXIT_CRITICAL(&s_targets_lock);
+        if (event != SENSE_RECOVERY_EVENT_NONE) ambient_sense_log_recovery(event);
+#ifdef CONFIG_METEO_MODBUS
+        if (!is_ok || event != SENSE_RECOVERY_EVENT_NONE) modbus_server_push_health(is_faulted);
+#else
+        (void)is_faulted;
+#endif
+        if (event == SENSE_RECOVERY_EVENT_RECOVERED) last_wake_time = xTaskGetTickCount(); // No catch up burst
+        if (wait_ms > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(wait_ms)); // Back-off
+            continue;
+        }
+        if (action != SENSE_RECOVERY_MEASURE || !is_ok) continue; // Recovery steps and retries run at once
+
+        // Wait for the next period, fixed rate releases
+        if (s_is_period_changed)
+        {
+            s_is_period_changed = false;
+            last_wake_time = xTaskGetTickCount(); // Releases from now on, no catch up burst
+        }
+        if (s_loop_period_ms > 0)
+        {
+            xTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(s_loop_period_ms));
+        }
+        else
+        {
+            taskYIELD();
+        }
     }
-    else
+}
+
+// Soft reset (bme68x_init() starts with one), then the measurement and heater configuration
+static int8_t ambient_sense_setup_sensor(struct bme68x_dev *bme688_handle, struct bme68x_conf *conf)
+{
+    int8_t ret = bme68x_init(bme688_handle);
+    if (ret != BME68X_OK)
     {
-        ESP_LOGI(LOG_TAG, "BME68x initialization succeeded");
+        ESP_LOGE(LOG_TAG, "BME68x initialization failed");
+        return ret;
     }
 
-    struct bme68x_data data;
-    uint8_t            n_fields;
-
-    // Set sensor configuration
-    struct bme68x_conf conf = {
-        .os_hum = BME68X_OS_16X,
-        .os_pres = BME68X_OS_1X,
-        .os_temp = BME68X_OS_2X,
-        .filter = BME68X_FILTER_OFF,
-        .odr = BME68X_ODR_NONE,
-    };
-    ret = bme68x_set_conf(&conf, &bme688_handle);
+    ret = ambient_sense_apply_targets(conf, bme688_handle);
     if (ret != BME68X_OK)
     {
         ESP_LOGE(LOG_TAG, "BME68x configuration failed");
-        return;
-    }
-    else
-    {
-        ESP_LOGI(LOG_TAG, "BME68x configuration succeeded");
+        return ret;
     }
 
     // Set heater configuration
@@ -99,62 +359,329 @@ void ambient_sense_task(void *pvParameter)
         .heatr_temp = 320, // Target temperature in degree Celsius
         .heatr_dur = 150,  // Duration in milliseconds
     };
-    ret = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &bme688_handle);
+    ret = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, bme688_handle);
     if (ret != BME68X_OK)
     {
         ESP_LOGE(LOG_TAG, "BME68x heater configuration failed");
-        return;
+        return ret;
     }
-    else
+    ESP_LOGI(LOG_TAG, "BME68x setup succeeded");
+    return BME68X_OK;
+}
+
+// Bus clear and controller reset, e.g. after a device held SDA low through a reset in the middle of a read
+static bool ambient_sense_reset_bus(void)
+{
+    // i2c_master_bus_reset() pulses SCL until SDA is released, then resets the controller state machine
+    esp_err_t i2c_ret = i2c_master_bus_reset(s_i2c_bus_handle);
+    if (i2c_ret != ESP_OK) ESP_LOGE(LOG_TAG, "I2C bus reset failed: %s", esp_err_to_name(i2c_ret));
+    return i2c_ret == ESP_OK;
+}
+
+// One forced measurement, published on success
+static bool ambient_sense_measure(struct bme68x_dev *bme688_handle, struct bme68x_conf *conf, meteo_frame_t *frame)
+{
+    task_jitter_release_now(&s_jitter);
+
+    // New I2C clock or targets, changed between two measurements (the sensor is asleep)
+    if (s_is_i2c_speed_changed && !ambient_sense_update_i2c_speed()) return false;
+    if (s_is_targets_changed && ambient_sense_apply_targets(conf, bme688_handle) != BME68X_OK)
     {
-        ESP_LOGI(LOG_TAG, "BME68x heater configuration succeeded");
+        ESP_LOGE(LOG_TAG, "BME68x configuration failed");
+        return false;
     }
 
-    while (1)
+    // Set sensor to forced mode
+    int64_t meas_start_us = esp_timer_get_time();
+    int8_t  ret = bme68x_set_op_mode(BME68X_FORCED_MODE, bme688_handle);
+    if (ret != BME68X_OK)
     {
-        // Set sensor to forced mode
-        ret = bme68x_set_op_mode(BME68X_FORCED_MODE, &bme688_handle);
-        if (ret != BME68X_OK)
-        {
-            ESP_LOGE(LOG_TAG, "BME68x setting operation mode failed");
-            return;
-        }
+        ESP_LOGE(LOG_TAG, "BME68x setting operation mode failed");
+        return false;
+    }
 
-        // Wait for the measurement to complete
-        vTaskDelay(pdMS_TO_TICKS(1 + (bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &bme688_handle) / 1000)));
+    // Wait for the measurement to complete
+    vTaskDelay(pdMS_TO_TICKS(1 + (bme68x_get_meas_dur(BME68X_FORCED_MODE, conf, bme688_handle) / 1000)));
 
-        // Get sensor data
-        ret = bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, &bme688_handle);
-        if (ret == BME68X_OK && n_fields > 0)
-        {
-            ESP_LOGI(LOG_TAG,
-                     "Temperature: %.1f°C, Pressure: %.1fhPa, Humidity: %.1f%%, Gas Resistance: %.2fMOhms.",
-                     data.temperature,
-                     data.pressure / 100.0,
-                     data.humidity,
-                     data.gas_resistance / 1e6);
-            bool is_temperature_negative = (data.temperature < 0.0f);
-            set_var_amb_temp_degc(data.temperature);
-            set_var_is_amb_temp_negative(is_temperature_negative);
-            set_var_amb_humid_pct(data.humidity);
-            set_var_amb_press_kpa(data.pressure / 1000.0);
-        }
-        else
-        {
-            ESP_LOGE(LOG_TAG, "Failed to get sensor data");
-            return;
-        }
+    // Get sensor data, the sample timestamp jitter comes from this read being delayed or preempted
+    struct bme68x_data data;
+    uint8_t            n_fields;
+    int64_t            read_start_us = esp_timer_get_time();
+    ret = bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, bme688_handle);
+    int64_t read_end_us = esp_timer_get_time();
+    task_jitter_on_section(&s_jitter, (int32_t)(read_end_us - read_start_us));
+    if (ret != BME68X_OK || n_fields == 0)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to get sensor data");
+        return false;
+    }
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_perf.n_samples++;
+    s_perf.busy_us += (uint64_t)(read_end_us - meas_start_us);
+    s_perf.n_transfers = s_bus_perf.n_transfers;
+    s_perf.n_bytes = s_bus_perf.n_bytes;
+    taskEXIT_CRITICAL(&s_targets_lock);
+
+    meteo_frame_set_sample(
+        frame, read_end_us, data.temperature, data.pressure, data.humidity, data.gas_resistance, s_bme688_field_regs);
+    task_jitter_on_sample(&s_jitter, frame->timestamp_us);
+#ifdef CONFIG_METEO_STREAM
+    data_stream_push(frame);
+#else
+    ambient_sense_log_sample(&data);
+#endif
+#ifdef CONFIG_METEO_BLE_BROADCAST
+    ble_broadcast_push(frame);
+#endif
+#ifdef CONFIG_METEO_HISTORY
+    history_push(frame);
+#endif
+#ifdef CONFIG_METEO_FLASH_LOG
+    flash_log_push(frame);
+#endif
+#ifdef CONFIG_METEO_STATION_LINK
+    station_link_push(frame);
+#endif
+    lcd_variables_set_frame(frame);
+    ambient_sense_update_stats(frame);
+    ambient_sense_update_alerts(frame);
+#ifdef CONFIG_METEO_MODBUS
+    modbus_server_push(frame); // After the statistics and alerts of the frame
+#endif
+    ambient_sense_update_noise(frame, (uint32_t)(read_end_us - meas_start_us));
+    warm_boot_save_frame(frame);
+    warm_boot_mark_phase(WARM_BOOT_PHASE_FRESH_SAMPLE);
+    return true;
+}
+
+// The device is added again to the bus with the new clock
+static bool ambient_sense_update_i2c_speed(void)
+{
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_bme688_i2c_dev_config.scl_speed_hz = s_i2c_speed_hz;
+    s_is_i2c_speed_changed = false;
+    taskEXIT_CRITICAL(&s_targets_lock);
+
+    esp_err_t i2c_ret = i2c_master_bus_rm_device(s_bme688_i2c_dev_handle);
+    if (i2c_ret == ESP_OK)
+    {
+        i2c_ret = i2c_master_bus_add_device(s_i2c_bus_handle, &s_bme688_i2c_dev_config, &s_bme688_i2c_dev_handle);
+    }
+    if (i2c_ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "BME688 I2C clock change failed: %s", esp_err_to_name(i2c_ret));
+        s_is_i2c_speed_changed = true; // Retried before the next measurement
+        return false;
+    }
+    ESP_LOGI(LOG_TAG, "BME688 I2C clock %lu Hz", (unsigned long)s_bme688_i2c_dev_config.scl_speed_hz);
+    return true;
+}
+
+// Faults and recoveries are rare, logged at once
+static void ambient_sense_log_recovery(sense_recovery_event_t event)
+{
+    const sense_recovery_stats_t *stats = &s_recovery.stats;
+    if (event == SENSE_RECOVERY_EVENT_FAULT)
+    {
+        ESP_LOGW(LOG_TAG, "Sensor fault %lu, recovering", (unsigned long)stats->n_faults);
+        return;
+    }
+    ESP_LOGW(LOG_TAG,
+             "Sensor recovered in %lu ms (max %lu ms), %lu samples lost, %lu bus resets, %lu sensor resets so far",
+             (unsigned long)stats->last_recover_ms,
+             (unsigned long)stats->max_recover_ms,
+             (unsigned long)stats->n_samples_lost,
+             (unsigned long)stats->n_bus_resets,
+             (unsigned long)stats->n_sensor_resets);
+}
+
+// Log the sample and measure the log call cost, either deferred (binary record) or synchronous (UART printf)
+static void ambient_sense_log_sample(const struct bme68x_data *data)
+{
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+#ifdef CONFIG_METEO_DEFERRED_LOG
+    DLOG(DLOG_FMT_AMBIENT_SAMPLE,
+         DLOG_ARG_F(data->temperature),
+         DLOG_ARG_F(data->pressure / 100.0f),
+         DLOG_ARG_F(data->humidity),
+         DLOG_ARG_F(data->gas_resistance / 1e6f));
+#else
+    ESP_LOGI(LOG_TAG,
+             "Temperature: %.1f°C, Pressure: %.1fhPa, Humidity: %.1f%%, Gas Resistance: %.2fMOhms.",
+             data->temperature,
+             data->pressure / 100.0,
+             data->humidity,
+             data->gas_resistance / 1e6);
+#endif
+    s_log_cost_last_cycles = esp_cpu_get_cycle_count() - start_cycles;
+
+    if (s_log_cost_last_cycles > s_log_cost_max_cycles) s_log_cost_max_cycles = s_log_cost_last_cycles;
+    s_log_cost_total_cycles += s_log_cost_last_cycles;
+    s_log_cost_count++;
+    if (s_log_cost_count >= AMBIENT_SENSE_LOG_COST_REPORT_N)
+    {
+        uint32_t avg_cycles = (uint32_t)(s_log_cost_total_cycles / s_log_cost_count);
+#ifdef CONFIG_METEO_DEFERRED_LOG
+        DLOG(DLOG_FMT_AMBIENT_LOG_COST,
+             DLOG_ARG_U(s_log_cost_last_cycles),
+             DLOG_ARG_U(s_log_cost_max_cycles),
+             DLOG_ARG_U(avg_cycles));
+#else
+        ESP_LOGI(LOG_TAG,
+                 "Sample log call cost: last %lu, max %lu, avg %lu cycles",
+                 (unsigned long)s_log_cost_last_cycles,
+                 (unsigned long)s_log_cost_max_cycles,
+                 (unsigned long)avg_cycles);
+#endif
+        s_log_cost_max_cycles = 0;
+        s_log_cost_total_cycles = 0;
+        s_log_cost_count = 0;
+    }
+}
+
+// Add the sample to the sliding windows and publish their statistics to the UI
+static void ambient_sense_update_stats(const meteo_frame_t *frame)
+{
+    window_stats_add(&s_temp_high_low_stats, frame->timestamp_us, frame->temperature_degc);
+    window_stats_add(&s_temp_avg_stats, frame->timestamp_us, frame->temperature_degc);
+    window_stats_add(&s_humid_avg_stats, frame->timestamp_us, frame->humidity_pct);
+    window_stats_add(&s_press_avg_stats, frame->timestamp_us, frame->pressure_pa / 1000.0f);
+
+    set_var_amb_temp_high_degc(window_stats_max(&s_temp_high_low_stats));
+    set_var_amb_temp_low_degc(window_stats_min(&s_temp_high_low_stats));
+    set_var_amb_temp_avg_degc(window_stats_mean(&s_temp_avg_stats));
+    set_var_amb_humid_avg_pct(window_stats_mean(&s_humid_avg_stats));
+    set_var_amb_press_avg_kpa(window_stats_mean(&s_press_avg_stats));
+}
+
+// Evaluate the alert rules on the sample, publish and report the changes only
+static void ambient_sense_update_alerts(const meteo_frame_t *frame)
+{
+    uint8_t changed = alert_engine_eval(&s_alerts, frame);
+    if (changed == 0) return;
+
+    set_var_active_alerts(s_alerts.active_mask);
+#ifdef CONFIG_METEO_STREAM
+    data_stream_push_alert(frame, s_alerts.active_mask, changed);
+#elif defined(CONFIG_METEO_DEFERRED_LOG)
+    DLOG(DLOG_FMT_ALERTS,
+         DLOG_ARG_U(s_alerts.active_mask),
+         DLOG_ARG_U(changed),
+         DLOG_ARG_F(frame->temperature_degc),
+         DLOG_ARG_F(frame->pressure_pa / 1000.0f));
+#else
+    ESP_LOGW(LOG_TAG,
+             "Alerts active 0x%x (changed 0x%x), Temperature: %.1f°C, Pressure: %.2fkPa",
+             s_alerts.active_mask,
+             changed,
+             frame->temperature_degc,
+             frame->pressure_pa / 1000.0);
+#endif
+}
+
+// Pick the oversampling and IIR filter for the current targets and configure the sensor
+static int8_t ambient_sense_apply_targets(struct bme68x_conf *conf, struct bme68x_dev *bme688_handle)
+{
+    sense_targets_t targets;
+    sense_config_t  config;
+    uint8_t         os_codes[SENSE_N_CHANNELS];
+    taskENTER_CRITICAL(&s_targets_lock);
+    targets = s_targets;
+    memcpy(os_codes, s_os_codes, sizeof(os_codes));
+    s_is_targets_changed = false;
+    taskEXIT_CRITICAL(&s_targets_lock);
 
-        // Wait for before the next read
-        vTaskDelay(pdMS_TO_TICKS(AMBIENT_SENSE_MEAS_LOOP_PERIOD_MS));
+    bool is_target_met = sense_optimizer_pick(&targets, &config);
+    bool is_os_fixed = false;
+    for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++)
+    {
+        if (os_codes[ch] == 0) continue;
+        config.os_codes[ch] = os_codes[ch];
+        config.noise[ch] = sense_optimizer_noise((sense_channel_t)ch, os_codes[ch], config.filter_code);
+        is_os_fixed = true;
+    }
+    if (is_os_fixed) config.meas_us = sense_optimizer_meas_us(config.os_codes);
+    conf->os_temp = config.os_codes[SENSE_CH_TEMP];
+    conf->os_pres = config.os_codes[SENSE_CH_PRESS];
+    conf->os_hum = config.os_codes[SENSE_CH_HUMID];
+    conf->filter = config.filter_code;
+    int8_t ret = bme68x_set_conf(conf, bme688_handle);
+    if (ret != BME68X_OK) return ret;
+
+    uint32_t period_ms = targets.loop_period_us / 1000U;
+    if (period_ms != s_loop_period_ms)
+    {
+        s_loop_period_ms = period_ms;
+        s_is_period_changed = true;
+        task_jitter_set_period(&s_jitter, task_jitter_tick_period_us(period_ms));
+        ESP_LOGI(LOG_TAG, "Loop period %lu ms", (unsigned long)period_ms);
     }
+    taskENTER_CRITICAL(&s_targets_lock);
+    s_recovery.config.sample_period_us = (period_ms > 0) ? period_ms * 1000U
+                                                         : config.meas_us + SENSE_OPTIMIZER_READ_OVERHEAD_US;
+    s_sense_config = config;
+    taskEXIT_CRITICAL(&s_targets_lock);
+    sense_noise_meter_reset(&s_noise_meter);
+    ESP_LOGI(LOG_TAG,
+             "Oversampling T x%u, P x%u, H x%u, IIR filter %u: %lu us/measurement, response %lu ms",
+             1U << (conf->os_temp - 1U),
+             1U << (conf->os_pres - 1U),
+             1U << (conf->os_hum - 1U),
+             (1U << conf->filter) - 1U,
+             (unsigned long)config.meas_us,
+             (unsigned long)(config.response_us / 1000U));
+    const char *note = is_target_met ? "" : ", targets not met within the budgets";
+    ESP_LOGI(LOG_TAG,
+             "Model noise T %.4f°C, P %.2fPa, H %.3f%%%s",
+             config.noise[SENSE_CH_TEMP],
+             config.noise[SENSE_CH_PRESS],
+             config.noise[SENSE_CH_HUMID],
+             is_os_fixed ? ", oversampling set by the tuning" : note);
+    return BME68X_OK;
+}
+
+// Estimate the achieved noise and time per sample, reported against the model ones every AMBIENT_SENSE_NOISE_REPORT_N
+static void ambient_sense_update_noise(const meteo_frame_t *frame, uint32_t sample_us)
+{
+    const float values[SENSE_N_CHANNELS] = {frame->temperature_degc, frame->pressure_pa, frame->humidity_pct};
+    sense_noise_meter_add(&s_noise_meter, values, sample_us);
+    if (s_noise_meter.n_samples < AMBIENT_SENSE_NOISE_REPORT_N) return;
+
+    uint8_t  filter_code = s_sense_config.filter_code;
+    float    temp_noise = sense_noise_meter_rms(&s_noise_meter, SENSE_CH_TEMP, filter_code);
+    float    press_noise = sense_noise_meter_rms(&s_noise_meter, SENSE_CH_PRESS, filter_code);
+    float    humid_noise = sense_noise_meter_rms(&s_noise_meter, SENSE_CH_HUMID, filter_code);
+    uint32_t avg_sample_us = sense_noise_meter_sample_us(&s_noise_meter);
+#ifdef CONFIG_METEO_DEFERRED_LOG
+    DLOG(DLOG_FMT_SENSE_NOISE,
+         DLOG_ARG_F(temp_noise),
+         DLOG_ARG_F(press_noise),
+         DLOG_ARG_F(humid_noise),
+         DLOG_ARG_U(avg_sample_us));
+#else
+    ESP_LOGI(LOG_TAG,
+             "Noise T %.4f°C, P %.2fPa, H %.3f%% measured at %lu us/sample",
+             temp_noise,
+             press_noise,
+             humid_noise,
+             (unsigned long)avg_sample_us);
+#endif
+    sense_noise_meter_reset(&s_noise_meter);
 }
 
 // BME688 microseconds delay function implementation
 static void bme68x_delay_us(uint32_t period, void *intf_ptr)
 {
-    // Use esp_rom_delay_us to delay for the specified period
-    esp_rom_delay_us(period);
+    // Block the task for the long delays (e.g. soft reset) so the display init can run meanwhile, busy wait for the
+    // short ones or the remainder of a tick. The first tick of a delay is partial, one more is waited so that the
+    // sensor never gets less than the requested delay.
+    const uint32_t tick_period_us = portTICK_PERIOD_MS * 1000U;
+    if (period >= tick_period_us)
+    {
+        vTaskDelay(period / tick_period_us + 1);
+        period %= tick_period_us;
+    }
+    if (period > 0) esp_rom_delay_us(period);
 }
 
 // BME688 I2C read function implementation
@@ -163,9 +690,17 @@ static BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr, uint8_t *reg_data,
     // Cast the interface pointer to the I2C device handle
     i2c_master_dev_handle_t bme688_i2c_dev_handle = *(i2c_master_dev_handle_t *)intf_ptr;
 
-    const int32_t i2c_write_timeout_ms = -1; // -1 == Wait forever
-    esp_err_t     i2c_ret
-        = i2c_master_transmit_receive(bme688_i2c_dev_handle, &reg_addr, 1, reg_data, length, i2c_write_timeout_ms);
+    esp_err_t i2c_ret = i2c_master_transmit_receive(
+        bme688_i2c_dev_handle, &reg_addr, 1, reg_data, length, AMBIENT_SENSE_I2C_TIMEOUT_MS);
+    s_bus_perf.n_transfers += 2;
+    s_bus_perf.n_bytes += 1U + length;
+    I2C_TRACE_CAPTURE(I2C_TRACE_WRITE_READ, BME688_I2C_ADDR, &reg_addr, 1, reg_data, length, i2c_ret == ESP_OK);
+
+    // Keep a copy of the field data registers for the raw ADC values
+    if (i2c_ret == ESP_OK && reg_addr == BME68X_REG_FIELD0 && length >= BME68X_LEN_FIELD)
+    {
+        memcpy(s_bme688_field_regs, reg_data, BME68X_LEN_FIELD);
+    }
 
     // Return success or failure
     return (i2c_ret == ESP_OK) ? BME68X_OK : BME68X_E_COM_FAIL;
@@ -191,9 +726,19 @@ static BME68X_INTF_RET_TYPE bme68x_i2c_write(uint8_t reg_addr, const uint8_t *re
     // TODO: Update to use i2c_master_register_event_callbacks and be asynchronous
 
     // Perform the I2C multi-buffer transmit
-    const int32_t i2c_write_timeout_ms = -1; // -1 == Wait forever
-    esp_err_t     i2c_ret
-        = i2c_master_multi_buffer_transmit(bme688_i2c_dev_handle, write_buffers_array, 2, i2c_write_timeout_ms);
+    esp_err_t i2c_ret = i2c_master_multi_buffer_transmit(
+        bme688_i2c_dev_handle, write_buffers_array, 2, AMBIENT_SENSE_I2C_TIMEOUT_MS);
+    s_bus_perf.n_transfers++;
+    s_bus_perf.n_bytes += 1U + length;
+#ifdef CONFIG_METEO_I2C_TRACE
+    // Same bytes as on the bus, the register address then the data. The whole length is given, a write longer than
+    // the trace data is recorded truncated and flagged so.
+    uint8_t trace_data[I2C_TRACE_MAX_DATA];
+    size_t  trace_length = (length < sizeof(trace_data)) ? length : sizeof(trace_data) - 1;
+    trace_data[0] = reg_addr;
+    memcpy(&trace_data[1], reg_data, trace_length);
+    I2C_TRACE_CAPTURE(I2C_TRACE_WRITE, BME688_I2C_ADDR, trace_data, length + 1, NULL, 0, i2c_ret == ESP_OK);
+#endif
 
     // Return success or failure
     return (i2c_ret == ESP_OK) ? BME68X_OK : BME68X_E_COM_FAIL;
@@ -0,0 +1,388 @@
+#include "ble_broadcast.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "esp_log.h"
+    #include "host/ble_hs.h"
+    #include "mbedtls/ccm.h"
+    #include "nimble/nimble_port.h"
+    #include "nimble/nimble_port_freertos.h"
+    #include "nvs.h"
+#endif
+
+#define BLE_BROADCAST_AD_TYPE_FLAGS        0x01
+#define BLE_BROADCAST_AD_TYPE_SERVICE_DATA 0x16
+#define BLE_BROADCAST_AD_FLAGS             0x06 //< LE general discoverable, BR/EDR not supported
+#define BLE_BROADCAST_PDU_OVERHEAD_SIZE    16U  //< Preamble (1), access address (4), header (2), AdvA (6), CRC (3)
+
+_Static_assert(BLE_BROADCAST_ADV_SIZE_ENCRYPT <= BLE_BROADCAST_ADV_MAX_SIZE, "Must fit in a legacy advertising PDU");
+
+void ble_broadcast_init_state(ble_broadcast_state_t *state, const ble_broadcast_thresholds_t *thresholds)
+{
+    memset(state, 0, sizeof(*state));
+    state->thresholds = *thresholds;
+}
+
+static bool ble_broadcast_is_moved(float value, float sent, float threshold)
+{
+    if (isnan(value) != isnan(sent)) return true;
+    return fabsf(value - sent) > threshold;
+}
+
+bool ble_broadcast_update(ble_broadcast_state_t *state, const meteo_frame_t *frame)
+{
+    state->n_frames++;
+    const ble_broadcast_thresholds_t *thresholds = &state->thresholds;
+    bool is_update = !state->is_sent
+                  || ble_broadcast_is_moved(frame->temperature_degc, state->temp_degc, thresholds->temp_degc)
+                  || ble_broadcast_is_moved(frame->humidity_pct, state->humid_pct, thresholds->humid_pct)
+                  || ble_broadcast_is_moved(frame->pressure_pa, state->press_pa, thresholds->press_pa)
+                  || frame->timestamp_us - state->sent_us >= (int64_t)thresholds->max_interval_ms * 1000;
+    if (!is_update) return false;
+
+    if (state->is_sent) state->packet_id++;
+    state->is_sent = true;
+    state->temp_degc = frame->temperature_degc;
+    state->humid_pct = frame->humidity_pct;
+    state->press_pa = frame->pressure_pa;
+    state->sent_us = frame->timestamp_us;
+    state->n_updates++;
+    return true;
+}
+
+// Rounded to the resolution and clamped to the range, NaN as 0
+static int32_t ble_broadcast_quantize(float value, float scale, int32_t min, int32_t max)
+{
+    if (isnan(value)) return 0;
+    float scaled = roundf(value * scale);
+    if (scaled < (float)min) return min;
+    if (scaled > (float)max) return max;
+    return (int32_t)scaled;
+}
+
+static uint8_t *put_le(uint8_t *dst, uint32_t value, uint8_t n_bytes)
+{
+    for (uint8_t i = 0; i < n_bytes; i++) *dst++ = (uint8_t)(value >> (8U * i));
+    return dst;
+}
+
+size_t ble_broadcast_encode(const meteo_frame_t          *frame,
+                            uint8_t                       packet_id,
+                            const ble_broadcast_crypto_t *crypto,
+                            uint8_t                      *buffer,
+                            size_t                        buffer_size)
+{
+    bool   is_encrypted = crypto != NULL && crypto->key != NULL;
+    size_t adv_size = is_encrypted ? BLE_BROADCAST_ADV_SIZE_ENCRYPT : BLE_BROADCAST_ADV_SIZE;
+    if (frame == NULL || buffer == NULL || buffer_size < adv_size) return 0;
+    if (is_encrypted && (crypto->mac == NULL || crypto->ccm == NULL)) return 0;
+
+    uint8_t *dst = buffer;
+    dst = put_le(dst, 2, 1);
+    dst = put_le(dst, BLE_BROADCAST_AD_TYPE_FLAGS, 1);
+    dst = put_le(dst, BLE_BROADCAST_AD_FLAGS, 1);
+
+    uint8_t device_info = BTHOME_DEVICE_INFO | (is_encrypted ? BTHOME_DEVICE_INFO_ENCRYPTED : 0);
+    dst = put_le(dst, (uint32_t)(adv_size - 3U - 1U), 1); // Service data AD length, without the flags AD and itself
+    dst = put_le(dst, BLE_BROADCAST_AD_TYPE_SERVICE_DATA, 1);
+    dst = put_le(dst, BTHOME_UUID, 2);
+    dst = put_le(dst, device_info, 1);
+
+    uint8_t *objects = dst;
+    dst = put_le(dst, BTHOME_ID_PACKET_ID, 1);
+    dst = put_le(dst, packet_id, 1);
+    dst = put_le(dst, BTHOME_ID_TEMPERATURE, 1);
+    dst = put_le(dst, (uint32_t)ble_broadcast_quantize(frame->temperature_degc, 100.0f, INT16_MIN, INT16_MAX), 2);
+    dst = put_le(dst, BTHOME_ID_HUMIDITY, 1);
+    dst = put_le(dst, (uint32_t)ble_broadcast_quantize(frame->humidity_pct, 100.0f, 0, UINT16_MAX), 2);
+    dst = put_le(dst, BTHOME_ID_PRESSURE, 1);
+    dst = put_le(dst, (uint32_t)ble_broadcast_quantize(frame->pressure_pa, 1.0f, 0, 0xFFFFFF), 3); // 0.01 hPa == 1 Pa
+    if (!is_encrypted) return (size_t)(dst - buffer);
+
+    // Nonce: MAC (as shown), UUID (LE), device info, counter (LE)
+    uint8_t nonce[BLE_BROADCAST_NONCE_SIZE];
+    memcpy(nonce, crypto->mac, 6);
+    put_le(&nonce[6], BTHOME_UUID, 2);
+    nonce[8] = device_info;
+    put_le(&nonce[9], crypto->counter, 4);
+    uint8_t mic[BLE_BROADCAST_MIC_SIZE];
+    if (!crypto->ccm(crypto->key, nonce, objects, BLE_BROADCAST_OBJECTS_SIZE, objects, mic)) return 0;
+    dst = put_le(dst, crypto->counter, 4);
+    memcpy(dst, mic, sizeof(mic));
+    dst += sizeof(mic);
+    return (size_t)(dst - buffer);
+}
+
+bool ble_broadcast_next_counter(uint32_t *counter, uint32_t *reserved_end)
+{
+    (*counter)++;
+    if (*counter <= *reserved_end) return false;
+    *reserved_end = *counter + BLE_BROADCAST_COUNTER_BLOCK - 1U;
+    return true;
+}
+
+uint32_t ble_broadcast_air_time_us(size_t adv_size)
+{
+    return (uint32_t)(BLE_BROADCAST_PDU_OVERHEAD_SIZE + adv_size) * 8U; // 1 us per bit
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "ble_broadcast";
+
+    #ifdef CONFIG_METEO_BLE_ADV_INTERVAL_MS
+        #define BLE_BROADCAST_ADV_INTERVAL_MS CONFIG_METEO_BLE_ADV_INTERVAL_MS
+    #else
+        #define BLE_BROADCAST_ADV_INTERVAL_MS 1000
+    #endif
+    #ifdef CONFIG_METEO_BLE_BINDKEY
+        #define BLE_BROADCAST_BINDKEY CONFIG_METEO_BLE_BINDKEY
+    #else
+        #define BLE_BROADCAST_BINDKEY ""
+    #endif
+    #define BLE_BROADCAST_NVS_NAMESPACE   "ble"
+    #define BLE_BROADCAST_NVS_COUNTER_END "counter_end"
+
+// NOTE: The sensing task only copies the frame and posts an event, the change detection, the encryption and the
+// advertising data update run in the NimBLE host task (HCI commands wait for the controller).
+static portMUX_TYPE           s_lock = portMUX_INITIALIZER_UNLOCKED;
+static meteo_frame_t          s_pending_frame;
+static struct ble_npl_event   s_update_event;
+static bool                   s_is_synced = false;
+static uint8_t                s_own_addr_type;
+static uint8_t                s_mac[6];
+static ble_broadcast_state_t  s_state;
+static uint8_t                s_bindkey[BLE_BROADCAST_KEY_SIZE];
+static ble_broadcast_crypto_t s_crypto = {0};
+static uint32_t               s_counter_end = 0; //< Last reserved encryption counter
+
+static bool ble_broadcast_ccm(const uint8_t  key[BLE_BROADCAST_KEY_SIZE],
+                              const uint8_t  nonce[BLE_BROADCAST_NONCE_SIZE],
+                              const uint8_t *in,
+                              size_t         length,
+                              uint8_t       *out,
+                              uint8_t        mic[BLE_BROADCAST_MIC_SIZE])
+{
+    mbedtls_ccm_context ctx;
+    mbedtls_ccm_init(&ctx);
+    int ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, BLE_BROADCAST_KEY_SIZE * 8U);
+    if (ret == 0)
+    {
+        ret = mbedtls_ccm_encrypt_and_tag(
+            &ctx, length, nonce, BLE_BROADCAST_NONCE_SIZE, NULL, 0, in, out, mic, BLE_BROADCAST_MIC_SIZE);
+    }
+    mbedtls_ccm_free(&ctx);
+    return ret == 0;
+}
+
+// 32 hex digits, anything else is refused
+static bool ble_broadcast_parse_bindkey(const char *hex, uint8_t key[BLE_BROADCAST_KEY_SIZE])
+{
+    if (strlen(hex) != BLE_BROADCAST_KEY_SIZE * 2U) return false;
+    for (size_t i = 0; i < BLE_BROADCAST_KEY_SIZE * 2U; i++)
+    {
+        char    c = hex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9')
+        {
+            nibble = (uint8_t)(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            nibble = (uint8_t)(c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            nibble = (uint8_t)(c - 'A' + 10);
+        }
+        else
+        {
+            return false;
+        }
+        key[i / 2U] = (uint8_t)((i % 2U == 0) ? (nibble << 4) : (key[i / 2U] | nibble));
+    }
+    return true;
+}
+
+// Non connectable, non scannable: the advertising data is all there is
+static void ble_broadcast_start(const uint8_t *adv_data, size_t adv_size)
+{
+    struct ble_gap_adv_params adv_params = {
+        .conn_mode = BLE_GAP_CONN_MODE_NON,
+        .disc_mode = BLE_GAP_DISC_MODE_GEN,
+        .itvl_min = BLE_GAP_ADV_ITVL_MS(BLE_BROADCAST_ADV_INTERVAL_MS),
+        .itvl_max = BLE_GAP_ADV_ITVL_MS(BLE_BROADCAST_ADV_INTERVAL_MS),
+    };
+    int rc = ble_gap_adv_set_data(adv_data, (int)adv_size);
+    if (rc == 0) rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &adv_params, NULL, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(LOG_TAG, "Advertising start failed: %d", rc);
+        return;
+    }
+
+    uint32_t event_air_us = 3U * ble_broadcast_air_time_us(adv_size);
+    ESP_LOGI(LOG_TAG,
+             "Advertising %u bytes%s every %u ms, %lu us on air per event (%.3f %% duty cycle)",
+             (unsigned)adv_size,
+             (s_crypto.key != NULL) ? " encrypted" : "",
+             (unsigned)BLE_BROADCAST_ADV_INTERVAL_MS,
+             (unsigned long)event_air_us,
+             100.0 * event_air_us / (BLE_BROADCAST_ADV_INTERVAL_MS * 1000.0));
+}
+
+static esp_err_t ble_broadcast_save_counter_end(uint32_t counter_end)
+{
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open(BLE_BROADCAST_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+    ret = nvs_set_u32(handle, BLE_BROADCAST_NVS_COUNTER_END, counter_end);
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+}
+
+// The encryption counter resumes after the block reserved by the previous boot
+static esp_err_t ble_broadcast_load_counter(void)
+{
+    nvs_handle_t handle;
+    uint32_t     counter_end = 0;
+    esp_err_t    ret = nvs_open(BLE_BROADCAST_NVS_NAMESPACE, NVS_READONLY, &handle); // NVS initialized by app_main
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) return ret; // Resuming at 0 would reuse counters
+    if (ret == ESP_OK) // No namespace yet: first boot
+    {
+        nvs_get_u32(handle, BLE_BROADCAST_NVS_COUNTER_END, &counter_end);
+        nvs_close(handle);
+    }
+    s_crypto.counter = counter_end;
+    s_counter_end = counter_end;
+    ESP_LOGI(LOG_TAG, "Encryption counter resumes after %lu", (unsigned long)counter_end);
+    return ESP_OK;
+}
+
+// Runs in the NimBLE host task, advertising starts with the first frame so receivers never see placeholder values
+static void ble_broadcast_on_update(struct ble_npl_event *event)
+{
+    meteo_frame_t frame;
+    taskENTER_CRITICAL(&s_lock);
+    frame = s_pending_frame;
+    bool    is_update = s_is_synced && ble_broadcast_update(&s_state, &frame);
+    uint8_t packet_id = s_state.packet_id;
+    taskEXIT_CRITICAL(&s_lock);
+    if (!is_update) return;
+
+    uint8_t adv_data[BLE_BROADCAST_ADV_MAX_SIZE];
+    if (s_crypto.key != NULL && ble_broadcast_next_counter(&s_crypto.counter, &s_counter_end))
+    {
+        esp_err_t ret = ble_broadcast_save_counter_end(s_counter_end);
+        if (ret != ESP_OK)
+        {
+            // Advertising a counter a reboot could reuse would make receivers drop the packets after it
+            ESP_LOGE(LOG_TAG, "Encryption counter reservation failed: %s", esp_err_to_name(ret));
+            s_crypto.counter--;
+            s_counter_end = s_crypto.counter;
+            return;
+        }
+    }
+    size_t adv_size = ble_broadcast_encode(&frame, packet_id, &s_crypto, adv_data, sizeof(adv_data));
+    if (adv_size == 0)
+    {
+        ESP_LOGW(LOG_TAG, "Advertising data encoding failed");
+        return;
+    }
+    if (!ble_gap_adv_active())
+    {
+        ble_broadcast_start(adv_data, adv_size);
+        return;
+    }
+    int rc = ble_gap_adv_set_data(adv_data, (int)adv_size);
+    if (rc != 0) ESP_LOGW(LOG_TAG, "Advertising data update failed: %d", rc);
+}
+
+static void ble_broadcast_on_sync(void)
+{
+    int rc = ble_hs_util_ensure_addr(0);
+    if (rc == 0) rc = ble_hs_id_infer_auto(0, &s_own_addr_type);
+    uint8_t addr[6];
+    if (rc == 0) rc = ble_hs_id_copy_addr(s_own_addr_type, addr, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(LOG_TAG, "No BLE address: %d", rc);
+        return;
+    }
+    // The nonce takes the address as shown, NimBLE keeps it little endian
+    for (uint8_t i = 0; i < sizeof(s_mac); i++) s_mac[i] = addr[sizeof(addr) - 1U - i];
+    s_crypto.mac = s_mac;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_is_synced = true;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static void ble_broadcast_host_task(void *pvParameter)
+{
+    nimble_port_run(); // Returns on nimble_port_stop()
+    nimble_port_freertos_deinit();
+}
+
+esp_err_t ble_broadcast_init(void)
+{
+    const ble_broadcast_thresholds_t thresholds = {
+        .temp_degc = CONFIG_METEO_BLE_TEMP_DELTA_CDEGC / 100.0f,
+        .humid_pct = CONFIG_METEO_BLE_HUMID_DELTA_DPCT / 10.0f,
+        .press_pa = CONFIG_METEO_BLE_PRESS_DELTA_PA,
+        .max_interval_ms = CONFIG_METEO_BLE_REFRESH_S * 1000U,
+    };
+    ble_broadcast_init_state(&s_state, &thresholds);
+    // A configured bind key is never downgraded to unencrypted advertisements: no broadcast instead
+    if (BLE_BROADCAST_BINDKEY[0] != '\0')
+    {
+        if (!ble_broadcast_parse_bindkey(BLE_BROADCAST_BINDKEY, s_bindkey))
+        {
+            ESP_LOGE(LOG_TAG, "Bind key is not 32 hex digits, not advertising");
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t ret = ble_broadcast_load_counter();
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(LOG_TAG, "No NVS for the encryption counter, not advertising: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        s_crypto.key = s_bindkey;
+        s_crypto.ccm = ble_broadcast_ccm;
+    }
+
+    esp_err_t ret = nimble_port_init();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "NimBLE init failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    ble_npl_event_init(&s_update_event, ble_broadcast_on_update, NULL);
+    ble_hs_cfg.sync_cb = ble_broadcast_on_sync;
+    nimble_port_freertos_init(ble_broadcast_host_task);
+    return ESP_OK;
+}
+
+void ble_broadcast_push(const meteo_frame_t *frame)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_pending_frame = *frame;
+    taskEXIT_CRITICAL(&s_lock);
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &s_update_event); // No-op while already queued
+}
+
+void ble_broadcast_get_state(ble_broadcast_state_t *state)
+{
+    if (state == NULL) return;
+    taskENTER_CRITICAL(&s_lock);
+    *state = s_state;
+    taskEXIT_CRITICAL(&s_lock);
+}
+#endif
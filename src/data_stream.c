@@ -0,0 +1,289 @@
+#include "data_stream.h"
+
+#include <string.h>
+
+#include "byte_codec.h"
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "driver/usb_serial_jtag.h"
+    #include "esp_log.h"
+    #include "esp_timer.h"
+
+    #include "timebase.h"
+#endif
+
+#define DATA_STREAM_BUFFER_SIZE        1024U // Bytes per buffer, two buffers are used
+#define DATA_STREAM_FLUSH_PERIOD_MS    20U   // Partially filled buffer flush period
+#define DATA_STREAM_TX_TIMEOUT_MS      50U   // Give up on a buffer if the host does not read it
+#define DATA_STREAM_USJ_TX_BUFFER_SIZE 2048U
+#define DATA_STREAM_TIME_PERIOD_US     5000000LL // Time frame period, the stamps are converted with the last one
+
+_Static_assert(DATA_STREAM_SAMPLE_FRAME_SIZE <= DATA_STREAM_BUFFER_SIZE, "Stream buffer must hold at least a frame");
+
+uint16_t data_stream_crc16(const uint8_t *data, size_t length)
+{
+    // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t data_stream_encode_sample(const meteo_frame_t *frame, uint8_t *buffer, size_t buffer_size)
+{
+    if (frame == NULL || buffer == NULL || buffer_size < DATA_STREAM_SAMPLE_FRAME_SIZE) return 0;
+
+    uint8_t *dst = buffer;
+    dst = put_u8(dst, DATA_STREAM_SYNC_0);
+    dst = put_u8(dst, DATA_STREAM_SYNC_1);
+    dst = put_u8(dst, DATA_STREAM_TYPE_SAMPLE);
+    dst = put_u8(dst, DATA_STREAM_SAMPLE_PAYLOAD_SIZE);
+
+    dst = put_u32(dst, frame->sequence);
+    dst = put_u64(dst, (uint64_t)frame->timestamp_us);
+    dst = put_u32(dst, frame->raw.temp_adc);
+    dst = put_u32(dst, frame->raw.press_adc);
+    dst = put_u16(dst, frame->raw.hum_adc);
+    dst = put_u16(dst, frame->raw.gas_adc);
+    dst = put_u8(dst, frame->raw.gas_range);
+    dst = put_u8(dst, frame->raw.status);
+    dst = put_f32(dst, frame->temperature_degc);
+    dst = put_f32(dst, frame->pressure_pa);
+    dst = put_f32(dst, frame->humidity_pct);
+    dst = put_f32(dst, frame->gas_resistance_ohm);
+
+    // CRC covers the type, the length and the payload, not the sync bytes
+    dst = put_u16(dst, data_stream_crc16(&buffer[2], DATA_STREAM_SAMPLE_FRAME_SIZE - 2 - DATA_STREAM_CRC_SIZE));
+    return (size_t)(dst - buffer);
+}
+
+size_t data_stream_encode_alert(
+    const meteo_frame_t *frame, uint8_t active_mask, uint8_t changed_mask, uint8_t *buffer, size_t buffer_size)
+{
+    if (frame == NULL || buffer == NULL || buffer_size < DATA_STREAM_ALERT_FRAME_SIZE) return 0;
+
+    uint8_t *dst = buffer;
+    dst = put_u8(dst, DATA_STREAM_SYNC_0);
+    dst = put_u8(dst, DATA_STREAM_SYNC_1);
+    dst = put_u8(dst, DATA_STREAM_TYPE_ALERT);
+    dst = put_u8(dst, DATA_STREAM_ALERT_PAYLOAD_SIZE);
+
+    dst = put_u32(dst, frame->sequence);
+    dst = put_u64(dst, (uint64_t)frame->timestamp_us);
+    dst = put_u8(dst, active_mask);
+    dst = put_u8(dst, changed_mask);
+
+    dst = put_u16(dst, data_stream_crc16(&buffer[2], DATA_STREAM_ALERT_FRAME_SIZE - 2 - DATA_STREAM_CRC_SIZE));
+    return (size_t)(dst - buffer);
+}
+
+size_t data_stream_encode_time(int64_t mono_us, int64_t utc_us, uint8_t *buffer, size_t buffer_size)
+{
+    uint8_t  payload[DATA_STREAM_TIME_PAYLOAD_SIZE];
+    uint8_t *dst = put_u64(payload, (uint64_t)mono_us);
+    put_u64(dst, (uint64_t)utc_us);
+    return data_stream_encode_frame(DATA_STREAM_TYPE_TIME, payload, sizeof(payload), buffer, buffer_size);
+}
+
+size_t data_stream_encode_frame(
+    uint8_t type, const uint8_t *payload, size_t payload_size, uint8_t *buffer, size_t buffer_size)
+{
+    size_t frame_size = DATA_STREAM_HEADER_SIZE + payload_size + DATA_STREAM_CRC_SIZE;
+    if (payload == NULL || buffer == NULL || payload_size > DATA_STREAM_MAX_PAYLOAD_SIZE || buffer_size < frame_size)
+    {
+        return 0;
+    }
+
+    uint8_t *dst = buffer;
+    dst = put_u8(dst, DATA_STREAM_SYNC_0);
+    dst = put_u8(dst, DATA_STREAM_SYNC_1);
+    dst = put_u8(dst, type);
+    dst = put_u8(dst, (uint8_t)payload_size);
+    memcpy(dst, payload, payload_size);
+    dst += payload_size;
+
+    dst = put_u16(dst, data_stream_crc16(&buffer[2], frame_size - 2 - DATA_STREAM_CRC_SIZE));
+    return (size_t)(dst - buffer);
+}
+
+uint32_t data_stream_count_frames(const uint8_t *data, size_t length)
+{
+    uint32_t n_frames = 0;
+    size_t   end = 0;
+    // The length byte of the next frame is only read when the frame header was sent
+    while (end + DATA_STREAM_HEADER_SIZE <= length)
+    {
+        end += DATA_STREAM_HEADER_SIZE + data[end + 3] + DATA_STREAM_CRC_SIZE;
+        if (end > length) break;
+        n_frames++;
+    }
+    return n_frames;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "data_stream";
+
+// NOTE: Double buffering, the sensing loop appends encoded frames to the fill buffer while the stream task hands the
+// other one to the USB-Serial/JTAG driver. The producer never waits: when the fill buffer is full and the other one is
+// still being sent, the frame is dropped and counted (the host also sees the sequence gap).
+typedef struct
+{
+    uint8_t  data[DATA_STREAM_BUFFER_SIZE];
+    size_t   length;
+    uint32_t n_frames;
+} data_stream_buffer_t;
+
+static data_stream_buffer_t s_buffers[2];
+static uint8_t              s_fill_index = 0;
+static bool                 s_tx_busy = false; //< The buffer which is not the fill buffer is being sent
+static portMUX_TYPE         s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t         s_task_handle = NULL;
+static data_stream_stats_t  s_stats = {0};
+
+// Must be called in the critical section, the fill buffer becomes the transmit one
+static void data_stream_swap_buffers(void)
+{
+    s_tx_busy = true;
+    s_fill_index ^= 1;
+    s_buffers[s_fill_index].length = 0;
+    s_buffers[s_fill_index].n_frames = 0;
+}
+
+esp_err_t data_stream_init(void)
+{
+    usb_serial_jtag_driver_config_t usj_config = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+    usj_config.tx_buffer_size = DATA_STREAM_USJ_TX_BUFFER_SIZE;
+    esp_err_t ret = usb_serial_jtag_driver_install(&usj_config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "USB-Serial/JTAG driver install failed!");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// Append an encoded frame to the fill buffer, never waits
+static bool data_stream_enqueue(const uint8_t *encoded, size_t length)
+{
+    if (length == 0) return false;
+
+    bool queued = false;
+    bool notify = false;
+    taskENTER_CRITICAL(&s_lock);
+    data_stream_buffer_t *fill = &s_buffers[s_fill_index];
+    if (fill->length + length > DATA_STREAM_BUFFER_SIZE && !s_tx_busy)
+    {
+        data_stream_swap_buffers();
+        fill = &s_buffers[s_fill_index];
+        notify = true;
+    }
+    if (fill->length + length <= DATA_STREAM_BUFFER_SIZE)
+    {
+        memcpy(&fill->data[fill->length], encoded, length);
+        fill->length += length;
+        fill->n_frames++;
+        queued = true;
+    }
+    else
+    {
+        s_stats.frames_dropped++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (notify && s_task_handle != NULL) xTaskNotifyGive(s_task_handle);
+    return queued;
+}
+
+bool data_stream_push(const meteo_frame_t *frame)
+{
+    uint8_t encoded[DATA_STREAM_SAMPLE_FRAME_SIZE];
+    return data_stream_enqueue(encoded, data_stream_encode_sample(frame, encoded, sizeof(encoded)));
+}
+
+bool data_stream_push_alert(const meteo_frame_t *frame, uint8_t active_mask, uint8_t changed_mask)
+{
+    uint8_t encoded[DATA_STREAM_ALERT_FRAME_SIZE];
+    return data_stream_enqueue(
+        encoded, data_stream_encode_alert(frame, active_mask, changed_mask, encoded, sizeof(encoded)));
+}
+
+bool data_stream_push_i2c_trace(const uint8_t *record, size_t length)
+{
+    uint8_t encoded[DATA_STREAM_HEADER_SIZE + DATA_STREAM_MAX_PAYLOAD_SIZE + DATA_STREAM_CRC_SIZE];
+    return data_stream_enqueue(
+        encoded, data_stream_encode_frame(DATA_STREAM_TYPE_I2C_TRACE, record, length, encoded, sizeof(encoded)));
+}
+
+bool data_stream_push_station_batch(const uint8_t *payload, size_t length)
+{
+    uint8_t encoded[DATA_STREAM_HEADER_SIZE + DATA_STREAM_MAX_PAYLOAD_SIZE + DATA_STREAM_CRC_SIZE];
+    return data_stream_enqueue(
+        encoded, data_stream_encode_frame(DATA_STREAM_TYPE_STATION_BATCH, payload, length, encoded, sizeof(encoded)));
+}
+
+void data_stream_get_stats(data_stream_stats_t *stats)
+{
+    if (stats == NULL) return;
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// Time frame of now, once the timebase is synced
+static void data_stream_push_time(void)
+{
+    int64_t mono_us = esp_timer_get_time();
+    int64_t utc_us;
+    if (!timebase_utc_us(mono_us, &utc_us)) return;
+    uint8_t encoded[DATA_STREAM_TIME_FRAME_SIZE];
+    data_stream_enqueue(encoded, data_stream_encode_time(mono_us, utc_us, encoded, sizeof(encoded)));
+}
+
+void data_stream_task(void *pvParameter)
+{
+    s_task_handle = xTaskGetCurrentTaskHandle();
+    int64_t last_time_us = -DATA_STREAM_TIME_PERIOD_US;
+    while (1)
+    {
+        // Woken up by a full buffer, or periodically to flush a partially filled one
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DATA_STREAM_FLUSH_PERIOD_MS));
+        if (esp_timer_get_time() - last_time_us >= DATA_STREAM_TIME_PERIOD_US)
+        {
+            last_time_us = esp_timer_get_time();
+            data_stream_push_time();
+        }
+
+        taskENTER_CRITICAL(&s_lock);
+        if (!s_tx_busy && s_buffers[s_fill_index].length > 0) data_stream_swap_buffers();
+        data_stream_buffer_t *tx = s_tx_busy ? &s_buffers[s_fill_index ^ 1] : NULL;
+        taskEXIT_CRITICAL(&s_lock);
+        if (tx == NULL) continue;
+
+        size_t offset = 0;
+        while (offset < tx->length)
+        {
+            int written = usb_serial_jtag_write_bytes(
+                &tx->data[offset], tx->length - offset, pdMS_TO_TICKS(DATA_STREAM_TX_TIMEOUT_MS));
+            if (written <= 0) break; // Host not reading, drop the rest of this buffer
+            offset += (size_t)written;
+        }
+
+        uint32_t n_sent = (offset < tx->length) ? data_stream_count_frames(tx->data, offset) : tx->n_frames;
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.frames_sent += n_sent;
+        s_stats.frames_dropped += tx->n_frames - n_sent;
+        s_stats.bytes_sent += offset;
+        s_tx_busy = false;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+}
+#endif
@@ -0,0 +1,253 @@
+#include "deferred_log.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "esp_log.h"
+#endif
+
+#ifdef CONFIG_METEO_DEFERRED_LOG_RING_LEN
+    #define DEFERRED_LOG_RING_LEN CONFIG_METEO_DEFERRED_LOG_RING_LEN
+#else
+    #define DEFERRED_LOG_RING_LEN 32
+#endif
+#define DEFERRED_LOG_RING_MASK (DEFERRED_LOG_RING_LEN - 1)
+
+_Static_assert((DEFERRED_LOG_RING_LEN & DEFERRED_LOG_RING_MASK) == 0, "Deferred log ring length must be a power of 2");
+
+#define DEFERRED_LOG_TASK_PERIOD_MS  100U
+#define DEFERRED_LOG_LINE_MAX_LENGTH 160U
+
+// NOTE: Bounded multi-producer ring, each slot sequence number tells if it is free for the producer at position
+// 'pos' (seq == pos) or holds a record ready for the consumer (seq == pos + 1). Producers never block, a full ring
+// drops the record and counts it.
+typedef struct
+{
+    atomic_uint_fast32_t  seq;
+    deferred_log_record_t record;
+} deferred_log_slot_t;
+
+static deferred_log_slot_t  s_ring[DEFERRED_LOG_RING_LEN];
+static atomic_uint_fast32_t s_head = 0;
+static uint32_t             s_tail = 0; //< Single consumer, not shared
+static atomic_uint_fast32_t s_dropped = 0;
+
+#define DEFERRED_LOG_FMT_TAG(id, tag, fmt) tag,
+static const char *const s_tags[DLOG_FMT_COUNT] = {DEFERRED_LOG_FORMATS(DEFERRED_LOG_FMT_TAG)};
+#undef DEFERRED_LOG_FMT_TAG
+
+#define DEFERRED_LOG_FMT_STRING(id, tag, fmt) fmt,
+static const char *const s_formats[DLOG_FMT_COUNT] = {DEFERRED_LOG_FORMATS(DEFERRED_LOG_FMT_STRING)};
+#undef DEFERRED_LOG_FMT_STRING
+
+static uint32_t deferred_log_timestamp_ms(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_log_timestamp();
+#else
+    return 0;
+#endif
+}
+
+void deferred_log_init(void)
+{
+    for (uint32_t i = 0; i < DEFERRED_LOG_RING_LEN; i++)
+    {
+        atomic_store_explicit(&s_ring[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&s_head, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_dropped, 0, memory_order_relaxed);
+    s_tail = 0;
+}
+
+bool deferred_log_write(uint16_t fmt_id, uint8_t n_args, const uint32_t *args)
+{
+    if (n_args > DEFERRED_LOG_MAX_ARGS) n_args = DEFERRED_LOG_MAX_ARGS;
+
+    deferred_log_slot_t *slot;
+    uint_fast32_t        pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+    while (1)
+    {
+        slot = &s_ring[pos & DEFERRED_LOG_RING_MASK];
+        uint_fast32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int32_t       diff = (int32_t)((uint32_t)seq - (uint32_t)pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(
+                    &s_head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Ring full, the consumer did not release this slot yet
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+        }
+    }
+
+    slot->record.timestamp_ms = deferred_log_timestamp_ms();
+    slot->record.fmt_id = fmt_id;
+    slot->record.n_args = n_args;
+    slot->record.reserved = 0;
+    for (uint8_t i = 0; i < n_args; i++)
+    {
+        slot->record.args[i] = args[i];
+    }
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+bool deferred_log_read(deferred_log_record_t *record)
+{
+    if (record == NULL) return false;
+
+    deferred_log_slot_t *slot = &s_ring[s_tail & DEFERRED_LOG_RING_MASK];
+    uint_fast32_t        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if ((int32_t)((uint32_t)seq - (s_tail + 1)) < 0) return false; // Empty
+
+    *record = slot->record;
+    atomic_store_explicit(&slot->seq, s_tail + DEFERRED_LOG_RING_LEN, memory_order_release);
+    s_tail++;
+    return true;
+}
+
+const char *deferred_log_tag(uint16_t fmt_id)
+{
+    if (fmt_id >= DLOG_FMT_COUNT) return "dlog";
+    return s_tags[fmt_id];
+}
+
+uint32_t deferred_log_dropped_count(void)
+{
+    return (uint32_t)atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
+
+// Format one conversion specification with the raw argument, returns the number of chars appended
+static size_t deferred_log_format_arg(const char *spec,
+                                      size_t      spec_length,
+                                      uint32_t    raw_arg,
+                                      char       *buffer,
+                                      size_t      buffer_size)
+{
+    // Rebuild the conversion without length modifiers, the argument type comes from the conversion char
+    char   conversion[16];
+    size_t conversion_length = 0;
+    for (size_t i = 0; i < spec_length && conversion_length < sizeof(conversion) - 2; i++)
+    {
+        char c = spec[i];
+        if (c == 'l' || c == 'h' || c == 'z' || c == 'j' || c == 't' || c == 'L') continue;
+        conversion[conversion_length++] = c;
+    }
+    conversion[conversion_length] = '\0';
+
+    int  written;
+    char type = spec[spec_length - 1];
+    switch (type)
+    {
+    case 'd':
+    case 'i': written = snprintf(buffer, buffer_size, conversion, (int)(int32_t)raw_arg); break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    {
+        float value;
+        memcpy(&value, &raw_arg, sizeof(value));
+        written = snprintf(buffer, buffer_size, conversion, (double)value);
+        break;
+    }
+    default: written = snprintf(buffer, buffer_size, conversion, (unsigned int)raw_arg); break;
+    }
+
+    if (written < 0) return 0;
+    return ((size_t)written < buffer_size) ? (size_t)written : buffer_size - 1;
+}
+
+size_t deferred_log_format(const deferred_log_record_t *record, char *buffer, size_t buffer_size)
+{
+    if (record == NULL || buffer == NULL || buffer_size == 0) return 0;
+
+    if (record->fmt_id >= DLOG_FMT_COUNT)
+    {
+        int written = snprintf(buffer, buffer_size, "Unknown deferred log format id %u", record->fmt_id);
+        if (written < 0) return 0;
+        return ((size_t)written < buffer_size) ? (size_t)written : buffer_size - 1;
+    }
+
+    const char *fmt = s_formats[record->fmt_id];
+    size_t      pos = 0;
+    uint8_t     arg_index = 0;
+    while (*fmt != '\0' && pos < buffer_size - 1)
+    {
+        if (*fmt != '%')
+        {
+            buffer[pos++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%')
+        {
+            buffer[pos++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Find the conversion char ending the specification
+        size_t spec_length = 1;
+        while (fmt[spec_length] != '\0' && strchr("diouxXcfFeEgGs", fmt[spec_length]) == NULL)
+        {
+            spec_length++;
+        }
+        if (fmt[spec_length] == '\0') break; // Malformed format string
+        spec_length++;
+
+        if (fmt[spec_length - 1] == 's' || arg_index >= record->n_args)
+        {
+            buffer[pos++] = '?'; // Strings are not supported and missing arguments are not read
+        }
+        else
+        {
+            pos += deferred_log_format_arg(fmt, spec_length, record->args[arg_index], &buffer[pos], buffer_size - pos);
+        }
+        arg_index++;
+        fmt += spec_length;
+    }
+    buffer[pos] = '\0';
+    return pos;
+}
+
+#ifdef ESP_PLATFORM
+void deferred_log_task(void *pvParameter)
+{
+    deferred_log_record_t record;
+    char                  line[DEFERRED_LOG_LINE_MAX_LENGTH];
+    uint32_t              reported_dropped = 0;
+    while (1)
+    {
+        while (deferred_log_read(&record))
+        {
+            deferred_log_format(&record, line, sizeof(line));
+            ESP_LOGI(deferred_log_tag(record.fmt_id), "(%lu) %s", (unsigned long)record.timestamp_ms, line);
+        }
+
+        uint32_t dropped = deferred_log_dropped_count();
+        if (dropped != reported_dropped)
+        {
+            ESP_LOGW("dlog", "%lu deferred log records dropped", (unsigned long)(dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_TASK_PERIOD_MS));
+    }
+}
+#endif
@@ -0,0 +1,61 @@
+#include "display_policy.h"
+
+#include <math.h>
+#include <string.h>
+
+// The first valid value is a change, a value lost is not
+static bool display_policy_is_moved(float value, float ref, float threshold)
+{
+    if (isnan(value)) return false;
+    return isnan(ref) || fabsf(value - ref) >= threshold;
+}
+
+void display_policy_init(display_policy_t *policy, const display_policy_config_t *config, int64_t now_us)
+{
+    memset(policy, 0, sizeof(*policy));
+    policy->config = *config;
+    policy->state = DISPLAY_POLICY_ON;
+    policy->activity_us = now_us;
+    policy->ref_temp_degc = NAN;
+    policy->ref_humid_pct = NAN;
+    policy->ref_press_kpa = NAN;
+}
+
+display_policy_state_t display_policy_update(display_policy_t *policy, int64_t now_us, const lcd_variables_t *vars)
+{
+    const display_policy_config_t *config = &policy->config;
+    bool                           is_alert_raised = (vars->active_alerts & ~policy->alerts) != 0;
+    policy->alerts = vars->active_alerts;
+    if (is_alert_raised || display_policy_is_moved(vars->amb_temp_degc, policy->ref_temp_degc, config->wake_temp_degc)
+        || display_policy_is_moved(vars->amb_humid_pct, policy->ref_humid_pct, config->wake_humid_pct)
+        || display_policy_is_moved(vars->amb_press_kpa, policy->ref_press_kpa, config->wake_press_kpa))
+    {
+        policy->activity_us = now_us;
+        policy->ref_temp_degc = vars->amb_temp_degc;
+        policy->ref_humid_pct = vars->amb_humid_pct;
+        policy->ref_press_kpa = vars->amb_press_kpa;
+    }
+
+    display_policy_state_t state;
+    int64_t                idle_us = now_us - policy->activity_us;
+    if (idle_us < config->dim_after_us)
+    {
+        state = DISPLAY_POLICY_ON;
+    }
+    else if (idle_us < config->off_after_us || policy->alerts != 0)
+    {
+        state = DISPLAY_POLICY_DIM;
+    }
+    else
+    {
+        state = DISPLAY_POLICY_OFF;
+    }
+    if (policy->state == DISPLAY_POLICY_OFF && state != DISPLAY_POLICY_OFF) policy->n_wakes++;
+    policy->state = state;
+    return state;
+}
+
+uint8_t display_policy_contrast(const display_policy_t *policy, display_policy_state_t state)
+{
+    return (state == DISPLAY_POLICY_DIM) ? policy->config.dim_contrast : DISPLAY_POLICY_CONTRAST_FULL;
+}
@@ -0,0 +1,645 @@
+#include "flash_log.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "byte_codec.h"
+#include "data_stream.h" //< CRC-16
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include <sys/time.h>
+
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "esp_log.h"
+    #include "esp_partition.h"
+    #include "esp_timer.h"
+
+    #include "timebase.h"
+#endif
+
+#define FLASH_LOG_HEADER_MAGIC 0x474C4D53U //< "SMLG"
+#define FLASH_LOG_FOOTER_MAGIC 0x474C4D45U //< "EMLG"
+#define FLASH_LOG_FOOTER_USED  (4U + 4U + 8U + HISTORY_N_CHANNELS * 12U + 2U)
+#define FLASH_LOG_ERASED       0xFFU
+#define FLASH_LOG_READ_CHUNK   128U
+
+_Static_assert(FLASH_LOG_FOOTER_USED <= FLASH_LOG_FOOTER_SIZE, "Footer must fit in its reserved area");
+
+typedef struct
+{
+    uint32_t        seq;
+    int64_t         start_us;
+    bool            has_summary; //< From the footer or, for the sector being filled, from RAM
+    uint32_t        n_samples;
+    int64_t         end_us; //< Last sample
+    history_block_t summary[HISTORY_N_CHANNELS];
+} flash_log_sector_t;
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1U);
+}
+
+static bool flash_log_read_at(flash_log_t *log, uint32_t sector, uint32_t offset, void *data, size_t size)
+{
+    log->n_reads++;
+    log->n_bytes_read += (uint32_t)size;
+    return log->io.read(log->io.ctx, sector * FLASH_LOG_SECTOR_SIZE + offset, data, size);
+}
+
+static uint32_t flash_log_physical(const flash_log_t *log, uint32_t index)
+{
+    return (log->oldest + index) % log->n_sectors;
+}
+
+static void flash_log_reset_summary(history_block_t summary[HISTORY_N_CHANNELS])
+{
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        summary[ch].min = INT16_MAX;
+        summary[ch].max = INT16_MIN;
+        summary[ch].sum = 0;
+        summary[ch].n_valid = 0;
+    }
+}
+
+static void flash_log_add_to_summary(history_block_t summary[HISTORY_N_CHANNELS], const int16_t *values)
+{
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        if (values[ch] == HISTORY_STORE_INVALID) continue;
+        if (values[ch] < summary[ch].min) summary[ch].min = values[ch];
+        if (values[ch] > summary[ch].max) summary[ch].max = values[ch];
+        summary[ch].sum += values[ch];
+        summary[ch].n_valid++;
+    }
+}
+
+static bool flash_log_read_header(flash_log_t *log, uint32_t sector, uint32_t *seq, int64_t *start_us)
+{
+    uint8_t header[FLASH_LOG_HEADER_SIZE];
+    if (!flash_log_read_at(log, sector, 0, header, sizeof(header))) return false;
+    if (get_u32(header) != FLASH_LOG_HEADER_MAGIC) return false;
+    *seq = get_u32(&header[4]);
+    *start_us = (int64_t)get_u64(&header[8]);
+    return true;
+}
+
+static bool flash_log_read_footer(flash_log_t *log, uint32_t sector, flash_log_sector_t *info)
+{
+    uint8_t footer[FLASH_LOG_FOOTER_USED];
+    if (!flash_log_read_at(log, sector, FLASH_LOG_FOOTER_OFFSET, footer, sizeof(footer))) return false;
+    if (get_u32(footer) != FLASH_LOG_FOOTER_MAGIC) return false;
+    uint16_t crc = (uint16_t)(footer[FLASH_LOG_FOOTER_USED - 2] | (footer[FLASH_LOG_FOOTER_USED - 1] << 8));
+    if (crc != data_stream_crc16(footer, FLASH_LOG_FOOTER_USED - 2)) return false;
+
+    info->n_samples = get_u32(&footer[4]);
+    info->end_us = (int64_t)get_u64(&footer[8]);
+    const uint8_t *src = &footer[16];
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++, src += 12)
+    {
+        info->summary[ch].min = (int16_t)(src[0] | (src[1] << 8));
+        info->summary[ch].max = (int16_t)(src[2] | (src[3] << 8));
+        info->summary[ch].sum = (int32_t)get_u32(&src[4]);
+        info->summary[ch].n_valid = get_u32(&src[8]);
+    }
+    return true;
+}
+
+// Header and footer of the sector at the logical index, false without header. The summary of the sector being filled
+// comes from RAM, a sector without valid footer (torn by a reset while it was written) is decoded up to its end.
+static bool flash_log_get_sector(flash_log_t *log, uint32_t index, flash_log_sector_t *info)
+{
+    uint32_t sector = flash_log_physical(log, index);
+    if (!flash_log_read_header(log, sector, &info->seq, &info->start_us)) return false;
+    if (log->is_open && index == log->n_used - 1U)
+    {
+        info->has_summary = true;
+        info->n_samples = log->n_samples;
+        info->end_us = log->last_us;
+        memcpy(info->summary, log->summary, sizeof(info->summary));
+        return true;
+    }
+    info->has_summary = flash_log_read_footer(log, sector, info);
+    if (!info->has_summary)
+    {
+        info->n_samples = UINT32_MAX;
+        info->end_us = INT64_MAX;
+    }
+    return true;
+}
+
+typedef struct
+{
+    flash_log_t *log;
+    uint32_t     sector;
+    uint32_t     offset; //< Of the next record
+    uint8_t      chunk[FLASH_LOG_READ_CHUNK];
+    uint32_t     chunk_offset;
+    uint32_t     chunk_len;
+    int64_t      timestamp_us;
+    int64_t      dt_us;
+    int16_t      values[HISTORY_N_CHANNELS];
+} flash_log_decoder_t;
+
+static void flash_log_decoder_init(flash_log_decoder_t *decoder, flash_log_t *log, uint32_t sector, int64_t start_us)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->log = log;
+    decoder->sector = sector;
+    decoder->offset = FLASH_LOG_HEADER_SIZE;
+    decoder->timestamp_us = start_us;
+}
+
+// Next record of the sector, false at its end (erased byte or footer area)
+static bool flash_log_decoder_next(flash_log_decoder_t *decoder)
+{
+    uint32_t chunk_end = decoder->chunk_offset + decoder->chunk_len;
+    if (decoder->offset >= chunk_end
+        || (decoder->offset + FLASH_LOG_MAX_RECORD_SIZE > chunk_end && chunk_end < FLASH_LOG_FOOTER_OFFSET))
+    {
+        uint32_t len = FLASH_LOG_FOOTER_OFFSET - decoder->offset;
+        if (len == 0) return false;
+        if (len > FLASH_LOG_READ_CHUNK) len = FLASH_LOG_READ_CHUNK;
+        if (!flash_log_read_at(decoder->log, decoder->sector, decoder->offset, decoder->chunk, len)) return false;
+        decoder->chunk_offset = decoder->offset;
+        decoder->chunk_len = len;
+    }
+
+    const uint8_t *record = &decoder->chunk[decoder->offset - decoder->chunk_offset];
+    uint8_t        len = record[0];
+    if (len == FLASH_LOG_ERASED || len == 0 || &record[1 + len] > &decoder->chunk[decoder->chunk_len]) return false;
+
+    const uint8_t *src = &record[1];
+    const uint8_t *end = &record[1 + len];
+    uint64_t       raw;
+    size_t         n_read = get_varint(src, (size_t)(end - src), &raw);
+    if (n_read == 0) return false;
+    src += n_read;
+    int64_t dt_us = decoder->dt_us + unzigzag(raw);
+    int64_t timestamp_us = decoder->timestamp_us + dt_us;
+    int16_t values[HISTORY_N_CHANNELS];
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        n_read = get_varint(src, (size_t)(end - src), &raw);
+        if (n_read == 0) return false;
+        src += n_read;
+        values[ch] = (int16_t)(decoder->values[ch] + unzigzag(raw));
+    }
+    decoder->timestamp_us = timestamp_us;
+    decoder->dt_us = dt_us;
+    memcpy(decoder->values, values, sizeof(values));
+    decoder->offset += 1U + len;
+    return true;
+}
+
+bool flash_log_format(flash_log_t *log, const flash_log_io_t *io)
+{
+    if (io == NULL || io->size < FLASH_LOG_SECTOR_SIZE || io->size % FLASH_LOG_SECTOR_SIZE != 0) return false;
+    if (!io->erase(io->ctx, 0, io->size)) return false;
+    return flash_log_mount(log, io);
+}
+
+bool flash_log_mount(flash_log_t *log, const flash_log_io_t *io)
+{
+    if (log == NULL || io == NULL || io->size < FLASH_LOG_SECTOR_SIZE || io->size % FLASH_LOG_SECTOR_SIZE != 0)
+    {
+        return false;
+    }
+    memset(log, 0, sizeof(*log));
+    log->io = *io;
+    log->n_sectors = io->size / FLASH_LOG_SECTOR_SIZE;
+
+    // The sequence numbers increase along the ring, the oldest sector follows the newest one
+    uint32_t newest = 0;
+    uint32_t newest_seq = 0;
+    int64_t  newest_start_us = 0;
+    for (uint32_t sector = 0; sector < log->n_sectors; sector++)
+    {
+        uint32_t seq;
+        int64_t  start_us;
+        if (!flash_log_read_header(log, sector, &seq, &start_us)) continue;
+        if (log->n_used == 0 || (int32_t)(seq - newest_seq) > 0)
+        {
+            newest = sector;
+            newest_seq = seq;
+            newest_start_us = start_us;
+        }
+        log->n_used++;
+    }
+    if (log->n_used == 0) return true;
+    log->oldest = (newest + log->n_sectors + 1U - log->n_used) % log->n_sectors;
+    log->next_seq = newest_seq + 1U;
+
+    // Without a footer the newest sector is being filled: replay its records
+    flash_log_sector_t info;
+    if (flash_log_read_footer(log, newest, &info))
+    {
+        log->last_us = info.end_us;
+        return true;
+    }
+    log->is_open = true;
+    log->start_us = newest_start_us;
+    flash_log_reset_summary(log->summary);
+    flash_log_decoder_t decoder;
+    flash_log_decoder_init(&decoder, log, newest, newest_start_us);
+    while (flash_log_decoder_next(&decoder))
+    {
+        flash_log_add_to_summary(log->summary, decoder.values);
+        log->n_samples++;
+    }
+    log->write_offset = decoder.offset;
+    log->last_us = decoder.timestamp_us;
+    log->last_dt_us = decoder.dt_us;
+    memcpy(log->last, decoder.values, sizeof(log->last));
+    return true;
+}
+
+static bool flash_log_close(flash_log_t *log)
+{
+    uint8_t  footer[FLASH_LOG_FOOTER_USED];
+    uint8_t *dst = put_u32(footer, FLASH_LOG_FOOTER_MAGIC);
+    dst = put_u32(dst, log->n_samples);
+    dst = put_u64(dst, (uint64_t)log->last_us);
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        const history_block_t *summary = &log->summary[ch];
+        *dst++ = (uint8_t)summary->min;
+        *dst++ = (uint8_t)((uint16_t)summary->min >> 8);
+        *dst++ = (uint8_t)summary->max;
+        *dst++ = (uint8_t)((uint16_t)summary->max >> 8);
+        dst = put_u32(dst, (uint32_t)summary->sum);
+        dst = put_u32(dst, summary->n_valid);
+    }
+    uint16_t crc = data_stream_crc16(footer, FLASH_LOG_FOOTER_USED - 2);
+    *dst++ = (uint8_t)crc;
+    *dst++ = (uint8_t)(crc >> 8);
+
+    uint32_t sector = flash_log_physical(log, log->n_used - 1U);
+    log->is_open = false;
+    return log->io.write(log->io.ctx, sector * FLASH_LOG_SECTOR_SIZE + FLASH_LOG_FOOTER_OFFSET, footer, sizeof(footer));
+}
+
+// Erase the next sector of the ring (dropping the oldest one when full) and write its header
+static bool flash_log_open(flash_log_t *log, int64_t start_us)
+{
+    if (log->n_used == log->n_sectors)
+    {
+        log->oldest = (log->oldest + 1U) % log->n_sectors;
+        log->n_used--;
+    }
+    uint32_t sector = flash_log_physical(log, log->n_used);
+    if (!log->io.erase(log->io.ctx, sector * FLASH_LOG_SECTOR_SIZE, FLASH_LOG_SECTOR_SIZE)) return false;
+
+    uint8_t  header[FLASH_LOG_HEADER_SIZE];
+    uint8_t *dst = put_u32(header, FLASH_LOG_HEADER_MAGIC);
+    dst = put_u32(dst, log->next_seq);
+    put_u64(dst, (uint64_t)start_us);
+    if (!log->io.write(log->io.ctx, sector * FLASH_LOG_SECTOR_SIZE, header, sizeof(header))) return false;
+
+    log->n_used++;
+    log->next_seq++;
+    log->is_open = true;
+    log->write_offset = FLASH_LOG_HEADER_SIZE;
+    log->start_us = start_us;
+    log->last_us = start_us;
+    log->last_dt_us = 0;
+    memset(log->last, 0, sizeof(log->last));
+    log->n_samples = 0;
+    flash_log_reset_summary(log->summary);
+    return true;
+}
+
+bool flash_log_append(flash_log_t *log, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS])
+{
+    if (log->n_used > 0 && timestamp_us < log->last_us)
+    {
+        log->n_rejected++;
+        return false;
+    }
+
+    int16_t packed[HISTORY_N_CHANNELS];
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        packed[ch] = history_store_pack((history_channel_t)ch, values[ch]);
+    }
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        if (!log->is_open && !flash_log_open(log, timestamp_us)) return false;
+
+        // Deltas from the previous sample of the sector, from the sector start and 0 for the first one. The time step
+        // is stored as its change from the previous step: one byte at a steady sampling period.
+        int64_t  dt_us = timestamp_us - log->last_us;
+        uint8_t  record[FLASH_LOG_MAX_RECORD_SIZE];
+        uint8_t *dst = put_varint(&record[1], zigzag(dt_us - log->last_dt_us));
+        for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+        {
+            dst = put_varint(dst, zigzag((int64_t)packed[ch] - log->last[ch]));
+        }
+        uint32_t len = (uint32_t)(dst - record);
+        record[0] = (uint8_t)(len - 1U);
+        if (log->write_offset + len > FLASH_LOG_FOOTER_OFFSET)
+        {
+            if (!flash_log_close(log)) return false;
+            continue;
+        }
+
+        uint32_t sector = flash_log_physical(log, log->n_used - 1U);
+        if (!log->io.write(log->io.ctx, sector * FLASH_LOG_SECTOR_SIZE + log->write_offset, record, len)) return false;
+        log->write_offset += len;
+        log->last_us = timestamp_us;
+        log->last_dt_us = dt_us;
+        memcpy(log->last, packed, sizeof(packed));
+        log->n_samples++;
+        flash_log_add_to_summary(log->summary, packed);
+        return true;
+    }
+    return false;
+}
+
+bool flash_log_seek(flash_log_t *log, int64_t timestamp_us, uint32_t *index)
+{
+    if (log->n_used == 0) return false;
+
+    // Last sector starting at or before the timestamp
+    uint32_t low = 0;
+    uint32_t high = log->n_used;
+    while (high - low > 1U)
+    {
+        uint32_t mid = low + (high - low) / 2U;
+        uint32_t seq;
+        int64_t  start_us;
+        if (!flash_log_read_header(log, flash_log_physical(log, mid), &seq, &start_us)) return false;
+        if (start_us <= timestamp_us)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *index = low;
+    return true;
+}
+
+// Decode the samples of the sector in [start_us, end_us), false once past end_us
+static bool flash_log_scan_sector(flash_log_t              *log,
+                                  uint32_t                  index,
+                                  const flash_log_sector_t *info,
+                                  int64_t                   start_us,
+                                  int64_t                   end_us,
+                                  flash_log_sample_fn_t     fn,
+                                  void                     *ctx,
+                                  uint32_t                 *n_samples)
+{
+    flash_log_decoder_t decoder;
+    flash_log_decoder_init(&decoder, log, flash_log_physical(log, index), info->start_us);
+    uint32_t n_decoded = 0;
+    while (n_decoded < info->n_samples && flash_log_decoder_next(&decoder))
+    {
+        n_decoded++;
+        if (decoder.timestamp_us < start_us) continue;
+        if (decoder.timestamp_us >= end_us) return false;
+        float values[HISTORY_N_CHANNELS];
+        for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+        {
+            values[ch] = history_store_unpack((history_channel_t)ch, decoder.values[ch]);
+        }
+        fn(ctx, decoder.timestamp_us, values);
+        (*n_samples)++;
+    }
+    return true;
+}
+
+uint32_t flash_log_read(flash_log_t *log, int64_t start_us, int64_t end_us, flash_log_sample_fn_t fn, void *ctx)
+{
+    uint32_t index;
+    uint32_t n_samples = 0;
+    if (fn == NULL || !flash_log_seek(log, start_us, &index)) return 0;
+    for (; index < log->n_used; index++)
+    {
+        flash_log_sector_t info;
+        if (!flash_log_get_sector(log, index, &info)) break;
+        if (info.start_us >= end_us) break;
+        if (!flash_log_scan_sector(log, index, &info, start_us, end_us, fn, ctx, &n_samples)) break;
+    }
+    return n_samples;
+}
+
+typedef struct
+{
+    history_channel_t channel;
+    int16_t           min;
+    int16_t           max;
+    int64_t           sum;
+    uint32_t          n_valid;
+    uint32_t          n_scanned;
+} flash_log_acc_t;
+
+static void flash_log_acc_add(void *ctx, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS])
+{
+    (void)timestamp_us;
+    flash_log_acc_t *acc = ctx;
+    acc->n_scanned++;
+    int16_t value = history_store_pack(acc->channel, values[acc->channel]);
+    if (value == HISTORY_STORE_INVALID) return;
+    if (value < acc->min) acc->min = value;
+    if (value > acc->max) acc->max = value;
+    acc->sum += value;
+    acc->n_valid++;
+}
+
+bool flash_log_aggregate(flash_log_t         *log,
+                         history_channel_t    channel,
+                         int64_t              start_us,
+                         int64_t              end_us,
+                         history_aggregate_t *aggregate)
+{
+    if (log == NULL || aggregate == NULL || channel >= HISTORY_N_CHANNELS) return false;
+    memset(aggregate, 0, sizeof(*aggregate));
+    flash_log_acc_t acc = {.channel = channel, .min = INT16_MAX, .max = INT16_MIN};
+
+    uint32_t index;
+    uint32_t n_samples = 0;
+    bool     is_seeked = flash_log_seek(log, start_us, &index);
+    for (; is_seeked && index < log->n_used; index++)
+    {
+        flash_log_sector_t info;
+        if (!flash_log_get_sector(log, index, &info)) break;
+        if (info.start_us >= end_us) break;
+        if (info.has_summary && info.start_us >= start_us && info.end_us < end_us)
+        {
+            // Whole sector in the range: its summary, no decoding
+            const history_block_t *summary = &info.summary[channel];
+            aggregate->n_summaries++;
+            if (summary->n_valid == 0) continue;
+            if (summary->min < acc.min) acc.min = summary->min;
+            if (summary->max > acc.max) acc.max = summary->max;
+            acc.sum += summary->sum;
+            acc.n_valid += summary->n_valid;
+            continue;
+        }
+        if (!flash_log_scan_sector(log, index, &info, start_us, end_us, flash_log_acc_add, &acc, &n_samples)) break;
+    }
+
+    aggregate->n_samples = acc.n_valid;
+    aggregate->n_scanned = acc.n_scanned;
+    if (acc.n_valid == 0)
+    {
+        aggregate->min = NAN;
+        aggregate->max = NAN;
+        aggregate->mean = NAN;
+        return false;
+    }
+    aggregate->min = history_store_unpack(channel, acc.min);
+    aggregate->max = history_store_unpack(channel, acc.max);
+    float offset = history_store_unpack(channel, 0);
+    float resolution = history_store_unpack(channel, 1) - offset;
+    aggregate->mean = offset + (float)((double)acc.sum / acc.n_valid) * resolution;
+    return true;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "flash_log";
+
+    #ifdef CONFIG_METEO_FLASH_LOG_PERIOD_S
+        #define FLASH_LOG_PERIOD_S CONFIG_METEO_FLASH_LOG_PERIOD_S
+    #else
+        #define FLASH_LOG_PERIOD_S 60
+    #endif
+    #define FLASH_LOG_PARTITION_LABEL "meteo_log"
+
+// NOTE: The sensing task only adds its frame to the period sums, in a short critical section. The flash writes (and the
+// sector erases, about 45 ms every few hours at one sample a minute) stall the cache of both cores, the background task
+// does them once per period.
+static flash_log_t            s_log;
+static const esp_partition_t *s_partition = NULL;
+static portMUX_TYPE           s_lock = portMUX_INITIALIZER_UNLOCKED;
+static float                  s_period_sum[HISTORY_N_CHANNELS];
+static uint32_t               s_period_n_samples = 0;
+static int64_t                s_period_first_us; //< Monotonic stamps of the first and last frames of the period
+static int64_t                s_period_last_us;
+
+static bool flash_log_partition_read(void *ctx, uint32_t offset, void *data, size_t size)
+{
+    return esp_partition_read(ctx, offset, data, size) == ESP_OK;
+}
+
+static bool flash_log_partition_write(void *ctx, uint32_t offset, const void *data, size_t size)
+{
+    return esp_partition_write(ctx, offset, data, size) == ESP_OK;
+}
+
+static bool flash_log_partition_erase(void *ctx, uint32_t offset, size_t size)
+{
+    return esp_partition_erase_range(ctx, offset, size) == ESP_OK;
+}
+
+// UTC time of a monotonic stamp from the timebase, from the system clock until it is synced
+static int64_t flash_log_utc_us(int64_t mono_us)
+{
+    int64_t utc_us;
+    if (timebase_utc_us(mono_us, &utc_us)) return utc_us;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000LL + now.tv_usec - (esp_timer_get_time() - mono_us);
+}
+
+esp_err_t flash_log_init(void)
+{
+    s_partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FLASH_LOG_PARTITION_LABEL);
+    if (s_partition == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "No \"%s\" partition", FLASH_LOG_PARTITION_LABEL);
+        return ESP_FAIL;
+    }
+    flash_log_io_t io = {
+        .read = flash_log_partition_read,
+        .write = flash_log_partition_write,
+        .erase = flash_log_partition_erase,
+        .ctx = (void *)s_partition,
+        .size = s_partition->size - s_partition->size % FLASH_LOG_SECTOR_SIZE,
+    };
+    if (!flash_log_mount(&s_log, &io))
+    {
+        ESP_LOGE(LOG_TAG, "Mount failed!");
+        return ESP_FAIL;
+    }
+
+    // NOTE: The timestamps are the wall clock. Until it is set from a time source, the clock restarts from the epoch at
+    // each boot: it is moved past the last logged sample so the log stays sorted.
+    if (s_log.n_used > 0 && flash_log_utc_us(esp_timer_get_time()) < s_log.last_us)
+    {
+        int64_t        resume_us = s_log.last_us + FLASH_LOG_PERIOD_S * 1000000LL;
+        struct timeval resume = {.tv_sec = resume_us / 1000000LL, .tv_usec = resume_us % 1000000LL};
+        settimeofday(&resume, NULL);
+        timebase_refresh(); // Stepped to the resumed clock
+    }
+    ESP_LOGI(LOG_TAG,
+             "%lu of %lu sectors used, one sample every %d s",
+             (unsigned long)s_log.n_used,
+             (unsigned long)s_log.n_sectors,
+             FLASH_LOG_PERIOD_S);
+    return ESP_OK;
+}
+
+void flash_log_push(const meteo_frame_t *frame)
+{
+    if (s_partition == NULL) return;
+    taskENTER_CRITICAL(&s_lock);
+    s_period_sum[HISTORY_CH_TEMP] += frame->temperature_degc;
+    s_period_sum[HISTORY_CH_PRESS] += frame->pressure_pa;
+    s_period_sum[HISTORY_CH_HUMID] += frame->humidity_pct;
+    if (s_period_n_samples == 0) s_period_first_us = frame->timestamp_us;
+    s_period_last_us = frame->timestamp_us;
+    s_period_n_samples++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void flash_log_task(void *pvParameter)
+{
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(FLASH_LOG_PERIOD_S * 1000));
+        if (s_partition == NULL) continue;
+
+        // Average of the period, NaN for a channel missing in any frame, stamped between its first and last frames
+        float    values[HISTORY_N_CHANNELS];
+        uint32_t n_samples;
+        int64_t  mono_us;
+        taskENTER_CRITICAL(&s_lock);
+        n_samples = s_period_n_samples;
+        mono_us = s_period_first_us + (s_period_last_us - s_period_first_us) / 2;
+        for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+        {
+            values[ch] = (n_samples > 0) ? s_period_sum[ch] / (float)n_samples : NAN;
+            s_period_sum[ch] = 0.0f;
+        }
+        s_period_n_samples = 0;
+        taskEXIT_CRITICAL(&s_lock);
+        if (n_samples == 0) continue;
+
+        if (!flash_log_append(&s_log, flash_log_utc_us(mono_us), values))
+        {
+            ESP_LOGW(LOG_TAG, "Append failed, %lu samples rejected", (unsigned long)s_log.n_rejected);
+        }
+        else if (s_log.n_samples == 1)
+        {
+            ESP_LOGI(LOG_TAG, "Sector %lu opened", (unsigned long)s_log.next_seq - 1UL);
+        }
+    }
+}
+#endif
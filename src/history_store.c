@@ -0,0 +1,400 @@
+#include "history_store.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/semphr.h"
+
+    #include "esp_heap_caps.h"
+    #include "esp_log.h"
+    #include "esp_timer.h"
+#endif
+
+// Packed value = (value - offset) / resolution
+static const float s_offsets[HISTORY_N_CHANNELS] = {0.0f, 100000.0f, 0.0f};
+static const float s_resolutions[HISTORY_N_CHANNELS] = {0.01f, 1.0f, 0.01f};
+
+static uint32_t history_store_n_blocks(uint32_t capacity)
+{
+    return (capacity + HISTORY_STORE_BLOCK_LEN - 1U) / HISTORY_STORE_BLOCK_LEN;
+}
+
+size_t history_store_memory_size(uint32_t capacity)
+{
+    size_t n_blocks = history_store_n_blocks(capacity);
+    return HISTORY_N_CHANNELS * n_blocks * (sizeof(history_block_t) + HISTORY_STORE_BLOCK_LEN * sizeof(int16_t));
+}
+
+static void history_store_reset_block(history_block_t *block)
+{
+    block->min = INT16_MAX;
+    block->max = INT16_MIN;
+    block->sum = 0;
+    block->n_valid = 0;
+}
+
+static void history_store_restart(history_store_t *store, int64_t slot)
+{
+    store->first_slot = slot;
+    store->next_slot = slot;
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++) history_store_reset_block(&store->open_block[ch]);
+}
+
+bool history_store_init(history_store_t *store, int64_t period_us, uint32_t capacity, void *memory, size_t size)
+{
+    if (store == NULL || memory == NULL || period_us <= 0 || capacity == 0) return false;
+    if (size < history_store_memory_size(capacity) || ((uintptr_t)memory % sizeof(int32_t)) != 0) return false;
+
+    memset(store, 0, sizeof(*store));
+    uint32_t n_blocks = history_store_n_blocks(capacity);
+    store->capacity = n_blocks * HISTORY_STORE_BLOCK_LEN;
+    store->period_us = period_us;
+    // Summaries first for their alignment, then the columns
+    history_block_t *blocks = memory;
+    int16_t         *columns = (int16_t *)&blocks[HISTORY_N_CHANNELS * n_blocks];
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        store->blocks[ch] = &blocks[ch * n_blocks];
+        store->columns[ch] = &columns[(size_t)ch * store->capacity];
+        store->latest[ch] = NAN;
+    }
+    store->period_slot = -1;
+    history_store_restart(store, 0);
+    return true;
+}
+
+int16_t history_store_pack(history_channel_t channel, float value)
+{
+    if (channel >= HISTORY_N_CHANNELS || isnan(value)) return HISTORY_STORE_INVALID;
+    float packed = roundf((value - s_offsets[channel]) / s_resolutions[channel]);
+    if (packed < (float)(INT16_MIN + 1)) return INT16_MIN + 1;
+    if (packed > (float)INT16_MAX) return INT16_MAX;
+    return (int16_t)packed;
+}
+
+float history_store_unpack(history_channel_t channel, int16_t packed)
+{
+    if (channel >= HISTORY_N_CHANNELS || packed == HISTORY_STORE_INVALID) return NAN;
+    return s_offsets[channel] + (float)packed * s_resolutions[channel];
+}
+
+// Store the packed values at next_slot, the summary of a completed block is written when the next one starts
+static void history_store_put(history_store_t *store, const int16_t packed[HISTORY_N_CHANNELS])
+{
+    int64_t  slot = store->next_slot;
+    uint32_t n_blocks = store->capacity / HISTORY_STORE_BLOCK_LEN;
+    bool     is_block_start = (slot % HISTORY_STORE_BLOCK_LEN) == 0 && slot > store->first_slot;
+    uint32_t closed_block = (uint32_t)(((slot - 1) / HISTORY_STORE_BLOCK_LEN) % n_blocks);
+    uint32_t index = (uint32_t)(slot % store->capacity);
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        history_block_t *open = &store->open_block[ch];
+        if (is_block_start)
+        {
+            store->blocks[ch][closed_block] = *open;
+            history_store_reset_block(open);
+        }
+        int16_t value = packed[ch];
+        store->columns[ch][index] = value;
+        if (value == HISTORY_STORE_INVALID) continue;
+        if (value < open->min) open->min = value;
+        if (value > open->max) open->max = value;
+        open->sum += value;
+        open->n_valid++;
+    }
+    store->next_slot++;
+}
+
+static void history_store_commit_period(history_store_t *store)
+{
+    int64_t slot = store->period_slot;
+    if (slot - store->next_slot >= (int64_t)store->capacity)
+    {
+        history_store_restart(store, slot); // Gap longer than the history, nothing left to keep
+    }
+
+    // Missing periods since the last stored one
+    int16_t packed[HISTORY_N_CHANNELS];
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++) packed[ch] = HISTORY_STORE_INVALID;
+    while (store->next_slot < slot) history_store_put(store, packed);
+
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        if (store->period_n_samples == 0) continue;
+        packed[ch] = history_store_pack((history_channel_t)ch, store->period_sum[ch] / (float)store->period_n_samples);
+    }
+    history_store_put(store, packed);
+}
+
+void history_store_add(history_store_t *store, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS])
+{
+    int64_t slot = timestamp_us / store->period_us;
+    if (store->period_slot < 0)
+    {
+        store->period_slot = slot;
+        history_store_restart(store, slot);
+    }
+    else if (slot > store->period_slot)
+    {
+        history_store_commit_period(store);
+        store->period_slot = slot;
+        memset(store->period_sum, 0, sizeof(store->period_sum));
+        store->period_n_samples = 0;
+    }
+    // NOTE: A sample older than the current period (clock going back) is averaged in the current period
+
+    // A NaN value makes the period average of its channel NaN, stored as missing
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        store->period_sum[ch] += values[ch];
+        store->latest[ch] = values[ch];
+    }
+    store->period_n_samples++;
+    store->latest_us = timestamp_us;
+}
+
+// First slot still stored: a block is overwritten as a whole once the ring wrapped
+static int64_t history_store_oldest_slot(const history_store_t *store)
+{
+    int64_t n_blocks = store->capacity / HISTORY_STORE_BLOCK_LEN;
+    int64_t oldest = ((store->next_slot - 1) / HISTORY_STORE_BLOCK_LEN - n_blocks + 1) * HISTORY_STORE_BLOCK_LEN;
+    return (oldest > store->first_slot) ? oldest : store->first_slot;
+}
+
+bool history_store_range(const history_store_t *store, int64_t *first_us, int64_t *end_us)
+{
+    if (store->next_slot == store->first_slot) return false;
+    if (first_us != NULL) *first_us = history_store_oldest_slot(store) * store->period_us;
+    if (end_us != NULL) *end_us = store->next_slot * store->period_us;
+    return true;
+}
+
+static int64_t history_store_slot_ceil(const history_store_t *store, int64_t timestamp_us)
+{
+    if (timestamp_us <= 0) return 0;
+    return (timestamp_us + store->period_us - 1) / store->period_us;
+}
+
+typedef struct
+{
+    int16_t  min;
+    int16_t  max;
+    int64_t  sum;
+    uint32_t n_valid;
+    uint32_t n_scanned;
+    uint32_t n_summaries;
+} history_store_acc_t;
+
+// Slots [start, end), the whole blocks in between from their summaries
+static void history_store_scan(const history_store_t *store,
+                               uint8_t                channel,
+                               int64_t                start,
+                               int64_t                end,
+                               history_store_acc_t   *acc)
+{
+    int64_t oldest = history_store_oldest_slot(store);
+    if (start < oldest) start = oldest;
+    if (end > store->next_slot) end = store->next_slot;
+    int64_t        open_block = (store->next_slot - 1) / HISTORY_STORE_BLOCK_LEN;
+    uint32_t       n_blocks = store->capacity / HISTORY_STORE_BLOCK_LEN;
+    const int16_t *column = store->columns[channel];
+    int64_t        slot = start;
+    while (slot < end)
+    {
+        int64_t block = slot / HISTORY_STORE_BLOCK_LEN;
+        int64_t block_end = (block + 1) * HISTORY_STORE_BLOCK_LEN;
+        if (slot == block * HISTORY_STORE_BLOCK_LEN && block_end <= end)
+        {
+            const history_block_t *summary = (block == open_block)
+                                               ? &store->open_block[channel]
+                                               : &store->blocks[channel][(uint32_t)(block % n_blocks)];
+            acc->n_summaries++;
+            if (summary->n_valid > 0)
+            {
+                if (summary->min < acc->min) acc->min = summary->min;
+                if (summary->max > acc->max) acc->max = summary->max;
+                acc->sum += summary->sum;
+                acc->n_valid += summary->n_valid;
+            }
+            slot = block_end;
+            continue;
+        }
+
+        int64_t scan_end = (block_end < end) ? block_end : end;
+        acc->n_scanned += (uint32_t)(scan_end - slot);
+        for (; slot < scan_end; slot++)
+        {
+            int16_t value = column[(uint32_t)(slot % store->capacity)];
+            if (value == HISTORY_STORE_INVALID) continue;
+            if (value < acc->min) acc->min = value;
+            if (value > acc->max) acc->max = value;
+            acc->sum += value;
+            acc->n_valid++;
+        }
+    }
+}
+
+static void history_store_acc_reset(history_store_acc_t *acc)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->min = INT16_MAX;
+    acc->max = INT16_MIN;
+}
+
+bool history_store_aggregate(const history_store_t *store,
+                             history_channel_t      channel,
+                             int64_t                start_us,
+                             int64_t                end_us,
+                             history_aggregate_t   *aggregate)
+{
+    if (store == NULL || aggregate == NULL || channel >= HISTORY_N_CHANNELS) return false;
+
+    history_store_acc_t acc;
+    history_store_acc_reset(&acc);
+    history_store_scan(
+        store, channel, history_store_slot_ceil(store, start_us), history_store_slot_ceil(store, end_us), &acc);
+    aggregate->n_samples = acc.n_valid;
+    aggregate->n_scanned = acc.n_scanned;
+    aggregate->n_summaries = acc.n_summaries;
+    if (acc.n_valid == 0)
+    {
+        aggregate->min = NAN;
+        aggregate->max = NAN;
+        aggregate->mean = NAN;
+        return false;
+    }
+    aggregate->min = history_store_unpack(channel, acc.min);
+    aggregate->max = history_store_unpack(channel, acc.max);
+    aggregate->mean = s_offsets[channel] + (float)((double)acc.sum / acc.n_valid) * s_resolutions[channel];
+    return true;
+}
+
+uint32_t history_store_decimate(const history_store_t *store,
+                                history_channel_t      channel,
+                                int64_t                start_us,
+                                int64_t                end_us,
+                                minmax_bucket_t       *buckets,
+                                uint32_t               n_buckets)
+{
+    if (store == NULL || buckets == NULL || channel >= HISTORY_N_CHANNELS || n_buckets == 0) return 0;
+
+    uint32_t n_read = 0;
+    int64_t  start = history_store_slot_ceil(store, start_us);
+    int64_t  span = history_store_slot_ceil(store, end_us) - start;
+    for (uint32_t i = 0; i < n_buckets; i++)
+    {
+        history_store_acc_t acc;
+        history_store_acc_reset(&acc);
+        history_store_scan(store, channel, start + span * i / n_buckets, start + span * (i + 1) / n_buckets, &acc);
+        n_read += acc.n_scanned + acc.n_summaries;
+        buckets[i].min = (acc.n_valid > 0) ? history_store_unpack(channel, acc.min) : INFINITY;
+        buckets[i].max = (acc.n_valid > 0) ? history_store_unpack(channel, acc.max) : -INFINITY;
+    }
+    return n_read;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "history";
+
+    #ifdef CONFIG_METEO_HISTORY_DAYS
+        #define HISTORY_DAYS CONFIG_METEO_HISTORY_DAYS
+    #else
+        #define HISTORY_DAYS 7
+    #endif
+    #define HISTORY_PERIOD_US 1000000LL
+
+// NOTE: The queries hold the lock for a bounded time (a few hundred summaries at most for a chart), the sensing task
+// waits at most that long to store a sample.
+static history_store_t   s_store;
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buffer;
+
+    #ifdef CONFIG_METEO_HISTORY_BENCH
+// A week of synthetic 1 s samples in the PSRAM columns, then the same queries as the host benchmark
+static void history_bench(void)
+{
+    const int64_t week_us = 7LL * 86400LL * HISTORY_PERIOD_US;
+    for (int64_t t = 0; t < week_us; t += HISTORY_PERIOD_US)
+    {
+        float values[HISTORY_N_CHANNELS] = {20.0f + (float)(t % 3600000000LL) * 1e-9f, 101325.0f, 50.0f};
+        history_store_add(&s_store, t, values);
+    }
+
+    static const struct
+    {
+        const char *name;
+        int64_t     span_us;
+    } s_queries[] = {{"hour", 3600LL * HISTORY_PERIOD_US},
+                     {"day", 86400LL * HISTORY_PERIOD_US},
+                     {"week", 7LL * 86400LL * HISTORY_PERIOD_US}};
+    for (uint8_t i = 0; i < sizeof(s_queries) / sizeof(s_queries[0]); i++)
+    {
+        history_aggregate_t aggregate;
+        int64_t             query_start_us = week_us - s_queries[i].span_us - 1234567; // Not block aligned
+        int64_t             start_us = esp_timer_get_time();
+        history_store_aggregate(&s_store, HISTORY_CH_TEMP, query_start_us, week_us, &aggregate);
+        int64_t elapsed_us = esp_timer_get_time() - start_us;
+        ESP_LOGI(LOG_TAG,
+                 "Aggregate of a %s: %lld us, %lu values and %lu summaries read",
+                 s_queries[i].name,
+                 elapsed_us,
+                 (unsigned long)aggregate.n_scanned,
+                 (unsigned long)aggregate.n_summaries);
+    }
+    minmax_bucket_t buckets[MINMAX_SERIES_LEN];
+    int64_t         start_us = esp_timer_get_time();
+    uint32_t        n_read = history_store_decimate(&s_store, HISTORY_CH_TEMP, 0, week_us, buckets, MINMAX_SERIES_LEN);
+    ESP_LOGI(LOG_TAG,
+             "Week chart decimation: %lld us, %lu values read",
+             esp_timer_get_time() - start_us,
+             (unsigned long)n_read);
+}
+    #endif
+
+esp_err_t history_init(void)
+{
+    uint32_t capacity = HISTORY_DAYS * 86400U;
+    size_t   size = history_store_memory_size(capacity);
+    void    *memory = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (memory == NULL)
+    {
+        ESP_LOGE(LOG_TAG, "No PSRAM for %u days of history (%u bytes)", (unsigned)HISTORY_DAYS, (unsigned)size);
+        return ESP_FAIL;
+    }
+    history_store_init(&s_store, HISTORY_PERIOD_US, capacity, memory, size);
+    #ifdef CONFIG_METEO_HISTORY_BENCH
+    history_bench();
+    history_store_init(&s_store, HISTORY_PERIOD_US, capacity, memory, size);
+    #endif
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+    ESP_LOGI(LOG_TAG, "%u days of history in %u bytes of PSRAM", (unsigned)HISTORY_DAYS, (unsigned)size);
+    return ESP_OK;
+}
+
+void history_push(const meteo_frame_t *frame)
+{
+    if (s_lock == NULL) return;
+    float values[HISTORY_N_CHANNELS] = {
+        [HISTORY_CH_TEMP] = frame->temperature_degc,
+        [HISTORY_CH_PRESS] = frame->pressure_pa,
+        [HISTORY_CH_HUMID] = frame->humidity_pct,
+    };
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    history_store_add(&s_store, frame->timestamp_us, values);
+    xSemaphoreGive(s_lock);
+}
+
+bool history_decimate(
+    history_channel_t channel, int64_t start_us, int64_t end_us, minmax_bucket_t *buckets, uint32_t n_buckets)
+{
+    if (s_lock == NULL) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    history_store_decimate(&s_store, channel, start_us, end_us, buckets, n_buckets);
+    xSemaphoreGive(s_lock);
+    return true;
+}
+#endif
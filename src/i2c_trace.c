@@ -0,0 +1,223 @@
+#include "i2c_trace.h"
+
+#include <string.h>
+
+#include "byte_codec.h"
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_METEO_I2C_TRACE)
+    #include "esp_timer.h"
+
+    #include "data_stream.h"
+#endif
+
+#define I2C_TRACE_BME68X_OK         0
+#define I2C_TRACE_BME68X_E_COM_FAIL -2
+
+size_t i2c_trace_encode(const i2c_trace_record_t *record, uint8_t *buffer, size_t buffer_size)
+{
+    if (record == NULL || buffer == NULL) return 0;
+
+    // Truncate to I2C_TRACE_MAX_DATA bytes in total, the write bytes first
+    uint8_t  flags = record->flags;
+    uint16_t write_length = record->write_length;
+    uint16_t read_length = record->read_length;
+    if (write_length > I2C_TRACE_MAX_DATA)
+    {
+        write_length = I2C_TRACE_MAX_DATA;
+        flags |= I2C_TRACE_FLAG_TRUNCATED;
+    }
+    if (read_length > I2C_TRACE_MAX_DATA - write_length)
+    {
+        read_length = I2C_TRACE_MAX_DATA - write_length;
+        flags |= I2C_TRACE_FLAG_TRUNCATED;
+    }
+
+    uint8_t  header[2 + 10 + 3 + 3];
+    uint8_t *dst = header;
+    *dst++ = (uint8_t)((record->kind & I2C_TRACE_KIND_MASK) | (flags & ~I2C_TRACE_KIND_MASK));
+    *dst++ = record->address & 0x7FU;
+    dst = put_varint(dst, (uint64_t)record->timestamp_us);
+    dst = put_varint(dst, write_length);
+    dst = put_varint(dst, read_length);
+
+    size_t header_size = (size_t)(dst - header);
+    size_t size = header_size + write_length + read_length;
+    if (size > buffer_size) return 0;
+    memcpy(buffer, header, header_size);
+    if (write_length > 0) memcpy(&buffer[header_size], record->write_data, write_length);
+    if (read_length > 0) memcpy(&buffer[header_size + write_length], record->read_data, read_length);
+    return size;
+}
+
+size_t i2c_trace_decode(const uint8_t *buffer, size_t buffer_size, i2c_trace_record_t *record)
+{
+    if (buffer == NULL || record == NULL || buffer_size < 2) return 0;
+
+    record->kind = buffer[0] & I2C_TRACE_KIND_MASK;
+    record->flags = buffer[0] & ~I2C_TRACE_KIND_MASK;
+    record->address = buffer[1];
+    if (record->kind > I2C_TRACE_WRITE_READ || record->address > 0x7FU) return 0;
+
+    size_t   offset = 2;
+    uint64_t values[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        size_t n = get_varint(&buffer[offset], buffer_size - offset, &values[i]);
+        if (n == 0) return 0;
+        offset += n;
+    }
+    if (values[1] > I2C_TRACE_MAX_DATA || values[2] > I2C_TRACE_MAX_DATA) return 0;
+    record->timestamp_us = (int64_t)values[0];
+    record->write_length = (uint16_t)values[1];
+    record->read_length = (uint16_t)values[2];
+
+    if (buffer_size - offset < (size_t)record->write_length + record->read_length) return 0;
+    record->write_data = &buffer[offset];
+    record->read_data = &buffer[offset + record->write_length];
+    return offset + record->write_length + record->read_length;
+}
+
+size_t i2c_trace_encode_header(uint8_t *buffer, size_t buffer_size)
+{
+    if (buffer == NULL || buffer_size < I2C_TRACE_HEADER_SIZE) return 0;
+    memcpy(buffer, I2C_TRACE_MAGIC, 4);
+    buffer[4] = I2C_TRACE_VERSION;
+    return I2C_TRACE_HEADER_SIZE;
+}
+
+bool i2c_trace_replay_init(i2c_trace_replay_t *replay, const uint8_t *buffer, size_t size)
+{
+    memset(replay, 0, sizeof(*replay));
+    if (buffer == NULL || size < I2C_TRACE_HEADER_SIZE) return false;
+    if (memcmp(buffer, I2C_TRACE_MAGIC, 4) != 0 || buffer[4] != I2C_TRACE_VERSION) return false;
+    replay->data = &buffer[I2C_TRACE_HEADER_SIZE];
+    replay->size = size - I2C_TRACE_HEADER_SIZE;
+    return true;
+}
+
+// Next record of the device from its cursor, the cursor is moved past it. False at the end of the trace.
+static bool i2c_trace_replay_next(i2c_trace_replay_t *replay, uint8_t address, i2c_trace_record_t *record)
+{
+    size_t *cursor = &replay->cursors[address & 0x7FU];
+    while (*cursor < replay->size)
+    {
+        size_t size = i2c_trace_decode(&replay->data[*cursor], replay->size - *cursor, record);
+        if (size == 0)
+        {
+            *cursor = replay->size; // Corrupted or cut trace, ends here
+            return false;
+        }
+        *cursor += size;
+        if (record->address == (address & 0x7FU)) return true;
+    }
+    return false;
+}
+
+bool i2c_trace_replay_transfer(i2c_trace_replay_t *replay,
+                               uint8_t             address,
+                               const uint8_t      *write_data,
+                               size_t              write_length,
+                               uint8_t            *read_data,
+                               size_t              read_length)
+{
+    i2c_trace_record_t record;
+    if (!i2c_trace_replay_next(replay, address, &record)) return false;
+
+    uint8_t kind = (write_length > 0) ? ((read_length > 0) ? I2C_TRACE_WRITE_READ : I2C_TRACE_WRITE) : I2C_TRACE_READ;
+    bool    is_truncated = (record.flags & I2C_TRACE_FLAG_TRUNCATED) != 0;
+    bool    is_match = (record.kind == kind) && (is_truncated ? (write_length >= record.write_length)
+                                                              : (write_length == record.write_length));
+    // Truncated records only compare their prefix
+    if (is_match && record.write_length > 0)
+    {
+        is_match = memcmp(write_data, record.write_data, record.write_length) == 0;
+    }
+    if (is_match && !is_truncated) is_match = (read_length == record.read_length);
+    if (!is_match)
+    {
+        replay->n_mismatches++;
+        return false;
+    }
+
+    replay->now_us = record.timestamp_us;
+    replay->n_replayed++;
+    if (read_length > 0)
+    {
+        size_t n_recorded = (record.read_length < read_length) ? record.read_length : read_length;
+        memcpy(read_data, record.read_data, n_recorded);
+        memset(&read_data[n_recorded], 0, read_length - n_recorded);
+    }
+    return (record.flags & I2C_TRACE_FLAG_ERROR) == 0;
+}
+
+bool i2c_trace_replay_is_done(const i2c_trace_replay_t *replay, uint8_t address)
+{
+    // Done when no record of the device is left after its cursor
+    size_t             cursor = replay->cursors[address & 0x7FU];
+    i2c_trace_record_t record;
+    while (cursor < replay->size)
+    {
+        size_t size = i2c_trace_decode(&replay->data[cursor], replay->size - cursor, &record);
+        if (size == 0) return true;
+        if (record.address == (address & 0x7FU)) return false;
+        cursor += size;
+    }
+    return true;
+}
+
+int64_t i2c_trace_replay_now_us(const i2c_trace_replay_t *replay)
+{
+    return replay->now_us;
+}
+
+int8_t i2c_trace_bme68x_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    i2c_trace_bme68x_intf_t *intf = (i2c_trace_bme68x_intf_t *)intf_ptr;
+    bool                     is_ok
+        = i2c_trace_replay_transfer(intf->replay, intf->address, &reg_addr, 1, reg_data, length);
+    return is_ok ? I2C_TRACE_BME68X_OK : I2C_TRACE_BME68X_E_COM_FAIL;
+}
+
+int8_t i2c_trace_bme68x_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    // Same bytes on the bus as the device port: the register address, then the data
+    i2c_trace_bme68x_intf_t *intf = (i2c_trace_bme68x_intf_t *)intf_ptr;
+    uint8_t                  write_data[I2C_TRACE_MAX_DATA];
+    if (length >= sizeof(write_data)) length = sizeof(write_data) - 1; // Compared with the truncated record
+    write_data[0] = reg_addr;
+    memcpy(&write_data[1], reg_data, length);
+    bool is_ok = i2c_trace_replay_transfer(intf->replay, intf->address, write_data, length + 1, NULL, 0);
+    return is_ok ? I2C_TRACE_BME68X_OK : I2C_TRACE_BME68X_E_COM_FAIL;
+}
+
+void i2c_trace_bme68x_delay_us(uint32_t period, void *intf_ptr)
+{
+    // Fast-forward: the time of the next replayed record is the recorded one
+    (void)period;
+    (void)intf_ptr;
+}
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_METEO_I2C_TRACE)
+void i2c_trace_capture(uint8_t        kind,
+                       uint8_t        address,
+                       const uint8_t *write_data,
+                       size_t         write_length,
+                       const uint8_t *read_data,
+                       size_t         read_length,
+                       bool           is_ok)
+{
+    const i2c_trace_record_t record = {
+        .timestamp_us = esp_timer_get_time(),
+        .kind = kind,
+        .flags = is_ok ? 0 : I2C_TRACE_FLAG_ERROR,
+        .address = address,
+        .write_length = (write_length > I2C_TRACE_MAX_DATA) ? I2C_TRACE_MAX_DATA + 1 : (uint16_t)write_length,
+        .read_length = (read_length > I2C_TRACE_MAX_DATA) ? I2C_TRACE_MAX_DATA + 1 : (uint16_t)read_length,
+        .write_data = write_data,
+        .read_data = read_data,
+    };
+    uint8_t encoded[I2C_TRACE_MAX_RECORD_SIZE];
+    size_t  length = i2c_trace_encode(&record, encoded, sizeof(encoded));
+    if (length > 0) data_stream_push_i2c_trace(encoded, length);
+}
+#endif
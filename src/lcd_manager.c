@@ -1,6 +1,7 @@
 #include "lcd_manager.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -10,22 +11,40 @@
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_vendor.h"
 #include "esp_log.h"
-#include "esp_lvgl_port.h"
+#include "esp_timer.h"
 
-#include "lvgl.h"
-#include "ui.h" //< For EEZ Studio functions
-#include "vars.h"
+#ifdef CONFIG_METEO_UI_MINIMAL
+    #include "mono_ui.h"
+    #ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+        #include "history_store.h"
+        #include "minmax_series.h"
+        #include "mono_chart.h"
+    #endif
+#else
+    #include "esp_lvgl_port.h"
 
+    #include "lvgl.h"
+    #include "ui.h" //< For EEZ Studio functions
+    #include "vars.h"
+#endif
+
+#include "alert_engine.h"
+#include "display_policy.h"
+#include "i2c_trace.h"
 #include "lcd_variables.h"
+#include "task_jitter.h"
+#include "task_plan.h"
+#include "tuning.h"
+#include "warm_boot.h"
 
 static const char *LOG_TAG = "lcd";
 
-#define LVGL_LOCK_TIMEOUT_MS 1000U
-#define UI_TASK_PERIOD_MS    10U
+#define LVGL_LOCK_TIMEOUT_MS    1000U
+#define UI_PREEMPT_THRESHOLD_US 2000U
+#define UI_STATS_PERIOD_MS      10000U
 
-#define LCD_PIXEL_CLOCK_HZ   (400 * 1000)
-#define LCD_RESET_PIN_NUM    -1 // No LCD reset pin on XIAO Expansion Base Board -  -1 for unused
-#define LCD_I2C_HW_ADDR      0x3C
+#define LCD_RESET_PIN_NUM       -1 // No LCD reset pin on XIAO Expansion Base Board -  -1 for unused
+#define LCD_I2C_HW_ADDR         0x3C
 
 // The pixel number in horizontal and vertical
 #define SSD1306_LCD_H_RES 128
@@ -35,14 +54,43 @@ static const char *LOG_TAG = "lcd";
 #define SSD1306_LCD_CMD_BITS   8
 #define SSD1306_LCD_PARAM_BITS 8
 
+#ifdef CONFIG_METEO_UI_MINIMAL
+static mono_ui_t s_mono_ui;
+
+    #ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+        #define UI_HISTORY_SAMPLE_PERIOD_MS 1000U
+        #define UI_HISTORY_DURATION_US      ((int64_t)CONFIG_METEO_UI_HISTORY_HOURS * 3600 * 1000000)
+        #define UI_HISTORY_BUCKET_PERIOD_US (UI_HISTORY_DURATION_US / MINMAX_SERIES_LEN) //< One bucket per chart column
+        #ifdef CONFIG_METEO_UI_HISTORY_SCROLL
+            #define UI_HISTORY_CHART_MODE MONO_CHART_SCROLL
+        #else
+            #define UI_HISTORY_CHART_MODE MONO_CHART_SWEEP
+        #endif
+
+// NOTE: The history screen shares the framebuffer of the main screen, it is fully drawn when shown
+static minmax_series_t     s_temp_history;
+static minmax_series_t     s_press_history;
+static mono_chart_screen_t s_history_screen;
+static bool                s_is_history_shown = false;
+        #ifdef CONFIG_METEO_HISTORY
+static bool s_is_history_stored = true; //< Until a load finds the store not running, then the screen samples alone
+        #endif
+    #endif
+#else
 static lv_display_t *s_disp = NULL;
+static int64_t       s_render_start_us = 0;
+// NOTE: The alert label is not in the EEZ Studio project, it is added at runtime on the main screen
+static lv_obj_t     *s_alert_label = NULL;
+static uint32_t      s_shown_alerts_version = 0;
+#endif
 
 // LCD I2C Variables
+static i2c_master_bus_handle_t   s_lcd_i2c_bus = NULL;
 static esp_lcd_panel_io_handle_t s_lcd_io_handle = NULL;
 
-static const esp_lcd_panel_io_i2c_config_t io_config = {
+static esp_lcd_panel_io_i2c_config_t io_config = {
     .dev_addr = LCD_I2C_HW_ADDR,
-    .scl_speed_hz = LCD_PIXEL_CLOCK_HZ,
+    .scl_speed_hz = TUNING_DEFAULT_I2C_HZ, // Changed at runtime by lcd_manager_set_i2c_speed()
     .control_phase_bytes = 1,               // According to SSD1306 datasheet
     .lcd_cmd_bits = SSD1306_LCD_CMD_BITS,   // According to SSD1306 datasheet
     .lcd_param_bits = SSD1306_LCD_CMD_BITS, // According to SSD1306 datasheet
@@ -59,13 +107,342 @@ static const esp_lcd_panel_dev_config_t s_panel_config = {
     .vendor_config = &s_ssd1306_config,
 };
 
-static const lvgl_port_cfg_t s_lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+static task_jitter_t s_jitter;
+
+#ifdef CONFIG_METEO_UI_POWER_SAVE
+// NOTE: Applied by the lcd task. While the panel is off the minimal renderer keeps drawing in its framebuffer and
+// sends the dirty pages at the wake, LVGL stops invalidating and redraws the whole screen at the wake.
+static const display_policy_config_t s_display_policy_config = {
+    .dim_after_us = (int64_t)CONFIG_METEO_UI_DIM_AFTER_S * 1000000,
+    .off_after_us = (int64_t)CONFIG_METEO_UI_OFF_AFTER_S * 1000000,
+    .dim_contrast = CONFIG_METEO_UI_DIM_CONTRAST,
+    .wake_temp_degc = 0.5f,
+    .wake_humid_pct = 3.0f,
+    .wake_press_kpa = 0.2f,
+};
+static display_policy_t       s_display_policy;
+static display_policy_state_t s_display_state = DISPLAY_POLICY_ON; //< Applied to the panel
+#endif
+
+// Tuning, applied by the lcd task between two ticks
+static portMUX_TYPE s_tuning_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     s_period_ms = TUNING_DEFAULT_UI_PERIOD_MS;
+static uint32_t     s_i2c_speed_hz = TUNING_DEFAULT_I2C_HZ;
+static bool         s_is_i2c_speed_changed = false;
+
+// Ticks and panel traffic since boot for the tuning perf command, published under s_tuning_lock. The bytes are only
+// counted with the minimal renderer (LVGL flushes from its own task).
+typedef struct
+{
+    uint32_t n_ticks;
+    uint64_t busy_us;
+    uint32_t n_transfers;
+    uint64_t n_bytes;
+} lcd_perf_t;
+
+static lcd_perf_t s_perf;
+static lcd_perf_t s_bus_perf; //< Updated by the page writes, lcd task only
+
+// NOTE: Renderer cost, to compare the LVGL/EEZ stack with the minimal renderer. The tick is the per period update
+// (EEZ flow and bindings, or the minimal field update), the frame is the render and flush of a changed screen.
+typedef struct
+{
+    uint32_t n;
+    uint32_t max_us;
+    uint64_t total_us;
+} ui_time_stats_t;
+
+typedef struct
+{
+    ui_time_stats_t tick;
+    ui_time_stats_t frame;
+    uint64_t        frame_bytes; //< Only known for the minimal renderer
+} ui_stats_t;
+
+static ui_stats_t s_ui_stats = {0};
+
+static void ui_time_stats_add(ui_time_stats_t *stats, int64_t duration_us)
+{
+    uint32_t us = (duration_us > 0) ? (uint32_t)duration_us : 0;
+    stats->n++;
+    stats->total_us += us;
+    if (us > stats->max_us) stats->max_us = us;
+}
+
+static void ui_stats_log(const ui_stats_t *stats)
+{
+    uint32_t tick_avg_us = stats->tick.n ? (uint32_t)(stats->tick.total_us / stats->tick.n) : 0;
+    uint32_t frame_avg_us = stats->frame.n ? (uint32_t)(stats->frame.total_us / stats->frame.n) : 0;
+    uint32_t frame_avg_bytes = stats->frame.n ? (uint32_t)(stats->frame_bytes / stats->frame.n) : 0;
+    ESP_LOGI(LOG_TAG,
+             "UI tick avg %lu us (max %lu), %lu frames avg %lu us (max %lu), %lu bytes/frame",
+             (unsigned long)tick_avg_us,
+             (unsigned long)stats->tick.max_us,
+             (unsigned long)stats->frame.n,
+             (unsigned long)frame_avg_us,
+             (unsigned long)stats->frame.max_us,
+             (unsigned long)frame_avg_bytes);
+}
+
+#ifdef CONFIG_METEO_UI_MINIMAL
+static bool lcd_manager_write_page(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data)
+{
+    // Page aligned area, the SSD1306 driver sends the bytes as is (horizontal addressing, one byte per column)
+    bool is_ok = esp_lcd_panel_draw_bitmap(s_lcd_panel_handle, col_start, page * 8, col_end, (page + 1) * 8, data) ==
+                 ESP_OK;
+    s_bus_perf.n_transfers += 3; // Column range, page range, then the pixels after a control byte each
+    s_bus_perf.n_bytes += 4U + 4U + 1U + (col_end - col_start);
+#ifdef CONFIG_METEO_I2C_TRACE
+    // Traced as the transfers the driver sends (control byte, column and page ranges, then the pixel bytes), so a
+    // trace replays in the host SSD1306 emulator (ssd1306_emu.h)
+    const uint8_t columns[] = {0x00, 0x21, col_start, col_end - 1};
+    const uint8_t pages[] = {0x00, 0x22, page, page};
+    uint8_t       pixels[1 + MONO_FB_WIDTH] = {0x40};
+    memcpy(&pixels[1], data, col_end - col_start);
+    I2C_TRACE_CAPTURE(I2C_TRACE_WRITE, LCD_I2C_HW_ADDR, columns, sizeof(columns), NULL, 0, is_ok);
+    I2C_TRACE_CAPTURE(I2C_TRACE_WRITE, LCD_I2C_HW_ADDR, pages, sizeof(pages), NULL, 0, is_ok);
+    I2C_TRACE_CAPTURE(I2C_TRACE_WRITE, LCD_I2C_HW_ADDR, pixels, 1 + col_end - col_start, NULL, 0, is_ok);
+#endif
+    return is_ok;
+}
+
+// NOTE: The panel IO keeps its clock, it is created again with the new one. The SSD1306 init sequence turns the
+// display off, so the whole framebuffer is sent again after it.
+static esp_err_t lcd_manager_update_i2c_speed(uint32_t scl_speed_hz)
+{
+    io_config.scl_speed_hz = scl_speed_hz;
+    esp_err_t ret = ESP_OK;
+    // A failed attempt is retried from where it stopped
+    if (s_lcd_panel_handle != NULL)
+    {
+        ret = esp_lcd_panel_del(s_lcd_panel_handle);
+        if (ret == ESP_OK) s_lcd_panel_handle = NULL;
+    }
+    if ((ret == ESP_OK) && (s_lcd_io_handle != NULL))
+    {
+        ret = esp_lcd_panel_io_del(s_lcd_io_handle);
+        if (ret == ESP_OK) s_lcd_io_handle = NULL;
+    }
+    if (ret == ESP_OK) ret = esp_lcd_new_panel_io_i2c(s_lcd_i2c_bus, &io_config, &s_lcd_io_handle);
+    if (ret == ESP_OK) ret = esp_lcd_new_panel_ssd1306(s_lcd_io_handle, &s_panel_config, &s_lcd_panel_handle);
+    if (ret == ESP_OK) ret = esp_lcd_panel_init(s_lcd_panel_handle);
+    if (ret == ESP_OK) ret = esp_lcd_panel_disp_on_off(s_lcd_panel_handle, true);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG,
+                 "Display I2C clock change to %lu Hz failed: %s",
+                 (unsigned long)scl_speed_hz,
+                 esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    mono_fb_mark_all_dirty(&s_mono_ui.fb);
+    #ifdef CONFIG_METEO_UI_POWER_SAVE
+    s_display_state = DISPLAY_POLICY_ON; // On at the reset contrast, the policy state is applied again
+    #endif
+    ESP_LOGI(LOG_TAG, "Display I2C clock set to %lu Hz", (unsigned long)scl_speed_hz);
+    return ESP_OK;
+}
+
+static void lcd_manager_mono_tick(void)
+{
+    int64_t start_us;
+#ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+    if (s_is_history_shown)
+    {
+        // Only the columns of the buckets started since the last tick are drawn
+        start_us = esp_timer_get_time();
+        mono_chart_screen_update(&s_history_screen, &s_mono_ui.fb, &s_temp_history, &s_press_history);
+    }
+    else
+#endif
+    {
+        // One consistent copy, e.g. the temperature and its sign label always come from the same measurement
+        lcd_variables_t vars;
+        lcd_variables_snapshot(&vars);
+        const mono_ui_values_t values = {
+            .amb_temp_degc = vars.amb_temp_degc,
+            .amb_humid_pct = vars.amb_humid_pct,
+            .amb_press_kpa = vars.amb_press_kpa,
+            .is_amb_temp_negative = vars.is_amb_temp_negative,
+            .is_station_connected = vars.is_station_connected,
+            .alert_name = alert_engine_first_name((uint8_t)vars.active_alerts),
+        };
+        start_us = esp_timer_get_time();
+        mono_ui_update(&s_mono_ui, &values);
+    }
+    ui_time_stats_add(&s_ui_stats.tick, esp_timer_get_time() - start_us);
+
+    #ifdef CONFIG_METEO_UI_POWER_SAVE
+    // Panel off: the changed pages stay dirty until the wake
+    if (s_display_state == DISPLAY_POLICY_OFF) return;
+    #endif
+    // Nothing to send when no displayed field changed (and no page was left dirty by a failed write)
+    size_t n_bytes = mono_fb_flush(&s_mono_ui.fb, lcd_manager_write_page, NULL);
+    if (n_bytes == 0) return;
+    ui_time_stats_add(&s_ui_stats.frame, esp_timer_get_time() - start_us);
+    s_ui_stats.frame_bytes += n_bytes;
+}
+
+#ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+    #ifdef CONFIG_METEO_HISTORY
+// The series are rebuilt from the history store (1 s averages of every sample) when the screen is shown. Their buckets
+// are aligned on the monotonic time, the newest one is being filled and takes the displayed values from then on.
+static bool lcd_manager_history_load(void)
+{
+    const int64_t period_us = UI_HISTORY_BUCKET_PERIOD_US;
+    int64_t       newest_index = esp_timer_get_time() / period_us;
+    int64_t       end_us = (newest_index + 1) * period_us;
+    uint32_t      n_buckets = (newest_index + 1 < MINMAX_SERIES_LEN) ? (uint32_t)newest_index + 1U : MINMAX_SERIES_LEN;
+    int64_t       start_us = end_us - n_buckets * period_us;
+
+    minmax_bucket_t buckets[MINMAX_SERIES_LEN];
+    if (!history_decimate(HISTORY_CH_TEMP, start_us, end_us, buckets, n_buckets)) return false;
+    minmax_series_load(&s_temp_history, (uint32_t)newest_index, newest_index * period_us, buckets, n_buckets);
+    history_decimate(HISTORY_CH_PRESS, start_us, end_us, buckets, n_buckets);
+    for (uint32_t i = 0; i < n_buckets; i++)
+    {
+        buckets[i].min /= 1000.0f; // Pa to the displayed kPa, the empty buckets stay infinite
+        buckets[i].max /= 1000.0f;
+    }
+    minmax_series_load(&s_press_history, (uint32_t)newest_index, newest_index * period_us, buckets, n_buckets);
+    return true;
+}
+    #endif
+
+// Sample the displayed values into the history series and alternate the main and history screens
+static void lcd_manager_history_tick(TickType_t now)
+{
+    static TickType_t last_sample_time = 0;
+    static TickType_t last_switch_time = 0;
+    #ifdef CONFIG_METEO_HISTORY
+    bool is_sampled = s_is_history_shown || !s_is_history_stored; // The store keeps the samples while hidden
+    #else
+    bool is_sampled = true;
+    #endif
+    if (is_sampled && (now - last_sample_time) >= pdMS_TO_TICKS(UI_HISTORY_SAMPLE_PERIOD_MS))
+    {
+        // The values are NaN until the first measurement, they are not counted
+        int64_t timestamp_us = esp_timer_get_time();
+        minmax_series_add(&s_temp_history, timestamp_us, get_var_amb_temp_degc());
+        minmax_series_add(&s_press_history, timestamp_us, get_var_amb_press_kpa());
+        last_sample_time = now;
+    }
+
+    if ((now - last_switch_time) < pdMS_TO_TICKS(CONFIG_METEO_UI_SCREEN_PERIOD_S * 1000U)) return;
+    last_switch_time = now;
+    s_is_history_shown = !s_is_history_shown;
+    if (s_is_history_shown)
+    {
+    #ifdef CONFIG_METEO_HISTORY
+        if (s_is_history_stored && !lcd_manager_history_load())
+        {
+            ESP_LOGW(LOG_TAG, "No history store, the history screen keeps its own samples");
+            s_is_history_stored = false;
+        }
+    #endif
+        mono_fb_clear(&s_mono_ui.fb);
+        mono_chart_screen_draw(&s_history_screen, &s_mono_ui.fb, &s_temp_history, &s_press_history);
+    }
+    else
+    {
+        mono_ui_init(&s_mono_ui); // The next tick draws every field
+    }
+}
+#endif
+
+static esp_err_t lcd_manager_mono_init(void)
+{
+    ESP_LOGI(LOG_TAG, "Initialize the minimal renderer");
+    mono_ui_init(&s_mono_ui);
+#ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+    minmax_series_init(&s_temp_history, UI_HISTORY_BUCKET_PERIOD_US);
+    minmax_series_init(&s_press_history, UI_HISTORY_BUCKET_PERIOD_US);
+    mono_chart_screen_init(&s_history_screen, UI_HISTORY_CHART_MODE);
+#endif
+    // The first tick draws the values (restored on a warm boot) and flushes the whole framebuffer
+    lcd_manager_mono_tick();
+    ESP_LOGI(LOG_TAG,
+             "First frame: all fields drawn in %lu us, drawn and sent in %lu us",
+             (unsigned long)s_ui_stats.tick.max_us,
+             (unsigned long)s_ui_stats.frame.max_us);
+    s_ui_stats = (ui_stats_t){0};
+    return ESP_OK;
+}
+#else
+// Show the first active alert, the label text is only set when the mask version changed. Called under the LVGL lock.
+static void lcd_manager_alert_tick(void)
+{
+    uint32_t version = lcd_variables_version(LCD_VAR_active_alerts);
+    if (version == s_shown_alerts_version) return;
+    s_shown_alerts_version = version;
+    const char *name = alert_engine_first_name((uint8_t)get_var_active_alerts());
+    lv_label_set_text(s_alert_label, (name != NULL) ? name : "");
+}
+
+// Called by the LVGL task, under the LVGL lock
+static void lcd_manager_lvgl_event_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) == LV_EVENT_RENDER_START)
+    {
+        s_render_start_us = esp_timer_get_time(); // Only sent when there are invalidated areas
+    }
+    else if (s_render_start_us != 0)
+    {
+        ui_time_stats_add(&s_ui_stats.frame, esp_timer_get_time() - s_render_start_us); // LV_EVENT_REFR_READY
+        s_render_start_us = 0;
+    }
+}
+#endif
+
+#ifdef CONFIG_METEO_UI_POWER_SAVE
+// Turn the panel off, or on at the contrast of the policy state. A failed change is retried at the next tick. Called
+// under the LVGL lock with LVGL.
+static void lcd_manager_display_policy_tick(void)
+{
+    lcd_variables_t vars;
+    lcd_variables_snapshot(&vars);
+    display_policy_state_t state = display_policy_update(&s_display_policy, esp_timer_get_time(), &vars);
+    if (state == s_display_state) return;
+
+    esp_err_t ret = ESP_OK;
+    if (state == DISPLAY_POLICY_OFF)
+    {
+        ret = esp_lcd_panel_disp_on_off(s_lcd_panel_handle, false);
+    }
+    else
+    {
+        uint8_t contrast = display_policy_contrast(&s_display_policy, state);
+        if (s_display_state == DISPLAY_POLICY_OFF) ret = esp_lcd_panel_disp_on_off(s_lcd_panel_handle, true);
+        if (ret == ESP_OK) ret = esp_lcd_panel_io_tx_param(s_lcd_io_handle, DISPLAY_POLICY_CMD_CONTRAST, &contrast, 1);
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(LOG_TAG, "Display power state change failed: %s", esp_err_to_name(ret));
+        return;
+    }
+    #ifndef CONFIG_METEO_UI_MINIMAL
+    // Nothing is rendered while off, the whole screen is drawn again at the wake
+    lv_display_enable_invalidation(s_disp, state != DISPLAY_POLICY_OFF);
+    if (s_display_state == DISPLAY_POLICY_OFF) lv_obj_invalidate(lv_screen_active());
+    #endif
+    if (state == DISPLAY_POLICY_OFF)
+    {
+        ESP_LOGD(LOG_TAG, "Display off, %lu wakes", (unsigned long)s_display_policy.n_wakes);
+    }
+    s_display_state = state;
+}
+#endif
 
 esp_err_t lcd_manager_init(i2c_master_bus_handle_t s_i2c_bus)
 {
     if (s_i2c_bus == NULL) return ESP_FAIL;
+    s_lcd_i2c_bus = s_i2c_bus;
 
     ESP_LOGI(LOG_TAG, "Install panel IO");
+    taskENTER_CRITICAL(&s_tuning_lock);
+    io_config.scl_speed_hz = s_i2c_speed_hz;
+    s_is_i2c_speed_changed = false;
+    taskEXIT_CRITICAL(&s_tuning_lock);
     ESP_ERROR_CHECK(esp_lcd_new_panel_io_i2c(s_i2c_bus, &io_config, &s_lcd_io_handle));
     if (s_lcd_io_handle == NULL) return ESP_FAIL;
 
@@ -77,9 +454,18 @@ esp_err_t lcd_manager_init(i2c_master_bus_handle_t s_i2c_bus)
     ESP_ERROR_CHECK(esp_lcd_panel_reset(s_lcd_panel_handle));
     ESP_ERROR_CHECK(esp_lcd_panel_init(s_lcd_panel_handle));
     ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(s_lcd_panel_handle, true));
+#ifdef CONFIG_METEO_UI_POWER_SAVE
+    display_policy_init(&s_display_policy, &s_display_policy_config, esp_timer_get_time());
+#endif
 
+#ifdef CONFIG_METEO_UI_MINIMAL
+    if (lcd_manager_mono_init() != ESP_OK) return ESP_FAIL;
+#else
     ESP_LOGI(LOG_TAG, "Initialize LVGL");
-    ESP_ERROR_CHECK(lvgl_port_init(&s_lvgl_port_cfg));
+    // LVGL task on the UI core, with the lcd task
+    lvgl_port_cfg_t lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+    lvgl_port_cfg.task_affinity = TASK_PLAN_UI_CORE;
+    ESP_ERROR_CHECK(lvgl_port_init(&lvgl_port_cfg));
 
     const lvgl_port_display_cfg_t lvgl_port_display_cfg = {.io_handle = s_lcd_io_handle,
                                                            .panel_handle = s_lcd_panel_handle,
@@ -105,14 +491,6 @@ esp_err_t lcd_manager_init(i2c_master_bus_handle_t s_i2c_bus)
     /* Rotation of the screen */
     lv_display_set_rotation(s_disp, LV_DISPLAY_ROTATION_0);
 
-    // Init EEZ UI Variables
-    esp_err_t var_ret = lcd_variables_init();
-    if (var_ret == ESP_FAIL)
-    {
-        ESP_LOGE(LOG_TAG, "Failed to init EEZ variables handles!");
-        return ESP_FAIL;
-    }
-
     // Lock the mutex due to the LVGL APIs are not thread-safe
     if (!!!lvgl_port_lock(LVGL_LOCK_TIMEOUT_MS))
     {
@@ -122,17 +500,104 @@ esp_err_t lcd_manager_init(i2c_master_bus_handle_t s_i2c_bus)
     esp_lcd_panel_invert_color(s_lcd_panel_handle,
                                true); // Invert colors to fit with EEZ Studio visual
     ui_init();
+    s_alert_label = lv_label_create(objects.obj0);
+    lv_obj_set_pos(s_alert_label, 2, 50);
+    lv_label_set_long_mode(s_alert_label, LV_LABEL_LONG_CLIP);
+    lv_label_set_text(s_alert_label, "");
+    lv_obj_set_style_text_color(s_alert_label, lv_color_hex(0xffffffff), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_text_font(s_alert_label, &lv_font_montserrat_12, LV_PART_MAIN | LV_STATE_DEFAULT);
+    // Evaluate the bindings and flush now, the values restored on a warm boot are on the first frame
+    ui_tick();
+    lv_refr_now(s_disp);
+    lv_display_add_event_cb(s_disp, lcd_manager_lvgl_event_cb, LV_EVENT_RENDER_START, NULL);
+    lv_display_add_event_cb(s_disp, lcd_manager_lvgl_event_cb, LV_EVENT_REFR_READY, NULL);
     lvgl_port_unlock(); // Release the mutex
+#endif
+    warm_boot_mark_phase(WARM_BOOT_PHASE_FIRST_FRAME);
 
     return ESP_OK;
 }
 
+void lcd_manager_set_period_ms(uint32_t period_ms)
+{
+    taskENTER_CRITICAL(&s_tuning_lock);
+    s_period_ms = period_ms;
+    taskEXIT_CRITICAL(&s_tuning_lock);
+}
+
+void lcd_manager_set_i2c_speed(uint32_t scl_speed_hz)
+{
+    taskENTER_CRITICAL(&s_tuning_lock);
+    s_is_i2c_speed_changed = (scl_speed_hz != s_i2c_speed_hz) || s_is_i2c_speed_changed;
+    s_i2c_speed_hz = scl_speed_hz;
+    taskEXIT_CRITICAL(&s_tuning_lock);
+#ifndef CONFIG_METEO_UI_MINIMAL
+    // The LVGL port flushes from its own task through the panel IO, the clock is only set at init
+    ESP_LOGI(LOG_TAG, "Display I2C clock %lu Hz applied at the next restart", (unsigned long)scl_speed_hz);
+#endif
+}
+
+void lcd_manager_get_perf(tuning_perf_counters_t *counters)
+{
+    taskENTER_CRITICAL(&s_tuning_lock);
+    counters->n_ui_ticks = s_perf.n_ticks;
+    counters->ui_busy_us = s_perf.busy_us;
+    counters->lcd_n_transfers = s_perf.n_transfers;
+    counters->lcd_n_bytes = s_perf.n_bytes;
+    taskEXIT_CRITICAL(&s_tuning_lock);
+}
+
 void lcd_manager_task(void *pvParameter)
 {
+    // The display init runs in this task, in parallel with the sensor init of the ambient sense task
+    i2c_master_bus_handle_t i2c_bus = (i2c_master_bus_handle_t)pvParameter;
+    if (lcd_manager_init(i2c_bus) != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "UI initialization failed!");
+        vTaskDelete(NULL);
+    }
+
     // NOTE: This is the old example lvgl demo from espressif before integrating EEZ studio
     // example_lvgl_demo_ui(s_disp);
+    taskENTER_CRITICAL(&s_tuning_lock);
+    uint32_t period_ms = s_period_ms;
+    taskEXIT_CRITICAL(&s_tuning_lock);
+    task_jitter_init(&s_jitter, "lcd", task_jitter_tick_period_us(period_ms), UI_PREEMPT_THRESHOLD_US);
+    task_jitter_register(&s_jitter);
+    TickType_t last_wake_time = xTaskGetTickCount();
+    TickType_t last_stats_time = last_wake_time;
     while (1)
     {
+        task_jitter_release_now(&s_jitter);
+        int64_t busy_start_us = esp_timer_get_time();
+
+#ifdef CONFIG_METEO_UI_MINIMAL
+        taskENTER_CRITICAL(&s_tuning_lock);
+        bool     is_i2c_speed_changed = s_is_i2c_speed_changed;
+        uint32_t i2c_speed_hz = s_i2c_speed_hz;
+        s_is_i2c_speed_changed = false;
+        taskEXIT_CRITICAL(&s_tuning_lock);
+        if (is_i2c_speed_changed && (lcd_manager_update_i2c_speed(i2c_speed_hz) != ESP_OK))
+        {
+            // Retried at the next tick, the display stays dark until then
+            taskENTER_CRITICAL(&s_tuning_lock);
+            s_is_i2c_speed_changed = true;
+            taskEXIT_CRITICAL(&s_tuning_lock);
+        }
+    #ifdef CONFIG_METEO_UI_HISTORY_SCREEN
+        lcd_manager_history_tick(xTaskGetTickCount());
+    #endif
+    #ifdef CONFIG_METEO_UI_POWER_SAVE
+        lcd_manager_display_policy_tick();
+    #endif
+        lcd_manager_mono_tick();
+        if ((xTaskGetTickCount() - last_stats_time) >= pdMS_TO_TICKS(UI_STATS_PERIOD_MS))
+        {
+            ui_stats_log(&s_ui_stats);
+            s_ui_stats = (ui_stats_t){0};
+            last_stats_time = xTaskGetTickCount();
+        }
+#else
         // Lock the mutex due to the LVGL APIs are not thread-safe
         if (!!!lvgl_port_lock(LVGL_LOCK_TIMEOUT_MS))
         {
@@ -140,9 +605,29 @@ void lcd_manager_task(void *pvParameter)
         }
         else
         {
+    #ifdef CONFIG_METEO_UI_POWER_SAVE
+            lcd_manager_display_policy_tick();
+    #endif
+            int64_t tick_start_us = esp_timer_get_time();
             ui_tick();
-            lvgl_port_unlock(); // Release the mutex
+            lcd_manager_alert_tick();
+            ui_time_stats_add(&s_ui_stats.tick, esp_timer_get_time() - tick_start_us);
+
+            // The frame stats are updated by the LVGL task under the same lock
+            if ((xTaskGetTickCount() - last_stats_time) >= pdMS_TO_TICKS(UI_STATS_PERIOD_MS))
+            {
+                ui_stats_t stats = s_ui_stats;
+                s_ui_stats = (ui_stats_t){0};
+                last_stats_time = xTaskGetTickCount();
+                lvgl_port_unlock();
+                ui_stats_log(&stats);
+            }
+            else
+            {
+                lvgl_port_unlock(); // Release the mutex
+            }
         }
+#endif
 
         // NOTE: This is an example of an EEZ Studio simple screen, toggle the variable here shpould toggle the onscreen
         // "LED"
@@ -154,7 +639,26 @@ void lcd_manager_task(void *pvParameter)
             set_var_is_station_connected(!current_state);
             last_toggle_time = current_time;
         }
-        vTaskDelay(pdMS_TO_TICKS(UI_TASK_PERIOD_MS));
+
+        int64_t busy_us = esp_timer_get_time() - busy_start_us;
+        taskENTER_CRITICAL(&s_tuning_lock);
+        s_perf.n_ticks++;
+        s_perf.busy_us += (uint64_t)busy_us;
+        s_perf.n_transfers = s_bus_perf.n_transfers;
+        s_perf.n_bytes = s_bus_perf.n_bytes;
+        bool is_period_changed = (s_period_ms != period_ms);
+        period_ms = s_period_ms;
+        taskEXIT_CRITICAL(&s_tuning_lock);
+        if (is_period_changed)
+        {
+            // The jitter stats restart for the new period, and the next tick is one new period from now
+            task_jitter_set_period(&s_jitter, task_jitter_tick_period_us(period_ms));
+            last_wake_time = xTaskGetTickCount();
+            ESP_LOGI(LOG_TAG, "UI period set to %lu ms", (unsigned long)period_ms);
+        }
+        xTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(period_ms));
     }
+#ifndef CONFIG_METEO_UI_MINIMAL
     ESP_ERROR_CHECK(lvgl_port_remove_disp(s_disp));
+#endif
 }
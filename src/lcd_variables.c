@@ -1,127 +1,97 @@
 #include "lcd_variables.h"
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
 
-#include "vars.h"
+#include "seqlock.h"
 
-#include <math.h>
+#define LCD_VARIABLE_INIT(name, type, eez_type, init, unit, precision) .name = (init),
+static lcd_variables_t s_values = {LCD_VARIABLES(LCD_VARIABLE_INIT)};
+#undef LCD_VARIABLE_INIT
 
-// NOTE: Getter/Setter for EEZ Studio functions
-static bool              s_is_station_connected = false;
-static SemaphoreHandle_t s_is_station_connected_mutex = NULL;
+// NOTE: Readers never block, the writers are the sensing task, the UI task and the EEZ Studio flow (seqlock.h)
+static uint32_t  s_versions[LCD_VAR_COUNT];
+static seqlock_t s_lock = SEQLOCK_INIT;
 
-bool get_var_is_station_connected()
-{
-    if (s_is_station_connected_mutex == NULL) return 0;
-    xSemaphoreTake(s_is_station_connected_mutex, portMAX_DELAY);
-    int32_t value = s_is_station_connected;
-    xSemaphoreGive(s_is_station_connected_mutex);
-    return value;
-}
-void set_var_is_station_connected(bool value)
-{
-    if (s_is_station_connected_mutex == NULL) return;
-    xSemaphoreTake(s_is_station_connected_mutex, portMAX_DELAY);
-    s_is_station_connected = value;
-    xSemaphoreGive(s_is_station_connected_mutex);
-}
-static float             s_amb_temp_degc = NAN;
-static SemaphoreHandle_t s_amb_temp_degc_mutex = NULL;
-
-float get_var_amb_temp_degc()
-{
-    if (s_amb_temp_degc_mutex == NULL) return NAN;
-    xSemaphoreTake(s_amb_temp_degc_mutex, portMAX_DELAY);
-    float value = s_amb_temp_degc;
-    xSemaphoreGive(s_amb_temp_degc_mutex);
-    return value;
-}
+#define LCD_VARIABLE_INFO(name, type, eez_type, init, unit, precision)                                                \
+    [LCD_VAR_##name] = {#name, unit, LCD_VAR_TYPE_##eez_type, precision},
+const lcd_var_info_t lcd_var_infos[LCD_VAR_COUNT] = {LCD_VARIABLES(LCD_VARIABLE_INFO)};
+#undef LCD_VARIABLE_INFO
 
-void set_var_amb_temp_degc(float value)
+// Store a value in a write section, compared bitwise so that NaN set again is not a change
+static void lcd_variables_store(lcd_var_id_t id, void *slot, const void *value, size_t size)
 {
-    if (s_amb_temp_degc_mutex == NULL) return;
-    xSemaphoreTake(s_amb_temp_degc_mutex, portMAX_DELAY);
-    s_amb_temp_degc = value;
-    xSemaphoreGive(s_amb_temp_degc_mutex);
+    if (memcmp(slot, value, size) == 0) return;
+    memcpy(slot, value, size);
+    s_versions[id]++;
 }
 
-static float             s_amb_humid_pct = NAN;
-static SemaphoreHandle_t s_amb_humid_pct_mutex = NULL;
-
-float get_var_amb_humid_pct()
+#define LCD_VARIABLE_DEFINE(name, type, eez_type, init, unit, precision)                                              \
+    type get_var_##name()                                                                                              \
+    {                                                                                                                  \
+        type value;                                                                                                    \
+        seqlock_read(&s_lock, &value, &s_values.name, sizeof(value));                                                  \
+        return value;                                                                                                  \
+    }                                                                                                                  \
+    void set_var_##name(type value)                                                                                    \
+    {                                                                                                                  \
+        seqlock_write_begin(&s_lock);                                                                                  \
+        lcd_variables_store(LCD_VAR_##name, &s_values.name, &value, sizeof(value));                                    \
+        seqlock_write_end(&s_lock);                                                                                    \
+    }
+LCD_VARIABLES(LCD_VARIABLE_DEFINE)
+#undef LCD_VARIABLE_DEFINE
+
+void lcd_variables_set_frame(const meteo_frame_t *frame)
 {
-    if (s_amb_humid_pct_mutex == NULL) return NAN;
-    xSemaphoreTake(s_amb_humid_pct_mutex, portMAX_DELAY);
-    float value = s_amb_humid_pct;
-    xSemaphoreGive(s_amb_humid_pct_mutex);
-    return value;
+    if (frame == NULL) return;
+    float temp_degc = frame->temperature_degc;
+    bool  is_temp_negative = temp_degc < 0.0f;
+    float humid_pct = frame->humidity_pct;
+    float press_kpa = frame->pressure_pa / 1000.0f;
+
+    seqlock_write_begin(&s_lock);
+    lcd_variables_store(LCD_VAR_amb_temp_degc, &s_values.amb_temp_degc, &temp_degc, sizeof(temp_degc));
+    lcd_variables_store(
+        LCD_VAR_is_amb_temp_negative, &s_values.is_amb_temp_negative, &is_temp_negative, sizeof(is_temp_negative));
+    lcd_variables_store(LCD_VAR_amb_humid_pct, &s_values.amb_humid_pct, &humid_pct, sizeof(humid_pct));
+    lcd_variables_store(LCD_VAR_amb_press_kpa, &s_values.amb_press_kpa, &press_kpa, sizeof(press_kpa));
+    seqlock_write_end(&s_lock);
 }
 
-void set_var_amb_humid_pct(float value)
+void lcd_variables_snapshot(lcd_variables_t *snapshot)
 {
-    if (s_amb_humid_pct_mutex == NULL) return;
-    xSemaphoreTake(s_amb_humid_pct_mutex, portMAX_DELAY);
-    s_amb_humid_pct = value;
-    xSemaphoreGive(s_amb_humid_pct_mutex);
+    if (snapshot == NULL) return;
+    seqlock_read(&s_lock, snapshot, &s_values, sizeof(*snapshot));
 }
 
-static float             s_amb_press_kpa = NAN;
-static SemaphoreHandle_t s_amb_press_kpa_mutex = NULL;
-
-float get_var_amb_press_kpa()
+uint32_t lcd_variables_version(lcd_var_id_t id)
 {
-    if (s_amb_press_kpa_mutex == NULL) return NAN;
-    xSemaphoreTake(s_amb_press_kpa_mutex, portMAX_DELAY);
-    float value = s_amb_press_kpa;
-    xSemaphoreGive(s_amb_press_kpa_mutex);
-    return value;
+    if (id >= LCD_VAR_COUNT) return 0;
+    uint32_t version;
+    seqlock_read(&s_lock, &version, &s_versions[id], sizeof(version));
+    return version;
 }
 
-void set_var_amb_press_kpa(float value)
+int lcd_variables_format(lcd_var_id_t id, char *text, size_t text_size)
 {
-    if (s_amb_press_kpa_mutex == NULL) return;
-    xSemaphoreTake(s_amb_press_kpa_mutex, portMAX_DELAY);
-    s_amb_press_kpa = value;
-    xSemaphoreGive(s_amb_press_kpa_mutex);
+    if (id >= LCD_VAR_COUNT || text == NULL) return -1;
+    const char *separator = (lcd_var_infos[id].unit[0] != '\0') ? " " : "";
+
+    lcd_variables_t snapshot;
+    lcd_variables_snapshot(&snapshot);
+    switch (id)
+    {
+#define LCD_VARIABLE_FORMAT(name, type, eez_type, init, unit, precision)                                              \
+    case LCD_VAR_##name:                                                                                               \
+        if (LCD_VAR_TYPE_##eez_type == LCD_VAR_TYPE_FLOAT)                                                             \
+        {                                                                                                              \
+            return snprintf(text, text_size, "%.*f%s%s", precision, (double)snapshot.name, separator, unit);           \
+        }                                                                                                              \
+        return snprintf(text, text_size, "%ld%s%s", (long)snapshot.name, separator, unit);
+        LCD_VARIABLES(LCD_VARIABLE_FORMAT)
+#undef LCD_VARIABLE_FORMAT
+    default:
+        return -1;
+    }
 }
-
-static bool              s_is_amb_temp_negative = false;
-static SemaphoreHandle_t s_is_amb_temp_negative_mutex = NULL;
-
-bool get_var_is_amb_temp_negative()
-{
-    if (s_is_amb_temp_negative_mutex == NULL) return false;
-    xSemaphoreTake(s_is_amb_temp_negative_mutex, portMAX_DELAY);
-    bool value = s_is_amb_temp_negative;
-    xSemaphoreGive(s_is_amb_temp_negative_mutex);
-    return value;
-}
-
-void set_var_is_amb_temp_negative(bool value)
-{
-    if (s_is_amb_temp_negative_mutex == NULL) return;
-    xSemaphoreTake(s_is_amb_temp_negative_mutex, portMAX_DELAY);
-    s_is_amb_temp_negative = value;
-    xSemaphoreGive(s_is_amb_temp_negative_mutex);
-}
-
-esp_err_t lcd_variables_init(void)
-{
-    s_is_station_connected_mutex = xSemaphoreCreateMutex();
-    if (s_is_station_connected_mutex == NULL) return ESP_FAIL;
-
-    s_amb_temp_degc_mutex = xSemaphoreCreateMutex();
-    if (s_amb_temp_degc_mutex == NULL) return ESP_FAIL;
-
-    s_amb_humid_pct_mutex = xSemaphoreCreateMutex();
-    if (s_amb_humid_pct_mutex == NULL) return ESP_FAIL;
-
-    s_amb_press_kpa_mutex = xSemaphoreCreateMutex();
-    if (s_amb_press_kpa_mutex == NULL) return ESP_FAIL;
-
-    s_is_amb_temp_negative_mutex = xSemaphoreCreateMutex();
-    if (s_is_amb_temp_negative_mutex == NULL) return ESP_FAIL;
-
-    return ESP_OK;
-}
\ No newline at end of file
@@ -11,9 +11,23 @@
 #include "esp_chip_info.h"
 #include "esp_flash.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
 
 #include "ambient_sense.h"
+#include "ble_broadcast.h"
+#include "data_stream.h"
+#include "deferred_log.h"
+#include "flash_log.h"
+#include "history_store.h"
 #include "lcd_manager.h"
+#include "lcd_variables.h"
+#include "mem_telemetry.h"
+#include "modbus_server.h"
+#include "station_link.h"
+#include "task_plan.h"
+#include "timebase.h"
+#include "tuning.h"
+#include "warm_boot.h"
 
 static const char *LOG_TAG = "main";
 
@@ -22,12 +36,17 @@ static const char *LOG_TAG = "main";
 #else
     #define BLINK_GPIO (gpio_num_t)21 // LED_BUILT_IN
 #endif
+#define BLINK_HALF_PERIOD_MS       1000
+#define BLINK_ALERT_HALF_PERIOD_MS 125
 
 #define I2C_BUS_PORT    0
 
 #define I2C_SDA_PIN_NUM GPIO_NUM_5 // SDA pin for XIAO ESP32S3 with Grove Base Expansion Board
 #define I2C_SCL_PIN_NUM GPIO_NUM_6 // SCL pin for XIAO ESP32S3 with Grove Base Expansion Board
 
+// Transient I2C bus init task, freed once the bus is created
+#define I2C_BUS_INIT_TASK_STACK_SIZE 3072
+
 static i2c_master_bus_handle_t       s_i2c_bus = NULL;
 static const i2c_master_bus_config_t s_i2c_bus_config = {
     .clk_source = I2C_CLK_SRC_DEFAULT,
@@ -38,18 +57,91 @@ static const i2c_master_bus_config_t s_i2c_bus_config = {
     .flags.enable_internal_pullup = true,
 };
 
+// Statically allocated tasks, the stacks are sized in menuconfig from the mem telemetry high water marks
+static StaticTask_t s_ambient_sense_task_tcb;
+static StackType_t  s_ambient_sense_task_stack[CONFIG_METEO_AMBIENT_SENSE_TASK_STACK_SIZE];
+static StaticTask_t s_lcd_task_tcb;
+static StackType_t  s_lcd_task_stack[CONFIG_METEO_LCD_TASK_STACK_SIZE];
+static StaticTask_t s_blink_task_tcb;
+static StackType_t  s_blink_task_stack[CONFIG_METEO_BLINK_TASK_STACK_SIZE];
+static StaticTask_t s_dlog_task_tcb;
+static StackType_t  s_dlog_task_stack[CONFIG_METEO_DLOG_TASK_STACK_SIZE];
+static StaticTask_t s_mem_telemetry_task_tcb;
+static StackType_t  s_mem_telemetry_task_stack[CONFIG_METEO_MEM_TELEMETRY_TASK_STACK_SIZE];
+#ifdef CONFIG_METEO_STREAM
+static StaticTask_t s_stream_task_tcb;
+static StackType_t  s_stream_task_stack[CONFIG_METEO_STREAM_TASK_STACK_SIZE];
+#endif
+#ifdef CONFIG_METEO_FLASH_LOG
+static StaticTask_t s_flash_log_task_tcb;
+static StackType_t  s_flash_log_task_stack[CONFIG_METEO_FLASH_LOG_TASK_STACK_SIZE];
+#endif
+#ifdef CONFIG_METEO_STATION_COORDINATOR
+static StaticTask_t s_station_link_task_tcb;
+static StackType_t  s_station_link_task_stack[CONFIG_METEO_STATION_LINK_TASK_STACK_SIZE];
+#endif
+#ifdef CONFIG_METEO_MODBUS_RTU
+static StaticTask_t s_modbus_rtu_task_tcb;
+static StackType_t  s_modbus_rtu_task_stack[CONFIG_METEO_MODBUS_TASK_STACK_SIZE];
+#endif
+#ifdef CONFIG_METEO_MODBUS_TCP
+static StaticTask_t s_modbus_tcp_task_tcb;
+static StackType_t  s_modbus_tcp_task_stack[CONFIG_METEO_MODBUS_TASK_STACK_SIZE];
+#endif
+
+// NOTE: ESP-IDF FreeRTOS stack sizes are in bytes (StackType_t is a byte)
+static void create_static_task(TaskFunction_t task_function,
+                               const char    *name,
+                               StackType_t   *stack,
+                               uint32_t       stack_size,
+                               void          *parameter,
+                               UBaseType_t    priority,
+                               StaticTask_t  *tcb,
+                               BaseType_t     core_id)
+{
+    TaskHandle_t task_handle
+        = xTaskCreateStaticPinnedToCore(task_function, name, stack_size, parameter, priority, stack, tcb, core_id);
+    if (mem_telemetry_register_task(task_handle, stack_size) != ESP_OK)
+    {
+        ESP_LOGW(LOG_TAG, "Task %s not registered in mem telemetry", name);
+    }
+}
+
+// The I2C bus interrupt is allocated on the core creating the bus, use a transient task on the sensing core
+static void i2c_bus_init_task(void *pvParameter)
+{
+    TaskHandle_t caller_task_handle = (TaskHandle_t)pvParameter;
+    ESP_ERROR_CHECK(i2c_new_master_bus(&s_i2c_bus_config, &s_i2c_bus));
+    xTaskNotifyGive(caller_task_handle);
+    vTaskDelete(NULL);
+}
+
+static void create_i2c_bus_on_core(BaseType_t core_id)
+{
+    xTaskCreatePinnedToCore(&i2c_bus_init_task,
+                            "i2c_init",
+                            I2C_BUS_INIT_TASK_STACK_SIZE,
+                            xTaskGetCurrentTaskHandle(),
+                            TASK_PLAN_SENSING_PRIORITY,
+                            NULL,
+                            core_id);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
 void blink_task(void *pvParameter)
 {
     // Set the GPIO as a push/pull output
     gpio_set_direction(BLINK_GPIO, GPIO_MODE_OUTPUT);
     while (1)
     {
+        // Fast blink while an alert is active
+        uint32_t half_period_ms = (get_var_active_alerts() != 0) ? BLINK_ALERT_HALF_PERIOD_MS : BLINK_HALF_PERIOD_MS;
         // Blink off (output low)
         gpio_set_level(BLINK_GPIO, 0);
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(half_period_ms));
         // Blink on (output high)
         gpio_set_level(BLINK_GPIO, 1);
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(half_period_ms));
     }
 }
 
@@ -85,38 +177,212 @@ void print_board_info(void)
 
 void app_main()
 {
+    warm_boot_mark_phase(WARM_BOOT_PHASE_APP_START);
+
     // Set UART log level
     esp_log_level_set(LOG_TAG, ESP_LOG_INFO);
 
     ESP_LOGI(LOG_TAG, "-- XIAO ESP32S3 Meteo Station Exploration --");
 
-    print_board_info();
+    // Deferred log ring must be ready before any task logs in it
+    deferred_log_init();
+
+    // UI variables loaded with the last measurements on a warm boot so the first frame shows them
+    meteo_frame_t last_frame;
+    if (warm_boot_restore(&last_frame))
+    {
+        lcd_variables_set_frame(&last_frame);
+    }
+
+    // Monotonic to UTC conversion of the exported samples, from the RTC until SNTP syncs it
+    if (timebase_init() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Timebase initialization failed!");
+    }
+
+    // NVS shared by the tuning, the BLE encryption counter and the Wi-Fi driver. A partition full or written by a newer
+    // NVS version is erased: the tuned values go back to their defaults and the counter restarts from its first block.
+    esp_err_t nvs_ret = nvs_flash_init();
+    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        nvs_flash_erase();
+        nvs_ret = nvs_flash_init();
+    }
+    if (nvs_ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "NVS initialization failed: %s", esp_err_to_name(nvs_ret));
+    }
 
-    ESP_LOGI(LOG_TAG, "Starting program...");
+#ifdef CONFIG_METEO_TUNING
+    // Tuned values kept in NVS, set before the tasks read them
+    if (tuning_init() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Tuning initialization failed!");
+    }
+#endif
 
     // Drivers Init
     ESP_LOGI(LOG_TAG, "Initialize I2C bus");
-    ESP_ERROR_CHECK(i2c_new_master_bus(&s_i2c_bus_config, &s_i2c_bus));
+    create_i2c_bus_on_core(TASK_PLAN_SENSING_CORE);
 
     esp_err_t ambient_sense_ret = ambient_sense_init(s_i2c_bus);
-    esp_err_t lcd_ret = lcd_manager_init(s_i2c_bus);
+#ifdef CONFIG_METEO_HISTORY
+    if (history_init() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "History initialization failed!");
+    }
+#endif
 
-    // Tasks Init
-    xTaskCreate(&blink_task, "blink_task", configMINIMAL_STACK_SIZE, NULL, 5, NULL);
-    if (lcd_ret == ESP_OK)
+    // Tasks Init, the sensor init (ambient sense task) and the display init (lcd task) run in parallel
+    if (ambient_sense_ret == ESP_OK)
     {
-        xTaskCreate(&lcd_manager_task, "lcd_task", configMINIMAL_STACK_SIZE * 4, NULL, 4, NULL);
+        create_static_task(&ambient_sense_task,
+                           "ambient_sense_task",
+                           s_ambient_sense_task_stack,
+                           sizeof(s_ambient_sense_task_stack),
+                           NULL,
+                           TASK_PLAN_SENSING_PRIORITY,
+                           &s_ambient_sense_task_tcb,
+                           TASK_PLAN_SENSING_CORE);
     }
     else
     {
-        ESP_LOGE(LOG_TAG, "UI initialization failed!");
+        ESP_LOGE(LOG_TAG, "Ambient sense initialization failed!");
     }
-    if (ambient_sense_ret == ESP_OK)
+    create_static_task(&lcd_manager_task,
+                       "lcd_task",
+                       s_lcd_task_stack,
+                       sizeof(s_lcd_task_stack),
+                       s_i2c_bus,
+                       TASK_PLAN_UI_PRIORITY,
+                       &s_lcd_task_tcb,
+                       TASK_PLAN_UI_CORE);
+    create_static_task(&blink_task,
+                       "blink_task",
+                       s_blink_task_stack,
+                       sizeof(s_blink_task_stack),
+                       NULL,
+                       TASK_PLAN_BLINK_PRIORITY,
+                       &s_blink_task_tcb,
+                       TASK_PLAN_UI_CORE);
+    create_static_task(&deferred_log_task,
+                       "dlog_task",
+                       s_dlog_task_stack,
+                       sizeof(s_dlog_task_stack),
+                       NULL,
+                       TASK_PLAN_BACKGROUND_PRIORITY,
+                       &s_dlog_task_tcb,
+                       TASK_PLAN_UI_CORE);
+    create_static_task(&mem_telemetry_task,
+                       "mem_task",
+                       s_mem_telemetry_task_stack,
+                       sizeof(s_mem_telemetry_task_stack),
+                       NULL,
+                       TASK_PLAN_BACKGROUND_PRIORITY,
+                       &s_mem_telemetry_task_tcb,
+                       TASK_PLAN_UI_CORE);
+#ifdef CONFIG_METEO_STREAM
+    if (data_stream_init() == ESP_OK)
     {
-        xTaskCreate(&ambient_sense_task, "ambient_sense_task", configMINIMAL_STACK_SIZE * 2, NULL, 5, NULL);
+        create_static_task(&data_stream_task,
+                           "stream_task",
+                           s_stream_task_stack,
+                           sizeof(s_stream_task_stack),
+                           NULL,
+                           TASK_PLAN_STREAM_PRIORITY,
+                           &s_stream_task_tcb,
+                           TASK_PLAN_UI_CORE);
     }
     else
     {
-        ESP_LOGE(LOG_TAG, "Ambient sense initialization failed!");
+        ESP_LOGE(LOG_TAG, "Data stream initialization failed!");
     }
+#endif
+#ifdef CONFIG_METEO_FLASH_LOG
+    if (flash_log_init() == ESP_OK)
+    {
+        create_static_task(&flash_log_task,
+                           "flash_log_task",
+                           s_flash_log_task_stack,
+                           sizeof(s_flash_log_task_stack),
+                           NULL,
+                           TASK_PLAN_BACKGROUND_PRIORITY,
+                           &s_flash_log_task_tcb,
+                           TASK_PLAN_UI_CORE);
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Flash log initialization failed!");
+    }
+#endif
+#ifdef CONFIG_METEO_BLE_BROADCAST
+    if (ble_broadcast_init() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "BLE broadcast initialization failed!");
+    }
+#endif
+#ifdef CONFIG_METEO_STATION_LINK
+    if (station_link_init() == ESP_OK)
+    {
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+        create_static_task(&station_link_task,
+                           "station_task",
+                           s_station_link_task_stack,
+                           sizeof(s_station_link_task_stack),
+                           NULL,
+                           TASK_PLAN_STREAM_PRIORITY,
+                           &s_station_link_task_tcb,
+                           TASK_PLAN_UI_CORE);
+    #endif
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Station link initialization failed!");
+    }
+#endif
+#ifdef CONFIG_METEO_MODBUS
+    if (modbus_server_init() == ESP_OK)
+    {
+    #ifdef CONFIG_METEO_MODBUS_RTU
+        create_static_task(&modbus_server_rtu_task,
+                           "modbus_rtu_task",
+                           s_modbus_rtu_task_stack,
+                           sizeof(s_modbus_rtu_task_stack),
+                           NULL,
+                           TASK_PLAN_STREAM_PRIORITY,
+                           &s_modbus_rtu_task_tcb,
+                           TASK_PLAN_UI_CORE);
+    #endif
+    #ifdef CONFIG_METEO_MODBUS_TCP
+        create_static_task(&modbus_server_tcp_task,
+                           "modbus_tcp_task",
+                           s_modbus_tcp_task_stack,
+                           sizeof(s_modbus_tcp_task_stack),
+                           NULL,
+                           TASK_PLAN_STREAM_PRIORITY,
+                           &s_modbus_tcp_task_tcb,
+                           TASK_PLAN_UI_CORE);
+    #endif
+    }
+    else
+    {
+        ESP_LOGE(LOG_TAG, "Modbus server initialization failed!");
+    }
+#endif
+#ifdef CONFIG_METEO_TIMEBASE_SNTP
+    if (timebase_start_sntp() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "SNTP start failed!");
+    }
+#endif
+#ifdef CONFIG_METEO_TUNING
+    if (tuning_console_start() != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Tuning console start failed!");
+    }
+#endif
+
+    print_board_info();
+
+    ESP_LOGI(LOG_TAG, "Program started");
 }
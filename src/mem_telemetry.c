@@ -0,0 +1,126 @@
+#include "mem_telemetry.h"
+
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "task_jitter.h"
+
+#ifdef CONFIG_METEO_MEM_TELEMETRY_PERIOD_MS
+    #define MEM_TELEMETRY_PERIOD_MS CONFIG_METEO_MEM_TELEMETRY_PERIOD_MS
+#else
+    #define MEM_TELEMETRY_PERIOD_MS 10000
+#endif
+
+static const char *LOG_TAG = "mem";
+
+static const uint32_t s_heap_caps[MEM_TELEMETRY_HEAP_COUNT] = {
+    [MEM_TELEMETRY_HEAP_INTERNAL] = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    [MEM_TELEMETRY_HEAP_DMA] = MALLOC_CAP_DMA,
+    [MEM_TELEMETRY_HEAP_SPIRAM] = MALLOC_CAP_SPIRAM,
+};
+static const char *s_heap_names[MEM_TELEMETRY_HEAP_COUNT] = {"internal", "dma", "spiram"};
+
+static TaskHandle_t             s_task_handles[MEM_TELEMETRY_MAX_TASKS] = {NULL};
+static uint32_t                 s_task_stack_sizes[MEM_TELEMETRY_MAX_TASKS] = {0};
+static uint8_t                  s_n_tasks = 0;
+static mem_telemetry_snapshot_t s_snapshot = {0};
+static portMUX_TYPE             s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t mem_telemetry_register_task(TaskHandle_t task_handle, uint32_t stack_size_bytes)
+{
+    if (task_handle == NULL) return ESP_FAIL;
+
+    esp_err_t ret = ESP_FAIL;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_n_tasks < MEM_TELEMETRY_MAX_TASKS)
+    {
+        s_task_handles[s_n_tasks] = task_handle;
+        s_task_stack_sizes[s_n_tasks] = stack_size_bytes;
+        s_n_tasks++;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+void mem_telemetry_sample(void)
+{
+    mem_telemetry_snapshot_t snapshot = {0};
+    snapshot.timestamp_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    uint8_t n_tasks = s_n_tasks;
+    taskEXIT_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < n_tasks; i++)
+    {
+        // NOTE: ESP-IDF FreeRTOS stack sizes and high water marks are in bytes
+        snapshot.tasks[i].name = pcTaskGetName(s_task_handles[i]);
+        snapshot.tasks[i].stack_size_bytes = s_task_stack_sizes[i];
+        snapshot.tasks[i].stack_high_water_mark_bytes = uxTaskGetStackHighWaterMark(s_task_handles[i]);
+    }
+    snapshot.n_tasks = n_tasks;
+
+    for (int i = 0; i < MEM_TELEMETRY_HEAP_COUNT; i++)
+    {
+        mem_telemetry_heap_stats_t *heap = &snapshot.heaps[i];
+        heap->total_bytes = heap_caps_get_total_size(s_heap_caps[i]);
+        heap->free_bytes = heap_caps_get_free_size(s_heap_caps[i]);
+        heap->min_free_bytes = heap_caps_get_minimum_free_size(s_heap_caps[i]);
+        heap->largest_free_block_bytes = heap_caps_get_largest_free_block(s_heap_caps[i]);
+        heap->fragmentation_pct
+            = (heap->free_bytes > 0) ? (uint8_t)(100U - (uint32_t)((uint64_t)heap->largest_free_block_bytes * 100U
+                                                                   / heap->free_bytes))
+                                     : 0;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_snapshot = snapshot;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void mem_telemetry_get_snapshot(mem_telemetry_snapshot_t *snapshot)
+{
+    if (snapshot == NULL) return;
+    taskENTER_CRITICAL(&s_lock);
+    *snapshot = s_snapshot;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void mem_telemetry_task(void *pvParameter)
+{
+    mem_telemetry_snapshot_t snapshot;
+    while (1)
+    {
+        mem_telemetry_sample();
+        mem_telemetry_get_snapshot(&snapshot);
+
+        for (uint8_t i = 0; i < snapshot.n_tasks; i++)
+        {
+            const mem_telemetry_task_stats_t *task = &snapshot.tasks[i];
+            ESP_LOGI(LOG_TAG,
+                     "Task %-16s stack %5lu B, used max %5lu B, free min %5lu B",
+                     task->name,
+                     (unsigned long)task->stack_size_bytes,
+                     (unsigned long)(task->stack_size_bytes - task->stack_high_water_mark_bytes),
+                     (unsigned long)task->stack_high_water_mark_bytes);
+        }
+        for (int i = 0; i < MEM_TELEMETRY_HEAP_COUNT; i++)
+        {
+            const mem_telemetry_heap_stats_t *heap = &snapshot.heaps[i];
+            if (heap->total_bytes == 0) continue;
+            ESP_LOGI(LOG_TAG,
+                     "Heap %-8s free %7lu/%7lu B, min free %7lu B, largest block %7lu B, fragmentation %u%%",
+                     s_heap_names[i],
+                     (unsigned long)heap->free_bytes,
+                     (unsigned long)heap->total_bytes,
+                     (unsigned long)heap->min_free_bytes,
+                     (unsigned long)heap->largest_free_block_bytes,
+                     heap->fragmentation_pct);
+        }
+        task_jitter_log_report(); // Scheduling telemetry on the same period
+        vTaskDelay(pdMS_TO_TICKS(MEM_TELEMETRY_PERIOD_MS));
+    }
+}
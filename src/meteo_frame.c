@@ -0,0 +1,31 @@
+#include "meteo_frame.h"
+
+#define METEO_RAW_GAS_RANGE_MSK 0x0FU //< BME68X_GAS_RANGE_MSK
+
+void meteo_raw_decode(const uint8_t *field_regs, meteo_raw_t *raw)
+{
+    raw->status = field_regs[0];
+    raw->press_adc = ((uint32_t)field_regs[2] << 12) | ((uint32_t)field_regs[3] << 4) | ((uint32_t)field_regs[4] >> 4);
+    raw->temp_adc = ((uint32_t)field_regs[5] << 12) | ((uint32_t)field_regs[6] << 4) | ((uint32_t)field_regs[7] >> 4);
+    raw->hum_adc = (uint16_t)(((uint32_t)field_regs[8] << 8) | (uint32_t)field_regs[9]);
+    // BME688 (variant high) gas ADC registers
+    raw->gas_adc = (uint16_t)(((uint32_t)field_regs[15] << 2) | ((uint32_t)field_regs[16] >> 6));
+    raw->gas_range = field_regs[16] & METEO_RAW_GAS_RANGE_MSK;
+}
+
+void meteo_frame_set_sample(meteo_frame_t *frame,
+                            int64_t        timestamp_us,
+                            float          temperature_degc,
+                            float          pressure_pa,
+                            float          humidity_pct,
+                            float          gas_resistance_ohm,
+                            const uint8_t *field_regs)
+{
+    frame->sequence++;
+    frame->timestamp_us = timestamp_us;
+    frame->temperature_degc = temperature_degc;
+    frame->pressure_pa = pressure_pa;
+    frame->humidity_pct = humidity_pct;
+    frame->gas_resistance_ohm = gas_resistance_ohm;
+    meteo_raw_decode(field_regs, &frame->raw);
+}
@@ -0,0 +1,79 @@
+#include "minmax_series.h"
+
+#include <math.h>
+
+static void minmax_series_start_bucket(minmax_series_t *series)
+{
+    minmax_bucket_t *bucket = &series->buckets[series->n_buckets % MINMAX_SERIES_LEN];
+    bucket->min = INFINITY;
+    bucket->max = -INFINITY;
+    series->n_buckets++;
+}
+
+void minmax_series_init(minmax_series_t *series, int64_t bucket_period_us)
+{
+    series->bucket_period_us = (bucket_period_us > 0) ? bucket_period_us : 1;
+    series->bucket_start_us = 0;
+    series->n_buckets = 0;
+}
+
+uint32_t minmax_series_add(minmax_series_t *series, int64_t timestamp_us, float value)
+{
+    uint32_t n_started = 0;
+    if (series->n_buckets == 0)
+    {
+        series->bucket_start_us = timestamp_us;
+        minmax_series_start_bucket(series);
+        n_started = 1;
+    }
+    else if (timestamp_us >= series->bucket_start_us + series->bucket_period_us)
+    {
+        // Buckets without samples in between stay empty, at most a ring worth of them is cleared
+        int64_t n_elapsed = (timestamp_us - series->bucket_start_us) / series->bucket_period_us;
+        int64_t n_cleared = (n_elapsed > MINMAX_SERIES_LEN) ? MINMAX_SERIES_LEN : n_elapsed;
+        series->bucket_start_us += n_elapsed * series->bucket_period_us;
+        series->n_buckets += (uint32_t)(n_elapsed - n_cleared);
+        for (int64_t i = 0; i < n_cleared; i++)
+        {
+            minmax_series_start_bucket(series);
+        }
+        n_started = (uint32_t)n_elapsed;
+    }
+    // NOTE: A sample older than the newest bucket (clock going back) is counted in the newest bucket
+
+    if (isnan(value)) return n_started;
+    minmax_bucket_t *bucket = &series->buckets[(series->n_buckets - 1) % MINMAX_SERIES_LEN];
+    if (value < bucket->min) bucket->min = value;
+    if (value > bucket->max) bucket->max = value;
+    return n_started;
+}
+
+void minmax_series_load(minmax_series_t       *series,
+                        uint32_t               newest_index,
+                        int64_t                newest_start_us,
+                        const minmax_bucket_t *buckets,
+                        uint32_t               n_buckets)
+{
+    series->n_buckets = newest_index + 1U;
+    series->bucket_start_us = newest_start_us;
+    for (uint32_t age = 0; age < MINMAX_SERIES_LEN && age <= newest_index; age++)
+    {
+        minmax_bucket_t *bucket = &series->buckets[(newest_index - age) % MINMAX_SERIES_LEN];
+        if (age < n_buckets)
+        {
+            *bucket = buckets[n_buckets - 1U - age];
+        }
+        else
+        {
+            bucket->min = INFINITY;
+            bucket->max = -INFINITY;
+        }
+    }
+}
+
+bool minmax_series_get(const minmax_series_t *series, uint32_t index, minmax_bucket_t *bucket)
+{
+    if (index >= series->n_buckets || series->n_buckets - index > MINMAX_SERIES_LEN) return false;
+    *bucket = series->buckets[index % MINMAX_SERIES_LEN];
+    return true;
+}
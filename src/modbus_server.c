@@ -0,0 +1,724 @@
+#include "modbus_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "driver/uart.h"
+    #include "driver/uart_vfs.h"
+    #include "esp_event.h"
+    #include "esp_log.h"
+    #include "esp_netif.h"
+    #include "esp_timer.h"
+    #include "esp_wifi.h"
+
+    #include "ambient_sense.h"
+    #include "timebase.h"
+#endif
+
+#define MODBUS_INVALID_I16 0x8000U
+#define MODBUS_INVALID_U16 0xFFFFU
+#define MODBUS_INVALID_U32 0xFFFFFFFFUL
+
+static uint16_t modbus_pack_i16(float value, float scale)
+{
+    if (isnan(value)) return MODBUS_INVALID_I16;
+    float scaled = roundf(value * scale);
+    if (scaled < (float)(INT16_MIN + 1)) scaled = (float)(INT16_MIN + 1); // INT16_MIN is the missing value
+    if (scaled > (float)INT16_MAX) scaled = (float)INT16_MAX;
+    return (uint16_t)(int16_t)scaled;
+}
+
+static uint16_t modbus_pack_u16(float value, float scale)
+{
+    if (isnan(value)) return MODBUS_INVALID_U16;
+    float scaled = roundf(value * scale);
+    if (scaled < 0.0f) scaled = 0.0f;
+    if (scaled > (float)(UINT16_MAX - 1)) scaled = (float)(UINT16_MAX - 1);
+    return (uint16_t)scaled;
+}
+
+static void modbus_put_u32(uint16_t *registers, uint32_t value)
+{
+    registers[0] = (uint16_t)(value >> 16);
+    registers[1] = (uint16_t)value;
+}
+
+static void modbus_put_float_u32(uint16_t *registers, float value)
+{
+    if (isnan(value) || value < 0.0f)
+    {
+        modbus_put_u32(registers, MODBUS_INVALID_U32);
+        return;
+    }
+    double rounded = round((double)value);
+    modbus_put_u32(registers, rounded >= (double)MODBUS_INVALID_U32 ? MODBUS_INVALID_U32 - 1U : (uint32_t)rounded);
+}
+
+// Magnus formula (Sonntag constants), within 0.35 °C from -45 to 60 °C
+static float modbus_dew_point_degc(float temp_degc, float humid_pct)
+{
+    if (isnan(temp_degc) || isnan(humid_pct) || humid_pct <= 0.0f) return NAN;
+    const float b = 17.62f, c = 243.12f;
+    float       gamma = logf(humid_pct / 100.0f) + b * temp_degc / (c + temp_degc);
+    return c * gamma / (b - gamma);
+}
+
+void modbus_server_map(const meteo_frame_t          *frame,
+                       const lcd_variables_t        *variables,
+                       const sense_recovery_stats_t *recovery,
+                       uint16_t                      registers[MODBUS_N_REGISTERS])
+{
+    modbus_put_u32(&registers[MODBUS_REG_SEQUENCE], frame->sequence);
+    modbus_put_u32(&registers[MODBUS_REG_UPTIME_S], (uint32_t)(frame->timestamp_us / 1000000));
+    registers[MODBUS_REG_TEMP] = modbus_pack_i16(frame->temperature_degc, 100.0f);
+    registers[MODBUS_REG_HUMID] = modbus_pack_u16(frame->humidity_pct, 100.0f);
+    modbus_put_float_u32(&registers[MODBUS_REG_PRESS], frame->pressure_pa);
+    modbus_put_float_u32(&registers[MODBUS_REG_GAS], frame->gas_resistance_ohm);
+
+    registers[MODBUS_REG_TEMP_HIGH] = modbus_pack_i16(variables->amb_temp_high_degc, 100.0f);
+    registers[MODBUS_REG_TEMP_LOW] = modbus_pack_i16(variables->amb_temp_low_degc, 100.0f);
+    registers[MODBUS_REG_TEMP_AVG] = modbus_pack_i16(variables->amb_temp_avg_degc, 100.0f);
+    registers[MODBUS_REG_HUMID_AVG] = modbus_pack_u16(variables->amb_humid_avg_pct, 100.0f);
+    modbus_put_float_u32(&registers[MODBUS_REG_PRESS_AVG], variables->amb_press_avg_kpa * 1000.0f);
+    registers[MODBUS_REG_DEW_POINT] =
+        modbus_pack_i16(modbus_dew_point_degc(frame->temperature_degc, frame->humidity_pct), 100.0f);
+    registers[MODBUS_REG_ALERTS] = (uint16_t)variables->active_alerts;
+    modbus_put_u32(&registers[MODBUS_REG_SAMPLE_AGE_S], 0);
+
+    modbus_server_map_health(recovery, false, registers);
+}
+
+void modbus_server_map_health(const sense_recovery_stats_t *recovery,
+                              bool                          is_faulted,
+                              uint16_t                      registers[MODBUS_N_REGISTERS])
+{
+    modbus_put_u32(&registers[MODBUS_REG_N_FAULTS], recovery->n_faults);
+    modbus_put_u32(&registers[MODBUS_REG_N_BUS_RESETS], recovery->n_bus_resets);
+    modbus_put_u32(&registers[MODBUS_REG_N_SAMPLES_LOST], recovery->n_samples_lost);
+    modbus_put_u32(&registers[MODBUS_REG_MAX_RECOVER_MS], recovery->max_recover_ms);
+    registers[MODBUS_REG_SENSOR_STATE] = is_faulted ? MODBUS_SENSOR_RECOVERING : MODBUS_SENSOR_MEASURING;
+}
+
+void modbus_server_map_utc(const int64_t *utc_us, uint16_t registers[MODBUS_N_REGISTERS])
+{
+    bool is_valid = utc_us != NULL && *utc_us >= 0 && *utc_us / 1000000 < (int64_t)MODBUS_INVALID_U32;
+    modbus_put_u32(&registers[MODBUS_REG_UTC_S], is_valid ? (uint32_t)(*utc_us / 1000000) : MODBUS_INVALID_U32);
+}
+
+// Age of the published measurement at the request, from its uptime register (missing until the first one)
+static void modbus_put_sample_age(uint16_t registers[MODBUS_N_REGISTERS], int64_t now_us)
+{
+    uint32_t uptime_s = ((uint32_t)registers[MODBUS_REG_UPTIME_S] << 16) | registers[MODBUS_REG_UPTIME_S + 1];
+    if (uptime_s == MODBUS_INVALID_U32) return;
+    int64_t age_s = now_us / 1000000 - (int64_t)uptime_s;
+    modbus_put_u32(&registers[MODBUS_REG_SAMPLE_AGE_S], age_s > 0 ? (uint32_t)age_s : 0);
+}
+
+void modbus_snapshot_init(modbus_snapshot_t *snapshot)
+{
+    seqlock_init(&snapshot->lock);
+    memset(snapshot->registers, 0xFF, sizeof(snapshot->registers));
+    snapshot->registers[MODBUS_REG_TEMP] = MODBUS_INVALID_I16;
+    snapshot->registers[MODBUS_REG_TEMP_HIGH] = MODBUS_INVALID_I16;
+    snapshot->registers[MODBUS_REG_TEMP_LOW] = MODBUS_INVALID_I16;
+    snapshot->registers[MODBUS_REG_TEMP_AVG] = MODBUS_INVALID_I16;
+    snapshot->registers[MODBUS_REG_DEW_POINT] = MODBUS_INVALID_I16;
+}
+
+void modbus_snapshot_publish(modbus_snapshot_t *snapshot, const uint16_t registers[MODBUS_N_REGISTERS])
+{
+    seqlock_write_begin(&snapshot->lock);
+    memcpy(snapshot->registers, registers, sizeof(snapshot->registers));
+    seqlock_write_end(&snapshot->lock);
+}
+
+void modbus_snapshot_read(modbus_snapshot_t *snapshot, uint16_t registers[MODBUS_N_REGISTERS])
+{
+    seqlock_read(&snapshot->lock, registers, snapshot->registers, sizeof(snapshot->registers));
+}
+
+void modbus_server_init_state(modbus_server_t *server, modbus_snapshot_t *snapshot, uint8_t unit_id)
+{
+    memset(server, 0, sizeof(*server));
+    server->snapshot = snapshot;
+    server->unit_id = unit_id;
+}
+
+static size_t modbus_exception(modbus_server_t *server, uint8_t function, uint8_t code, uint8_t *response)
+{
+    server->n_exceptions++;
+    response[0] = function | 0x80U;
+    response[1] = code;
+    return 2;
+}
+
+size_t modbus_server_handle_pdu(
+    modbus_server_t *server, const uint8_t *pdu, size_t length, uint8_t *response, size_t size)
+{
+    if (length < 1 || size < MODBUS_MAX_PDU_SIZE) return 0;
+    server->n_requests++;
+    uint8_t function = pdu[0];
+    if (function != MODBUS_FC_READ_HOLDING && function != MODBUS_FC_READ_INPUT)
+    {
+        return modbus_exception(server, function, MODBUS_EX_ILLEGAL_FUNCTION, response);
+    }
+    if (length != 5) return modbus_exception(server, function, MODBUS_EX_ILLEGAL_VALUE, response);
+
+    uint16_t address = (uint16_t)((pdu[1] << 8) | pdu[2]);
+    uint16_t quantity = (uint16_t)((pdu[3] << 8) | pdu[4]);
+    if (quantity == 0 || quantity > MODBUS_MAX_READ_REGISTERS)
+    {
+        return modbus_exception(server, function, MODBUS_EX_ILLEGAL_VALUE, response);
+    }
+    if ((uint32_t)address + quantity > MODBUS_N_REGISTERS)
+    {
+        return modbus_exception(server, function, MODBUS_EX_ILLEGAL_ADDRESS, response);
+    }
+
+    // One snapshot per request, whatever the register count
+    uint16_t registers[MODBUS_N_REGISTERS];
+    modbus_snapshot_read(server->snapshot, registers);
+    if (server->clock_us != NULL) modbus_put_sample_age(registers, server->clock_us());
+    response[0] = function;
+    response[1] = (uint8_t)(quantity * 2U);
+    for (uint16_t i = 0; i < quantity; i++)
+    {
+        response[2 + 2 * i] = (uint8_t)(registers[address + i] >> 8);
+        response[3 + 2 * i] = (uint8_t)registers[address + i];
+    }
+    return 2U + quantity * 2U;
+}
+
+uint16_t modbus_crc16(const uint8_t *data, size_t length)
+{
+    // CRC-16/MODBUS: reflected poly 0xA001, init 0xFFFF, sent low byte first
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) crc = (crc & 1U) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+    return crc;
+}
+
+static bool modbus_rtu_is_crc_ok(const uint8_t *adu, size_t length)
+{
+    if (length < 4) return false;
+    uint16_t crc = modbus_crc16(adu, length - 2);
+    return adu[length - 2] == (uint8_t)crc && adu[length - 1] == (uint8_t)(crc >> 8);
+}
+
+size_t modbus_server_handle_rtu(
+    modbus_server_t *server, const uint8_t *adu, size_t length, uint8_t *response, size_t size)
+{
+    if (size < MODBUS_RTU_MAX_ADU_SIZE) return 0;
+    if (!modbus_rtu_is_crc_ok(adu, length))
+    {
+        server->n_crc_errors++;
+        return 0;
+    }
+    if (adu[0] != server->unit_id)
+    {
+        server->n_other_unit++; // Broadcast (0) included: the read functions have no broadcast form
+        return 0;
+    }
+    response[0] = adu[0];
+    size_t pdu_size = modbus_server_handle_pdu(server, &adu[1], length - 3, &response[1], size - 3);
+    uint16_t crc = modbus_crc16(response, 1 + pdu_size);
+    response[1 + pdu_size] = (uint8_t)crc;
+    response[2 + pdu_size] = (uint8_t)(crc >> 8);
+    return 3 + pdu_size;
+}
+
+int modbus_tcp_frame_length(const uint8_t *data, size_t length)
+{
+    if (length < 6) return 0;
+    uint16_t protocol_id = (uint16_t)((data[2] << 8) | data[3]);
+    uint16_t follow = (uint16_t)((data[4] << 8) | data[5]); // Unit id and PDU
+    if (protocol_id != 0 || follow < 2 || follow > 1U + MODBUS_MAX_PDU_SIZE) return -1;
+    return (length >= 6U + follow) ? (int)(6U + follow) : 0;
+}
+
+size_t modbus_server_handle_tcp(
+    modbus_server_t *server, const uint8_t *adu, size_t length, uint8_t *response, size_t size)
+{
+    if (size < MODBUS_TCP_MAX_ADU_SIZE || modbus_tcp_frame_length(adu, length) != (int)length) return 0;
+    // The unit id is not checked, the TCP server is the station itself
+    memcpy(response, adu, MODBUS_TCP_MBAP_SIZE);
+    size_t pdu_size = modbus_server_handle_pdu(
+        server, &adu[MODBUS_TCP_MBAP_SIZE], length - MODBUS_TCP_MBAP_SIZE, &response[MODBUS_TCP_MBAP_SIZE], size - 7);
+    response[4] = (uint8_t)((pdu_size + 1U) >> 8);
+    response[5] = (uint8_t)(pdu_size + 1U);
+    return MODBUS_TCP_MBAP_SIZE + pdu_size;
+}
+
+uint32_t modbus_rtu_silence_us(uint32_t baud)
+{
+    if (baud == 0 || baud > 19200) return 1750;
+    return (uint32_t)((35ULL * 11ULL * 1000000ULL / 10ULL + baud - 1U) / baud);
+}
+
+void modbus_rtu_rx_init(modbus_rtu_rx_t *rx, uint32_t baud)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->silence_us = modbus_rtu_silence_us(baud);
+}
+
+void modbus_rtu_rx_feed(modbus_rtu_rx_t *rx, const uint8_t *data, size_t length, int64_t now_us)
+{
+    if (length == 0) return;
+    // Bytes after a silence start a new frame, whatever was left
+    if (rx->length > 0 && now_us - rx->last_byte_us >= (int64_t)rx->silence_us)
+    {
+        rx->length = 0;
+        rx->is_overflow = false;
+    }
+    size_t n_copied = (length < sizeof(rx->buffer) - rx->length) ? length : sizeof(rx->buffer) - rx->length;
+    memcpy(&rx->buffer[rx->length], data, n_copied);
+    rx->length += n_copied;
+    rx->is_overflow |= n_copied < length;
+    rx->last_byte_us = now_us;
+}
+
+// Request length from its function code, 0 when it is not known (yet)
+static size_t modbus_rtu_expected_length(const modbus_rtu_rx_t *rx)
+{
+    if (rx->length < 2) return 0;
+    switch (rx->buffer[1])
+    {
+    case 0x01: // Read coils, discrete inputs, holding and input registers, write single coil and register
+    case 0x02:
+    case 0x03:
+    case 0x04:
+    case 0x05:
+    case 0x06:
+        return 8;
+    case 0x0F: // Write multiple coils and registers: byte count at offset 6
+    case 0x10:
+        return (rx->length >= 7) ? 9U + rx->buffer[6] : 0;
+    default:
+        return 0;
+    }
+}
+
+size_t modbus_rtu_rx_poll(modbus_rtu_rx_t *rx, int64_t now_us)
+{
+    if (rx->length == 0) return 0;
+    size_t expected = modbus_rtu_expected_length(rx);
+    if (!rx->is_overflow && expected == rx->length && modbus_rtu_is_crc_ok(rx->buffer, rx->length))
+    {
+        size_t length = rx->length;
+        rx->length = 0; // Consumed, the caller reads rx->buffer before feeding again
+        return length;
+    }
+    if (now_us - rx->last_byte_us < (int64_t)rx->silence_us) return 0;
+
+    // End of frame by silence
+    size_t length = rx->is_overflow ? 0 : rx->length;
+    rx->length = 0;
+    rx->is_overflow = false;
+    return length;
+}
+
+static int64_t modbus_now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+static bool modbus_write_all(int fd, const uint8_t *data, size_t length, bool is_socket)
+{
+    while (length > 0)
+    {
+        ssize_t n = is_socket ? send(fd, data, length, 0) : write(fd, data, length);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+void modbus_rtu_port_init(modbus_rtu_port_t *port, modbus_server_t *server, int fd, uint32_t baud)
+{
+    port->server = server;
+    port->fd = fd;
+    modbus_rtu_rx_init(&port->rx, baud);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+bool modbus_rtu_port_poll(modbus_rtu_port_t *port, int timeout_ms)
+{
+    // Wait for bytes, or only until the silence ending a partial frame
+    int64_t wait_us = (int64_t)timeout_ms * 1000;
+    if (port->rx.length > 0)
+    {
+        int64_t left_us = port->rx.last_byte_us + port->rx.silence_us - modbus_now_us();
+        wait_us = (left_us < 0) ? 0 : (left_us < wait_us ? left_us : wait_us);
+    }
+    fd_set         read_fds;
+    struct timeval timeout = {.tv_sec = wait_us / 1000000, .tv_usec = wait_us % 1000000};
+    FD_ZERO(&read_fds);
+    FD_SET(port->fd, &read_fds);
+    int n_ready = select(port->fd + 1, &read_fds, NULL, NULL, &timeout);
+    if (n_ready < 0 && errno != EINTR) return false;
+    if (n_ready > 0)
+    {
+        uint8_t data[MODBUS_RTU_MAX_ADU_SIZE];
+        ssize_t n = read(port->fd, data, sizeof(data));
+        if (n < 0 && errno != EAGAIN && errno != EINTR) return false;
+        if (n > 0) modbus_rtu_rx_feed(&port->rx, data, (size_t)n, modbus_now_us());
+    }
+
+    size_t length = modbus_rtu_rx_poll(&port->rx, modbus_now_us());
+    if (length == 0) return true;
+    uint8_t response[MODBUS_RTU_MAX_ADU_SIZE];
+    size_t  response_size = modbus_server_handle_rtu(port->server, port->rx.buffer, length, response, sizeof(response));
+    if (response_size == 0) return true;
+
+    // The response starts after 3.5 characters of silence, a request completed by its length ended just now
+    int64_t gap_us = port->rx.last_byte_us + port->rx.silence_us - modbus_now_us();
+    if (gap_us > 0) usleep((useconds_t)gap_us);
+    return modbus_write_all(port->fd, response, response_size, false);
+}
+
+bool modbus_tcp_port_open(modbus_tcp_port_t *port, modbus_server_t *server, uint16_t number)
+{
+    memset(port, 0, sizeof(*port));
+    port->server = server;
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++) port->client_fds[i] = -1;
+    port->listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (port->listen_fd < 0) return false;
+
+    int                is_reused = 1;
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(number), .sin_addr.s_addr = INADDR_ANY};
+    setsockopt(port->listen_fd, SOL_SOCKET, SO_REUSEADDR, &is_reused, sizeof(is_reused));
+    if (bind(port->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(port->listen_fd, MODBUS_TCP_MAX_CLIENTS) != 0)
+    {
+        close(port->listen_fd);
+        port->listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+uint16_t modbus_tcp_port_number(const modbus_tcp_port_t *port)
+{
+    struct sockaddr_in address;
+    socklen_t          size = sizeof(address);
+    if (getsockname(port->listen_fd, (struct sockaddr *)&address, &size) != 0) return 0;
+    return ntohs(address.sin_port);
+}
+
+static void modbus_tcp_accept(modbus_tcp_port_t *port)
+{
+    int fd = accept(port->listen_fd, NULL, NULL);
+    if (fd < 0) return;
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++)
+    {
+        if (port->client_fds[i] >= 0) continue;
+        int is_no_delay = 1; // Each response in its own segment at once
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &is_no_delay, sizeof(is_no_delay));
+        port->client_fds[i] = fd;
+        port->rx_length[i] = 0;
+        return;
+    }
+    close(fd); // No free client slot
+}
+
+static void modbus_tcp_drop(modbus_tcp_port_t *port, uint8_t client)
+{
+    close(port->client_fds[client]);
+    port->client_fds[client] = -1;
+    port->rx_length[client] = 0;
+}
+
+// Answer the whole frames received from the client, a partial one stays for the next segment
+static void modbus_tcp_receive(modbus_tcp_port_t *port, uint8_t client)
+{
+    uint8_t *rx = port->rx[client];
+    size_t   free_size = sizeof(port->rx[0]) - port->rx_length[client];
+    ssize_t  n = recv(port->client_fds[client], &rx[port->rx_length[client]], free_size, 0);
+    if (n <= 0)
+    {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        modbus_tcp_drop(port, client); // Closed by the client
+        return;
+    }
+    port->rx_length[client] += (size_t)n;
+
+    size_t offset = 0;
+    while (true)
+    {
+        int length = modbus_tcp_frame_length(&rx[offset], port->rx_length[client] - offset);
+        if (length < 0)
+        {
+            modbus_tcp_drop(port, client); // Not Modbus, no way to find the next frame
+            return;
+        }
+        if (length == 0) break;
+        uint8_t response[MODBUS_TCP_MAX_ADU_SIZE];
+        size_t  size = modbus_server_handle_tcp(port->server, &rx[offset], (size_t)length, response, sizeof(response));
+        offset += (size_t)length;
+        if (size > 0 && !modbus_write_all(port->client_fds[client], response, size, true))
+        {
+            modbus_tcp_drop(port, client);
+            return;
+        }
+    }
+    memmove(rx, &rx[offset], port->rx_length[client] - offset);
+    port->rx_length[client] -= offset;
+}
+
+void modbus_tcp_port_poll(modbus_tcp_port_t *port, int timeout_ms)
+{
+    fd_set read_fds;
+    int    max_fd = port->listen_fd;
+    FD_ZERO(&read_fds);
+    FD_SET(port->listen_fd, &read_fds);
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++)
+    {
+        if (port->client_fds[i] < 0) continue;
+        FD_SET(port->client_fds[i], &read_fds);
+        if (port->client_fds[i] > max_fd) max_fd = port->client_fds[i];
+    }
+    struct timeval timeout = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+    if (select(max_fd + 1, &read_fds, NULL, NULL, &timeout) <= 0) return;
+
+    if (FD_ISSET(port->listen_fd, &read_fds)) modbus_tcp_accept(port);
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++)
+    {
+        if (port->client_fds[i] >= 0 && FD_ISSET(port->client_fds[i], &read_fds)) modbus_tcp_receive(port, i);
+    }
+}
+
+void modbus_tcp_port_close(modbus_tcp_port_t *port)
+{
+    for (uint8_t i = 0; i < MODBUS_TCP_MAX_CLIENTS; i++)
+    {
+        if (port->client_fds[i] >= 0) modbus_tcp_drop(port, i);
+    }
+    if (port->listen_fd >= 0) close(port->listen_fd);
+    port->listen_fd = -1;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "modbus_server";
+
+    #ifdef CONFIG_METEO_MODBUS_UNIT_ID
+        #define MODBUS_UNIT_ID CONFIG_METEO_MODBUS_UNIT_ID
+    #else
+        #define MODBUS_UNIT_ID 1
+    #endif
+    #ifdef CONFIG_METEO_MODBUS_RTU
+        #define MODBUS_RTU_UART CONFIG_METEO_MODBUS_RTU_UART
+        #define MODBUS_RTU_BAUD CONFIG_METEO_MODBUS_RTU_BAUD
+    #endif
+    #ifdef CONFIG_METEO_MODBUS_TCP
+        #define MODBUS_TCP_PORT CONFIG_METEO_MODBUS_TCP_PORT
+    #endif
+    #define MODBUS_POLL_TIMEOUT_MS 1000
+
+// NOTE: One server state per transport (their counters are written by their own task), both reading the same snapshot
+static modbus_snapshot_t s_snapshot;
+static uint16_t          s_registers[MODBUS_N_REGISTERS]; //< Last published map, written by the sensing task only
+    #ifdef CONFIG_METEO_MODBUS_RTU
+static modbus_server_t   s_rtu_server;
+static modbus_rtu_port_t s_rtu_port;
+    #endif
+    #ifdef CONFIG_METEO_MODBUS_TCP
+static modbus_server_t   s_tcp_server;
+static modbus_tcp_port_t s_tcp_port;
+    #endif
+
+    #ifdef CONFIG_METEO_MODBUS_RTU
+// UART driver behind the VFS, select() then wakes on the driver receive events. Even parity (8E1) by default as in the
+// Modbus serial line specification, else 2 stop bits (8N2). A driver enable GPIO sets the RS485 half duplex mode.
+static esp_err_t modbus_server_rtu_init(void)
+{
+    const uart_config_t config = {
+        .baud_rate = MODBUS_RTU_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        #ifdef CONFIG_METEO_MODBUS_RTU_PARITY_EVEN
+        .parity = UART_PARITY_EVEN,
+        .stop_bits = UART_STOP_BITS_1,
+        #else
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_2,
+        #endif
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    esp_err_t ret = uart_driver_install(MODBUS_RTU_UART, 2 * MODBUS_RTU_MAX_ADU_SIZE, 0, 0, NULL, 0);
+    if (ret == ESP_OK) ret = uart_param_config(MODBUS_RTU_UART, &config);
+    if (ret == ESP_OK)
+    {
+        ret = uart_set_pin(MODBUS_RTU_UART,
+                           CONFIG_METEO_MODBUS_RTU_TX_GPIO,
+                           CONFIG_METEO_MODBUS_RTU_RX_GPIO,
+                           CONFIG_METEO_MODBUS_RTU_DE_GPIO,
+                           UART_PIN_NO_CHANGE);
+    }
+    if (ret == ESP_OK && CONFIG_METEO_MODBUS_RTU_DE_GPIO >= 0)
+    {
+        ret = uart_set_mode(MODBUS_RTU_UART, UART_MODE_RS485_HALF_DUPLEX);
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "UART%d init failed: %s", MODBUS_RTU_UART, esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    uart_vfs_dev_use_driver(MODBUS_RTU_UART);
+
+    char path[16];
+    snprintf(path, sizeof(path), "/dev/uart/%d", MODBUS_RTU_UART);
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+    {
+        ESP_LOGE(LOG_TAG, "%s open failed", path);
+        return ESP_FAIL;
+    }
+    modbus_server_init_state(&s_rtu_server, &s_snapshot, MODBUS_UNIT_ID);
+    s_rtu_server.clock_us = esp_timer_get_time;
+    modbus_rtu_port_init(&s_rtu_port, &s_rtu_server, fd, MODBUS_RTU_BAUD);
+    ESP_LOGI(LOG_TAG, "RTU unit %d on UART%d at %d baud", MODBUS_UNIT_ID, MODBUS_RTU_UART, MODBUS_RTU_BAUD);
+    return ESP_OK;
+}
+    #endif
+
+    #ifdef CONFIG_METEO_MODBUS_TCP
+static void modbus_server_on_wifi_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && (id == WIFI_EVENT_STA_START || id == WIFI_EVENT_STA_DISCONNECTED))
+    {
+        esp_wifi_connect(); // Retried at each disconnection
+    }
+    else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP)
+    {
+        const ip_event_got_ip_t *event = data;
+        ESP_LOGI(LOG_TAG, "TCP server at " IPSTR ":%d", IP2STR(&event->ip_info.ip), MODBUS_TCP_PORT);
+    }
+}
+
+// Station connection to the site access point, the listening socket is open before it is up
+static esp_err_t modbus_server_tcp_init(void)
+{
+    esp_err_t ret = esp_netif_init(); // NVS (Wi-Fi calibration data) initialized by app_main
+    if (ret == ESP_OK)
+    {
+        ret = esp_event_loop_create_default();
+        if (ret == ESP_ERR_INVALID_STATE) ret = ESP_OK; // Already created
+    }
+    if (ret == ESP_OK && esp_netif_create_default_wifi_sta() == NULL) ret = ESP_FAIL;
+
+    wifi_init_config_t init_config = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_config_t      config = {0};
+    strlcpy((char *)config.sta.ssid, CONFIG_METEO_MODBUS_WIFI_SSID, sizeof(config.sta.ssid));
+    strlcpy((char *)config.sta.password, CONFIG_METEO_MODBUS_WIFI_PASSWORD, sizeof(config.sta.password));
+    if (ret == ESP_OK) ret = esp_wifi_init(&init_config);
+    if (ret == ESP_OK)
+    {
+        ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, modbus_server_on_wifi_event, NULL);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, modbus_server_on_wifi_event, NULL);
+    }
+    if (ret == ESP_OK) ret = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (ret == ESP_OK) ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (ret == ESP_OK) ret = esp_wifi_set_config(WIFI_IF_STA, &config);
+    if (ret == ESP_OK) ret = esp_wifi_start();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Wi-Fi station init failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+
+    modbus_server_init_state(&s_tcp_server, &s_snapshot, MODBUS_UNIT_ID);
+    s_tcp_server.clock_us = esp_timer_get_time;
+    if (!modbus_tcp_port_open(&s_tcp_port, &s_tcp_server, MODBUS_TCP_PORT))
+    {
+        ESP_LOGE(LOG_TAG, "TCP port %d listen failed", MODBUS_TCP_PORT);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+    #endif
+
+esp_err_t modbus_server_init(void)
+{
+    modbus_snapshot_init(&s_snapshot);
+    modbus_snapshot_read(&s_snapshot, s_registers);
+    esp_err_t ret = ESP_OK;
+    #ifdef CONFIG_METEO_MODBUS_RTU
+    if (modbus_server_rtu_init() != ESP_OK) ret = ESP_FAIL;
+    #endif
+    #ifdef CONFIG_METEO_MODBUS_TCP
+    if (modbus_server_tcp_init() != ESP_OK) ret = ESP_FAIL;
+    #endif
+    return ret;
+}
+
+void modbus_server_push(const meteo_frame_t *frame)
+{
+    lcd_variables_t        variables;
+    sense_recovery_stats_t recovery;
+    int64_t                utc_us;
+    lcd_variables_snapshot(&variables);
+    ambient_sense_get_recovery_stats(&recovery);
+    modbus_server_map(frame, &variables, &recovery, s_registers);
+    modbus_server_map_utc(timebase_utc_us(frame->timestamp_us, &utc_us) ? &utc_us : NULL, s_registers);
+    modbus_snapshot_publish(&s_snapshot, s_registers);
+}
+
+void modbus_server_push_health(bool is_faulted)
+{
+    sense_recovery_stats_t recovery;
+    ambient_sense_get_recovery_stats(&recovery);
+    modbus_server_map_health(&recovery, is_faulted, s_registers);
+    modbus_snapshot_publish(&s_snapshot, s_registers);
+}
+
+void modbus_server_rtu_task(void *pvParameter)
+{
+    #ifdef CONFIG_METEO_MODBUS_RTU
+    while (1)
+    {
+        if (!modbus_rtu_port_poll(&s_rtu_port, MODBUS_POLL_TIMEOUT_MS))
+        {
+            ESP_LOGE(LOG_TAG, "UART%d read failed", MODBUS_RTU_UART);
+            vTaskDelay(pdMS_TO_TICKS(MODBUS_POLL_TIMEOUT_MS));
+        }
+    }
+    #else
+    vTaskDelete(NULL);
+    #endif
+}
+
+void modbus_server_tcp_task(void *pvParameter)
+{
+    #ifdef CONFIG_METEO_MODBUS_TCP
+    while (1) modbus_tcp_port_poll(&s_tcp_port, MODBUS_POLL_TIMEOUT_MS);
+    #else
+    vTaskDelete(NULL);
+    #endif
+}
+#endif
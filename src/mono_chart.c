@@ -0,0 +1,232 @@
+#include "mono_chart.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mono_fonts.h"
+
+#define MONO_CHART_MAX_PAGES 8
+
+#define MONO_CHART_TEMP_TEXT_PAGE  0
+#define MONO_CHART_TEMP_PLOT_PAGE  1
+#define MONO_CHART_PRESS_TEXT_PAGE 4
+#define MONO_CHART_PRESS_PLOT_PAGE 5
+#define MONO_CHART_PLOT_N_PAGES    3
+#define MONO_CHART_TEMP_STEP       1.0f // degC
+#define MONO_CHART_PRESS_STEP      0.5f // kPa
+
+void mono_chart_init(mono_chart_t *chart, uint8_t page, uint8_t n_pages, float step, mono_chart_mode_t mode)
+{
+    memset(chart, 0, sizeof(*chart));
+    chart->page = page;
+    chart->n_pages = (n_pages <= MONO_CHART_MAX_PAGES) ? n_pages : MONO_CHART_MAX_PAGES;
+    chart->step = (step > 0.0f) ? step : 1.0f;
+    chart->mode = mode;
+}
+
+// Bucket shown at column x, false when the column is blank (sweep gap, or not enough buckets yet)
+static bool mono_chart_column_index(const mono_chart_t *chart, uint32_t n_buckets, int16_t x, uint32_t *index)
+{
+    if (n_buckets == 0) return false;
+    uint32_t newest = n_buckets - 1;
+    uint32_t age;
+    if (chart->mode == MONO_CHART_SCROLL)
+    {
+        age = (uint32_t)(MONO_FB_WIDTH - 1 - x);
+    }
+    else
+    {
+        age = (newest % MONO_FB_WIDTH + MONO_FB_WIDTH - (uint32_t)x) % MONO_FB_WIDTH;
+        if (age == MONO_FB_WIDTH - 1) return false; // Gap in front of the newest bucket
+    }
+    if (age > newest) return false;
+    *index = newest - age;
+    return true;
+}
+
+static int16_t mono_chart_column_x(const mono_chart_t *chart, uint32_t newest, uint32_t index)
+{
+    if (chart->mode == MONO_CHART_SCROLL) return (int16_t)(MONO_FB_WIDTH - 1 - (newest - index));
+    return (int16_t)(index % MONO_FB_WIDTH);
+}
+
+static void mono_chart_draw_column(mono_chart_t *chart, mono_fb_t *fb, int16_t x, const minmax_bucket_t *bucket)
+{
+    uint8_t bytes[MONO_CHART_MAX_PAGES] = {0};
+    if (bucket != NULL && !minmax_bucket_is_empty(bucket))
+    {
+        int16_t height = chart->n_pages * 8;
+        float   rows_per_unit = (float)(height - 1) / (chart->scale_max - chart->scale_min);
+        // Row 0 at the top, the max is drawn above the min
+        int16_t y_top = (int16_t)((height - 1) - lroundf((bucket->max - chart->scale_min) * rows_per_unit));
+        int16_t y_bottom = (int16_t)((height - 1) - lroundf((bucket->min - chart->scale_min) * rows_per_unit));
+        if (y_top < 0) y_top = 0;
+        if (y_bottom > height - 1) y_bottom = height - 1;
+        for (int16_t y = y_top; y <= y_bottom; y++)
+        {
+            bytes[y / 8] |= (uint8_t)(1U << (y % 8));
+        }
+    }
+    mono_fb_write_column(fb, x, chart->page, chart->n_pages, bytes);
+}
+
+bool mono_chart_get_range(const mono_chart_t *chart, const minmax_series_t *series, float *min, float *max)
+{
+    bool is_found = false;
+    for (int16_t x = 0; x < MONO_FB_WIDTH; x++)
+    {
+        uint32_t        index;
+        minmax_bucket_t bucket;
+        if (!mono_chart_column_index(chart, series->n_buckets, x, &index)) continue;
+        if (!minmax_series_get(series, index, &bucket) || minmax_bucket_is_empty(&bucket)) continue;
+        if (!is_found || bucket.min < *min) *min = bucket.min;
+        if (!is_found || bucket.max > *max) *max = bucket.max;
+        is_found = true;
+    }
+    return is_found;
+}
+
+void mono_chart_redraw(mono_chart_t *chart, mono_fb_t *fb, const minmax_series_t *series)
+{
+    float min;
+    float max;
+    if (mono_chart_get_range(chart, series, &min, &max))
+    {
+        chart->scale_min = floorf(min / chart->step) * chart->step;
+        chart->scale_max = ceilf(max / chart->step) * chart->step;
+        if (chart->scale_max - chart->scale_min < chart->step) chart->scale_max = chart->scale_min + chart->step;
+    }
+
+    // Every column is written whole, only the bytes which differ from the screen are sent
+    for (int16_t x = 0; x < MONO_FB_WIDTH; x++)
+    {
+        uint32_t        index;
+        minmax_bucket_t bucket;
+        bool is_shown = mono_chart_column_index(chart, series->n_buckets, x, &index) &&
+                        minmax_series_get(series, index, &bucket);
+        mono_chart_draw_column(chart, fb, x, is_shown ? &bucket : NULL);
+    }
+    chart->n_drawn = series->n_buckets;
+    chart->n_redraws++;
+}
+
+void mono_chart_update(mono_chart_t *chart, mono_fb_t *fb, const minmax_series_t *series)
+{
+    if (series->n_buckets == 0) return;
+    if (chart->n_drawn == 0 || series->n_buckets < chart->n_drawn ||
+        series->n_buckets - chart->n_drawn >= MONO_FB_WIDTH - 1)
+    {
+        mono_chart_redraw(chart, fb, series); // First draw, series restarted or too many new buckets
+        return;
+    }
+
+    // The previous newest bucket may have got samples since it was drawn, it is drawn again with the new ones
+    uint32_t newest = series->n_buckets - 1;
+    uint32_t first = chart->n_drawn - 1;
+    for (uint32_t index = first; index <= newest; index++)
+    {
+        minmax_bucket_t bucket;
+        if (minmax_series_get(series, index, &bucket) && !minmax_bucket_is_empty(&bucket) &&
+            (bucket.min < chart->scale_min || bucket.max > chart->scale_max))
+        {
+            mono_chart_redraw(chart, fb, series); // Out of scale, fit it again
+            return;
+        }
+    }
+
+    for (uint32_t index = first; index <= newest; index++)
+    {
+        minmax_bucket_t bucket;
+        bool            is_valid = minmax_series_get(series, index, &bucket);
+        if (chart->mode == MONO_CHART_SCROLL)
+        {
+            if (index > first) mono_fb_scroll_left(fb, chart->page, chart->n_pages);
+            mono_chart_draw_column(chart, fb, MONO_FB_WIDTH - 1, is_valid ? &bucket : NULL);
+        }
+        else
+        {
+            mono_chart_draw_column(chart, fb, mono_chart_column_x(chart, newest, index), is_valid ? &bucket : NULL);
+        }
+    }
+    if (chart->mode == MONO_CHART_SWEEP)
+    {
+        mono_chart_draw_column(chart, fb, (int16_t)((newest + 1) % MONO_FB_WIDTH), NULL); // Gap
+    }
+    chart->n_drawn = series->n_buckets;
+}
+
+void mono_chart_screen_init(mono_chart_screen_t *screen, mono_chart_mode_t mode)
+{
+    memset(screen, 0, sizeof(*screen));
+    mono_chart_init(
+        &screen->temp_chart, MONO_CHART_TEMP_PLOT_PAGE, MONO_CHART_PLOT_N_PAGES, MONO_CHART_TEMP_STEP, mode);
+    mono_chart_init(
+        &screen->press_chart, MONO_CHART_PRESS_PLOT_PAGE, MONO_CHART_PLOT_N_PAGES, MONO_CHART_PRESS_STEP, mode);
+}
+
+// Header line: unit and shown range, redrawn when its text changes
+static void mono_chart_screen_update_text(mono_fb_t             *fb,
+                                          const mono_chart_t    *chart,
+                                          const minmax_series_t *series,
+                                          uint8_t                page,
+                                          const char            *unit,
+                                          char                  *shown_text,
+                                          size_t                 shown_text_size)
+{
+    char  text[24];
+    float min;
+    float max;
+    if (mono_chart_get_range(chart, series, &min, &max))
+    {
+        snprintf(text, sizeof(text), "%s %.1f..%.1f", unit, (double)min, (double)max);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%s", unit);
+    }
+    if (strcmp(text, shown_text) == 0) return;
+
+    int16_t width = mono_fb_draw_text(fb, &mono_font_5x7, 0, page * 8, MONO_FB_WIDTH, text);
+    mono_fb_fill_rect(fb, width, page * 8, MONO_FB_WIDTH - width, 8, false);
+    strncpy(shown_text, text, shown_text_size - 1);
+    shown_text[shown_text_size - 1] = '\0';
+}
+
+void mono_chart_screen_update(mono_chart_screen_t   *screen,
+                              mono_fb_t             *fb,
+                              const minmax_series_t *temp_series,
+                              const minmax_series_t *press_series)
+{
+    mono_chart_update(&screen->temp_chart, fb, temp_series);
+    mono_chart_update(&screen->press_chart, fb, press_series);
+    mono_chart_screen_update_text(fb,
+                                  &screen->temp_chart,
+                                  temp_series,
+                                  MONO_CHART_TEMP_TEXT_PAGE,
+                                  "°C",
+                                  screen->temp_text,
+                                  sizeof(screen->temp_text));
+    mono_chart_screen_update_text(fb,
+                                  &screen->press_chart,
+                                  press_series,
+                                  MONO_CHART_PRESS_TEXT_PAGE,
+                                  "kpA",
+                                  screen->press_text,
+                                  sizeof(screen->press_text));
+}
+
+void mono_chart_screen_draw(mono_chart_screen_t   *screen,
+                            mono_fb_t             *fb,
+                            const minmax_series_t *temp_series,
+                            const minmax_series_t *press_series)
+{
+    // The framebuffer holds another screen, the header texts are drawn again
+    screen->temp_text[0] = '\0';
+    screen->press_text[0] = '\0';
+    mono_fb_fill_rect(fb, 0, MONO_CHART_TEMP_TEXT_PAGE * 8, MONO_FB_WIDTH, 8, false);
+    mono_fb_fill_rect(fb, 0, MONO_CHART_PRESS_TEXT_PAGE * 8, MONO_FB_WIDTH, 8, false);
+    mono_chart_redraw(&screen->temp_chart, fb, temp_series);
+    mono_chart_redraw(&screen->press_chart, fb, press_series);
+    mono_chart_screen_update(screen, fb, temp_series, press_series);
+}
@@ -0,0 +1,210 @@
+#include "mono_fb.h"
+
+#include <string.h>
+
+static void mono_fb_mark_dirty(mono_fb_t *fb, uint8_t page, int16_t col_start, int16_t col_end)
+{
+    if (fb->dirty_end[page] == 0)
+    {
+        fb->dirty_start[page] = (uint8_t)col_start;
+        fb->dirty_end[page] = (uint8_t)col_end;
+        return;
+    }
+    if (col_start < fb->dirty_start[page]) fb->dirty_start[page] = (uint8_t)col_start;
+    if (col_end > fb->dirty_end[page]) fb->dirty_end[page] = (uint8_t)col_end;
+}
+
+// Set (or clear) the bits of mask in a page column byte, only marks the column dirty when the byte changes
+static void mono_fb_write_bits(mono_fb_t *fb, uint8_t page, int16_t x, uint8_t mask, uint8_t bits)
+{
+    uint8_t *byte = &fb->data[page * MONO_FB_WIDTH + x];
+    uint8_t  value = (uint8_t)((*byte & ~mask) | (bits & mask));
+    if (value == *byte) return;
+    *byte = value;
+    mono_fb_mark_dirty(fb, page, x, x + 1);
+}
+
+void mono_fb_clear(mono_fb_t *fb)
+{
+    memset(fb->data, 0, sizeof(fb->data));
+    mono_fb_mark_all_dirty(fb);
+}
+
+void mono_fb_mark_all_dirty(mono_fb_t *fb)
+{
+    for (uint8_t page = 0; page < MONO_FB_N_PAGES; page++)
+    {
+        fb->dirty_start[page] = 0;
+        fb->dirty_end[page] = MONO_FB_WIDTH;
+    }
+}
+
+void mono_fb_fill_rect(mono_fb_t *fb, int16_t x, int16_t y, int16_t width, int16_t height, bool is_on)
+{
+    int16_t x_end = x + width;
+    int16_t y_end = y + height;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x_end > MONO_FB_WIDTH) x_end = MONO_FB_WIDTH;
+    if (y_end > MONO_FB_HEIGHT) y_end = MONO_FB_HEIGHT;
+    if (x >= x_end || y >= y_end) return;
+
+    for (int16_t page = y / 8; page <= (y_end - 1) / 8; page++)
+    {
+        // Rows of this page covered by the rectangle
+        int16_t row_start = (y > page * 8) ? y - page * 8 : 0;
+        int16_t row_end = (y_end < (page + 1) * 8) ? y_end - page * 8 : 8;
+        uint8_t mask = (uint8_t)((0xFFU << row_start) & (0xFFU >> (8 - row_end)));
+        for (int16_t col = x; col < x_end; col++)
+        {
+            mono_fb_write_bits(fb, (uint8_t)page, col, mask, is_on ? 0xFF : 0x00);
+        }
+    }
+}
+
+bool mono_fb_get_pixel(const mono_fb_t *fb, int16_t x, int16_t y)
+{
+    if (x < 0 || y < 0 || x >= MONO_FB_WIDTH || y >= MONO_FB_HEIGHT) return false;
+    return (fb->data[(y / 8) * MONO_FB_WIDTH + x] >> (y % 8)) & 1U;
+}
+
+void mono_fb_write_column(mono_fb_t *fb, int16_t x, uint8_t page, uint8_t n_pages, const uint8_t *bytes)
+{
+    if (x < 0 || x >= MONO_FB_WIDTH) return;
+    for (uint8_t i = 0; i < n_pages && page + i < MONO_FB_N_PAGES; i++)
+    {
+        mono_fb_write_bits(fb, page + i, x, 0xFF, bytes[i]);
+    }
+}
+
+void mono_fb_scroll_left(mono_fb_t *fb, uint8_t page, uint8_t n_pages)
+{
+    for (uint8_t i = 0; i < n_pages && page + i < MONO_FB_N_PAGES; i++)
+    {
+        uint8_t *row = &fb->data[(page + i) * MONO_FB_WIDTH];
+        for (int16_t x = 0; x < MONO_FB_WIDTH; x++)
+        {
+            mono_fb_write_bits(fb, page + i, x, 0xFF, (x + 1 < MONO_FB_WIDTH) ? row[x + 1] : 0x00);
+        }
+    }
+}
+
+// Next Latin-1 character of an UTF-8 string, other multi-byte sequences are returned as '?'
+static uint8_t mono_fb_next_char(const char **text)
+{
+    const uint8_t *s = (const uint8_t *)*text;
+    if (s[0] < 0x80)
+    {
+        *text += 1;
+        return s[0];
+    }
+    if ((s[0] == 0xC2 || s[0] == 0xC3) && (s[1] & 0xC0) == 0x80)
+    {
+        *text += 2;
+        return (uint8_t)(((s[0] & 0x03) << 6) | (s[1] & 0x3F));
+    }
+    *text += 1;
+    while ((**text & 0xC0) == 0x80)
+    {
+        *text += 1; // Skip the continuation bytes
+    }
+    return '?';
+}
+
+static const mono_glyph_t *mono_fb_find_glyph(const mono_font_t *font, uint8_t code)
+{
+    for (uint8_t i = 0; i < font->n_glyphs; i++)
+    {
+        if (font->glyphs[i].code == code) return &font->glyphs[i];
+    }
+    return NULL;
+}
+
+int16_t mono_fb_text_width(const mono_font_t *font, const char *text)
+{
+    int16_t width = 0;
+    while (*text != '\0')
+    {
+        const mono_glyph_t *glyph = mono_fb_find_glyph(font, mono_fb_next_char(&text));
+        if (glyph == NULL) continue;
+        if (width > 0) width += font->spacing;
+        width += glyph->width;
+    }
+    return width;
+}
+
+// Draw the glyph bitmap with its first row at top, a byte copy when top is on a page boundary
+static void mono_fb_draw_glyph(
+    mono_fb_t *fb, const mono_font_t *font, const mono_glyph_t *glyph, int16_t x, int16_t top, int16_t width)
+{
+    const uint8_t *bitmap = &font->bitmap[glyph->offset];
+    int16_t        shift = (int16_t)(((top % 8) + 8) % 8); // Rows between the bitmap top and its first page top
+    int16_t        page = (int16_t)((top - shift) / 8);
+    for (uint8_t glyph_page = 0; glyph_page < font->height_pages; glyph_page++, page++)
+    {
+        const uint8_t *column = &bitmap[glyph_page * glyph->width];
+        for (int16_t col = 0; col < width; col++)
+        {
+            int16_t fb_x = x + col;
+            if (fb_x < 0 || fb_x >= MONO_FB_WIDTH) continue;
+            // A glyph page spans two framebuffer pages, unless it is page aligned (shift 0)
+            if (page >= 0 && page < MONO_FB_N_PAGES)
+            {
+                mono_fb_write_bits(
+                    fb, (uint8_t)page, fb_x, (uint8_t)(0xFFU << shift), (uint8_t)(column[col] << shift));
+            }
+            if (shift != 0 && page + 1 >= 0 && page + 1 < MONO_FB_N_PAGES)
+            {
+                mono_fb_write_bits(fb,
+                                   (uint8_t)(page + 1),
+                                   fb_x,
+                                   (uint8_t)(0xFFU >> (8 - shift)),
+                                   (uint8_t)(column[col] >> (8 - shift)));
+            }
+        }
+    }
+}
+
+int16_t mono_fb_draw_text(
+    mono_fb_t *fb, const mono_font_t *font, int16_t x, int16_t y, int16_t max_width, const char *text)
+{
+    int16_t top = y + font->y_offset;
+    int16_t width = 0;
+    while (*text != '\0' && width < max_width)
+    {
+        const mono_glyph_t *glyph = mono_fb_find_glyph(font, mono_fb_next_char(&text));
+        if (glyph == NULL) continue;
+        if (width > 0)
+        {
+            int16_t spacing = (width + font->spacing > max_width) ? max_width - width : font->spacing;
+            mono_fb_fill_rect(fb, x + width, top, spacing, font->height_pages * 8, false);
+            width += spacing;
+        }
+        if (width >= max_width) break;
+
+        int16_t glyph_width = glyph->width;
+        if (width + glyph_width > max_width) glyph_width = max_width - width; // Clip like the LVGL labels
+        mono_fb_draw_glyph(fb, font, glyph, x + width, top, glyph_width);
+        width += glyph_width;
+    }
+    return width;
+}
+
+size_t mono_fb_flush(mono_fb_t *fb, mono_fb_write_fn_t write_fn, void *ctx)
+{
+    size_t n_bytes = 0;
+    for (uint8_t page = 0; page < MONO_FB_N_PAGES; page++)
+    {
+        if (fb->dirty_end[page] == 0) continue;
+
+        uint8_t col_start = fb->dirty_start[page];
+        uint8_t col_end = fb->dirty_end[page];
+        if (!write_fn(ctx, page, col_start, col_end, &fb->data[page * MONO_FB_WIDTH + col_start]))
+        {
+            continue; // Keep the page dirty, retried on the next flush
+        }
+        n_bytes += (size_t)(col_end - col_start);
+        fb->dirty_end[page] = 0;
+    }
+    return n_bytes;
+}
@@ -0,0 +1,128 @@
+#include "mono_fonts.h"
+
+// 5x7 glyphs (classic HD44780 style), one page high with the top row in the LSB
+static const uint8_t s_mono_font_5x7_bitmap[] = {
+    0x00, 0x00, 0x00,             // space
+    0x23, 0x13, 0x08, 0x64, 0x62, // %
+    0x08, 0x08, 0x08, 0x08, 0x08, // -
+    0x60, 0x60,                   // .
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+    0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+    0x42, 0x61, 0x51, 0x49, 0x46, // 2
+    0x21, 0x41, 0x45, 0x4B, 0x31, // 3
+    0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+    0x27, 0x45, 0x45, 0x45, 0x39, // 5
+    0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
+    0x01, 0x71, 0x09, 0x05, 0x03, // 7
+    0x36, 0x49, 0x49, 0x49, 0x36, // 8
+    0x06, 0x49, 0x49, 0x29, 0x1E, // 9
+    0x7C, 0x12, 0x11, 0x12, 0x7C, // A
+    0x3E, 0x41, 0x41, 0x41, 0x22, // C
+    0x7F, 0x41, 0x41, 0x22, 0x1C, // D
+    0x7F, 0x09, 0x09, 0x09, 0x01, // F
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+    0x00, 0x41, 0x7F, 0x41, 0x00, // I
+    0x7F, 0x02, 0x0C, 0x02, 0x7F, // M
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+    0x7F, 0x09, 0x19, 0x29, 0x46, // R
+    0x46, 0x49, 0x49, 0x49, 0x31, // S
+    0x01, 0x01, 0x7F, 0x01, 0x01, // T
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+    0x7F, 0x10, 0x28, 0x44,       // k
+    0x7C, 0x14, 0x14, 0x14, 0x08, // p
+    0x06, 0x09, 0x09, 0x06,       // °
+};
+
+static const mono_glyph_t s_mono_font_5x7_glyphs[] = {
+    {' ', 3, 0},
+    {'%', 5, 3},
+    {'-', 5, 8},
+    {'.', 2, 13},
+    {'0', 5, 15},
+    {'1', 5, 20},
+    {'2', 5, 25},
+    {'3', 5, 30},
+    {'4', 5, 35},
+    {'5', 5, 40},
+    {'6', 5, 45},
+    {'7', 5, 50},
+    {'8', 5, 55},
+    {'9', 5, 60},
+    {'A', 5, 65},
+    {'C', 5, 70},
+    {'D', 5, 75},
+    {'F', 5, 80},
+    {'H', 5, 85},
+    {'I', 5, 90},
+    {'M', 5, 95},
+    {'O', 5, 100},
+    {'R', 5, 105},
+    {'S', 5, 110},
+    {'T', 5, 115},
+    {'U', 5, 120},
+    {'k', 4, 125},
+    {'p', 5, 129},
+    {0xB0, 4, 134},
+};
+
+const mono_font_t mono_font_5x7 = {
+    .height_pages = 1,
+    .spacing = 1,
+    .n_glyphs = sizeof(s_mono_font_5x7_glyphs) / sizeof(s_mono_font_5x7_glyphs[0]),
+    .glyphs = s_mono_font_5x7_glyphs,
+    .bitmap = s_mono_font_5x7_bitmap,
+};
+
+// Same glyphs scaled 2x for the temperature, two pages high
+static const uint8_t s_mono_font_10x14_bitmap[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,                         // space page 0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,                         // space page 1
+    0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, // - page 0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // - page 1
+    0x00, 0x00, 0x00, 0x00,                                     // . page 0
+    0x3C, 0x3C, 0x3C, 0x3C,                                     // . page 1
+    0xFC, 0xFC, 0x03, 0x03, 0xC3, 0xC3, 0x33, 0x33, 0xFC, 0xFC, // 0 page 0
+    0x0F, 0x0F, 0x33, 0x33, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, // 0 page 1
+    0x00, 0x00, 0x0C, 0x0C, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, // 1 page 0
+    0x00, 0x00, 0x30, 0x30, 0x3F, 0x3F, 0x30, 0x30, 0x00, 0x00, // 1 page 1
+    0x0C, 0x0C, 0x03, 0x03, 0x03, 0x03, 0xC3, 0xC3, 0x3C, 0x3C, // 2 page 0
+    0x30, 0x30, 0x3C, 0x3C, 0x33, 0x33, 0x30, 0x30, 0x30, 0x30, // 2 page 1
+    0x03, 0x03, 0x03, 0x03, 0x33, 0x33, 0xCF, 0xCF, 0x03, 0x03, // 3 page 0
+    0x0C, 0x0C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, // 3 page 1
+    0xC0, 0xC0, 0x30, 0x30, 0x0C, 0x0C, 0xFF, 0xFF, 0x00, 0x00, // 4 page 0
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x3F, 0x3F, 0x03, 0x03, // 4 page 1
+    0x3F, 0x3F, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xC3, 0xC3, // 5 page 0
+    0x0C, 0x0C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, // 5 page 1
+    0xF0, 0xF0, 0xCC, 0xCC, 0xC3, 0xC3, 0xC3, 0xC3, 0x00, 0x00, // 6 page 0
+    0x0F, 0x0F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, // 6 page 1
+    0x03, 0x03, 0x03, 0x03, 0xC3, 0xC3, 0x33, 0x33, 0x0F, 0x0F, // 7 page 0
+    0x00, 0x00, 0x3F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 7 page 1
+    0x3C, 0x3C, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0x3C, 0x3C, // 8 page 0
+    0x0F, 0x0F, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x0F, 0x0F, // 8 page 1
+    0x3C, 0x3C, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFC, 0xFC, // 9 page 0
+    0x00, 0x00, 0x30, 0x30, 0x30, 0x30, 0x0C, 0x0C, 0x03, 0x03, // 9 page 1
+};
+
+static const mono_glyph_t s_mono_font_10x14_glyphs[] = {
+    {' ', 6, 0},
+    {'-', 10, 12},
+    {'.', 4, 32},
+    {'0', 10, 40},
+    {'1', 10, 60},
+    {'2', 10, 80},
+    {'3', 10, 100},
+    {'4', 10, 120},
+    {'5', 10, 140},
+    {'6', 10, 160},
+    {'7', 10, 180},
+    {'8', 10, 200},
+    {'9', 10, 220},
+};
+
+const mono_font_t mono_font_10x14 = {
+    .height_pages = 2,
+    .spacing = 1,
+    .n_glyphs = sizeof(s_mono_font_10x14_glyphs) / sizeof(s_mono_font_10x14_glyphs[0]),
+    .glyphs = s_mono_font_10x14_glyphs,
+    .bitmap = s_mono_font_10x14_bitmap,
+};
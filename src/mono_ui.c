@@ -0,0 +1,145 @@
+#include "mono_ui.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mono_fonts.h" //< The alert names are not in the EEZ Studio project, always in the 5x7 font
+
+#ifdef MONO_FONTS_EEZ
+    #include "mono_fonts_eez.h" //< Generated at build time from the EEZ Studio project, see tools/gen_mono_fonts.py
+
+    #define MONO_UI_FONT_TEMP       MONO_FONT_EEZ_AMBIENT_TEMPERATURE
+    #define MONO_UI_FONT_TEMP_SIGN  MONO_FONT_EEZ_NEGATIVE_TEMPERATURE
+    #define MONO_UI_FONT_TEMP_UNIT  MONO_FONT_EEZ_DEGREE_CELSIUS
+    #define MONO_UI_FONT_HUMID      MONO_FONT_EEZ_AMBIENT_HUMIDITY
+    #define MONO_UI_FONT_HUMID_UNIT MONO_FONT_EEZ_PERCENT
+    #define MONO_UI_FONT_PRESS      MONO_FONT_EEZ_AMBIENT_PRESSURE
+    #define MONO_UI_FONT_PRESS_UNIT MONO_FONT_EEZ_PERCENT_1
+#else
+    // Built-in fonts, Montserrat 20 is replaced by the 10x14 font and the smaller Montserrat sizes by the 5x7 one
+    #define MONO_UI_FONT_TEMP       (&mono_font_10x14)
+    #define MONO_UI_FONT_TEMP_SIGN  (&mono_font_10x14)
+    #define MONO_UI_FONT_TEMP_UNIT  (&mono_font_5x7)
+    #define MONO_UI_FONT_HUMID      (&mono_font_5x7)
+    #define MONO_UI_FONT_HUMID_UNIT (&mono_font_5x7)
+    #define MONO_UI_FONT_PRESS      (&mono_font_5x7)
+    #define MONO_UI_FONT_PRESS_UNIT (&mono_font_5x7)
+#endif
+
+// NOTE: Same positions as the EEZ Studio main screen (eez_studio/src/ui/screens.c)
+#define MONO_UI_LED_X           5
+#define MONO_UI_LED_Y           5
+#define MONO_UI_LED_SIZE        3
+
+#define MONO_UI_TEMP_SIGN_X     2
+#define MONO_UI_TEMP_SIGN_WIDTH 8
+#define MONO_UI_TEMP_X          10
+#define MONO_UI_TEMP_Y          20
+#define MONO_UI_TEMP_WIDTH      37
+#define MONO_UI_TEMP_UNIT_X     50
+
+#define MONO_UI_HUMID_X         66
+#define MONO_UI_HUMID_Y         11
+#define MONO_UI_HUMID_WIDTH     31
+#define MONO_UI_HUMID_UNIT_X    103
+
+#define MONO_UI_PRESS_X         66
+#define MONO_UI_PRESS_Y         36
+#define MONO_UI_PRESS_WIDTH     31
+#define MONO_UI_PRESS_UNIT_X    102
+#define MONO_UI_PRESS_UNIT_Y    35
+
+// Not on the EEZ Studio screen, bottom left below the temperature
+#define MONO_UI_ALERT_X         2
+#define MONO_UI_ALERT_Y         56
+#define MONO_UI_ALERT_WIDTH     60
+
+void mono_ui_init(mono_ui_t *ui)
+{
+    memset(ui, 0, sizeof(*ui));
+    mono_fb_clear(&ui->fb);
+    mono_fb_draw_text(&ui->fb, MONO_UI_FONT_TEMP_UNIT, MONO_UI_TEMP_UNIT_X, MONO_UI_TEMP_Y, MONO_FB_WIDTH, "°C");
+    mono_fb_draw_text(&ui->fb, MONO_UI_FONT_HUMID_UNIT, MONO_UI_HUMID_UNIT_X, MONO_UI_HUMID_Y, MONO_FB_WIDTH, "%");
+    mono_fb_draw_text(
+        &ui->fb, MONO_UI_FONT_PRESS_UNIT, MONO_UI_PRESS_UNIT_X, MONO_UI_PRESS_UNIT_Y, MONO_FB_WIDTH, "kpA");
+}
+
+// Redraw a value field when its text changed: draw the new text, then clear what is left of the old one
+static bool mono_ui_update_text(mono_ui_t         *ui,
+                                const mono_font_t *font,
+                                int16_t            x,
+                                int16_t            y,
+                                int16_t            max_width,
+                                char              *shown_text,
+                                const char        *text)
+{
+    if (strcmp(shown_text, text) == 0) return false;
+
+    int16_t width = mono_fb_draw_text(&ui->fb, font, x, y, max_width, text);
+    mono_fb_fill_rect(&ui->fb, x + width, y + font->y_offset, max_width - width, font->height_pages * 8, false);
+    strncpy(shown_text, text, MONO_UI_VALUE_TEXT_SIZE - 1);
+    shown_text[MONO_UI_VALUE_TEXT_SIZE - 1] = '\0';
+    return true;
+}
+
+uint8_t mono_ui_update(mono_ui_t *ui, const mono_ui_values_t *values)
+{
+    uint8_t changed = 0;
+    char    text[MONO_UI_VALUE_TEXT_SIZE];
+
+    // The sign has its own label, the temperature field shows the magnitude
+    snprintf(text, sizeof(text), "%.1f", (double)fabsf(values->amb_temp_degc));
+    if (mono_ui_update_text(
+            ui, MONO_UI_FONT_TEMP, MONO_UI_TEMP_X, MONO_UI_TEMP_Y, MONO_UI_TEMP_WIDTH, ui->temp_text, text))
+    {
+        changed |= MONO_UI_FIELD_TEMP;
+    }
+
+    if (values->is_amb_temp_negative != ui->is_temp_negative)
+    {
+        ui->is_temp_negative = values->is_amb_temp_negative;
+        mono_fb_fill_rect(&ui->fb,
+                          MONO_UI_TEMP_SIGN_X,
+                          MONO_UI_TEMP_Y + MONO_UI_FONT_TEMP_SIGN->y_offset,
+                          MONO_UI_TEMP_SIGN_WIDTH,
+                          MONO_UI_FONT_TEMP_SIGN->height_pages * 8,
+                          false);
+        if (ui->is_temp_negative)
+        {
+            mono_fb_draw_text(
+                &ui->fb, MONO_UI_FONT_TEMP_SIGN, MONO_UI_TEMP_SIGN_X, MONO_UI_TEMP_Y, MONO_UI_TEMP_SIGN_WIDTH, "-");
+        }
+        changed |= MONO_UI_FIELD_TEMP_SIGN;
+    }
+
+    snprintf(text, sizeof(text), "%.1f", (double)values->amb_humid_pct);
+    if (mono_ui_update_text(
+            ui, MONO_UI_FONT_HUMID, MONO_UI_HUMID_X, MONO_UI_HUMID_Y, MONO_UI_HUMID_WIDTH, ui->humid_text, text))
+    {
+        changed |= MONO_UI_FIELD_HUMID;
+    }
+
+    snprintf(text, sizeof(text), "%.1f", (double)values->amb_press_kpa);
+    if (mono_ui_update_text(
+            ui, MONO_UI_FONT_PRESS, MONO_UI_PRESS_X, MONO_UI_PRESS_Y, MONO_UI_PRESS_WIDTH, ui->press_text, text))
+    {
+        changed |= MONO_UI_FIELD_PRESS;
+    }
+
+    const char *alert_text = (values->alert_name != NULL) ? values->alert_name : "";
+    if (mono_ui_update_text(
+            ui, &mono_font_5x7, MONO_UI_ALERT_X, MONO_UI_ALERT_Y, MONO_UI_ALERT_WIDTH, ui->alert_text, alert_text))
+    {
+        changed |= MONO_UI_FIELD_ALERT;
+    }
+
+    if (values->is_station_connected != ui->is_led_on)
+    {
+        ui->is_led_on = values->is_station_connected;
+        mono_fb_fill_rect(
+            &ui->fb, MONO_UI_LED_X, MONO_UI_LED_Y, MONO_UI_LED_SIZE, MONO_UI_LED_SIZE, ui->is_led_on);
+        changed |= MONO_UI_FIELD_LED;
+    }
+    return changed;
+}
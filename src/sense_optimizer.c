@@ -0,0 +1,180 @@
+#include "sense_optimizer.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SENSE_MEAS_CYCLE_US 1963U
+// TPH switching (4 x 477 us), gas measurement (5 x 477 us) and wake up (1 ms) durations of a forced measurement
+#define SENSE_MEAS_FIXED_US (4U * 477U + 5U * 477U + 1000U)
+
+// Model RMS noise of a single conversion (white) and ADC resolution floor of each channel, typical datasheet orders
+// of magnitude (e.g. 3.3 Pa at 1x down to 1.3 Pa at 16x for the pressure)
+static const float s_white_noise[SENSE_N_CHANNELS] = {0.010f, 3.1f, 0.030f};
+static const float s_floor_noise[SENSE_N_CHANNELS] = {0.002f, 1.0f, 0.008f};
+
+static uint32_t sense_os_cycles(uint8_t os_code)
+{
+    return (os_code == 0) ? 0 : (1U << (os_code - 1U));
+}
+
+static uint32_t sense_filter_coef(uint8_t filter_code)
+{
+    return (1U << filter_code) - 1U;
+}
+
+uint32_t sense_optimizer_meas_us(const uint8_t os_codes[SENSE_N_CHANNELS])
+{
+    uint32_t n_cycles = 0;
+    for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++) n_cycles += sense_os_cycles(os_codes[ch]);
+    return n_cycles * SENSE_MEAS_CYCLE_US + SENSE_MEAS_FIXED_US;
+}
+
+float sense_optimizer_noise(sense_channel_t channel, uint8_t os_code, uint8_t filter_code)
+{
+    if (channel >= SENSE_N_CHANNELS || os_code < SENSE_OPTIMIZER_OS_MIN) return NAN;
+    float white = s_white_noise[channel];
+    float floor_noise = s_floor_noise[channel];
+    float noise = sqrtf(floor_noise * floor_noise + white * white / (float)sense_os_cycles(os_code));
+    if (channel == SENSE_CH_HUMID) return noise; // Not filtered
+    return noise / sqrtf(2.0f * (float)sense_filter_coef(filter_code) + 1.0f);
+}
+
+uint32_t sense_optimizer_response_us(uint8_t filter_code, uint32_t sample_period_us)
+{
+    // Filtered output: y += (x - y) / (c + 1), the step reaches the level after ln(1 - level) / ln(c / (c + 1)) samples
+    uint32_t coef = sense_filter_coef(filter_code);
+    uint32_t n_samples = 1;
+    if (coef > 0)
+    {
+        float a = (float)coef / (float)(coef + 1U);
+        n_samples = (uint32_t)ceilf(logf(1.0f - SENSE_OPTIMIZER_IIR_RESPONSE_LEVEL) / logf(a));
+    }
+    return n_samples * sample_period_us;
+}
+
+static void sense_optimizer_eval(const sense_targets_t *targets, sense_config_t *config)
+{
+    config->meas_us = sense_optimizer_meas_us(config->os_codes);
+    uint32_t sample_period_us = config->meas_us + SENSE_OPTIMIZER_READ_OVERHEAD_US;
+    if (targets->loop_period_us > sample_period_us) sample_period_us = targets->loop_period_us;
+    config->response_us = sense_optimizer_response_us(config->filter_code, sample_period_us);
+    config->is_target_met = true;
+    for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++)
+    {
+        config->noise[ch] = sense_optimizer_noise((sense_channel_t)ch, config->os_codes[ch], config->filter_code);
+        if (config->noise[ch] > targets->noise[ch]) config->is_target_met = false;
+    }
+}
+
+// Noise relative to the targets: the worst channel ratio, or the sum of the ratios
+static float sense_optimizer_noise_ratio(const sense_targets_t *targets, const sense_config_t *config, bool is_worst)
+{
+    float result = 0.0f;
+    for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++)
+    {
+        float ratio = config->noise[ch] / targets->noise[ch];
+        if (!is_worst)
+        {
+            result += ratio;
+        }
+        else if (ratio > result)
+        {
+            result = ratio;
+        }
+    }
+    return result;
+}
+
+static bool sense_optimizer_is_better(const sense_targets_t *targets,
+                                      const sense_config_t  *candidate,
+                                      const sense_config_t  *best)
+{
+    if (candidate->is_target_met != best->is_target_met) return candidate->is_target_met;
+    if (candidate->is_target_met)
+    {
+        if (candidate->meas_us != best->meas_us) return candidate->meas_us < best->meas_us;
+        return sense_optimizer_noise_ratio(targets, candidate, false) <
+               sense_optimizer_noise_ratio(targets, best, false);
+    }
+    float candidate_worst = sense_optimizer_noise_ratio(targets, candidate, true);
+    float best_worst = sense_optimizer_noise_ratio(targets, best, true);
+    if (candidate_worst != best_worst) return candidate_worst < best_worst;
+    return candidate->meas_us < best->meas_us;
+}
+
+bool sense_optimizer_pick(const sense_targets_t *targets, sense_config_t *config)
+{
+    if (targets == NULL || config == NULL) return false;
+
+    // 5^3 oversampling x 8 filter settings, exhaustive
+    bool           is_found = false;
+    sense_config_t candidate;
+    memset(config, 0, sizeof(*config));
+    for (uint8_t os_t = SENSE_OPTIMIZER_OS_MIN; os_t <= SENSE_OPTIMIZER_OS_MAX; os_t++)
+    {
+        for (uint8_t os_p = SENSE_OPTIMIZER_OS_MIN; os_p <= SENSE_OPTIMIZER_OS_MAX; os_p++)
+        {
+            for (uint8_t os_h = SENSE_OPTIMIZER_OS_MIN; os_h <= SENSE_OPTIMIZER_OS_MAX; os_h++)
+            {
+                for (uint8_t filter = 0; filter <= SENSE_OPTIMIZER_FILTER_MAX; filter++)
+                {
+                    candidate.os_codes[SENSE_CH_TEMP] = os_t;
+                    candidate.os_codes[SENSE_CH_PRESS] = os_p;
+                    candidate.os_codes[SENSE_CH_HUMID] = os_h;
+                    candidate.filter_code = filter;
+                    sense_optimizer_eval(targets, &candidate);
+                    if (candidate.meas_us > targets->max_meas_us) continue;
+                    if (filter > 0 && candidate.response_us > targets->max_response_us) continue;
+                    if (!is_found || sense_optimizer_is_better(targets, &candidate, config)) *config = candidate;
+                    is_found = true;
+                }
+            }
+        }
+    }
+    if (is_found) return config->is_target_met;
+
+    // Below the shortest measurement: the shortest one, unfiltered
+    const uint8_t shortest[SENSE_N_CHANNELS] = {SENSE_OPTIMIZER_OS_MIN, SENSE_OPTIMIZER_OS_MIN, SENSE_OPTIMIZER_OS_MIN};
+    memcpy(config->os_codes, shortest, sizeof(shortest));
+    config->filter_code = 0;
+    sense_optimizer_eval(targets, config);
+    config->is_target_met = false;
+    return false;
+}
+
+void sense_noise_meter_reset(sense_noise_meter_t *meter)
+{
+    memset(meter, 0, sizeof(*meter));
+}
+
+void sense_noise_meter_add(sense_noise_meter_t *meter, const float values[SENSE_N_CHANNELS], uint32_t sample_us)
+{
+    if (meter->n_samples > 0)
+    {
+        for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++)
+        {
+            double diff = (double)values[ch] - (double)meter->last[ch];
+            meter->sum_sq_diff[ch] += diff * diff;
+        }
+        meter->n_diffs++;
+    }
+    memcpy(meter->last, values, sizeof(meter->last));
+    meter->n_samples++;
+    meter->total_sample_us += sample_us;
+}
+
+float sense_noise_meter_rms(const sense_noise_meter_t *meter, sense_channel_t channel, uint8_t filter_code)
+{
+    if (channel >= SENSE_N_CHANNELS || meter->n_diffs == 0) return NAN;
+    // For white noise of RMS s, E[d^2] = 2 s^2. The filtered output is correlated from one sample to the next
+    // (coefficient a = c / (c + 1)), then E[d^2] = 2 s^2 (1 - a).
+    double one_minus_a = 1.0;
+    if (channel != SENSE_CH_HUMID) one_minus_a = 1.0 / (double)(sense_filter_coef(filter_code) + 1U);
+    return (float)sqrt(meter->sum_sq_diff[channel] / meter->n_diffs / (2.0 * one_minus_a));
+}
+
+uint32_t sense_noise_meter_sample_us(const sense_noise_meter_t *meter)
+{
+    if (meter->n_samples == 0) return 0;
+    return (uint32_t)(meter->total_sample_us / meter->n_samples);
+}
@@ -0,0 +1,107 @@
+#include "sense_recovery.h"
+
+#include <string.h>
+
+void sense_recovery_init(sense_recovery_t *recovery, const sense_recovery_config_t *config)
+{
+    memset(recovery, 0, sizeof(*recovery));
+    recovery->config = *config;
+    recovery->action = SENSE_RECOVERY_RESET_SENSOR; // Initial sensor setup
+}
+
+sense_recovery_action_t sense_recovery_action(const sense_recovery_t *recovery)
+{
+    return (sense_recovery_action_t)recovery->action;
+}
+
+// Start a bus and sensor reset cycle, at once the first time then after the back-off
+static void sense_recovery_start_cycle(sense_recovery_t *recovery, uint32_t *wait_ms)
+{
+    *wait_ms = recovery->backoff_ms;
+    if (recovery->backoff_ms == 0)
+    {
+        recovery->backoff_ms = recovery->config.initial_backoff_ms;
+    }
+    else
+    {
+        recovery->backoff_ms = (recovery->backoff_ms > recovery->config.max_backoff_ms / 2U)
+                                 ? recovery->config.max_backoff_ms
+                                 : recovery->backoff_ms * 2U;
+    }
+    recovery->action = SENSE_RECOVERY_RESET_BUS;
+}
+
+static sense_recovery_event_t sense_recovery_on_fault(sense_recovery_t *recovery, int64_t now_us)
+{
+    if (recovery->is_faulted) return SENSE_RECOVERY_EVENT_NONE;
+    recovery->is_faulted = true;
+    recovery->fault_start_us = now_us;
+    recovery->stats.n_faults++;
+    return SENSE_RECOVERY_EVENT_FAULT;
+}
+
+static void sense_recovery_on_recovered(sense_recovery_t *recovery, int64_t now_us)
+{
+    int64_t  outage_us = now_us - recovery->fault_start_us;
+    uint32_t n_lost = 1; // The failed sample
+    if (recovery->config.sample_period_us > 0 && outage_us / recovery->config.sample_period_us > 1)
+    {
+        n_lost = (uint32_t)(outage_us / recovery->config.sample_period_us);
+    }
+    recovery->stats.n_samples_lost += n_lost;
+    recovery->stats.last_recover_ms = (uint32_t)(outage_us / 1000);
+    if (recovery->stats.last_recover_ms > recovery->stats.max_recover_ms)
+    {
+        recovery->stats.max_recover_ms = recovery->stats.last_recover_ms;
+    }
+    recovery->is_faulted = false;
+    recovery->n_retries = 0;
+    recovery->backoff_ms = 0;
+}
+
+sense_recovery_event_t sense_recovery_report(sense_recovery_t *recovery, int64_t now_us, bool is_ok, uint32_t *wait_ms)
+{
+    sense_recovery_event_t event = SENSE_RECOVERY_EVENT_NONE;
+    *wait_ms = 0;
+    switch (recovery->action)
+    {
+    case SENSE_RECOVERY_MEASURE:
+        if (is_ok)
+        {
+            if (!recovery->is_faulted) break;
+            sense_recovery_on_recovered(recovery, now_us);
+            event = SENSE_RECOVERY_EVENT_RECOVERED;
+            break;
+        }
+        event = sense_recovery_on_fault(recovery, now_us);
+        // Transient error (e.g. a NACK): measure again, unless a reset cycle already ran
+        if (recovery->n_retries < recovery->config.max_retries && recovery->backoff_ms == 0)
+        {
+            recovery->n_retries++;
+            recovery->stats.n_retries++;
+            break;
+        }
+        sense_recovery_start_cycle(recovery, wait_ms);
+        break;
+    case SENSE_RECOVERY_RESET_BUS:
+        // The sensor state is unknown after a bus fault, it is reset even when the bus reset failed
+        recovery->stats.n_bus_resets++;
+        recovery->action = SENSE_RECOVERY_RESET_SENSOR;
+        break;
+    case SENSE_RECOVERY_RESET_SENSOR:
+        // Also the initial setup, a failure then starts a fault
+        if (recovery->is_faulted) recovery->stats.n_sensor_resets++;
+        if (is_ok)
+        {
+            recovery->action = SENSE_RECOVERY_MEASURE;
+            break;
+        }
+        event = sense_recovery_on_fault(recovery, now_us);
+        sense_recovery_start_cycle(recovery, wait_ms);
+        break;
+    default:
+        recovery->action = SENSE_RECOVERY_MEASURE;
+        break;
+    }
+    return event;
+}
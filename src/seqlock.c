@@ -0,0 +1,46 @@
+#include "seqlock.h"
+
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+static portMUX_TYPE s_writer_lock = portMUX_INITIALIZER_UNLOCKED;
+    #define SEQLOCK_WRITER_LOCK()   taskENTER_CRITICAL(&s_writer_lock)
+    #define SEQLOCK_WRITER_UNLOCK() taskEXIT_CRITICAL(&s_writer_lock)
+#else
+    #define SEQLOCK_WRITER_LOCK() // One writing thread in the host tests
+    #define SEQLOCK_WRITER_UNLOCK()
+#endif
+
+void seqlock_init(seqlock_t *lock)
+{
+    atomic_init(&lock->sequence, 0);
+}
+
+void seqlock_write_begin(seqlock_t *lock)
+{
+    SEQLOCK_WRITER_LOCK();
+    uint_fast32_t sequence = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+    atomic_store_explicit(&lock->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // The odd sequence is visible before the data changes
+}
+
+void seqlock_write_end(seqlock_t *lock)
+{
+    uint_fast32_t sequence = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+    atomic_store_explicit(&lock->sequence, sequence + 1, memory_order_release);
+    SEQLOCK_WRITER_UNLOCK();
+}
+
+void seqlock_read(seqlock_t *lock, void *dst, const void *src, size_t size)
+{
+    uint_fast32_t begin;
+    do
+    {
+        begin = atomic_load_explicit(&lock->sequence, memory_order_acquire);
+        memcpy(dst, src, size);
+        atomic_thread_fence(memory_order_acquire); // The copy completes before the sequence is checked again
+    } while ((begin & 1U) != 0 || begin != atomic_load_explicit(&lock->sequence, memory_order_relaxed));
+}
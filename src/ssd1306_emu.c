@@ -0,0 +1,411 @@
+#include "ssd1306_emu.h"
+
+#include <string.h>
+
+#define SSD1306_CMD_SET_MEMORY_ADDR_MODE 0x20
+#define SSD1306_CMD_SET_COLUMN_RANGE     0x21
+#define SSD1306_CMD_SET_PAGE_RANGE       0x22
+#define SSD1306_CMD_SET_CONTRAST         0x81
+#define SSD1306_CMD_SET_CHARGE_PUMP      0x8D
+#define SSD1306_CMD_MIRROR_X_OFF         0xA0
+#define SSD1306_CMD_MIRROR_X_ON          0xA1
+#define SSD1306_CMD_SET_MULTIPLEX        0xA8
+#define SSD1306_CMD_DISP_OFF             0xAE
+#define SSD1306_CMD_DISP_ON              0xAF
+#define SSD1306_CMD_MIRROR_Y_OFF         0xC0
+#define SSD1306_CMD_MIRROR_Y_ON          0xC8
+#define SSD1306_CMD_SET_OFFSET           0xD3
+#define SSD1306_CMD_SET_COMPINS          0xDA
+
+// Number of argument bytes following the opcode
+static uint8_t ssd1306_emu_n_args(uint8_t opcode, bool *is_known)
+{
+    *is_known = true;
+    if (opcode <= 0x1F || (opcode >= 0x40 && opcode <= 0x7F) || (opcode >= 0xB0 && opcode <= 0xB7)) return 0;
+    switch (opcode)
+    {
+    case 0x26: // Right/left horizontal scroll
+    case 0x27:
+        return 6;
+    case 0x29: // Vertical and horizontal scroll
+    case 0x2A:
+        return 5;
+    case 0xA3: // Vertical scroll area
+    case SSD1306_CMD_SET_COLUMN_RANGE:
+    case SSD1306_CMD_SET_PAGE_RANGE:
+        return 2;
+    case SSD1306_CMD_SET_MEMORY_ADDR_MODE:
+    case SSD1306_CMD_SET_CONTRAST:
+    case SSD1306_CMD_SET_CHARGE_PUMP:
+    case SSD1306_CMD_SET_MULTIPLEX:
+    case SSD1306_CMD_SET_OFFSET:
+    case 0xD5: // Clock divide ratio and oscillator frequency
+    case 0xD9: // Pre-charge period
+    case SSD1306_CMD_SET_COMPINS:
+    case 0xDB: // VCOMH deselect level
+        return 1;
+    case 0x2E: // Deactivate and activate scroll
+    case 0x2F:
+    case 0xA4: // Entire display on, off and on
+    case 0xA5:
+    case 0xA6: // Normal and inverse display
+    case 0xA7:
+    case SSD1306_CMD_MIRROR_X_OFF:
+    case SSD1306_CMD_MIRROR_X_ON:
+    case SSD1306_CMD_DISP_OFF:
+    case SSD1306_CMD_DISP_ON:
+    case SSD1306_CMD_MIRROR_Y_OFF:
+    case SSD1306_CMD_MIRROR_Y_ON:
+    case 0xE3: // NOP
+        return 0;
+    default:
+        *is_known = false;
+        return 0;
+    }
+}
+
+static void ssd1306_emu_execute(ssd1306_emu_t *emu)
+{
+    const uint8_t *cmd = emu->command;
+    if (cmd[0] <= 0x0F)
+    {
+        emu->col = (uint8_t)((emu->col & 0xF0U) | cmd[0]); // Page addressing column, lower nibble
+        return;
+    }
+    if (cmd[0] <= 0x1F)
+    {
+        emu->col = (uint8_t)(((cmd[0] & 0x07U) << 4) | (emu->col & 0x0FU));
+        return;
+    }
+    if (cmd[0] >= 0x40 && cmd[0] <= 0x7F)
+    {
+        emu->start_line = cmd[0] & 0x3FU;
+        return;
+    }
+    if (cmd[0] >= 0xB0 && cmd[0] <= 0xB7)
+    {
+        emu->page = cmd[0] & 0x07U;
+        return;
+    }
+    switch (cmd[0])
+    {
+    case SSD1306_CMD_SET_MEMORY_ADDR_MODE:
+        if ((cmd[1] & 0x03U) != 0x03U) emu->addressing = cmd[1] & 0x03U;
+        break;
+    case SSD1306_CMD_SET_COLUMN_RANGE:
+        emu->col_start = cmd[1] & 0x7FU;
+        emu->col_end = cmd[2] & 0x7FU;
+        emu->col = emu->col_start;
+        break;
+    case SSD1306_CMD_SET_PAGE_RANGE:
+        emu->page_start = cmd[1] & 0x07U;
+        emu->page_end = cmd[2] & 0x07U;
+        emu->page = emu->page_start;
+        break;
+    case SSD1306_CMD_SET_CONTRAST:
+        emu->contrast = cmd[1];
+        break;
+    case SSD1306_CMD_SET_MULTIPLEX:
+        if ((cmd[1] & 0x3FU) >= 15) emu->multiplex = cmd[1] & 0x3FU; // 0 to 14 are invalid
+        break;
+    case SSD1306_CMD_SET_OFFSET:
+        emu->display_offset = cmd[1] & 0x3FU;
+        break;
+    case 0x2E:
+        emu->is_scrolling = false;
+        break;
+    case 0x2F:
+        emu->is_scrolling = true;
+        break;
+    case 0xA4:
+    case 0xA5:
+        emu->is_entire_on = (cmd[0] == 0xA5);
+        break;
+    case 0xA6:
+    case 0xA7:
+        emu->is_inverted = (cmd[0] == 0xA7);
+        break;
+    case SSD1306_CMD_MIRROR_X_OFF:
+    case SSD1306_CMD_MIRROR_X_ON:
+        emu->is_seg_remapped = (cmd[0] == SSD1306_CMD_MIRROR_X_ON);
+        break;
+    case SSD1306_CMD_DISP_OFF:
+    case SSD1306_CMD_DISP_ON:
+        emu->is_on = (cmd[0] == SSD1306_CMD_DISP_ON);
+        break;
+    case SSD1306_CMD_MIRROR_Y_OFF:
+    case SSD1306_CMD_MIRROR_Y_ON:
+        emu->is_com_reversed = (cmd[0] == SSD1306_CMD_MIRROR_Y_ON);
+        break;
+    default:
+        break; // Timing and analog settings, scroll setup: no effect on the emulated image
+    }
+}
+
+static void ssd1306_emu_command_byte(ssd1306_emu_t *emu, uint8_t byte)
+{
+    emu->stats.n_command_bytes++;
+    if (emu->n_command_bytes == 0)
+    {
+        bool is_known;
+        emu->n_command_args = ssd1306_emu_n_args(byte, &is_known);
+        if (!is_known) emu->stats.n_unknown_commands++;
+    }
+    emu->command[emu->n_command_bytes++] = byte;
+    if (emu->n_command_bytes <= emu->n_command_args) return; // Arguments may follow in the next control bytes
+    ssd1306_emu_execute(emu);
+    emu->n_command_bytes = 0;
+}
+
+// Write at the GRAM pointer and move it as the addressing mode does
+static void ssd1306_emu_data_byte(ssd1306_emu_t *emu, uint8_t byte)
+{
+    emu->stats.n_data_bytes++;
+    emu->gram[emu->page * SSD1306_EMU_WIDTH + emu->col] = byte;
+    switch (emu->addressing)
+    {
+    case SSD1306_EMU_ADDRESSING_HORIZONTAL:
+        if (emu->col++ < emu->col_end) break;
+        emu->col = emu->col_start;
+        emu->page = (emu->page < emu->page_end) ? emu->page + 1 : emu->page_start;
+        break;
+    case SSD1306_EMU_ADDRESSING_VERTICAL:
+        if (emu->page++ < emu->page_end) break;
+        emu->page = emu->page_start;
+        emu->col = (emu->col < emu->col_end) ? emu->col + 1 : emu->col_start;
+        break;
+    default: // Page addressing, the column wraps in the same page
+        emu->col = (emu->col < SSD1306_EMU_WIDTH - 1) ? emu->col + 1 : emu->col_start;
+        break;
+    }
+}
+
+void ssd1306_emu_init(ssd1306_emu_t *emu)
+{
+    memset(emu, 0, sizeof(*emu));
+    emu->addressing = SSD1306_EMU_ADDRESSING_PAGE;
+    emu->col_end = SSD1306_EMU_WIDTH - 1;
+    emu->page_end = SSD1306_EMU_N_PAGES - 1;
+    emu->contrast = 0x7F;
+    emu->multiplex = SSD1306_EMU_HEIGHT - 1;
+}
+
+bool ssd1306_emu_transfer(ssd1306_emu_t *emu, const uint8_t *bytes, size_t length)
+{
+    if (bytes == NULL || length == 0) return false;
+    emu->stats.n_transfers++;
+
+    size_t i = 0;
+    while (i < length)
+    {
+        uint8_t control = bytes[i++];
+        emu->stats.n_control_bytes++;
+        bool is_data = (control & SSD1306_EMU_CONTROL_DATA) != 0;
+        // Co set: a single byte before the next control byte, clear: every byte up to the stop condition
+        size_t end = ((control & SSD1306_EMU_CONTROL_CONTINUATION) != 0 && i < length) ? i + 1 : length;
+        for (; i < end; i++)
+        {
+            if (is_data)
+            {
+                ssd1306_emu_data_byte(emu, bytes[i]);
+            }
+            else
+            {
+                ssd1306_emu_command_byte(emu, bytes[i]);
+            }
+        }
+    }
+    return true;
+}
+
+bool ssd1306_emu_get_pixel(const ssd1306_emu_t *emu, int16_t x, int16_t y)
+{
+    if (x < 0 || x >= SSD1306_EMU_WIDTH || y < 0 || y >= SSD1306_EMU_HEIGHT) return false;
+    if (!emu->is_on) return false;
+
+    // Row y is driven by COM y, or COM 63 - y with the reversed scan; only the multiplex ratio COMs are driven
+    uint8_t com = emu->is_com_reversed ? (uint8_t)(SSD1306_EMU_HEIGHT - 1 - y) : (uint8_t)y;
+    uint8_t row_index = (uint8_t)((com + SSD1306_EMU_HEIGHT - emu->display_offset) % SSD1306_EMU_HEIGHT);
+    if (row_index > emu->multiplex) return false;
+    if (emu->is_entire_on) return true;
+
+    uint8_t row = (uint8_t)((row_index + emu->start_line) % SSD1306_EMU_HEIGHT);
+    uint8_t col = emu->is_seg_remapped ? (uint8_t)(SSD1306_EMU_WIDTH - 1 - x) : (uint8_t)x;
+    bool    is_set = (emu->gram[(row / 8) * SSD1306_EMU_WIDTH + col] >> (row % 8)) & 1U;
+    return is_set != emu->is_inverted;
+}
+
+void ssd1306_emu_take_stats(ssd1306_emu_t *emu, ssd1306_emu_stats_t *stats)
+{
+    if (stats != NULL) *stats = emu->stats;
+    memset(&emu->stats, 0, sizeof(emu->stats));
+}
+
+uint32_t ssd1306_emu_bus_time_us(const ssd1306_emu_stats_t *stats, uint32_t scl_hz)
+{
+    if (scl_hz == 0) return 0;
+    uint64_t n_bytes = (uint64_t)stats->n_transfers + stats->n_control_bytes + stats->n_command_bytes +
+                       stats->n_data_bytes;
+    uint64_t n_clocks = n_bytes * 9U + stats->n_transfers * 2U;
+    return (uint32_t)(n_clocks * 1000000U / scl_hz);
+}
+
+// Row of 1-bit pixels, MSB first, lit pixels as the given bit value
+static void ssd1306_emu_pack_row(const ssd1306_emu_t *emu, int16_t y, bool lit_bit, uint8_t *row)
+{
+    for (int16_t byte = 0; byte < SSD1306_EMU_WIDTH / 8; byte++)
+    {
+        uint8_t value = 0;
+        for (int16_t bit = 0; bit < 8; bit++)
+        {
+            bool is_lit = ssd1306_emu_get_pixel(emu, (int16_t)(byte * 8 + bit), y);
+            if (is_lit == lit_bit) value |= (uint8_t)(0x80U >> bit);
+        }
+        row[byte] = value;
+    }
+}
+
+size_t ssd1306_emu_encode_pbm(const ssd1306_emu_t *emu, uint8_t *buffer, size_t buffer_size)
+{
+    static const char header[] = "P4\n128 64\n";
+    if (buffer == NULL || buffer_size < SSD1306_EMU_PBM_SIZE) return 0;
+
+    memcpy(buffer, header, sizeof(header) - 1);
+    uint8_t *row = &buffer[sizeof(header) - 1];
+    for (int16_t y = 0; y < SSD1306_EMU_HEIGHT; y++, row += SSD1306_EMU_WIDTH / 8)
+    {
+        ssd1306_emu_pack_row(emu, y, false, row); // PBM 1 is black
+    }
+    return SSD1306_EMU_PBM_SIZE;
+}
+
+static uint32_t ssd1306_emu_crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+static uint8_t *put_u32_be(uint8_t *dst, uint32_t value)
+{
+    *dst++ = (uint8_t)(value >> 24);
+    *dst++ = (uint8_t)(value >> 16);
+    *dst++ = (uint8_t)(value >> 8);
+    *dst++ = (uint8_t)value;
+    return dst;
+}
+
+// Chunk length, type and data are already in place at chunk, appends the CRC
+static uint8_t *ssd1306_emu_png_chunk_end(uint8_t *chunk, uint32_t data_length)
+{
+    uint32_t crc = ssd1306_emu_crc32(0, &chunk[4], 4U + data_length);
+    return put_u32_be(&chunk[8 + data_length], crc);
+}
+
+size_t ssd1306_emu_encode_png(const ssd1306_emu_t *emu, uint8_t *buffer, size_t buffer_size)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const uint32_t       row_size = 1U + SSD1306_EMU_WIDTH / 8; // Filter type byte, then the pixels
+    const uint32_t       raw_size = row_size * SSD1306_EMU_HEIGHT;
+    if (buffer == NULL || buffer_size < SSD1306_EMU_PNG_SIZE) return 0;
+
+    uint8_t *dst = buffer;
+    memcpy(dst, signature, sizeof(signature));
+    dst += sizeof(signature);
+
+    uint8_t *chunk = dst;
+    dst = put_u32_be(dst, 13);
+    memcpy(dst, "IHDR", 4);
+    dst = put_u32_be(dst + 4, SSD1306_EMU_WIDTH);
+    dst = put_u32_be(dst, SSD1306_EMU_HEIGHT);
+    *dst++ = 1; // Bit depth
+    *dst++ = 0; // Grayscale
+    *dst++ = 0; // Deflate
+    *dst++ = 0; // Adaptive filtering
+    *dst++ = 0; // No interlace
+    dst = ssd1306_emu_png_chunk_end(chunk, 13);
+
+    // zlib stream of a single stored deflate block, the image is small enough to skip compression
+    const uint32_t idat_size = 2U + 5U + raw_size + 4U;
+    chunk = dst;
+    dst = put_u32_be(dst, idat_size);
+    memcpy(dst, "IDAT", 4);
+    dst += 4;
+    *dst++ = 0x78;
+    *dst++ = 0x01;
+    *dst++ = 0x01; // Final stored block
+    *dst++ = (uint8_t)raw_size;
+    *dst++ = (uint8_t)(raw_size >> 8);
+    *dst++ = (uint8_t)~raw_size;
+    *dst++ = (uint8_t)(~raw_size >> 8);
+    uint8_t *raw = dst;
+    for (int16_t y = 0; y < SSD1306_EMU_HEIGHT; y++)
+    {
+        *dst++ = 0; // No filter
+        ssd1306_emu_pack_row(emu, y, true, dst);
+        dst += SSD1306_EMU_WIDTH / 8;
+    }
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    for (uint32_t i = 0; i < raw_size; i++)
+    {
+        adler_a = (adler_a + raw[i]) % 65521U;
+        adler_b = (adler_b + adler_a) % 65521U;
+    }
+    dst = put_u32_be(dst, (adler_b << 16) | adler_a);
+    dst = ssd1306_emu_png_chunk_end(chunk, idat_size);
+
+    chunk = dst;
+    dst = put_u32_be(dst, 0);
+    memcpy(dst, "IEND", 4);
+    dst = ssd1306_emu_png_chunk_end(chunk, 0);
+    return (size_t)(dst - buffer);
+}
+
+// esp_lcd_panel_io_tx_param(): control byte, command, parameters in one transfer
+static void ssd1306_emu_tx_param(ssd1306_emu_t *emu, uint8_t cmd, const uint8_t *params, size_t n_params)
+{
+    uint8_t transfer[2 + 2] = {0x00, cmd};
+    if (n_params > 0) memcpy(&transfer[2], params, n_params);
+    ssd1306_emu_transfer(emu, transfer, 2 + n_params);
+}
+
+void ssd1306_emu_panel_init(ssd1306_emu_t *emu)
+{
+    // Init sequence of the ESP-IDF SSD1306 panel driver for a 128x64 panel, then esp_lcd_panel_disp_on_off(true)
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_DISP_OFF, NULL, 0);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_MEMORY_ADDR_MODE, (const uint8_t[]){0x00}, 1);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_MULTIPLEX, (const uint8_t[]){SSD1306_EMU_HEIGHT - 1}, 1);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_COMPINS, (const uint8_t[]){0x12}, 1);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_CHARGE_PUMP, (const uint8_t[]){0x14}, 1);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_MIRROR_X_OFF, NULL, 0);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_MIRROR_Y_OFF, NULL, 0);
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_DISP_ON, NULL, 0);
+}
+
+void ssd1306_emu_panel_draw_bitmap(
+    ssd1306_emu_t *emu, uint8_t x_start, uint8_t y_start, uint8_t x_end, uint8_t y_end, const uint8_t *data)
+{
+    const uint8_t columns[] = {x_start & 0x7FU, (uint8_t)((x_end - 1) & 0x7FU)};
+    const uint8_t pages[] = {(uint8_t)((y_start / 8) & 0x07U), (uint8_t)(((y_end - 1) / 8) & 0x07U)};
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_COLUMN_RANGE, columns, sizeof(columns));
+    ssd1306_emu_tx_param(emu, SSD1306_CMD_SET_PAGE_RANGE, pages, sizeof(pages));
+
+    // esp_lcd_panel_io_tx_color() without command: the data control byte, then the pixel bytes
+    uint8_t transfer[1 + SSD1306_EMU_WIDTH * SSD1306_EMU_N_PAGES];
+    size_t  length = (size_t)(x_end - x_start) * (size_t)(y_end - y_start) / 8;
+    if (length > sizeof(transfer) - 1) length = sizeof(transfer) - 1;
+    transfer[0] = SSD1306_EMU_CONTROL_DATA;
+    memcpy(&transfer[1], data, length);
+    ssd1306_emu_transfer(emu, transfer, 1 + length);
+}
+
+bool ssd1306_emu_write_page(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data)
+{
+    ssd1306_emu_panel_draw_bitmap((ssd1306_emu_t *)ctx, col_start, page * 8, col_end, (page + 1) * 8, data);
+    return true;
+}
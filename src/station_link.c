@@ -0,0 +1,475 @@
+#include "station_link.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "byte_codec.h"
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/queue.h"
+    #include "freertos/task.h"
+
+    #include "esp_event.h"
+    #include "esp_log.h"
+    #include "esp_mac.h"
+    #include "esp_netif.h"
+    #include "esp_now.h"
+    #include "esp_timer.h"
+    #include "esp_wifi.h"
+
+    #include "data_stream.h"
+#endif
+
+#define STATION_LINK_RESTART_MS 10000 //< Leaf clock going back by more than this: the leaf restarted
+
+size_t station_link_encode_frame(station_link_leaf_t *leaf, const meteo_frame_t *frame, uint8_t *buffer, size_t size)
+{
+    if (leaf == NULL || frame == NULL || buffer == NULL || size < STATION_LINK_FRAME_SIZE) return 0;
+
+    const float values[HISTORY_N_CHANNELS] = {
+        [HISTORY_CH_TEMP] = frame->temperature_degc,
+        [HISTORY_CH_PRESS] = frame->pressure_pa,
+        [HISTORY_CH_HUMID] = frame->humidity_pct,
+    };
+    uint8_t *dst = buffer;
+    *dst++ = STATION_LINK_VERSION;
+    *dst++ = leaf->node_id;
+    dst = put_u16(dst, leaf->next_sequence++);
+    dst = put_u32(dst, (uint32_t)(frame->timestamp_us / 1000));
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        dst = put_u16(dst, (uint16_t)history_store_pack((history_channel_t)ch, values[ch]));
+    }
+    return (size_t)(dst - buffer);
+}
+
+bool station_link_decode_frame(const uint8_t *data, size_t length, station_link_sample_t *sample)
+{
+    if (data == NULL || length != STATION_LINK_FRAME_SIZE || data[0] != STATION_LINK_VERSION) return false;
+    if (data[1] == 0 || data[1] >= STATION_LINK_MAX_NODES) return false;
+
+    sample->node_id = data[1];
+    sample->sequence = get_u16(&data[2]);
+    sample->leaf_time_ms = get_u32(&data[4]);
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++) sample->values[ch] = (int16_t)get_u16(&data[8 + 2 * ch]);
+    return true;
+}
+
+void station_link_init_coordinator(station_link_coordinator_t *coordinator, int64_t max_latency_us)
+{
+    memset(coordinator, 0, sizeof(*coordinator));
+    coordinator->max_latency_us = max_latency_us;
+}
+
+static void station_link_restart_node(station_link_node_t *node, const station_link_sample_t *sample, int64_t rx_us)
+{
+    node->is_active = true;
+    node->last_sequence = sample->sequence;
+    node->window = 1U;
+    node->leaf_time_us = (int64_t)sample->leaf_time_ms * 1000;
+    node->last_leaf_time_ms = sample->leaf_time_ms;
+    node->offset_us = rx_us - node->leaf_time_us;
+    node->last_rx_us = rx_us;
+}
+
+// Sequence window update, false for a duplicate
+static bool station_link_accept_sequence(station_link_node_t *node, uint16_t sequence)
+{
+    int16_t diff = (int16_t)(sequence - node->last_sequence);
+    if (diff > 0)
+    {
+        node->window = (diff >= (int16_t)STATION_LINK_WINDOW) ? 1U : (node->window << diff) | 1U;
+        node->stats.n_lost += (uint32_t)diff - 1U;
+        node->last_sequence = sequence;
+        return true;
+    }
+    uint16_t back = (uint16_t)-diff;
+    if (back >= STATION_LINK_WINDOW || (node->window & (1ULL << back)) != 0) return false;
+    node->window |= 1ULL << back;
+    node->stats.n_late++;
+    if (node->stats.n_lost > 0) node->stats.n_lost--;
+    return true;
+}
+
+bool station_link_receive(station_link_coordinator_t *coordinator,
+                          const uint8_t              *data,
+                          size_t                      length,
+                          int64_t                     rx_us,
+                          station_link_record_t      *record)
+{
+    station_link_sample_t sample;
+    if (coordinator == NULL || record == NULL || !station_link_decode_frame(data, length, &sample)) return false;
+    station_link_node_t *node = &coordinator->nodes[sample.node_id];
+
+    // Leaf time unwrapped from the last frame. Going back by more than a late frame can, or a sequence number far
+    // behind the window: the leaf restarted.
+    int32_t leaf_delta_ms = (int32_t)(sample.leaf_time_ms - node->last_leaf_time_ms);
+    int16_t sequence_diff = (int16_t)(sample.sequence - node->last_sequence);
+    int64_t leaf_time_us;
+    if (!node->is_active || leaf_delta_ms < -STATION_LINK_RESTART_MS
+        || sequence_diff <= -(int16_t)STATION_LINK_WINDOW)
+    {
+        if (node->is_active) node->stats.n_restarts++;
+        station_link_restart_node(node, &sample, rx_us);
+        leaf_time_us = node->leaf_time_us;
+    }
+    else
+    {
+        if (!station_link_accept_sequence(node, sample.sequence))
+        {
+            node->stats.n_duplicates++;
+            return false;
+        }
+        leaf_time_us = node->leaf_time_us + (int64_t)leaf_delta_ms * 1000;
+        if (leaf_delta_ms > 0)
+        {
+            node->leaf_time_us = leaf_time_us;
+            node->last_leaf_time_ms = sample.leaf_time_ms;
+        }
+
+        // Lowest delay frame so far, or the previous offset grown by at most the drift allowance
+        int64_t offset_us = rx_us - leaf_time_us;
+        int64_t max_step_us = (rx_us - node->last_rx_us) * STATION_LINK_MAX_DRIFT_PPM / 1000000;
+        if (offset_us - node->offset_us > max_step_us) offset_us = node->offset_us + max_step_us;
+        node->offset_us = offset_us;
+        node->last_rx_us = rx_us;
+    }
+    node->stats.n_received++;
+
+    record->node_id = sample.node_id;
+    record->sequence = sample.sequence;
+    record->timestamp_us = leaf_time_us + node->offset_us;
+    memcpy(record->values, sample.values, sizeof(record->values));
+    return true;
+}
+
+void station_link_add(station_link_coordinator_t *coordinator, const station_link_record_t *record, int64_t now_us)
+{
+    if (coordinator->n_records == STATION_LINK_BATCH_LEN) return; // Full, the caller sends it first
+    if (coordinator->n_records == 0) coordinator->batch_start_us = now_us;
+    coordinator->batch[coordinator->n_records++] = *record;
+}
+
+bool station_link_batch_ready(const station_link_coordinator_t *coordinator, int64_t now_us)
+{
+    if (coordinator->n_records == 0) return false;
+    return coordinator->n_records == STATION_LINK_BATCH_LEN
+           || now_us - coordinator->batch_start_us >= coordinator->max_latency_us;
+}
+
+size_t station_link_encode_batch(station_link_coordinator_t *coordinator, uint8_t *buffer, size_t size)
+{
+    uint8_t n_records = coordinator->n_records;
+    if (n_records == 0 || buffer == NULL
+        || size < STATION_LINK_BATCH_HEADER_SIZE + (size_t)n_records * STATION_LINK_RECORD_SIZE)
+    {
+        return 0;
+    }
+
+    // Base timestamp of the first record, the others in ms from it (late records are older)
+    int64_t  base_us = coordinator->batch[0].timestamp_us;
+    uint8_t *dst = put_u32(buffer, (uint32_t)base_us);
+    dst = put_u32(dst, (uint32_t)((uint64_t)base_us >> 32));
+    *dst++ = n_records;
+    for (uint8_t i = 0; i < n_records; i++)
+    {
+        const station_link_record_t *record = &coordinator->batch[i];
+        *dst++ = record->node_id;
+        dst = put_u16(dst, record->sequence);
+        dst = put_u32(dst, (uint32_t)(int32_t)((record->timestamp_us - base_us) / 1000));
+        for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++) dst = put_u16(dst, (uint16_t)record->values[ch]);
+    }
+    coordinator->n_records = 0;
+    coordinator->n_batches++;
+    return (size_t)(dst - buffer);
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "station_link";
+
+    #ifdef CONFIG_METEO_STATION_CHANNEL
+        #define STATION_LINK_CHANNEL CONFIG_METEO_STATION_CHANNEL
+    #else
+        #define STATION_LINK_CHANNEL 1
+    #endif
+    #ifdef CONFIG_METEO_STATION_NODE_ID
+        #define STATION_LINK_NODE_ID CONFIG_METEO_STATION_NODE_ID
+    #else
+        #define STATION_LINK_NODE_ID 1
+    #endif
+    #ifdef CONFIG_METEO_STATION_COORDINATOR_MAC
+        #define STATION_LINK_COORDINATOR_MAC CONFIG_METEO_STATION_COORDINATOR_MAC
+    #else
+        #define STATION_LINK_COORDINATOR_MAC ""
+    #endif
+    #ifdef CONFIG_METEO_STATION_BATCH_LATENCY_MS
+        #define STATION_LINK_BATCH_LATENCY_MS CONFIG_METEO_STATION_BATCH_LATENCY_MS
+    #else
+        #define STATION_LINK_BATCH_LATENCY_MS 2000
+    #endif
+    #define STATION_LINK_QUEUE_LEN  32U
+    #define STATION_LINK_IN_FLIGHT  8U //< Leaf frames handed to ESP-NOW, waiting for their send callback
+    #define STATION_LINK_N_RETRIES  4U //< Leaf frames whose MAC retries failed, sent again with the next one
+    #define STATION_LINK_TICK_MS    100U
+
+_Static_assert(STATION_LINK_BATCH_SIZE <= DATA_STREAM_MAX_PAYLOAD_SIZE, "A batch must fit in a data stream frame");
+
+static bool         s_is_ready = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+// NOTE: The Wi-Fi task only stamps and queues the received frames, and the sensing task its own samples. The station
+// link task does the deduplication, the alignment and the batching.
+typedef struct
+{
+    int64_t               rx_us;
+    bool                  is_own; //< The coordinator sample, in record
+    uint8_t               data[STATION_LINK_FRAME_SIZE];
+    uint8_t               length;
+    station_link_record_t record;
+} station_link_item_t;
+
+static station_link_coordinator_t s_coordinator;
+static QueueHandle_t              s_queue = NULL;
+static uint16_t                   s_own_sequence = 0;
+static volatile uint32_t          s_n_queue_full = 0;
+
+static void station_link_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int length)
+{
+    station_link_item_t item = {.rx_us = esp_timer_get_time(), .is_own = false};
+    if (length != STATION_LINK_FRAME_SIZE) return;
+    memcpy(item.data, data, STATION_LINK_FRAME_SIZE);
+    item.length = (uint8_t)length;
+    if (xQueueSend(s_queue, &item, 0) != pdTRUE) s_n_queue_full++;
+}
+    #else
+typedef struct
+{
+    uint8_t data[STATION_LINK_FRAME_SIZE];
+} station_link_pending_t;
+
+// NOTE: ESP-NOW calls the send callback once per frame, in sending order: the frames in flight are a FIFO. The ones
+// whose MAC retries all failed (no acknowledgement) are kept and sent again after the next measurement, the
+// coordinator takes them as late frames.
+static station_link_leaf_t    s_leaf = {.node_id = STATION_LINK_NODE_ID};
+static uint8_t                s_peer_mac[ESP_NOW_ETH_ALEN];
+static station_link_pending_t s_in_flight[STATION_LINK_IN_FLIGHT];
+static uint8_t                s_in_flight_head = 0;
+static uint8_t                s_n_in_flight = 0;
+static station_link_pending_t s_retries[STATION_LINK_N_RETRIES];
+static uint8_t                s_n_retries = 0;
+
+static void station_link_send_cb(const uint8_t *mac, esp_now_send_status_t status)
+{
+    taskENTER_CRITICAL(&s_lock);
+    if (s_n_in_flight > 0)
+    {
+        station_link_pending_t *frame = &s_in_flight[s_in_flight_head];
+        s_in_flight_head = (uint8_t)((s_in_flight_head + 1U) % STATION_LINK_IN_FLIGHT);
+        s_n_in_flight--;
+        if (status != ESP_NOW_SEND_SUCCESS)
+        {
+            if (s_n_retries < STATION_LINK_N_RETRIES) s_retries[s_n_retries++] = *frame;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static void station_link_send(const uint8_t *data)
+{
+    bool is_queued = false;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_n_in_flight < STATION_LINK_IN_FLIGHT)
+    {
+        uint8_t tail = (uint8_t)((s_in_flight_head + s_n_in_flight) % STATION_LINK_IN_FLIGHT);
+        memcpy(s_in_flight[tail].data, data, STATION_LINK_FRAME_SIZE);
+        s_n_in_flight++;
+        is_queued = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (!is_queued) return;
+    if (esp_now_send(s_peer_mac, data, STATION_LINK_FRAME_SIZE) != ESP_OK)
+    {
+        taskENTER_CRITICAL(&s_lock);
+        s_n_in_flight--; // No callback for a frame ESP-NOW did not take, it was the last one queued
+        taskEXIT_CRITICAL(&s_lock);
+    }
+}
+
+// "aa:bb:cc:dd:ee:ff", empty for the broadcast address
+static bool station_link_parse_mac(const char *text, uint8_t mac[ESP_NOW_ETH_ALEN])
+{
+    if (text[0] == '\0')
+    {
+        memset(mac, 0xFF, ESP_NOW_ETH_ALEN);
+        return true;
+    }
+    unsigned int bytes[ESP_NOW_ETH_ALEN];
+    if (sscanf(text, "%2x:%2x:%2x:%2x:%2x:%2x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5])
+        != ESP_NOW_ETH_ALEN)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < ESP_NOW_ETH_ALEN; i++) mac[i] = (uint8_t)bytes[i];
+    return true;
+}
+    #endif
+
+static esp_err_t station_link_wifi_init(void)
+{
+    esp_err_t ret = esp_netif_init(); // NVS (Wi-Fi calibration data) initialized by app_main
+    if (ret == ESP_OK)
+    {
+        ret = esp_event_loop_create_default();
+        if (ret == ESP_ERR_INVALID_STATE) ret = ESP_OK; // Already created
+    }
+
+    // Station mode without association, on the channel shared by the site stations
+    wifi_init_config_t config = WIFI_INIT_CONFIG_DEFAULT();
+    if (ret == ESP_OK) ret = esp_wifi_init(&config);
+    if (ret == ESP_OK) ret = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (ret == ESP_OK) ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (ret == ESP_OK) ret = esp_wifi_start();
+    if (ret == ESP_OK) ret = esp_wifi_set_channel(STATION_LINK_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    if (ret == ESP_OK) ret = esp_now_init();
+    return ret;
+}
+
+esp_err_t station_link_init(void)
+{
+    esp_err_t ret = station_link_wifi_init();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Wi-Fi and ESP-NOW init failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+    station_link_init_coordinator(&s_coordinator, (int64_t)STATION_LINK_BATCH_LATENCY_MS * 1000);
+    s_queue = xQueueCreate(STATION_LINK_QUEUE_LEN, sizeof(station_link_item_t));
+    if (s_queue == NULL || esp_now_register_recv_cb(station_link_recv_cb) != ESP_OK) return ESP_FAIL;
+    ESP_LOGI(LOG_TAG, "Coordinator " MACSTR " on channel %d", MAC2STR(mac), STATION_LINK_CHANNEL);
+    #else
+    if (!station_link_parse_mac(STATION_LINK_COORDINATOR_MAC, s_peer_mac))
+    {
+        ESP_LOGE(LOG_TAG, "Coordinator MAC \"%s\" is not aa:bb:cc:dd:ee:ff", STATION_LINK_COORDINATOR_MAC);
+        return ESP_FAIL;
+    }
+    esp_now_peer_info_t peer = {.channel = STATION_LINK_CHANNEL, .ifidx = WIFI_IF_STA, .encrypt = false};
+    memcpy(peer.peer_addr, s_peer_mac, ESP_NOW_ETH_ALEN);
+    ret = esp_now_add_peer(&peer);
+    if (ret == ESP_OK) ret = esp_now_register_send_cb(station_link_send_cb);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Coordinator peer failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    ESP_LOGI(LOG_TAG,
+             "Leaf %d " MACSTR " to " MACSTR " on channel %d",
+             STATION_LINK_NODE_ID,
+             MAC2STR(mac),
+             MAC2STR(s_peer_mac),
+             STATION_LINK_CHANNEL);
+    #endif
+    s_is_ready = true;
+    return ESP_OK;
+}
+
+void station_link_push(const meteo_frame_t *frame)
+{
+    if (!s_is_ready) return;
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+    // Own sample as node 0, already on the coordinator clock
+    const float         values[HISTORY_N_CHANNELS] = {frame->temperature_degc, frame->pressure_pa, frame->humidity_pct};
+    station_link_item_t item = {.rx_us = frame->timestamp_us, .is_own = true};
+    item.record.node_id = 0;
+    item.record.sequence = s_own_sequence++;
+    item.record.timestamp_us = frame->timestamp_us;
+    for (uint8_t ch = 0; ch < HISTORY_N_CHANNELS; ch++)
+    {
+        item.record.values[ch] = history_store_pack((history_channel_t)ch, values[ch]);
+    }
+    if (xQueueSend(s_queue, &item, 0) != pdTRUE) s_n_queue_full++;
+    #else
+    uint8_t data[STATION_LINK_FRAME_SIZE];
+    if (station_link_encode_frame(&s_leaf, frame, data, sizeof(data)) == 0) return;
+    station_link_send(data);
+
+    // Then the frames which failed before, oldest first
+    station_link_pending_t retries[STATION_LINK_N_RETRIES];
+    uint8_t                n_retries;
+    taskENTER_CRITICAL(&s_lock);
+    n_retries = s_n_retries;
+    memcpy(retries, s_retries, sizeof(retries[0]) * n_retries);
+    s_n_retries = 0;
+    taskEXIT_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < n_retries; i++) station_link_send(retries[i].data);
+    #endif
+}
+
+bool station_link_get_node_stats(uint8_t node_id, station_link_node_stats_t *stats)
+{
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+    if (!s_is_ready || node_id >= STATION_LINK_MAX_NODES || stats == NULL) return false;
+    taskENTER_CRITICAL(&s_lock);
+    bool is_active = s_coordinator.nodes[node_id].is_active;
+    *stats = s_coordinator.nodes[node_id].stats;
+    taskEXIT_CRITICAL(&s_lock);
+    return is_active;
+    #else
+    return false;
+    #endif
+}
+
+void station_link_task(void *pvParameter)
+{
+    #ifdef CONFIG_METEO_STATION_COORDINATOR
+    uint8_t  payload[STATION_LINK_BATCH_SIZE];
+    uint32_t n_queue_full = 0;
+    while (1)
+    {
+        if (s_n_queue_full != n_queue_full)
+        {
+            n_queue_full = s_n_queue_full;
+            ESP_LOGW(LOG_TAG, "Queue full, %lu frames dropped", (unsigned long)n_queue_full);
+        }
+        station_link_item_t item;
+        if (xQueueReceive(s_queue, &item, pdMS_TO_TICKS(STATION_LINK_TICK_MS)) == pdTRUE)
+        {
+            station_link_record_t record = item.record;
+            bool                  is_new = item.is_own;
+            if (!item.is_own)
+            {
+                taskENTER_CRITICAL(&s_lock);
+                is_new = station_link_receive(&s_coordinator, item.data, item.length, item.rx_us, &record);
+                taskEXIT_CRITICAL(&s_lock);
+            }
+            if (is_new)
+            {
+                if (s_coordinator.n_records == STATION_LINK_BATCH_LEN)
+                {
+                    size_t size = station_link_encode_batch(&s_coordinator, payload, sizeof(payload));
+                    data_stream_push_station_batch(payload, size);
+                }
+                station_link_add(&s_coordinator, &record, esp_timer_get_time());
+            }
+        }
+        if (station_link_batch_ready(&s_coordinator, esp_timer_get_time()))
+        {
+            size_t size = station_link_encode_batch(&s_coordinator, payload, sizeof(payload));
+            if (!data_stream_push_station_batch(payload, size))
+            {
+                ESP_LOGW(LOG_TAG, "Batch of %u records dropped", (unsigned)payload[STATION_LINK_BATCH_HEADER_SIZE - 1]);
+            }
+        }
+    }
+    #else
+    vTaskDelete(NULL); // The leaf sends from station_link_push()
+    #endif
+}
+#endif
@@ -0,0 +1,218 @@
+#include "task_jitter.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "esp_log.h"
+    #include "esp_timer.h"
+
+    #define TASK_JITTER_MAX_TASKS 8
+
+static const char *LOG_TAG = "jitter";
+
+static task_jitter_t *s_registered[TASK_JITTER_MAX_TASKS] = {NULL};
+static uint8_t        s_n_registered = 0;
+static portMUX_TYPE   s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    #define TASK_JITTER_LOCK()   taskENTER_CRITICAL(&s_lock)
+    #define TASK_JITTER_UNLOCK() taskEXIT_CRITICAL(&s_lock)
+#else
+    #define TASK_JITTER_LOCK()
+    #define TASK_JITTER_UNLOCK()
+#endif
+
+static void task_jitter_stats_reset(task_jitter_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min_us = INT32_MAX;
+    stats->max_us = INT32_MIN;
+}
+
+// Everything measured is dropped, the name and threshold are kept
+static void task_jitter_restart(task_jitter_t *jitter, uint32_t period_us)
+{
+    jitter->period_us = period_us;
+    jitter->is_started = false;
+    jitter->first_release_us = 0;
+    jitter->n_periods = 0;
+    task_jitter_stats_reset(&jitter->release);
+    task_jitter_stats_reset(&jitter->sample);
+    jitter->section_min_us = INT32_MAX;
+    jitter->preemptions = 0;
+}
+
+void task_jitter_init(task_jitter_t *jitter, const char *name, uint32_t period_us, uint32_t preempt_threshold_us)
+{
+    if (jitter == NULL) return;
+    memset(jitter, 0, sizeof(*jitter));
+    jitter->name = name;
+    jitter->preempt_threshold_us = preempt_threshold_us;
+    task_jitter_restart(jitter, period_us);
+}
+
+void task_jitter_set_period(task_jitter_t *jitter, uint32_t period_us)
+{
+    if (jitter == NULL) return;
+
+    TASK_JITTER_LOCK();
+    task_jitter_restart(jitter, period_us);
+    TASK_JITTER_UNLOCK();
+}
+
+void task_jitter_stats_add(task_jitter_stats_t *stats, int32_t value_us)
+{
+    if (value_us < stats->min_us) stats->min_us = value_us;
+    if (value_us > stats->max_us) stats->max_us = value_us;
+    stats->n_samples++;
+    float delta = (float)value_us - stats->mean_us;
+    stats->mean_us += delta / (float)stats->n_samples;
+    stats->m2_us2 += delta * ((float)value_us - stats->mean_us);
+}
+
+float task_jitter_stats_stddev(const task_jitter_stats_t *stats)
+{
+    if (stats == NULL || stats->n_samples < 2) return 0.0f;
+    return sqrtf(stats->m2_us2 / (float)(stats->n_samples - 1));
+}
+
+static int64_t task_jitter_ideal_release_us(const task_jitter_t *jitter)
+{
+    return jitter->first_release_us + (int64_t)jitter->n_periods * jitter->period_us;
+}
+
+void task_jitter_on_release(task_jitter_t *jitter, int64_t now_us)
+{
+    if (jitter == NULL) return;
+
+    TASK_JITTER_LOCK();
+    if (!jitter->is_started)
+    {
+        // First release, the reference of the ideal schedule
+        jitter->is_started = true;
+        jitter->first_release_us = now_us;
+    }
+    else if (jitter->period_us == 0)
+    {
+        // Free running (e.g. back to back measurements), there is no schedule to be late on, only the releases counted
+        jitter->n_periods++;
+    }
+    else
+    {
+        jitter->n_periods++;
+        int64_t latency_us = now_us - task_jitter_ideal_release_us(jitter);
+        if (latency_us > (int64_t)jitter->period_us)
+        {
+            // Overrun, the task missed whole periods: restart the ideal schedule from now
+            jitter->first_release_us = now_us;
+            jitter->n_periods = 0;
+            jitter->preemptions++;
+        }
+        else if (latency_us < -(int64_t)jitter->period_us)
+        {
+            // Released on a shorter period than the schedule (e.g. a period truncated to the tick): the latency would
+            // grow without bound, restart from now
+            jitter->first_release_us = now_us;
+            jitter->n_periods = 0;
+        }
+        else
+        {
+            if (latency_us > (int64_t)jitter->preempt_threshold_us) jitter->preemptions++;
+            task_jitter_stats_add(&jitter->release, (int32_t)latency_us);
+        }
+    }
+    TASK_JITTER_UNLOCK();
+}
+
+void task_jitter_on_sample(task_jitter_t *jitter, int64_t sample_time_us)
+{
+    if (jitter == NULL || !jitter->is_started || jitter->period_us == 0) return;
+
+    TASK_JITTER_LOCK();
+    int64_t offset_us = sample_time_us - task_jitter_ideal_release_us(jitter);
+    if (offset_us >= INT32_MIN && offset_us <= INT32_MAX) task_jitter_stats_add(&jitter->sample, (int32_t)offset_us);
+    TASK_JITTER_UNLOCK();
+}
+
+void task_jitter_on_section(task_jitter_t *jitter, int32_t duration_us)
+{
+    if (jitter == NULL) return;
+
+    TASK_JITTER_LOCK();
+    // The shortest run of the section is its uninterrupted duration
+    if (duration_us < jitter->section_min_us) jitter->section_min_us = duration_us;
+    if (duration_us - jitter->section_min_us > (int32_t)jitter->preempt_threshold_us) jitter->preemptions++;
+    TASK_JITTER_UNLOCK();
+}
+
+#ifdef ESP_PLATFORM
+esp_err_t task_jitter_register(task_jitter_t *jitter)
+{
+    if (jitter == NULL) return ESP_FAIL;
+
+    esp_err_t ret = ESP_FAIL;
+    TASK_JITTER_LOCK();
+    if (s_n_registered < TASK_JITTER_MAX_TASKS)
+    {
+        s_registered[s_n_registered++] = jitter;
+        ret = ESP_OK;
+    }
+    TASK_JITTER_UNLOCK();
+    return ret;
+}
+
+uint32_t task_jitter_tick_period_us(uint32_t period_ms)
+{
+    return (uint32_t)pdTICKS_TO_MS(pdMS_TO_TICKS(period_ms)) * 1000U;
+}
+
+void task_jitter_release_now(task_jitter_t *jitter)
+{
+    task_jitter_on_release(jitter, esp_timer_get_time());
+}
+
+void task_jitter_log_report(void)
+{
+    TASK_JITTER_LOCK();
+    uint8_t n_registered = s_n_registered;
+    TASK_JITTER_UNLOCK();
+
+    for (uint8_t i = 0; i < n_registered; i++)
+    {
+        task_jitter_t jitter;
+        TASK_JITTER_LOCK();
+        jitter = *s_registered[i];
+        TASK_JITTER_UNLOCK();
+        if (jitter.period_us == 0)
+        {
+            ESP_LOGI(LOG_TAG, "Task %-16s free running, %lu releases", jitter.name, (unsigned long)jitter.n_periods);
+            continue;
+        }
+        if (jitter.release.n_samples == 0) continue;
+
+        ESP_LOGI(LOG_TAG,
+                 "Task %-16s release latency min %ld max %ld mean %.0f sd %.0f us, preemptions %lu/%lu",
+                 jitter.name,
+                 (long)jitter.release.min_us,
+                 (long)jitter.release.max_us,
+                 jitter.release.mean_us,
+                 task_jitter_stats_stddev(&jitter.release),
+                 (unsigned long)jitter.preemptions,
+                 (unsigned long)jitter.release.n_samples);
+        if (jitter.sample.n_samples > 0)
+        {
+            ESP_LOGI(LOG_TAG,
+                     "Task %-16s sample timestamp offset min %ld max %ld mean %.0f sd %.0f us",
+                     jitter.name,
+                     (long)jitter.sample.min_us,
+                     (long)jitter.sample.max_us,
+                     jitter.sample.mean_us,
+                     task_jitter_stats_stddev(&jitter.sample));
+        }
+    }
+}
+#endif
@@ -0,0 +1,241 @@
+#include "timebase.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "sdkconfig.h"
+
+    #include <sys/time.h>
+
+    #include "freertos/FreeRTOS.h"
+
+    #include "esp_log.h"
+    #include "esp_timer.h"
+    #ifdef CONFIG_METEO_TIMEBASE_SNTP
+        #include "esp_netif_sntp.h"
+    #endif
+#endif
+
+#define TIMEBASE_NS_PER_S 1000000000LL
+
+// Drift correction of an interval, split so that days of microseconds times the drift do not overflow
+static int64_t timebase_drift_us(int64_t elapsed_us, int32_t drift_ppb)
+{
+    int64_t q = elapsed_us / TIMEBASE_NS_PER_S;
+    int64_t r = elapsed_us % TIMEBASE_NS_PER_S;
+    return q * drift_ppb + r * drift_ppb / TIMEBASE_NS_PER_S;
+}
+
+// Part of the slew applied elapsed_us after the anchor
+static int64_t timebase_slew_applied_us(const timebase_t *tb, int64_t elapsed_us)
+{
+    if (elapsed_us <= 0) return 0;
+    int64_t max_us = elapsed_us / TIMEBASE_SLEW_RATIO;
+    if (tb->slew_us > max_us) return max_us;
+    if (tb->slew_us < -max_us) return -max_us;
+    return tb->slew_us;
+}
+
+void timebase_reset(timebase_t *tb)
+{
+    memset(tb, 0, sizeof(*tb));
+}
+
+int64_t timebase_date_utc_us(const char *date)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    if (date == NULL || strlen(date) != 11) return 0;
+    int month = 0;
+    while (month < 12 && strncmp(&months[3 * month], date, 3) != 0) month++;
+    int day = atoi(&date[4]);
+    int year = atoi(&date[7]);
+    if (month == 12 || day < 1 || day > 31 || year < 1970) return 0;
+
+    // Days since the epoch (days_from_civil(), the years starting in March so the leap day is the last one)
+    int     y = year - (month < 2);
+    int     doy = (153 * ((month + 10) % 12) + 2) / 5 + day - 1;
+    int     doe = (y % 400) * 365 + (y % 400) / 4 - (y % 400) / 100 + doy;
+    int64_t days = (int64_t)(y / 400) * 146097 + doe - 719468;
+    return (days - 1) * 86400LL * 1000000LL;
+}
+
+bool timebase_is_valid(const timebase_t *tb)
+{
+    return tb->source != TIMEBASE_SOURCE_NONE;
+}
+
+bool timebase_to_utc_us(const timebase_t *tb, int64_t mono_us, int64_t *utc_us)
+{
+    if (!timebase_is_valid(tb)) return false;
+    int64_t elapsed_us = mono_us - tb->anchor_mono_us;
+    *utc_us = tb->anchor_utc_us + elapsed_us + timebase_drift_us(elapsed_us, tb->drift_ppb)
+              + timebase_slew_applied_us(tb, elapsed_us);
+    return true;
+}
+
+timebase_sync_result_t timebase_sync(timebase_t *tb, int64_t mono_us, int64_t utc_us, timebase_source_t source)
+{
+    // The RTC counts from the same crystal as the monotonic clock, it would undo the drift learnt from SNTP
+    if (source == TIMEBASE_SOURCE_RTC && tb->source == TIMEBASE_SOURCE_SNTP) return TIMEBASE_IGNORED;
+    // An RTC never set counts from the epoch at each boot, no time until SNTP or a resumed clock sets it
+    if (source == TIMEBASE_SOURCE_RTC && utc_us < tb->min_utc_us)
+    {
+        tb->n_rejected++;
+        return TIMEBASE_REJECTED;
+    }
+    tb->n_syncs++;
+
+    int64_t predicted_us;
+    if (!timebase_to_utc_us(tb, mono_us, &predicted_us))
+    {
+        tb->last_error_us = 0;
+        tb->source = source;
+        tb->anchor_mono_us = mono_us;
+        tb->anchor_utc_us = utc_us;
+        tb->slew_us = 0;
+        tb->n_steps++;
+        return TIMEBASE_STEPPED;
+    }
+    int64_t error_us = utc_us - predicted_us;
+    int64_t elapsed_us = mono_us - tb->anchor_mono_us;
+    tb->last_error_us = error_us;
+
+    // Rate error between two SNTP syncs, against the line with the whole slew applied. A rate out of the drift range
+    // is a time jump, not a drift.
+    if (source == TIMEBASE_SOURCE_SNTP && tb->source == TIMEBASE_SOURCE_SNTP
+        && elapsed_us >= TIMEBASE_MIN_DRIFT_INTERVAL_US)
+    {
+        int64_t drift_error_us = error_us - (tb->slew_us - timebase_slew_applied_us(tb, elapsed_us));
+        if (llabs(drift_error_us) <= elapsed_us / (TIMEBASE_NS_PER_S / TIMEBASE_MAX_DRIFT_PPB))
+        {
+            int64_t rate_error_ppb = drift_error_us * 1000000LL / (elapsed_us / 1000); // ms, past the minimum interval
+            int64_t drift_ppb = tb->drift_ppb + rate_error_ppb / TIMEBASE_DRIFT_GAIN;
+            if (drift_ppb > TIMEBASE_MAX_DRIFT_PPB) drift_ppb = TIMEBASE_MAX_DRIFT_PPB;
+            if (drift_ppb < -TIMEBASE_MAX_DRIFT_PPB) drift_ppb = -TIMEBASE_MAX_DRIFT_PPB;
+            tb->drift_ppb = (int32_t)drift_ppb;
+        }
+    }
+    tb->source = source;
+    tb->anchor_mono_us = mono_us;
+
+    if (llabs(error_us) >= TIMEBASE_STEP_THRESHOLD_US)
+    {
+        tb->anchor_utc_us = utc_us;
+        tb->slew_us = 0;
+        tb->n_steps++;
+        return TIMEBASE_STEPPED;
+    }
+    tb->anchor_utc_us = predicted_us;
+    tb->slew_us = error_us;
+    return TIMEBASE_SLEWED;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "timebase";
+
+    #ifdef CONFIG_METEO_TIMEBASE_REFRESH_S
+        #define TIMEBASE_REFRESH_PERIOD_US ((int64_t)CONFIG_METEO_TIMEBASE_REFRESH_S * 1000000)
+    #else
+        #define TIMEBASE_REFRESH_PERIOD_US 60000000LL
+    #endif
+
+// NOTE: The syncs run in the esp_timer task (RTC) and in the lwIP task (SNTP), the exporters copy the model
+static timebase_t         s_timebase;
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_refresh_timer = NULL;
+
+static const char *const s_source_names[] = {"none", "RTC", "SNTP"};
+
+static void timebase_sync_now(int64_t mono_us, int64_t utc_us, timebase_source_t source)
+{
+    taskENTER_CRITICAL(&s_lock);
+    timebase_sync_result_t result = timebase_sync(&s_timebase, mono_us, utc_us, source);
+    int64_t                error_us = s_timebase.last_error_us;
+    int32_t                drift_ppb = s_timebase.drift_ppb;
+    uint32_t               n_rejected = s_timebase.n_rejected;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (result == TIMEBASE_STEPPED)
+    {
+        ESP_LOGI(LOG_TAG, "Stepped to %s time, error %lld ms", s_source_names[source], (long long)(error_us / 1000));
+    }
+    else if (source == TIMEBASE_SOURCE_SNTP)
+    {
+        ESP_LOGI(LOG_TAG, "SNTP error %lld us, drift %ld ppb", (long long)error_us, (long)drift_ppb);
+    }
+    else if (result == TIMEBASE_REJECTED && n_rejected == 1)
+    {
+        ESP_LOGW(LOG_TAG, "RTC time %lld s before the build, not set: no UTC time yet", (long long)(utc_us / 1000000));
+    }
+}
+
+void timebase_refresh(void)
+{
+    // Both clocks read back to back, the pair is off by the few us between the reads
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t mono_us = esp_timer_get_time();
+    timebase_sync_now(mono_us, (int64_t)now.tv_sec * 1000000LL + now.tv_usec, TIMEBASE_SOURCE_RTC);
+}
+
+static void timebase_refresh_cb(void *arg)
+{
+    timebase_refresh();
+}
+
+esp_err_t timebase_init(void)
+{
+    timebase_reset(&s_timebase);
+    s_timebase.min_utc_us = timebase_date_utc_us(__DATE__);
+    timebase_refresh();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = timebase_refresh_cb,
+        .name = "timebase",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_refresh_timer);
+    if (ret == ESP_OK) ret = esp_timer_start_periodic(s_refresh_timer, TIMEBASE_REFRESH_PERIOD_US);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Refresh timer start failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+    #ifdef CONFIG_METEO_TIMEBASE_SNTP
+// Called once the system clock is set to the server time
+static void timebase_sntp_cb(struct timeval *tv)
+{
+    int64_t mono_us = esp_timer_get_time();
+    timebase_sync_now(mono_us, (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec, TIMEBASE_SOURCE_SNTP);
+}
+    #endif
+
+esp_err_t timebase_start_sntp(void)
+{
+    #ifdef CONFIG_METEO_TIMEBASE_SNTP
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_METEO_TIMEBASE_SNTP_SERVER);
+    config.sync_cb = timebase_sntp_cb;
+    esp_err_t ret = esp_netif_sntp_init(&config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "SNTP start failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    ESP_LOGI(LOG_TAG, "SNTP server %s", CONFIG_METEO_TIMEBASE_SNTP_SERVER);
+    return ESP_OK;
+    #else
+    return ESP_ERR_NOT_SUPPORTED;
+    #endif
+}
+
+bool timebase_utc_us(int64_t mono_us, int64_t *utc_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    timebase_t tb = s_timebase;
+    taskEXIT_CRITICAL(&s_lock);
+    return timebase_to_utc_us(&tb, mono_us, utc_us);
+}
+#endif
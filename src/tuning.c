@@ -0,0 +1,465 @@
+#include "tuning.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+
+    #include "esp_console.h"
+    #include "esp_log.h"
+    #include "esp_timer.h"
+    #include "nvs.h"
+
+    #include "ambient_sense.h"
+    #include "lcd_manager.h"
+    #include "task_plan.h"
+#endif
+
+#define TUNING_PERF_DEFAULT_MS 2000U
+#define TUNING_PERF_MAX_S      60U
+#define TUNING_I2C_FRAME_BITS  11U //< Address byte with its ACK, start and stop of a transfer
+
+#define TUNING_PARAM_INFO(name, unit, min, max, init, help) {#name, unit, min, max, init, help},
+const tuning_param_info_t tuning_param_infos[TUNING_N_PARAMS] = {TUNING_PARAMS(TUNING_PARAM_INFO)};
+#undef TUNING_PARAM_INFO
+
+void tuning_defaults(tuning_values_t *values)
+{
+    for (uint8_t i = 0; i < TUNING_N_PARAMS; i++) values->values[i] = tuning_param_infos[i].init;
+}
+
+tuning_param_t tuning_find(const char *name)
+{
+    uint8_t i = 0;
+    for (; i < TUNING_N_PARAMS; i++)
+    {
+        if (strcmp(name, tuning_param_infos[i].name) == 0) break;
+    }
+    return (tuning_param_t)i;
+}
+
+static bool tuning_is_oversampling(tuning_param_t param)
+{
+    return param == TUNING_os_temp || param == TUNING_os_press || param == TUNING_os_humid;
+}
+
+static bool tuning_is_period(tuning_param_t param)
+{
+    return param == TUNING_sense_period_ms || param == TUNING_ui_period_ms;
+}
+
+bool tuning_is_valid(tuning_param_t param, uint32_t value)
+{
+    if (param >= TUNING_N_PARAMS) return false;
+    if (value < tuning_param_infos[param].min || value > tuning_param_infos[param].max) return false;
+    // A period between two ticks would be truncated by pdMS_TO_TICKS(), off the schedule the jitter is measured on
+    if (tuning_is_period(param) && value % TUNING_TICK_MS != 0) return false;
+    return !tuning_is_oversampling(param) || (value & (value - 1U)) == 0;
+}
+
+tuning_status_t tuning_parse_value(tuning_param_t param, const char *text, uint32_t *value)
+{
+    if (param >= TUNING_N_PARAMS) return TUNING_ERR_UNKNOWN_PARAM;
+    if (text == NULL || *text < '0' || *text > '9') return TUNING_ERR_INVALID_VALUE;
+    uint64_t result = 0;
+    for (; *text >= '0' && *text <= '9'; text++)
+    {
+        result = result * 10U + (uint64_t)(*text - '0');
+        if (result > UINT32_MAX) return TUNING_ERR_OUT_OF_RANGE;
+    }
+    if (*text == 'k')
+    {
+        result *= 1000U;
+        text++;
+    }
+    else if (*text == 'M')
+    {
+        result *= 1000000U;
+        text++;
+    }
+    if (*text != '\0') return TUNING_ERR_INVALID_VALUE;
+    if (result > UINT32_MAX) return TUNING_ERR_OUT_OF_RANGE;
+
+    const tuning_param_info_t *info = &tuning_param_infos[param];
+    if (result < info->min || result > info->max) return TUNING_ERR_OUT_OF_RANGE;
+    if (!tuning_is_valid(param, (uint32_t)result)) return TUNING_ERR_INVALID_VALUE;
+    *value = (uint32_t)result;
+    return TUNING_OK;
+}
+
+uint8_t tuning_os_code(uint32_t oversampling)
+{
+    uint8_t code = 0;
+    for (; oversampling != 0; oversampling >>= 1) code++;
+    return code;
+}
+
+// Append to the reply, which stays terminated when it is truncated
+static void tuning_append(char *out, size_t size, size_t *length, const char *format, ...)
+{
+    if (*length + 1 >= size) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(&out[*length], size - *length, format, args);
+    va_end(args);
+    if (n > 0) *length = (*length + (size_t)n < size) ? *length + (size_t)n : size - 1;
+}
+
+static void tuning_append_param(
+    const tuning_values_t *values, tuning_param_t param, char *out, size_t size, size_t *length)
+{
+    const tuning_param_info_t *info = &tuning_param_infos[param];
+    tuning_append(out,
+                  size,
+                  length,
+                  "%-16s %8lu %-2s [%lu..%lu]\n",
+                  info->name,
+                  (unsigned long)values->values[param],
+                  info->unit,
+                  (unsigned long)info->min,
+                  (unsigned long)info->max);
+}
+
+tuning_status_t tuning_command(
+    tuning_values_t *values, int argc, char **argv, char *out, size_t size, uint32_t *changed_mask)
+{
+    size_t length = 0;
+    *changed_mask = 0;
+    if (size > 0) out[0] = '\0';
+
+    if (argc <= 1 || (argc == 2 && strcmp(argv[1], "defaults") == 0))
+    {
+        for (uint8_t i = 0; argc == 2 && i < TUNING_N_PARAMS; i++)
+        {
+            if (values->values[i] != tuning_param_infos[i].init) *changed_mask |= 1U << i;
+            values->values[i] = tuning_param_infos[i].init;
+        }
+        for (uint8_t i = 0; i < TUNING_N_PARAMS; i++)
+        {
+            tuning_append_param(values, (tuning_param_t)i, out, size, &length);
+        }
+        return TUNING_OK;
+    }
+    if (argc > 3)
+    {
+        tuning_append(out, size, &length, "Usage: tune [<name> [<value>] | defaults]\n");
+        return TUNING_ERR_USAGE;
+    }
+
+    tuning_param_t param = tuning_find(argv[1]);
+    if (param == TUNING_N_PARAMS)
+    {
+        tuning_append(out, size, &length, "Unknown parameter %s\n", argv[1]);
+        return TUNING_ERR_UNKNOWN_PARAM;
+    }
+    const tuning_param_info_t *info = &tuning_param_infos[param];
+    if (argc == 2)
+    {
+        tuning_append_param(values, param, out, size, &length);
+        tuning_append(out, size, &length, "%s\n", info->help);
+        return TUNING_OK;
+    }
+
+    uint32_t        value;
+    tuning_status_t status = tuning_parse_value(param, argv[2], &value);
+    if (status == TUNING_ERR_OUT_OF_RANGE)
+    {
+        tuning_append(out,
+                      size,
+                      &length,
+                      "%s: %s out of [%lu..%lu]\n",
+                      info->name,
+                      argv[2],
+                      (unsigned long)info->min,
+                      (unsigned long)info->max);
+        return status;
+    }
+    if (status != TUNING_OK)
+    {
+        tuning_append(out, size, &length, "%s: invalid value %s\n", info->name, argv[2]);
+        return status;
+    }
+    if (values->values[param] != value) *changed_mask = 1U << param;
+    values->values[param] = value;
+    tuning_append_param(values, param, out, size, &length);
+    return TUNING_OK;
+}
+
+tuning_status_t tuning_perf_parse(int argc, char **argv, uint32_t *window_ms)
+{
+    *window_ms = TUNING_PERF_DEFAULT_MS;
+    if (argc <= 1) return TUNING_OK;
+    if (argc > 2) return TUNING_ERR_USAGE;
+    uint32_t seconds = 0;
+    for (const char *c = argv[1]; *c != '\0'; c++)
+    {
+        if (*c < '0' || *c > '9') return TUNING_ERR_INVALID_VALUE;
+        seconds = seconds * 10U + (uint32_t)(*c - '0');
+        if (seconds > TUNING_PERF_MAX_S) return TUNING_ERR_OUT_OF_RANGE;
+    }
+    if (seconds == 0) return (argv[1][0] == '\0') ? TUNING_ERR_INVALID_VALUE : TUNING_ERR_OUT_OF_RANGE;
+    *window_ms = seconds * 1000U;
+    return TUNING_OK;
+}
+
+uint64_t tuning_i2c_busy_us(uint32_t n_transfers, uint64_t n_bytes, uint32_t scl_hz)
+{
+    if (scl_hz == 0) return 0;
+    uint64_t n_clocks = n_bytes * 9U + (uint64_t)n_transfers * TUNING_I2C_FRAME_BITS;
+    return (n_clocks * 1000000U + scl_hz - 1U) / scl_hz;
+}
+
+void tuning_perf_compute(const tuning_perf_counters_t *start,
+                         const tuning_perf_counters_t *end,
+                         const tuning_values_t        *values,
+                         tuning_perf_t                *perf)
+{
+    int64_t  window_us = end->time_us - start->time_us;
+    uint32_t n_samples = end->n_samples - start->n_samples;
+    uint32_t n_ui_ticks = end->n_ui_ticks - start->n_ui_ticks;
+    if (window_us <= 0)
+    {
+        *perf = (tuning_perf_t){NAN, NAN, NAN, NAN, NAN, {NAN, NAN}};
+        return;
+    }
+
+    perf->sample_rate_hz = (float)n_samples * 1e6f / (float)window_us;
+    perf->sense_loop_us = (n_samples > 0) ? (float)(end->sense_busy_us - start->sense_busy_us) / (float)n_samples : NAN;
+    perf->ui_loop_us = (n_ui_ticks > 0) ? (float)(end->ui_busy_us - start->ui_busy_us) / (float)n_ui_ticks : NAN;
+    uint64_t sense_bus_us = tuning_i2c_busy_us(end->sense_n_transfers - start->sense_n_transfers,
+                                               end->sense_n_bytes - start->sense_n_bytes,
+                                               values->values[TUNING_sense_i2c_hz]);
+    uint64_t lcd_bus_us = tuning_i2c_busy_us(end->lcd_n_transfers - start->lcd_n_transfers,
+                                             end->lcd_n_bytes - start->lcd_n_bytes,
+                                             values->values[TUNING_lcd_i2c_hz]);
+    perf->sense_bus_pct = 100.0f * (float)sense_bus_us / (float)window_us;
+    perf->lcd_bus_pct = 100.0f * (float)lcd_bus_us / (float)window_us;
+    for (uint8_t core = 0; core < 2; core++)
+    {
+        perf->cpu_load_pct[core] = NAN;
+        if (!start->is_idle_known || !end->is_idle_known) continue;
+        float idle_pct = 100.0f * (float)(uint32_t)(end->idle_us[core] - start->idle_us[core]) / (float)window_us;
+        perf->cpu_load_pct[core] = (idle_pct < 100.0f) ? 100.0f - idle_pct : 0.0f;
+    }
+}
+
+int tuning_perf_format(const tuning_perf_t *perf, const tuning_values_t *values, char *out, size_t size)
+{
+    size_t length = 0;
+    if (size > 0) out[0] = '\0';
+    tuning_append(out,
+                  size,
+                  &length,
+                  "Sensing: %.2f samples/s, %.0f us per measurement (period %lu ms)\n",
+                  perf->sample_rate_hz,
+                  perf->sense_loop_us,
+                  (unsigned long)values->values[TUNING_sense_period_ms]);
+    tuning_append(out,
+                  size,
+                  &length,
+                  "UI: %.0f us per tick (period %lu ms)\n",
+                  perf->ui_loop_us,
+                  (unsigned long)values->values[TUNING_ui_period_ms]);
+    tuning_append(out,
+                  size,
+                  &length,
+                  "I2C bus: %.2f %% (sensor %.2f %% at %lu kHz, display %.2f %% at %lu kHz)\n",
+                  perf->sense_bus_pct + perf->lcd_bus_pct,
+                  perf->sense_bus_pct,
+                  (unsigned long)(values->values[TUNING_sense_i2c_hz] / 1000U),
+                  perf->lcd_bus_pct,
+                  (unsigned long)(values->values[TUNING_lcd_i2c_hz] / 1000U));
+    if (isnan(perf->cpu_load_pct[0]))
+    {
+        tuning_append(out, size, &length, "CPU load: unknown, FreeRTOS run time stats not enabled\n");
+    }
+    else
+    {
+        tuning_append(out,
+                      size,
+                      &length,
+                      "CPU load: core 0 %.1f %%, core 1 %.1f %%\n",
+                      perf->cpu_load_pct[0],
+                      perf->cpu_load_pct[1]);
+    }
+    return (int)length;
+}
+
+#ifdef ESP_PLATFORM
+static const char *LOG_TAG = "tuning";
+
+    #define TUNING_NVS_NAMESPACE "tuning"
+    #define TUNING_REPLY_SIZE    512U
+
+// NOTE: Only the console task changes the values after the init
+static tuning_values_t s_values;
+
+// Hand the changed values to the tasks, which apply them between two iterations
+static void tuning_apply(const tuning_values_t *values, uint32_t changed_mask)
+{
+    const uint32_t *v = values->values;
+    if (changed_mask & (1U << TUNING_sense_period_ms)) ambient_sense_set_period_ms(v[TUNING_sense_period_ms]);
+    if (changed_mask & (1U << TUNING_sense_i2c_hz)) ambient_sense_set_i2c_speed(v[TUNING_sense_i2c_hz]);
+    if (changed_mask & ((1U << TUNING_os_temp) | (1U << TUNING_os_press) | (1U << TUNING_os_humid)))
+    {
+        const uint8_t os_codes[SENSE_N_CHANNELS] = {[SENSE_CH_TEMP] = tuning_os_code(v[TUNING_os_temp]),
+                                                    [SENSE_CH_PRESS] = tuning_os_code(v[TUNING_os_press]),
+                                                    [SENSE_CH_HUMID] = tuning_os_code(v[TUNING_os_humid])};
+        ambient_sense_set_oversampling(os_codes);
+    }
+    if (changed_mask & (1U << TUNING_ui_period_ms)) lcd_manager_set_period_ms(v[TUNING_ui_period_ms]);
+    if (changed_mask & (1U << TUNING_lcd_i2c_hz)) lcd_manager_set_i2c_speed(v[TUNING_lcd_i2c_hz]);
+}
+
+static esp_err_t tuning_save(const tuning_values_t *values, uint32_t changed_mask)
+{
+    nvs_handle_t handle;
+    esp_err_t    ret = nvs_open(TUNING_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+    for (uint8_t i = 0; ret == ESP_OK && i < TUNING_N_PARAMS; i++)
+    {
+        if (changed_mask & (1U << i)) ret = nvs_set_u32(handle, tuning_param_infos[i].name, values->values[i]);
+    }
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t tuning_init(void)
+{
+    tuning_defaults(&s_values);
+
+    // No namespace yet: nothing was tuned. NVS is initialized by app_main.
+    nvs_handle_t handle;
+    uint32_t     loaded_mask = 0;
+    esp_err_t    ret = nvs_open(TUNING_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGE(LOG_TAG, "NVS open failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    if (ret == ESP_OK)
+    {
+        for (uint8_t i = 0; i < TUNING_N_PARAMS; i++)
+        {
+            uint32_t value;
+            if (nvs_get_u32(handle, tuning_param_infos[i].name, &value) != ESP_OK) continue;
+            if (!tuning_is_valid((tuning_param_t)i, value))
+            {
+                ESP_LOGW(LOG_TAG, "Saved %s %lu not valid, ignored", tuning_param_infos[i].name, (unsigned long)value);
+                continue;
+            }
+            s_values.values[i] = value;
+            if (value != tuning_param_infos[i].init) loaded_mask |= 1U << i;
+        }
+        nvs_close(handle);
+    }
+    for (uint8_t i = 0; i < TUNING_N_PARAMS; i++)
+    {
+        if (loaded_mask & (1U << i))
+        {
+            ESP_LOGI(LOG_TAG, "%s %lu", tuning_param_infos[i].name, (unsigned long)s_values.values[i]);
+        }
+    }
+    tuning_apply(&s_values, loaded_mask);
+    return ESP_OK;
+}
+
+static int tuning_tune_cmd(int argc, char **argv)
+{
+    char            reply[TUNING_REPLY_SIZE];
+    uint32_t        changed_mask;
+    tuning_status_t status = tuning_command(&s_values, argc, argv, reply, sizeof(reply), &changed_mask);
+    printf("%s", reply);
+    if (changed_mask == 0) return (status == TUNING_OK) ? 0 : 1;
+
+    tuning_apply(&s_values, changed_mask);
+    esp_err_t ret = tuning_save(&s_values, changed_mask);
+    if (ret != ESP_OK) printf("Applied, not saved: %s\n", esp_err_to_name(ret));
+    return 0;
+}
+
+static void tuning_perf_sample(tuning_perf_counters_t *counters)
+{
+    *counters = (tuning_perf_counters_t){0};
+    counters->time_us = esp_timer_get_time();
+    ambient_sense_get_perf(counters);
+    lcd_manager_get_perf(counters);
+    #ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    counters->is_idle_known = true;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS && core < 2; core++)
+    {
+        counters->idle_us[core] = (uint32_t)ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+    }
+    #endif
+}
+
+static int tuning_perf_cmd(int argc, char **argv)
+{
+    uint32_t window_ms;
+    if (tuning_perf_parse(argc, argv, &window_ms) != TUNING_OK)
+    {
+        printf("Usage: perf [<seconds>], 1 to %u s\n", TUNING_PERF_MAX_S);
+        return 1;
+    }
+    tuning_perf_counters_t start, end;
+    tuning_perf_t          perf;
+    char                   reply[TUNING_REPLY_SIZE];
+    tuning_perf_sample(&start);
+    vTaskDelay(pdMS_TO_TICKS(window_ms));
+    tuning_perf_sample(&end);
+    tuning_perf_compute(&start, &end, &s_values, &perf);
+    tuning_perf_format(&perf, &s_values, reply, sizeof(reply));
+    printf("%s", reply);
+    return 0;
+}
+
+esp_err_t tuning_console_start(void)
+{
+    esp_console_repl_t       *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "meteo>";
+    repl_config.task_stack_size = CONFIG_METEO_TUNING_TASK_STACK_SIZE;
+    repl_config.task_priority = TASK_PLAN_BACKGROUND_PRIORITY;
+    repl_config.task_core_id = TASK_PLAN_UI_CORE;
+    #if defined(CONFIG_ESP_CONSOLE_UART_DEFAULT) || defined(CONFIG_ESP_CONSOLE_UART_CUSTOM)
+    esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t                     ret = esp_console_new_repl_uart(&hw_config, &repl_config, &repl);
+    #elif defined(CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG)
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+    #elif defined(CONFIG_ESP_CONSOLE_USB_CDC)
+    esp_console_dev_usb_cdc_config_t hw_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    esp_err_t                        ret = esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl);
+    #else
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED; // No console
+    #endif
+
+    const esp_console_cmd_t tune_cmd = {
+        .command = "tune",
+        .help = "Show or set the performance parameters, saved in NVS",
+        .hint = "[<name> [<value>] | defaults]",
+        .func = &tuning_tune_cmd,
+    };
+    const esp_console_cmd_t perf_cmd = {
+        .command = "perf",
+        .help = "Measure the loop times, I2C bus use and CPU load over a window",
+        .hint = "[<seconds>]",
+        .func = &tuning_perf_cmd,
+    };
+    if (ret == ESP_OK) ret = esp_console_cmd_register(&tune_cmd);
+    if (ret == ESP_OK) ret = esp_console_cmd_register(&perf_cmd);
+    if (ret == ESP_OK) ret = esp_console_register_help_command();
+    if (ret == ESP_OK) ret = esp_console_start_repl(repl);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(LOG_TAG, "Console start failed: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+#endif
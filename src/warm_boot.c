@@ -0,0 +1,103 @@
+#include "warm_boot.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#define WARM_BOOT_SNAPSHOT_MAGIC   0x4D455445U // "METE"
+#define WARM_BOOT_SNAPSHOT_VERSION 2U
+
+static const char *LOG_TAG = "warm_boot";
+
+// NOTE: Kept in RTC slow memory across software resets, panics and watchdog resets (not across power cycles, the
+// content is random then). The checksum tells if the content is valid.
+typedef struct
+{
+    uint32_t      magic;
+    uint32_t      version;
+    uint32_t      boot_count;
+    bool          is_frame_saved; //< False until the first sample, the frame is not restored then
+    meteo_frame_t frame;
+    uint32_t      crc;
+} warm_boot_snapshot_t;
+
+static RTC_NOINIT_ATTR warm_boot_snapshot_t s_snapshot;
+
+static bool        s_is_warm_boot = false;
+static int64_t     s_phase_time_us[WARM_BOOT_PHASE_COUNT] = {0};
+static atomic_bool s_is_reported = false;
+
+static uint32_t warm_boot_snapshot_crc(const warm_boot_snapshot_t *snapshot)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)snapshot, offsetof(warm_boot_snapshot_t, crc));
+}
+
+bool warm_boot_restore(meteo_frame_t *frame)
+{
+    s_is_warm_boot = (s_snapshot.magic == WARM_BOOT_SNAPSHOT_MAGIC && s_snapshot.version == WARM_BOOT_SNAPSHOT_VERSION
+                      && s_snapshot.crc == warm_boot_snapshot_crc(&s_snapshot));
+    if (!s_is_warm_boot)
+    {
+        ESP_LOGI(LOG_TAG, "Cold boot (reset reason %d), no valid snapshot", esp_reset_reason());
+        s_snapshot.magic = WARM_BOOT_SNAPSHOT_MAGIC;
+        s_snapshot.version = WARM_BOOT_SNAPSHOT_VERSION;
+        s_snapshot.boot_count = 0;
+        s_snapshot.is_frame_saved = false;
+        s_snapshot.frame = (meteo_frame_t){0};
+        s_snapshot.crc = warm_boot_snapshot_crc(&s_snapshot);
+        return false;
+    }
+
+    s_snapshot.boot_count++;
+    s_snapshot.crc = warm_boot_snapshot_crc(&s_snapshot);
+    if (!s_snapshot.is_frame_saved)
+    {
+        // Reset before the first sample, e.g. a crash during the init
+        ESP_LOGI(LOG_TAG,
+                 "Warm boot #%lu (reset reason %d), no sample to restore",
+                 (unsigned long)s_snapshot.boot_count,
+                 esp_reset_reason());
+        return false;
+    }
+    ESP_LOGI(LOG_TAG,
+             "Warm boot #%lu (reset reason %d), restoring sample #%lu",
+             (unsigned long)s_snapshot.boot_count,
+             esp_reset_reason(),
+             (unsigned long)s_snapshot.frame.sequence);
+    if (frame != NULL) *frame = s_snapshot.frame;
+    return true;
+}
+
+void warm_boot_save_frame(const meteo_frame_t *frame)
+{
+    if (frame == NULL) return;
+    s_snapshot.frame = *frame;
+    s_snapshot.is_frame_saved = true;
+    s_snapshot.crc = warm_boot_snapshot_crc(&s_snapshot);
+}
+
+void warm_boot_mark_phase(warm_boot_phase_t phase)
+{
+    if (phase >= WARM_BOOT_PHASE_COUNT || s_phase_time_us[phase] != 0) return;
+    s_phase_time_us[phase] = esp_timer_get_time();
+
+    // Report once every phase is done, whichever task marks the last one. The esp_timer starts in the early startup,
+    // the ROM and bootloader time is not included.
+    for (int i = 0; i < WARM_BOOT_PHASE_COUNT; i++)
+    {
+        if (s_phase_time_us[i] == 0) return;
+    }
+    if (atomic_exchange(&s_is_reported, true)) return;
+    ESP_LOGI(LOG_TAG,
+             "%s boot timing: app start %lld us, first frame on screen %lld us, first fresh sample %lld us",
+             s_is_warm_boot ? "Warm" : "Cold",
+             s_phase_time_us[WARM_BOOT_PHASE_APP_START],
+             s_phase_time_us[WARM_BOOT_PHASE_FIRST_FRAME],
+             s_phase_time_us[WARM_BOOT_PHASE_FRESH_SAMPLE]);
+}
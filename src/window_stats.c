@@ -0,0 +1,150 @@
+#include "window_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+static void window_stats_deque_push(window_stats_deque_t *deque, uint32_t index, float value, bool is_min)
+{
+    // Drop the entries which can no longer be the extreme: older and not better than the new one
+    while (deque->len > 0)
+    {
+        const window_stats_entry_t *back =
+            &deque->entries[(deque->head + deque->len - 1) % WINDOW_STATS_MAX_BUCKETS];
+        if (is_min ? (back->value < value) : (back->value > value)) break;
+        deque->len--;
+    }
+    window_stats_entry_t *entry = &deque->entries[(deque->head + deque->len) % WINDOW_STATS_MAX_BUCKETS];
+    entry->index = index;
+    entry->value = value;
+    deque->len++;
+}
+
+// Pop the entries of buckets which left the window, oldest_index is the oldest bucket still in it
+static void window_stats_deque_expire(window_stats_deque_t *deque, uint32_t oldest_index)
+{
+    while (deque->len > 0 && (int32_t)(deque->entries[deque->head].index - oldest_index) < 0)
+    {
+        deque->head = (uint8_t)((deque->head + 1) % WINDOW_STATS_MAX_BUCKETS);
+        deque->len--;
+    }
+}
+
+static void window_stats_reset_bucket(window_stats_t *stats)
+{
+    stats->bucket_min = INFINITY;
+    stats->bucket_max = -INFINITY;
+    stats->bucket_sum = 0.0;
+    stats->bucket_count = 0;
+}
+
+void window_stats_init(window_stats_t *stats, int64_t window_us, uint8_t n_buckets)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (n_buckets < 2) n_buckets = 2;
+    if (n_buckets > WINDOW_STATS_MAX_BUCKETS) n_buckets = WINDOW_STATS_MAX_BUCKETS;
+    stats->n_buckets = n_buckets;
+    stats->bucket_period_us = (window_us >= n_buckets) ? window_us / n_buckets : 1;
+    window_stats_reset_bucket(stats);
+}
+
+// Close the current bucket and start the next one
+static void window_stats_next_bucket(window_stats_t *stats)
+{
+    uint8_t slot = (uint8_t)(stats->bucket_index % stats->n_buckets);
+    stats->sums[slot] = stats->bucket_sum;
+    stats->counts[slot] = stats->bucket_count;
+    stats->window_sum += stats->bucket_sum;
+    stats->window_count += stats->bucket_count;
+    if (stats->bucket_count > 0)
+    {
+        window_stats_deque_push(&stats->min_deque, stats->bucket_index, stats->bucket_min, true);
+        window_stats_deque_push(&stats->max_deque, stats->bucket_index, stats->bucket_max, false);
+    }
+
+    // The new bucket takes the slot of the bucket which leaves the window
+    stats->bucket_index++;
+    slot = (uint8_t)(stats->bucket_index % stats->n_buckets);
+    stats->window_sum -= stats->sums[slot];
+    stats->window_count -= stats->counts[slot];
+    stats->sums[slot] = 0.0;
+    stats->counts[slot] = 0;
+    uint32_t oldest_index = stats->bucket_index - (stats->n_buckets - 1);
+    window_stats_deque_expire(&stats->min_deque, oldest_index);
+    window_stats_deque_expire(&stats->max_deque, oldest_index);
+    window_stats_reset_bucket(stats);
+}
+
+void window_stats_advance(window_stats_t *stats, int64_t now_us)
+{
+    if (!stats->is_started || now_us < stats->bucket_start_us + stats->bucket_period_us) return;
+
+    int64_t n_elapsed = (now_us - stats->bucket_start_us) / stats->bucket_period_us;
+    stats->bucket_start_us += n_elapsed * stats->bucket_period_us;
+    if (n_elapsed >= stats->n_buckets)
+    {
+        // Every bucket left the window, skip the intermediate ones
+        window_stats_next_bucket(stats);
+        stats->bucket_index += (uint32_t)(n_elapsed - 1);
+        memset(stats->sums, 0, sizeof(stats->sums));
+        memset(stats->counts, 0, sizeof(stats->counts));
+        stats->window_sum = 0.0;
+        stats->window_count = 0;
+        stats->min_deque.len = 0;
+        stats->max_deque.len = 0;
+        return;
+    }
+    for (int64_t i = 0; i < n_elapsed; i++)
+    {
+        window_stats_next_bucket(stats);
+    }
+}
+
+void window_stats_add(window_stats_t *stats, int64_t timestamp_us, float value)
+{
+    if (!stats->is_started)
+    {
+        stats->is_started = true;
+        stats->bucket_start_us = timestamp_us;
+    }
+    window_stats_advance(stats, timestamp_us);
+
+    if (isnan(value)) return;
+    if (value < stats->bucket_min) stats->bucket_min = value;
+    if (value > stats->bucket_max) stats->bucket_max = value;
+    stats->bucket_sum += value;
+    stats->bucket_count++;
+}
+
+float window_stats_min(const window_stats_t *stats)
+{
+    float min = stats->bucket_min;
+    if (stats->min_deque.len > 0)
+    {
+        float oldest = stats->min_deque.entries[stats->min_deque.head].value;
+        if (oldest < min) min = oldest;
+    }
+    return isinf(min) ? NAN : min;
+}
+
+float window_stats_max(const window_stats_t *stats)
+{
+    float max = stats->bucket_max;
+    if (stats->max_deque.len > 0)
+    {
+        float oldest = stats->max_deque.entries[stats->max_deque.head].value;
+        if (oldest > max) max = oldest;
+    }
+    return isinf(max) ? NAN : max;
+}
+
+float window_stats_mean(const window_stats_t *stats)
+{
+    uint32_t count = window_stats_count(stats);
+    if (count == 0) return NAN;
+    return (float)((stats->window_sum + stats->bucket_sum) / count);
+}
+
+uint32_t window_stats_count(const window_stats_t *stats)
+{
+    return stats->window_count + stats->bucket_count;
+}
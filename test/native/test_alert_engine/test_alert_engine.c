@@ -0,0 +1,168 @@
+#include <unity.h>
+
+#include <math.h>
+
+#include "alert_engine.h"
+
+#define SAMPLE_PERIOD_US 250000LL // Ambient sense loop period
+
+static meteo_frame_t frame_at(int64_t timestamp_us, float temperature_degc, float humidity_pct, float pressure_kpa)
+{
+    meteo_frame_t frame = {
+        .timestamp_us = timestamp_us,
+        .temperature_degc = temperature_degc,
+        .humidity_pct = humidity_pct,
+        .pressure_pa = pressure_kpa * 1000.0f,
+    };
+    return frame;
+}
+
+// Time of the first sample where the alert was set (or cleared), -1 when it never changed
+typedef struct
+{
+    int64_t set_us;
+    int64_t clear_us;
+    int     n_changes;
+} alert_trace_t;
+
+static void trace_eval(alert_engine_t *engine, const meteo_frame_t *frame, alert_id_t id, alert_trace_t *trace)
+{
+    uint8_t changed = alert_engine_eval(engine, frame);
+    if (!((changed >> id) & 1U)) return;
+    trace->n_changes++;
+    if ((engine->active_mask >> id) & 1U) trace->set_us = frame->timestamp_us;
+    else trace->clear_us = frame->timestamp_us;
+}
+
+void test_frost_debounce_and_hysteresis(void)
+{
+    alert_engine_t engine;
+    alert_trace_t  trace = {-1, -1, 0};
+    alert_engine_init(&engine);
+    const int64_t debounce_us = alert_rules[ALERT_FROST].debounce_us;
+
+    // Cooling down through the threshold, with +-0.3 degC noise around it for a while
+    int64_t t = 0;
+    for (; t < 3600 * 1000000LL; t += SAMPLE_PERIOD_US)
+    {
+        float trend = 5.0f - (float)t / (600 * 1000000.0f); // -1 degC per 10 min
+        if (trend < 1.5f) trend = 1.5f;
+        float noise = ((t / SAMPLE_PERIOD_US) % 2) ? 0.3f : -0.3f;
+        meteo_frame_t frame = frame_at(t, trend + noise, 50.0f, 101.3f);
+        trace_eval(&engine, &frame, ALERT_FROST, &trace);
+    }
+    // Every other noisy sample is under 2.0 degC from a 2.3 degC trend on (1620 s), this is never debounced. Every
+    // sample is from a 1.7 degC trend (1980 s), the alert is set one debounce time later.
+    TEST_ASSERT_EQUAL(1, trace.n_changes);
+    TEST_ASSERT_INT_WITHIN(1, 1980 + debounce_us / 1000000, trace.set_us / 1000000);
+
+    // Warming up: the alert stays set until 3.0 degC (hysteresis) held for the debounce time
+    int64_t warm_start_us = t;
+    for (; t < warm_start_us + 3600 * 1000000LL; t += SAMPLE_PERIOD_US)
+    {
+        float         temperature = 1.5f + (float)(t - warm_start_us) / (600 * 1000000.0f);
+        meteo_frame_t frame = frame_at(t, temperature, 50.0f, 101.3f);
+        trace_eval(&engine, &frame, ALERT_FROST, &trace);
+        if (temperature < 3.0f) TEST_ASSERT_TRUE(engine.active_mask & (1U << ALERT_FROST));
+    }
+    TEST_ASSERT_EQUAL(2, trace.n_changes);
+    TEST_ASSERT_INT_WITHIN(1, (warm_start_us + debounce_us) / 1000000 + 900, trace.clear_us / 1000000);
+}
+
+void test_short_spike_is_debounced(void)
+{
+    alert_engine_t engine;
+    alert_trace_t  trace = {-1, -1, 0};
+    alert_engine_init(&engine);
+    const int64_t debounce_us = alert_rules[ALERT_HIGH_HUMIDITY].debounce_us;
+
+    // A humidity spike (e.g. breath on the sensor) shorter than the debounce time
+    int64_t t = 0;
+    for (; t < 10 * debounce_us; t += SAMPLE_PERIOD_US)
+    {
+        bool          is_spike = (t >= debounce_us && t < 2 * debounce_us - SAMPLE_PERIOD_US);
+        meteo_frame_t frame = frame_at(t, 20.0f, is_spike ? 95.0f : 60.0f, 101.3f);
+        trace_eval(&engine, &frame, ALERT_HIGH_HUMIDITY, &trace);
+    }
+    TEST_ASSERT_EQUAL(0, trace.n_changes);
+
+    // A NaN sample does not reset a pending transition
+    int64_t start_us = t;
+    for (; t < start_us + 2 * debounce_us; t += SAMPLE_PERIOD_US)
+    {
+        meteo_frame_t frame = frame_at(t, 20.0f, (t == start_us + SAMPLE_PERIOD_US) ? NAN : 90.0f, 101.3f);
+        trace_eval(&engine, &frame, ALERT_HIGH_HUMIDITY, &trace);
+    }
+    TEST_ASSERT_EQUAL(1, trace.n_changes);
+    TEST_ASSERT_TRUE(trace.set_us == start_us + debounce_us);
+    TEST_ASSERT_EQUAL_STRING("HUMID", alert_engine_first_name(engine.active_mask));
+}
+
+void test_pressure_drop(void)
+{
+    alert_engine_t engine;
+    alert_trace_t  trace = {-1, -1, 0};
+    alert_engine_init(&engine);
+    const alert_rule_t *rule = &alert_rules[ALERT_PRESSURE_DROP];
+    const int64_t       hour_us = 3600 * 1000000LL;
+
+    // Steady for 4 h, then a 0.2 kPa/h drop for 4 h, then steady again. 1 s samples with a 10 Pa noise.
+    for (int64_t t = 0; t < 16 * hour_us; t += 1000000LL)
+    {
+        float pressure = 101.5f;
+        if (t >= 4 * hour_us) pressure -= 0.2f * (float)(t - 4 * hour_us) / (float)hour_us;
+        if (t >= 8 * hour_us) pressure = 101.5f - 0.8f;
+        pressure += ((t / 1000000LL) % 3 - 1) * 0.01f;
+        meteo_frame_t frame = frame_at(t, 15.0f, 60.0f, pressure);
+        trace_eval(&engine, &frame, ALERT_PRESSURE_DROP, &trace);
+    }
+    TEST_ASSERT_EQUAL(2, trace.n_changes);
+    // 0.3 kPa dropped over 3 h after 1.5 h of drop, within a reference period (the window is 3 h +- 15 min)
+    int32_t ref_period_s = (int32_t)(rule->window_us / (ALERT_DROP_N_REFS - 1) / 1000000);
+    int32_t debounce_s = (int32_t)(rule->debounce_us / 1000000);
+    TEST_ASSERT_INT_WITHIN(ref_period_s, (4 * 3600 + 3600 * 3 / 2) + debounce_s, (int32_t)(trace.set_us / 1000000));
+    // Cleared when the drop over the last 3 h is back under 0.15 kPa: 0.75 h of drop left in the window
+    TEST_ASSERT_INT_WITHIN(ref_period_s, (8 * 3600 + 3600 * 9 / 4) + debounce_s, (int32_t)(trace.clear_us / 1000000));
+}
+
+void test_pressure_drop_needs_a_full_window(void)
+{
+    alert_engine_t engine;
+    alert_engine_init(&engine);
+    const int64_t hour_us = 3600 * 1000000LL;
+
+    // A fast drop right after boot, then a gap longer than the window: the references start over
+    int64_t t = 0;
+    for (; t < 2 * hour_us; t += 1000000LL)
+    {
+        meteo_frame_t frame = frame_at(t, 15.0f, 60.0f, 101.5f - 0.5f * (float)t / (float)hour_us);
+        alert_engine_eval(&engine, &frame);
+    }
+    TEST_ASSERT_EQUAL(0, engine.active_mask);
+    t += 4 * hour_us;
+    for (int64_t end_us = t + 2 * hour_us; t < end_us; t += 1000000LL)
+    {
+        meteo_frame_t frame = frame_at(t, 15.0f, 60.0f, 99.0f);
+        alert_engine_eval(&engine, &frame);
+    }
+    TEST_ASSERT_EQUAL(0, engine.active_mask);
+}
+
+void test_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("FROST", alert_engine_name(ALERT_FROST));
+    TEST_ASSERT_EQUAL_STRING("STORM", alert_engine_name(ALERT_PRESSURE_DROP));
+    TEST_ASSERT_NULL(alert_engine_first_name(0));
+    TEST_ASSERT_EQUAL_STRING("FROST", alert_engine_first_name((1U << ALERT_FROST) | (1U << ALERT_PRESSURE_DROP)));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frost_debounce_and_hysteresis);
+    RUN_TEST(test_short_spike_is_debounced);
+    RUN_TEST(test_pressure_drop);
+    RUN_TEST(test_pressure_drop_needs_a_full_window);
+    RUN_TEST(test_names);
+    return UNITY_END();
+}
@@ -0,0 +1,392 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bme68x.h"
+
+#include "lcd_variables.h"
+#include "meteo_frame.h"
+#include "mono_fb.h"
+#include "mono_ui.h"
+#include "ssd1306_emu.h"
+
+#include "bench_baseline.h"
+
+// NOTE: Micro-benchmarks of the sensing to panel pipeline stages, one test per stage. Each stage runs its operation
+// in BENCH_REPEATS batches, its cost is the median batch time in calibration operations (calibration_run()). A stage
+// fails when its cost stays above its committed baseline (bench_baseline.h) times BENCH_TOLERANCE (environment, 2 by
+// default) or when it sends more panel bytes than the baseline. A stage without baseline fails too, unless it is listed
+// in s_bench_unrecorded (ignored). BENCH_UPDATE=1 prints the baseline lines instead of checking them.
+#define BENCH_REPEATS           41U
+#define BENCH_ATTEMPTS          3U
+#define BENCH_DEFAULT_TOLERANCE 2.0
+#define CALIBRATION_OPS         200U
+#define CALIBRATION_STEPS       64U //< Loop iterations per calibration operation
+#define BYTES_FRAMES            64U //< UI frames of the deterministic panel bytes pass
+
+typedef struct
+{
+    const char *name;
+    void (*run)(uint32_t n_ops);
+    uint32_t n_ops;
+    uint32_t (*bytes)(void); //< Panel bytes per operation, NULL when the stage sends none
+} bench_t;
+
+static volatile float s_sink = 0.0f;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double bench_ns_per_op(void (*run)(uint32_t n_ops), uint32_t n_ops)
+{
+    double start_ns = now_ns();
+    run(n_ops);
+    return (now_ns() - start_ns) / n_ops;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double lhs = *(const double *)a, rhs = *(const double *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// Integer and float mix of about the pipeline instruction mix, in a loop the compiler cannot remove
+static void calibration_run(uint32_t n_ops)
+{
+    uint32_t state = 0x12345678U;
+    float    acc = 0.0f;
+    for (uint32_t i = 0; i < n_ops * CALIBRATION_STEPS; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        acc = acc * 0.999f + (float)(state & 0xFFU);
+    }
+    s_sink += acc;
+}
+
+// Median over the repeats of the stage time over the calibration time measured just before it, so that a change of
+// the host load or clock during the run affects both
+static double bench_cost(void (*run)(uint32_t n_ops), uint32_t n_ops, double *ns)
+{
+    double costs[BENCH_REPEATS], times[BENCH_REPEATS];
+    run(n_ops); // Warm up the caches and branch predictors
+    for (uint32_t r = 0; r < BENCH_REPEATS; r++)
+    {
+        double calibration_ns = bench_ns_per_op(calibration_run, CALIBRATION_OPS);
+        times[r] = bench_ns_per_op(run, n_ops);
+        costs[r] = times[r] / calibration_ns;
+    }
+    qsort(costs, BENCH_REPEATS, sizeof(costs[0]), compare_doubles);
+    qsort(times, BENCH_REPEATS, sizeof(times[0]), compare_doubles);
+    *ns = times[BENCH_REPEATS / 2];
+    return costs[BENCH_REPEATS / 2];
+}
+
+static float bench_tolerance(void)
+{
+    const char *text = getenv("BENCH_TOLERANCE");
+    double      tolerance = (text != NULL) ? atof(text) : 0.0;
+    return (float)((tolerance >= 1.0) ? tolerance : BENCH_DEFAULT_TOLERANCE);
+}
+
+static const bench_baseline_t *bench_find_baseline(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_bench_baselines) / sizeof(s_bench_baselines[0]); i++)
+    {
+        if (strcmp(s_bench_baselines[i].name, name) == 0) return &s_bench_baselines[i];
+    }
+    return NULL;
+}
+
+static bool bench_is_unrecorded(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_bench_unrecorded) / sizeof(s_bench_unrecorded[0]); i++)
+    {
+        if (strcmp(s_bench_unrecorded[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void bench_check(const bench_t *bench)
+{
+    const bench_baseline_t *baseline = bench_find_baseline(bench->name);
+    float                   limit = (baseline != NULL) ? baseline->cost * bench_tolerance() : NAN;
+    uint32_t                bytes = (bench->bytes != NULL) ? bench->bytes() : 0;
+
+    // A regression is persistent: measured again when above the limit, a host load burst does not last
+    double ns;
+    float  cost = (float)bench_cost(bench->run, bench->n_ops, &ns);
+    for (uint8_t attempt = 1; attempt < BENCH_ATTEMPTS && cost > limit; attempt++)
+    {
+        cost = (float)bench_cost(bench->run, bench->n_ops, &ns);
+    }
+    // One line per stage, key=value fields for the CI scripts
+    printf("BENCH name=%s ns_per_op=%.1f cost=%.3f bytes=%u baseline_cost=%.3f limit=%.3f baseline_bytes=%u\n",
+           bench->name,
+           ns,
+           cost,
+           (unsigned)bytes,
+           (baseline != NULL) ? baseline->cost : NAN,
+           limit,
+           (baseline != NULL) ? (unsigned)baseline->bytes : 0U);
+
+    const char *update = getenv("BENCH_UPDATE");
+    if (update != NULL && strcmp(update, "1") == 0)
+    {
+        printf("    {\"%s\", %.3ff, %u},\n", bench->name, cost, (unsigned)bytes);
+        return;
+    }
+    if (baseline == NULL && bench_is_unrecorded(bench->name)) TEST_IGNORE_MESSAGE("Baseline not recorded yet");
+    if (baseline == NULL) TEST_FAIL_MESSAGE("No baseline, add the BENCH_UPDATE=1 line to bench_baseline.h");
+    TEST_ASSERT_TRUE_MESSAGE(bytes <= baseline->bytes, "Panel bytes above the baseline");
+    TEST_ASSERT_TRUE_MESSAGE(cost <= limit, "Cost above the baseline times BENCH_TOLERANCE");
+}
+
+// BME68x register read and compensation, from a register image. The compensation cost does not depend on the
+// calibration values, any non-zero ones do.
+static uint8_t           s_bme68x_regs[256];
+static struct bme68x_dev s_bme68x;
+
+static BME68X_INTF_RET_TYPE bme68x_image_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    for (uint32_t i = 0; i < length; i++) reg_data[i] = s_bme68x_regs[(uint8_t)(reg_addr + i)];
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static BME68X_INTF_RET_TYPE bme68x_image_write(uint8_t        reg_addr,
+                                               const uint8_t *reg_data,
+                                               uint32_t       length,
+                                               void          *intf_ptr)
+{
+    // Burst writes are (register, value) pairs after the first register
+    s_bme68x_regs[reg_addr] = reg_data[0];
+    for (uint32_t i = 1; i + 1 < length; i += 2) s_bme68x_regs[reg_data[i]] = reg_data[i + 1];
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void bme68x_image_delay_us(uint32_t period, void *intf_ptr)
+{
+}
+
+static void bme68x_image_init(void)
+{
+    for (uint16_t reg = 0; reg < 256; reg++) s_bme68x_regs[reg] = (uint8_t)(0x35U + reg * 7U);
+    s_bme68x_regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+    s_bme68x_regs[BME68X_REG_VARIANT_ID] = BME68X_VARIANT_GAS_HIGH;
+    s_bme68x_regs[BME68X_REG_CTRL_MEAS] = BME68X_SLEEP_MODE;
+    s_bme68x_regs[BME68X_REG_FIELD0] = BME68X_NEW_DATA_MSK; // Field 0 measured, read again at each operation
+    s_bme68x = (struct bme68x_dev){
+        .intf = BME68X_I2C_INTF,
+        .read = bme68x_image_read,
+        .write = bme68x_image_write,
+        .delay_us = bme68x_image_delay_us,
+        .amb_temp = 25,
+    };
+    TEST_ASSERT_EQUAL_INT8(BME68X_OK, bme68x_init(&s_bme68x));
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X, .os_pres = BME68X_OS_4X, .os_temp = BME68X_OS_2X, .filter = BME68X_FILTER_SIZE_3};
+    TEST_ASSERT_EQUAL_INT8(BME68X_OK, bme68x_set_conf(&conf, &s_bme68x));
+}
+
+static void bme68x_compensation_run(uint32_t n_ops)
+{
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        struct bme68x_data data;
+        uint8_t            n_fields = 0;
+        bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, &s_bme68x);
+        s_sink += data.temperature + data.pressure + data.humidity;
+    }
+}
+
+// Frames of a slowly changing measurement, as the sensing loop publishes them
+static void frame_at(uint32_t i, meteo_frame_t *frame)
+{
+    frame->temperature_degc = 21.0f + (float)(i % 40U) * 0.05f;
+    frame->humidity_pct = 45.0f + (float)(i % 16U) * 0.1f;
+    frame->pressure_pa = 101300.0f + (float)(i % 8U) * 10.0f;
+    frame->gas_resistance_ohm = 50000.0f;
+}
+
+static void lcd_variables_set_frame_run(uint32_t n_ops)
+{
+    meteo_frame_t frame = {0};
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        frame_at(i, &frame);
+        lcd_variables_set_frame(&frame);
+    }
+}
+
+// The variables read by each UI tick of the main screen
+static void lcd_variables_get_run(uint32_t n_ops)
+{
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        sum += get_var_amb_temp_degc() + get_var_amb_humid_pct() + get_var_amb_press_kpa();
+        sum += (float)get_var_is_amb_temp_negative() + (float)get_var_is_station_connected();
+        sum += (float)get_var_active_alerts();
+    }
+    s_sink += sum;
+}
+
+// The three value labels of the main screen
+static void label_format_run(uint32_t n_ops)
+{
+    static const lcd_var_id_t s_labels[] = {LCD_VAR_amb_temp_degc, LCD_VAR_amb_humid_pct, LCD_VAR_amb_press_kpa};
+    char                      text[24];
+    uint32_t                  length = 0;
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        for (uint8_t l = 0; l < sizeof(s_labels) / sizeof(s_labels[0]); l++)
+        {
+            length += (uint32_t)lcd_variables_format(s_labels[l], text, sizeof(text));
+        }
+    }
+    s_sink += (float)length;
+}
+
+static mono_ui_t     s_ui;
+static ssd1306_emu_t s_emu;
+
+static void values_at(uint32_t i, mono_ui_values_t *values)
+{
+    meteo_frame_t frame;
+    frame_at(i, &frame);
+    *values = (mono_ui_values_t){
+        .amb_temp_degc = frame.temperature_degc,
+        .amb_humid_pct = frame.humidity_pct,
+        .amb_press_kpa = frame.pressure_pa / 1000.0f,
+        .is_station_connected = (i % 32U) < 16U,
+    };
+}
+
+// Main screen tick: the changed fields redrawn in the framebuffer. The EEZ Studio tick_screen_main() needs LVGL and
+// the EEZ flow, the minimal renderer evaluates the same screen bindings on the host.
+static void ui_tick_run(uint32_t n_ops)
+{
+    mono_ui_values_t values;
+    uint32_t         n_fields = 0;
+    mono_ui_init(&s_ui);
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        values_at(i, &values);
+        n_fields += mono_ui_update(&s_ui, &values);
+    }
+    s_sink += (float)n_fields;
+}
+
+// Tick and flush of the changed columns, through the panel driver model
+static void ui_frame_run(uint32_t n_ops)
+{
+    mono_ui_values_t values;
+    mono_ui_init(&s_ui);
+    ssd1306_emu_init(&s_emu);
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        values_at(i, &values);
+        mono_ui_update(&s_ui, &values);
+        mono_fb_flush(&s_ui.fb, ssd1306_emu_write_page, &s_emu);
+    }
+}
+
+static void full_flush_run(uint32_t n_ops)
+{
+    ssd1306_emu_init(&s_emu);
+    for (uint32_t i = 0; i < n_ops; i++)
+    {
+        mono_fb_mark_all_dirty(&s_ui.fb);
+        mono_fb_flush(&s_ui.fb, ssd1306_emu_write_page, &s_emu);
+    }
+}
+
+// Bytes on the I2C bus, with the address byte of each transfer
+static uint32_t panel_bytes(void)
+{
+    ssd1306_emu_stats_t stats;
+    ssd1306_emu_take_stats(&s_emu, &stats);
+    return stats.n_transfers + stats.n_control_bytes + stats.n_command_bytes + stats.n_data_bytes;
+}
+
+static uint32_t ui_frame_bytes(void)
+{
+    ui_frame_run(1); // The first frame draws everything
+    panel_bytes();
+    for (uint32_t i = 1; i < BYTES_FRAMES + 1U; i++)
+    {
+        mono_ui_values_t values;
+        values_at(i, &values);
+        mono_ui_update(&s_ui, &values);
+        mono_fb_flush(&s_ui.fb, ssd1306_emu_write_page, &s_emu);
+    }
+    return (panel_bytes() + BYTES_FRAMES / 2U) / BYTES_FRAMES;
+}
+
+static uint32_t full_flush_bytes(void)
+{
+    full_flush_run(1);
+    return panel_bytes();
+}
+
+void test_bme68x_compensation(void)
+{
+    bme68x_image_init();
+    bench_check(&(bench_t){"bme68x_compensation", bme68x_compensation_run, 10000, NULL});
+}
+
+void test_lcd_variables_set_frame(void)
+{
+    bench_check(&(bench_t){"lcd_variables_set_frame", lcd_variables_set_frame_run, 10000, NULL});
+}
+
+void test_lcd_variables_get(void)
+{
+    bench_check(&(bench_t){"lcd_variables_get", lcd_variables_get_run, 10000, NULL});
+}
+
+void test_label_format(void)
+{
+    meteo_frame_t frame = {.temperature_degc = 21.4f, .humidity_pct = 45.2f, .pressure_pa = 101300.0f};
+    lcd_variables_set_frame(&frame);
+    bench_check(&(bench_t){"label_format", label_format_run, 1000, NULL});
+}
+
+void test_ui_tick(void)
+{
+    bench_check(&(bench_t){"ui_tick", ui_tick_run, 500, NULL});
+}
+
+void test_ui_frame_flush(void)
+{
+    bench_check(&(bench_t){"ui_frame_flush", ui_frame_run, 500, ui_frame_bytes});
+}
+
+void test_full_frame_flush(void)
+{
+    mono_ui_init(&s_ui);
+    bench_check(&(bench_t){"full_frame_flush", full_flush_run, 200, full_flush_bytes});
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bme68x_compensation);
+    RUN_TEST(test_lcd_variables_set_frame);
+    RUN_TEST(test_lcd_variables_get);
+    RUN_TEST(test_label_format);
+    RUN_TEST(test_ui_tick);
+    RUN_TEST(test_ui_frame_flush);
+    RUN_TEST(test_full_frame_flush);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "ble_broadcast.h"
+
+static const ble_broadcast_thresholds_t s_thresholds = {
+    .temp_degc = 0.1f,
+    .humid_pct = 0.5f,
+    .press_pa = 10.0f,
+    .max_interval_ms = 600000,
+};
+
+// Stand-in for AES-CCM, keeps what it was given to check the nonce and the encrypted span
+static uint8_t s_ccm_nonce[BLE_BROADCAST_NONCE_SIZE];
+static size_t  s_ccm_length;
+
+static bool fake_ccm(const uint8_t  key[BLE_BROADCAST_KEY_SIZE],
+                     const uint8_t  nonce[BLE_BROADCAST_NONCE_SIZE],
+                     const uint8_t *in,
+                     size_t         length,
+                     uint8_t       *out,
+                     uint8_t        mic[BLE_BROADCAST_MIC_SIZE])
+{
+    memcpy(s_ccm_nonce, nonce, sizeof(s_ccm_nonce));
+    s_ccm_length = length;
+    for (size_t i = 0; i < length; i++) out[i] = in[i] ^ key[i % BLE_BROADCAST_KEY_SIZE];
+    for (uint8_t i = 0; i < BLE_BROADCAST_MIC_SIZE; i++) mic[i] = (uint8_t)(0xA0 + i);
+    return true;
+}
+
+void test_encode_layout(void)
+{
+    meteo_frame_t frame = {.temperature_degc = 25.06f, .humidity_pct = 50.55f, .pressure_pa = 100883.0f};
+    uint8_t       buffer[BLE_BROADCAST_ADV_MAX_SIZE];
+
+    TEST_ASSERT_EQUAL(BLE_BROADCAST_ADV_SIZE, ble_broadcast_encode(&frame, 7, NULL, buffer, sizeof(buffer)));
+    const uint8_t expected[] = {
+        0x02, 0x01, 0x06,             // Flags
+        0x10, 0x16, 0xD2, 0xFC, 0x40, // Service data, BTHome UUID, v2 not encrypted
+        0x00, 0x07,                   // Packet id
+        0x02, 0xCA, 0x09,             // 25.06 °C
+        0x03, 0xBF, 0x13,             // 50.55 %
+        0x04, 0x13, 0x8A, 0x01,       // 1008.83 hPa
+    };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, sizeof(expected));
+}
+
+void test_encode_clamps_and_rounds(void)
+{
+    meteo_frame_t frame = {.temperature_degc = -12.345f, .humidity_pct = 120.0f, .pressure_pa = NAN};
+    uint8_t       buffer[BLE_BROADCAST_ADV_SIZE];
+
+    TEST_ASSERT_EQUAL(BLE_BROADCAST_ADV_SIZE, ble_broadcast_encode(&frame, 0, NULL, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_INT16(-1235, (int16_t)(buffer[11] | (buffer[12] << 8)));
+    TEST_ASSERT_EQUAL_UINT16(12000, (uint16_t)(buffer[14] | (buffer[15] << 8)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((const uint8_t[]){0, 0, 0}), &buffer[17], 3);
+
+    TEST_ASSERT_EQUAL(0, ble_broadcast_encode(&frame, 0, NULL, buffer, sizeof(buffer) - 1));
+}
+
+void test_encode_encrypted(void)
+{
+    const uint8_t key[BLE_BROADCAST_KEY_SIZE] = {0x23, 0x1D, 0x39, 0xC1, 0xD7, 0xCC, 0x1A, 0xB1,
+                                                 0xAE, 0xE2, 0x24, 0xCD, 0x09, 0x6D, 0xB9, 0x32};
+    const uint8_t mac[6] = {0x54, 0x48, 0xE6, 0x8F, 0x80, 0xA5};
+    ble_broadcast_crypto_t crypto = {.key = key, .mac = mac, .counter = 0x00112233, .ccm = fake_ccm};
+    meteo_frame_t          frame = {.temperature_degc = 25.06f, .humidity_pct = 50.55f, .pressure_pa = 100883.0f};
+    uint8_t                plain[BLE_BROADCAST_ADV_MAX_SIZE];
+    uint8_t                buffer[BLE_BROADCAST_ADV_MAX_SIZE];
+
+    ble_broadcast_encode(&frame, 7, NULL, plain, sizeof(plain));
+    TEST_ASSERT_EQUAL(BLE_BROADCAST_ADV_SIZE_ENCRYPT, ble_broadcast_encode(&frame, 7, &crypto, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(BLE_BROADCAST_ADV_SIZE_ENCRYPT - 4, buffer[3]);
+    TEST_ASSERT_EQUAL_HEX8(BTHOME_DEVICE_INFO | BTHOME_DEVICE_INFO_ENCRYPTED, buffer[7]);
+
+    // Nonce: MAC as shown, UUID, device info, counter (little endian)
+    const uint8_t expected_nonce[] = {0x54, 0x48, 0xE6, 0x8F, 0x80, 0xA5, 0xD2, 0xFC, 0x41, 0x33, 0x22, 0x11, 0x00};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_nonce, s_ccm_nonce, sizeof(expected_nonce));
+
+    // Only the objects are encrypted, followed by the counter and the MIC
+    TEST_ASSERT_EQUAL(BLE_BROADCAST_OBJECTS_SIZE, s_ccm_length);
+    for (size_t i = 0; i < BLE_BROADCAST_OBJECTS_SIZE; i++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(plain[8 + i] ^ key[i], buffer[8 + i]);
+    }
+    const uint8_t expected_tail[] = {0x33, 0x22, 0x11, 0x00, 0xA0, 0xA1, 0xA2, 0xA3};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_tail, &buffer[8 + BLE_BROADCAST_OBJECTS_SIZE], sizeof(expected_tail));
+}
+
+void test_update_on_change_only(void)
+{
+    ble_broadcast_state_t state;
+    ble_broadcast_init_state(&state, &s_thresholds);
+    meteo_frame_t frame = {.timestamp_us = 0, .temperature_degc = 20.0f, .humidity_pct = 40.0f, .pressure_pa = 1e5f};
+
+    // First frame, then an hour of noise within half the thresholds: only the periodic refreshes
+    TEST_ASSERT_TRUE(ble_broadcast_update(&state, &frame));
+    TEST_ASSERT_EQUAL_UINT8(0, state.packet_id);
+    for (uint32_t i = 1; i < 3600; i++)
+    {
+        frame.timestamp_us = (int64_t)i * 1000000;
+        frame.temperature_degc = 20.0f + 0.04f * sinf((float)i);
+        frame.humidity_pct = 40.0f + 0.2f * cosf((float)i);
+        frame.pressure_pa = 1e5f + 4.0f * sinf((float)i * 0.1f);
+        if (i % 600 == 0)
+        {
+            TEST_ASSERT_TRUE(ble_broadcast_update(&state, &frame)); // Refreshed every max_interval_ms
+            continue;
+        }
+        TEST_ASSERT_FALSE(ble_broadcast_update(&state, &frame));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3600, state.n_frames);
+    TEST_ASSERT_EQUAL_UINT32(6, state.n_updates);
+    TEST_ASSERT_EQUAL_UINT8(5, state.packet_id);
+
+    // A move beyond a threshold is sent with the next packet id
+    frame.timestamp_us += 1000000;
+    frame.pressure_pa = state.press_pa - 10.5f;
+    TEST_ASSERT_TRUE(ble_broadcast_update(&state, &frame));
+    TEST_ASSERT_EQUAL_UINT8(6, state.packet_id);
+    TEST_ASSERT_EQUAL_FLOAT(frame.pressure_pa, state.press_pa);
+}
+
+void test_counter_resumes_after_reserved_block(void)
+{
+    // First boot, nothing reserved: the first counter reserves a block
+    uint32_t counter = 0, reserved_end = 0;
+    TEST_ASSERT_TRUE(ble_broadcast_next_counter(&counter, &reserved_end));
+    TEST_ASSERT_EQUAL_UINT32(1, counter);
+    TEST_ASSERT_EQUAL_UINT32(BLE_BROADCAST_COUNTER_BLOCK, reserved_end);
+    for (uint32_t i = 2; i <= BLE_BROADCAST_COUNTER_BLOCK; i++)
+    {
+        TEST_ASSERT_FALSE(ble_broadcast_next_counter(&counter, &reserved_end));
+    }
+    TEST_ASSERT_TRUE(ble_broadcast_next_counter(&counter, &reserved_end));
+    TEST_ASSERT_EQUAL_UINT32(BLE_BROADCAST_COUNTER_BLOCK + 1U, counter);
+    TEST_ASSERT_EQUAL_UINT32(2U * BLE_BROADCAST_COUNTER_BLOCK, reserved_end);
+
+    // Reboot in the middle of the block: the counter resumes from the persisted end, above every counter sent
+    uint32_t last_sent = counter + 10U;
+    counter = reserved_end;
+    TEST_ASSERT_TRUE(ble_broadcast_next_counter(&counter, &reserved_end));
+    TEST_ASSERT_GREATER_THAN_UINT32(last_sent, counter);
+    TEST_ASSERT_EQUAL_UINT32(3U * BLE_BROADCAST_COUNTER_BLOCK, reserved_end);
+}
+
+void test_air_time(void)
+{
+    // 16 bytes of PDU overhead plus the advertising data, at 1 us per bit
+    TEST_ASSERT_EQUAL_UINT32(288, ble_broadcast_air_time_us(BLE_BROADCAST_ADV_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(352, ble_broadcast_air_time_us(BLE_BROADCAST_ADV_SIZE_ENCRYPT));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_encode_layout);
+    RUN_TEST(test_encode_clamps_and_rounds);
+    RUN_TEST(test_encode_encrypted);
+    RUN_TEST(test_update_on_change_only);
+    RUN_TEST(test_counter_resumes_after_reserved_block);
+    RUN_TEST(test_air_time);
+    return UNITY_END();
+}
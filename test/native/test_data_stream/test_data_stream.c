@@ -0,0 +1,123 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "data_stream.h"
+
+void test_crc16_check_value(void)
+{
+    const char *check = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, data_stream_crc16((const uint8_t *)check, strlen(check)));
+}
+
+void test_encode_sample_layout(void)
+{
+    meteo_frame_t frame = {
+        .sequence = 0x01020304,
+        .timestamp_us = 0x1122334455667788LL,
+        .temperature_degc = 21.5f,
+        .pressure_pa = 101325.0f,
+        .humidity_pct = 40.0f,
+        .gas_resistance_ohm = 12000.0f,
+        .raw = {.temp_adc = 0x7FFFF, .press_adc = 0x80000, .hum_adc = 0x6000, .gas_adc = 0x3FF, .gas_range = 5},
+    };
+    uint8_t buffer[DATA_STREAM_SAMPLE_FRAME_SIZE];
+
+    TEST_ASSERT_EQUAL(DATA_STREAM_SAMPLE_FRAME_SIZE, data_stream_encode_sample(&frame, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_HEX8(DATA_STREAM_SYNC_0, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(DATA_STREAM_SYNC_1, buffer[1]);
+    TEST_ASSERT_EQUAL_HEX8(DATA_STREAM_TYPE_SAMPLE, buffer[2]);
+    TEST_ASSERT_EQUAL(DATA_STREAM_SAMPLE_PAYLOAD_SIZE, buffer[3]);
+
+    // Sequence and timestamp are little endian
+    const uint8_t expected_head[] = {0x04, 0x03, 0x02, 0x01, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_head, &buffer[4], sizeof(expected_head));
+
+    float temperature;
+    memcpy(&temperature, &buffer[4 + 26], sizeof(temperature));
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, temperature);
+
+    uint16_t crc = data_stream_crc16(&buffer[2], DATA_STREAM_SAMPLE_FRAME_SIZE - 4);
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)crc, buffer[DATA_STREAM_SAMPLE_FRAME_SIZE - 2]);
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)(crc >> 8), buffer[DATA_STREAM_SAMPLE_FRAME_SIZE - 1]);
+}
+
+void test_encode_sample_buffer_too_small(void)
+{
+    meteo_frame_t frame = {0};
+    uint8_t       buffer[DATA_STREAM_SAMPLE_FRAME_SIZE - 1];
+    TEST_ASSERT_EQUAL(0, data_stream_encode_sample(&frame, buffer, sizeof(buffer)));
+}
+
+void test_encode_alert_layout(void)
+{
+    meteo_frame_t frame = {.sequence = 7, .timestamp_us = 1000000};
+    uint8_t       buffer[DATA_STREAM_ALERT_FRAME_SIZE];
+    size_t        length = data_stream_encode_alert(&frame, 0x05, 0x04, buffer, sizeof(buffer));
+
+    TEST_ASSERT_EQUAL(DATA_STREAM_ALERT_FRAME_SIZE, length);
+    TEST_ASSERT_EQUAL_HEX8(DATA_STREAM_TYPE_ALERT, buffer[2]);
+    TEST_ASSERT_EQUAL(DATA_STREAM_ALERT_PAYLOAD_SIZE, buffer[3]);
+    TEST_ASSERT_EQUAL_HEX8(7, buffer[4]);
+    TEST_ASSERT_EQUAL_HEX8(0x40, buffer[4 + 4]); // 1000000 = 0x0F4240, little endian
+    TEST_ASSERT_EQUAL_HEX8(0x05, buffer[4 + 12]);
+    TEST_ASSERT_EQUAL_HEX8(0x04, buffer[4 + 13]);
+
+    uint16_t crc = data_stream_crc16(&buffer[2], DATA_STREAM_ALERT_FRAME_SIZE - 4);
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)crc, buffer[DATA_STREAM_ALERT_FRAME_SIZE - 2]);
+    TEST_ASSERT_EQUAL(0, data_stream_encode_alert(&frame, 0, 0, buffer, sizeof(buffer) - 1));
+}
+
+void test_encode_time_layout(void)
+{
+    const int64_t mono_us = 0x0102030405LL;
+    const int64_t utc_us = 1767225600LL * 1000000; // 2026-01-01T00:00:00Z
+    uint8_t       buffer[DATA_STREAM_TIME_FRAME_SIZE];
+
+    TEST_ASSERT_EQUAL(DATA_STREAM_TIME_FRAME_SIZE, data_stream_encode_time(mono_us, utc_us, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_HEX8(DATA_STREAM_TYPE_TIME, buffer[2]);
+    TEST_ASSERT_EQUAL(DATA_STREAM_TIME_PAYLOAD_SIZE, buffer[3]);
+    int64_t decoded_mono_us = 0, decoded_utc_us = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        decoded_mono_us |= (int64_t)buffer[4 + i] << (8 * i);
+        decoded_utc_us |= (int64_t)buffer[12 + i] << (8 * i);
+    }
+    TEST_ASSERT_EQUAL_INT64(mono_us, decoded_mono_us);
+    TEST_ASSERT_EQUAL_INT64(utc_us, decoded_utc_us);
+
+    uint16_t crc = data_stream_crc16(&buffer[2], DATA_STREAM_TIME_FRAME_SIZE - 4);
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)crc, buffer[DATA_STREAM_TIME_FRAME_SIZE - 2]);
+    TEST_ASSERT_EQUAL(0, data_stream_encode_time(mono_us, utc_us, buffer, sizeof(buffer) - 1));
+}
+
+void test_count_frames_sent(void)
+{
+    meteo_frame_t frame = {.sequence = 1};
+    uint8_t       buffer[DATA_STREAM_SAMPLE_FRAME_SIZE + DATA_STREAM_ALERT_FRAME_SIZE + DATA_STREAM_TIME_FRAME_SIZE];
+    size_t        length = data_stream_encode_sample(&frame, buffer, sizeof(buffer));
+    length += data_stream_encode_alert(&frame, 1, 1, &buffer[length], sizeof(buffer) - length);
+    length += data_stream_encode_time(0, 0, &buffer[length], sizeof(buffer) - length);
+    TEST_ASSERT_EQUAL(sizeof(buffer), length);
+
+    TEST_ASSERT_EQUAL(3, data_stream_count_frames(buffer, length));
+    TEST_ASSERT_EQUAL(0, data_stream_count_frames(buffer, 0));
+    TEST_ASSERT_EQUAL(0, data_stream_count_frames(buffer, DATA_STREAM_SAMPLE_FRAME_SIZE - 1));
+    TEST_ASSERT_EQUAL(1, data_stream_count_frames(buffer, DATA_STREAM_SAMPLE_FRAME_SIZE));
+    TEST_ASSERT_EQUAL(1, data_stream_count_frames(buffer, DATA_STREAM_SAMPLE_FRAME_SIZE + 2));
+    TEST_ASSERT_EQUAL(2, data_stream_count_frames(buffer, length - 1));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_encode_sample_layout);
+    RUN_TEST(test_encode_sample_buffer_too_small);
+    RUN_TEST(test_encode_alert_layout);
+    RUN_TEST(test_encode_time_layout);
+    RUN_TEST(test_count_frames_sent);
+
+    return UNITY_END();
+}
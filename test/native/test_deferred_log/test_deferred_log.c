@@ -0,0 +1,89 @@
+#include <unity.h>
+
+#include "deferred_log.h"
+
+void setUp(void)
+{
+    deferred_log_init();
+}
+
+void tearDown(void) { }
+
+void test_read_empty_ring(void)
+{
+    deferred_log_record_t record;
+    TEST_ASSERT_FALSE(deferred_log_read(&record));
+}
+
+void test_write_then_read_keeps_raw_args(void)
+{
+    DLOG(DLOG_FMT_AMBIENT_SAMPLE, DLOG_ARG_F(21.5f), DLOG_ARG_F(1013.2f), DLOG_ARG_F(45.0f), DLOG_ARG_F(0.12f));
+
+    deferred_log_record_t record;
+    TEST_ASSERT_TRUE(deferred_log_read(&record));
+    TEST_ASSERT_EQUAL(DLOG_FMT_AMBIENT_SAMPLE, record.fmt_id);
+    TEST_ASSERT_EQUAL(4, record.n_args);
+    TEST_ASSERT_EQUAL_HEX32(DLOG_ARG_F(21.5f), record.args[0]);
+    TEST_ASSERT_FALSE(deferred_log_read(&record));
+}
+
+void test_full_ring_drops_and_counts(void)
+{
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        if (deferred_log_write(DLOG_FMT_AMBIENT_LOG_COST, 1, &i)) written++;
+    }
+    TEST_ASSERT_EQUAL(1000 - written, deferred_log_dropped_count());
+
+    // Records come out in order and the ring accepts new ones once drained
+    deferred_log_record_t record;
+    for (uint32_t i = 0; i < written; i++)
+    {
+        TEST_ASSERT_TRUE(deferred_log_read(&record));
+        TEST_ASSERT_EQUAL(i, record.args[0]);
+    }
+    TEST_ASSERT_FALSE(deferred_log_read(&record));
+    TEST_ASSERT_TRUE(deferred_log_write(DLOG_FMT_AMBIENT_LOG_COST, 1, &written));
+}
+
+void test_format_sample(void)
+{
+    DLOG(DLOG_FMT_AMBIENT_SAMPLE, DLOG_ARG_F(-3.25f), DLOG_ARG_F(1001.37f), DLOG_ARG_F(55.55f), DLOG_ARG_F(1.234f));
+
+    deferred_log_record_t record;
+    char                  line[160];
+    TEST_ASSERT_TRUE(deferred_log_read(&record));
+    deferred_log_format(&record, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("Temperature: -3.2°C, Pressure: 1001.4hPa, Humidity: 55.5%, Gas Resistance: 1.23MOhms.",
+                             line);
+}
+
+void test_format_integers_and_truncation(void)
+{
+    DLOG(DLOG_FMT_AMBIENT_LOG_COST, DLOG_ARG_U(120), DLOG_ARG_U(4000000000u), DLOG_ARG_U(7));
+
+    deferred_log_record_t record;
+    char                  line[160];
+    TEST_ASSERT_TRUE(deferred_log_read(&record));
+    deferred_log_format(&record, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("Sample log call cost: last 120, max 4000000000, avg 7 cycles", line);
+
+    char   small[12];
+    size_t length = deferred_log_format(&record, small, sizeof(small));
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, length);
+    TEST_ASSERT_EQUAL_STRING("Sample log ", small);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_read_empty_ring);
+    RUN_TEST(test_write_then_read_keeps_raw_args);
+    RUN_TEST(test_full_ring_drops_and_counts);
+    RUN_TEST(test_format_sample);
+    RUN_TEST(test_format_integers_and_truncation);
+
+    return UNITY_END();
+}
@@ -0,0 +1,259 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display_policy.h"
+#include "mono_ui.h"
+#include "ssd1306_emu.h"
+
+#define SECOND_US 1000000LL
+#define MINUTE_US (60 * SECOND_US)
+#define HOUR_US   (60 * MINUTE_US)
+
+// NOTE: Panel current estimate. The SSD1306 logic and charge pump draw about 0.5 mA when the display is on and 10 uA
+// in sleep mode (display off), each lit pixel the segment current set by the contrast: about 30 mA for the whole
+// panel lit at contrast 0xFF on a 0.96" module.
+#define PANEL_ON_UA      500.0
+#define PANEL_SLEEP_UA   10.0
+#define PANEL_ALL_LIT_UA 30000.0
+#define PANEL_N_PIXELS   (SSD1306_EMU_WIDTH * SSD1306_EMU_HEIGHT)
+
+static const display_policy_config_t s_config = {
+    .dim_after_us = 60 * SECOND_US,
+    .off_after_us = 5 * MINUTE_US,
+    .dim_contrast = 0x08,
+    .wake_temp_degc = 0.5f,
+    .wake_humid_pct = 3.0f,
+    .wake_press_kpa = 0.2f,
+};
+
+static display_policy_t s_policy;
+
+void setUp(void)
+{
+    display_policy_init(&s_policy, &s_config, 0);
+}
+
+void tearDown(void)
+{
+}
+
+static lcd_variables_t vars_of(float temp_degc, float humid_pct, float press_kpa, int32_t alerts)
+{
+    return (lcd_variables_t){
+        .amb_temp_degc = temp_degc, .amb_humid_pct = humid_pct, .amb_press_kpa = press_kpa, .active_alerts = alerts};
+}
+
+void test_dim_then_off_without_activity(void)
+{
+    lcd_variables_t vars = vars_of(NAN, NAN, NAN, 0);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, 0, &vars));
+
+    // The first measurement is an activity, the noise around it is not
+    vars = vars_of(21.0f, 45.0f, 101.3f, 0);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, 30 * SECOND_US, &vars));
+    vars = vars_of(21.4f, 46.0f, 101.4f, 0);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, 89 * SECOND_US, &vars));
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_DIM, display_policy_update(&s_policy, 90 * SECOND_US, &vars));
+    TEST_ASSERT_EQUAL_UINT8(0x08, display_policy_contrast(&s_policy, DISPLAY_POLICY_DIM));
+    TEST_ASSERT_EQUAL_UINT8(DISPLAY_POLICY_CONTRAST_FULL, display_policy_contrast(&s_policy, DISPLAY_POLICY_ON));
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_DIM, display_policy_update(&s_policy, 329 * SECOND_US, &vars));
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, 330 * SECOND_US, &vars));
+
+    // A value lost is not an activity, the change is measured from the value at the last activity
+    vars = vars_of(NAN, 46.0f, 101.4f, 0);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, 400 * SECOND_US, &vars));
+    vars = vars_of(20.6f, 47.9f, 101.49f, 0);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, 410 * SECOND_US, &vars));
+    TEST_ASSERT_EQUAL_UINT32(0, s_policy.n_wakes);
+}
+
+void test_wake_on_change(void)
+{
+    const lcd_variables_t changes[] = {
+        vars_of(20.5f, 45.0f, 101.3f, 0),
+        vars_of(21.0f, 42.0f, 101.3f, 0),
+        vars_of(21.0f, 45.0f, 101.6f, 0),
+    };
+    for (uint8_t i = 0; i < sizeof(changes) / sizeof(changes[0]); i++)
+    {
+        display_policy_init(&s_policy, &s_config, 0);
+        lcd_variables_t vars = vars_of(21.0f, 45.0f, 101.3f, 0);
+        display_policy_update(&s_policy, 0, &vars);
+        TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, HOUR_US, &vars));
+        TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, HOUR_US + SECOND_US, &changes[i]));
+        TEST_ASSERT_EQUAL_UINT32(1, s_policy.n_wakes);
+        TEST_ASSERT_EQUAL(DISPLAY_POLICY_DIM, display_policy_update(&s_policy, HOUR_US + 61 * SECOND_US, &changes[i]));
+    }
+}
+
+void test_wake_on_alert(void)
+{
+    lcd_variables_t vars = vars_of(1.0f, 45.0f, 101.3f, 0);
+    display_policy_update(&s_policy, 0, &vars);
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, HOUR_US, &vars));
+
+    // Raised: full contrast, then dim but never off while it is active
+    vars.active_alerts = 0x1;
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, HOUR_US + SECOND_US, &vars));
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_DIM, display_policy_update(&s_policy, 2 * HOUR_US, &vars));
+    // Another one raised
+    vars.active_alerts = 0x5;
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_ON, display_policy_update(&s_policy, 2 * HOUR_US + SECOND_US, &vars));
+    vars.active_alerts = 0x4;
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_DIM, display_policy_update(&s_policy, 3 * HOUR_US, &vars));
+    // Cleared: off, it was idle long enough
+    vars.active_alerts = 0;
+    TEST_ASSERT_EQUAL(DISPLAY_POLICY_OFF, display_policy_update(&s_policy, 3 * HOUR_US + SECOND_US, &vars));
+    TEST_ASSERT_EQUAL_UINT32(1, s_policy.n_wakes);
+}
+
+// Day of an indoor station: daily temperature, humidity and pressure swings with sensor noise, a window opened in the
+// morning and a frost alert in the afternoon. One UI tick per measurement (1 s), the station LED toggling each second
+// as on the board, through the SSD1306 driver model.
+typedef struct
+{
+    ssd1306_emu_t emu;
+    mono_ui_t     ui;
+    uint64_t      n_bytes;
+    double        charge_uas;     //< Panel current integrated over the day
+    uint32_t      n_event_misses; //< Event ticks with the panel not at full contrast
+} sim_display_t;
+
+static double sim_uniform(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+static lcd_variables_t sim_vars_at(int64_t t_us)
+{
+    double  day = (double)t_us / (double)(24 * HOUR_US);
+    double  temp = 21.0 - 1.5 * cos(2.0 * M_PI * day) + 0.05 * (sim_uniform() - 0.5);
+    double  humid = 45.0 + 4.0 * cos(2.0 * M_PI * day) + 0.3 * (sim_uniform() - 0.5);
+    double  press = 101.3 + 0.2 * sin(2.0 * M_PI * day) + 0.005 * (sim_uniform() - 0.5);
+    int32_t alerts = 0;
+    if (t_us >= 8 * HOUR_US && t_us < 8 * HOUR_US + 20 * MINUTE_US) temp -= 3.0; // Window opened
+    if (t_us >= 15 * HOUR_US && t_us < 15 * HOUR_US + 30 * MINUTE_US) alerts = 0x1;
+    return vars_of((float)temp, (float)humid, (float)press, alerts);
+}
+
+static bool sim_is_event(int64_t t_us)
+{
+    return t_us == 8 * HOUR_US + SECOND_US || t_us == 15 * HOUR_US + SECOND_US;
+}
+
+static void sim_command(sim_display_t *display, const uint8_t *bytes, size_t length)
+{
+    ssd1306_emu_transfer(&display->emu, bytes, length);
+}
+
+static double sim_panel_current_ua(const ssd1306_emu_t *emu)
+{
+    if (!emu->is_on) return PANEL_SLEEP_UA;
+    uint32_t n_lit = 0;
+    for (int16_t y = 0; y < SSD1306_EMU_HEIGHT; y++)
+    {
+        for (int16_t x = 0; x < SSD1306_EMU_WIDTH; x++) n_lit += ssd1306_emu_get_pixel(emu, x, y);
+    }
+    return PANEL_ON_UA + PANEL_ALL_LIT_UA * n_lit / PANEL_N_PIXELS * (emu->contrast + 1) / 256.0;
+}
+
+static uint64_t sim_bus_bytes(ssd1306_emu_t *emu)
+{
+    ssd1306_emu_stats_t stats;
+    ssd1306_emu_take_stats(emu, &stats);
+    return (uint64_t)stats.n_transfers + stats.n_control_bytes + stats.n_command_bytes + stats.n_data_bytes;
+}
+
+static void sim_day(bool is_policy, sim_display_t *display)
+{
+    srand(7);
+    memset(display, 0, sizeof(*display));
+    ssd1306_emu_init(&display->emu);
+    ssd1306_emu_panel_init(&display->emu);
+    mono_ui_init(&display->ui);
+    display_policy_init(&s_policy, &s_config, 0);
+    sim_bus_bytes(&display->emu); // The init is the same for both
+
+    display_policy_state_t applied = DISPLAY_POLICY_ON;
+    double                 current_ua = 0.0;
+    for (int64_t t_us = 0; t_us < 24 * HOUR_US; t_us += SECOND_US)
+    {
+        lcd_variables_t        vars = sim_vars_at(t_us);
+        display_policy_state_t state = is_policy ? display_policy_update(&s_policy, t_us, &vars) : DISPLAY_POLICY_ON;
+        bool                   is_changed = (state != applied);
+        if (is_changed)
+        {
+            if (state == DISPLAY_POLICY_OFF)
+            {
+                sim_command(display, (const uint8_t[]){0x00, 0xAE}, 2);
+            }
+            else
+            {
+                if (applied == DISPLAY_POLICY_OFF) sim_command(display, (const uint8_t[]){0x00, 0xAF}, 2);
+                uint8_t contrast = display_policy_contrast(&s_policy, state);
+                sim_command(display, (const uint8_t[]){0x00, DISPLAY_POLICY_CMD_CONTRAST, contrast}, 3);
+            }
+            applied = state;
+        }
+        const mono_ui_values_t values = {
+            .amb_temp_degc = vars.amb_temp_degc,
+            .amb_humid_pct = vars.amb_humid_pct,
+            .amb_press_kpa = vars.amb_press_kpa,
+            .is_amb_temp_negative = vars.amb_temp_degc < 0.0f,
+            .is_station_connected = (t_us / SECOND_US) % 2 == 0,
+            .alert_name = (vars.active_alerts != 0) ? "Frost" : NULL,
+        };
+        mono_ui_update(&display->ui, &values);
+        // Off: the framebuffer keeps the changes, sent at the wake
+        if (applied != DISPLAY_POLICY_OFF) mono_fb_flush(&display->ui.fb, ssd1306_emu_write_page, &display->emu);
+
+        if (sim_is_event(t_us) && applied != DISPLAY_POLICY_ON) display->n_event_misses++;
+        // The lit pixels barely change between two frames, recounted once a minute and at each state change
+        if (t_us % MINUTE_US == 0 || is_changed)
+        {
+            current_ua = sim_panel_current_ua(&display->emu);
+        }
+        display->charge_uas += current_ua;
+    }
+    display->n_bytes = sim_bus_bytes(&display->emu);
+}
+
+void test_day_simulation(void)
+{
+    static sim_display_t always_on, policy;
+    sim_day(false, &always_on);
+    sim_day(true, &policy);
+
+    double always_on_ua = always_on.charge_uas / (24 * 3600);
+    double policy_ua = policy.charge_uas / (24 * 3600);
+    printf("Always on:  %7.0f bus bytes/h, panel %.2f mA\n", always_on.n_bytes / 24.0, always_on_ua / 1000.0);
+    printf("Policy:     %7.0f bus bytes/h, panel %.2f mA, %lu wakes\n",
+           policy.n_bytes / 24.0,
+           policy_ua / 1000.0,
+           (unsigned long)s_policy.n_wakes);
+    printf("Saved:      %7.0f bus bytes/h (%.0f %%), %.2f mAh/h (%.0f %%)\n",
+           (always_on.n_bytes - policy.n_bytes) / 24.0,
+           100.0 * (always_on.n_bytes - policy.n_bytes) / always_on.n_bytes,
+           (always_on_ua - policy_ua) / 1000.0,
+           100.0 * (always_on_ua - policy_ua) / always_on_ua);
+
+    TEST_ASSERT_EQUAL_UINT32(0, always_on.n_event_misses);
+    TEST_ASSERT_EQUAL_UINT32(0, policy.n_event_misses);
+    TEST_ASSERT_TRUE(s_policy.n_wakes >= 2);
+    TEST_ASSERT_TRUE(policy.n_bytes * 2 < always_on.n_bytes);
+    TEST_ASSERT_TRUE(policy_ua * 2 < always_on_ua);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dim_then_off_without_activity);
+    RUN_TEST(test_wake_on_change);
+    RUN_TEST(test_wake_on_alert);
+    RUN_TEST(test_day_simulation);
+    return UNITY_END();
+}
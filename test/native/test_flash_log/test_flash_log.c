@@ -0,0 +1,336 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "flash_log.h"
+
+#define SECOND_US     1000000LL
+#define BENCH_QUERIES 200U
+
+// NOR flash image in RAM: a write can only clear bits, an erase sets whole sectors back to 0xFF
+typedef struct
+{
+    uint8_t *data;
+    uint32_t size;
+    uint32_t n_erases;
+} nor_image_t;
+
+static nor_image_t    s_image;
+static flash_log_io_t s_io;
+static flash_log_t    s_log;
+
+static bool nor_read(void *ctx, uint32_t offset, void *data, size_t size)
+{
+    nor_image_t *image = ctx;
+    if (offset + size > image->size) return false;
+    memcpy(data, &image->data[offset], size);
+    return true;
+}
+
+static bool nor_write(void *ctx, uint32_t offset, const void *data, size_t size)
+{
+    nor_image_t   *image = ctx;
+    const uint8_t *src = data;
+    if (offset + size > image->size) return false;
+    for (size_t i = 0; i < size; i++) image->data[offset + i] &= src[i];
+    return true;
+}
+
+static bool nor_erase(void *ctx, uint32_t offset, size_t size)
+{
+    nor_image_t *image = ctx;
+    if (offset % FLASH_LOG_SECTOR_SIZE != 0 || size % FLASH_LOG_SECTOR_SIZE != 0 || offset + size > image->size)
+    {
+        return false;
+    }
+    memset(&image->data[offset], 0xFF, size);
+    image->n_erases += (uint32_t)(size / FLASH_LOG_SECTOR_SIZE);
+    return true;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    free(s_image.data);
+    memset(&s_image, 0, sizeof(s_image));
+}
+
+static void init_image(uint32_t n_sectors)
+{
+    s_image.size = n_sectors * FLASH_LOG_SECTOR_SIZE;
+    s_image.data = malloc(s_image.size);
+    memset(s_image.data, 0xA5, s_image.size); // Never erased
+    s_io = (flash_log_io_t){.read = nor_read, .write = nor_write, .erase = nor_erase, .ctx = &s_image};
+    s_io.size = s_image.size;
+    TEST_ASSERT_TRUE(flash_log_format(&s_log, &s_io));
+}
+
+// Slow weather like signals, values as stored (packed resolution)
+static void sample_at(int64_t timestamp_us, float values[HISTORY_N_CHANNELS])
+{
+    double t_h = (double)timestamp_us / (3600.0 * SECOND_US);
+    values[HISTORY_CH_TEMP] = roundf((float)(1500.0 + 800.0 * sin(t_h * 0.2618) + 300.0 * sin(t_h * 0.037))) * 0.01f;
+    values[HISTORY_CH_PRESS] = roundf((float)(101300.0 + 1500.0 * sin(t_h * 0.011)));
+    values[HISTORY_CH_HUMID] = roundf((float)(5500.0 - 2000.0 * sin(t_h * 0.2618))) * 0.01f;
+}
+
+typedef struct
+{
+    int64_t  first_us;
+    int64_t  last_us;
+    uint32_t n_samples;
+    float    temp_sum;
+} read_ctx_t;
+
+static void count_sample(void *ctx, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS])
+{
+    read_ctx_t *read = ctx;
+    if (read->n_samples == 0) read->first_us = timestamp_us;
+    TEST_ASSERT_TRUE(timestamp_us >= read->last_us);
+    float expected[HISTORY_N_CHANNELS];
+    sample_at(timestamp_us, expected);
+    TEST_ASSERT_FLOAT_WITHIN(0.006f, expected[HISTORY_CH_TEMP], values[HISTORY_CH_TEMP]);
+    TEST_ASSERT_FLOAT_WITHIN(0.6f, expected[HISTORY_CH_PRESS], values[HISTORY_CH_PRESS]);
+    TEST_ASSERT_FLOAT_WITHIN(0.006f, expected[HISTORY_CH_HUMID], values[HISTORY_CH_HUMID]);
+    read->last_us = timestamp_us;
+    read->n_samples++;
+    read->temp_sum += values[HISTORY_CH_TEMP];
+}
+
+static uint32_t fill(int64_t start_us, int64_t period_us, uint32_t n_samples)
+{
+    uint32_t n_appended = 0;
+    for (uint32_t i = 0; i < n_samples; i++)
+    {
+        float values[HISTORY_N_CHANNELS];
+        sample_at(start_us + i * period_us, values);
+        n_appended += flash_log_append(&s_log, start_us + i * period_us, values);
+    }
+    return n_appended;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void test_append_and_remount(void)
+{
+    init_image(8);
+    TEST_ASSERT_EQUAL_UINT32(0, s_log.n_used);
+    TEST_ASSERT_EQUAL_UINT32(0, flash_log_read(&s_log, 0, INT64_MAX, count_sample, &(read_ctx_t){0}));
+
+    // Less than a sector, then remounted as after a reset: the open sector is replayed from its records
+    TEST_ASSERT_EQUAL_UINT32(300, fill(1000 * SECOND_US, 60 * SECOND_US, 300));
+    flash_log_t before = s_log;
+    TEST_ASSERT_TRUE(flash_log_mount(&s_log, &s_io));
+    TEST_ASSERT_TRUE(s_log.is_open);
+    TEST_ASSERT_EQUAL_UINT32(1, s_log.n_used);
+    TEST_ASSERT_EQUAL_UINT32(before.write_offset, s_log.write_offset);
+    TEST_ASSERT_EQUAL_INT64(before.last_us, s_log.last_us);
+    TEST_ASSERT_EQUAL_UINT32(300, s_log.n_samples);
+    TEST_ASSERT_EQUAL_MEMORY(before.summary, s_log.summary, sizeof(before.summary));
+
+    // Older samples are rejected, NaN stored as missing
+    float values[HISTORY_N_CHANNELS] = {20.0f, NAN, 50.0f};
+    TEST_ASSERT_FALSE(flash_log_append(&s_log, 0, values));
+    TEST_ASSERT_EQUAL_UINT32(1, s_log.n_rejected);
+    int64_t last_us = s_log.last_us;
+    TEST_ASSERT_TRUE(flash_log_append(&s_log, last_us + 60 * SECOND_US, values));
+    history_aggregate_t aggregate;
+    TEST_ASSERT_TRUE(flash_log_aggregate(&s_log, HISTORY_CH_PRESS, last_us + 1, INT64_MAX, &aggregate) == false);
+    TEST_ASSERT_TRUE(flash_log_aggregate(&s_log, HISTORY_CH_TEMP, last_us + 1, INT64_MAX, &aggregate));
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, aggregate.max);
+
+    // Across sectors and another remount after the sector was closed
+    TEST_ASSERT_EQUAL_UINT32(2000, fill(last_us + 120 * SECOND_US, 60 * SECOND_US, 2000));
+    TEST_ASSERT_TRUE(s_log.n_used > 2);
+    before = s_log;
+    TEST_ASSERT_TRUE(flash_log_mount(&s_log, &s_io));
+    TEST_ASSERT_EQUAL_UINT32(before.n_used, s_log.n_used);
+    TEST_ASSERT_EQUAL_UINT32(before.next_seq, s_log.next_seq);
+    TEST_ASSERT_EQUAL_INT64(before.last_us, s_log.last_us);
+
+    read_ctx_t read = {0};
+    TEST_ASSERT_EQUAL_UINT32(300, flash_log_read(&s_log, 1000 * SECOND_US, last_us + 1, count_sample, &read));
+    TEST_ASSERT_EQUAL_INT64(last_us, read.last_us);
+    read = (read_ctx_t){0};
+    TEST_ASSERT_EQUAL_UINT32(2000, flash_log_read(&s_log, last_us + 61 * SECOND_US, INT64_MAX, count_sample, &read));
+    TEST_ASSERT_EQUAL_INT64(before.last_us, read.last_us);
+}
+
+void test_wrap_matches_decoded(void)
+{
+    init_image(16);
+    srand(11);
+    int64_t  t_us = 5 * SECOND_US;
+    uint32_t n_samples = 0;
+    while (s_image.n_erases < 16 + 40) // The ring wrapped a few times
+    {
+        float values[HISTORY_N_CHANNELS];
+        t_us += (rand() % 4 == 0) ? (int64_t)(rand() % 3600) * SECOND_US : 30 * SECOND_US; // Gaps
+        sample_at(t_us, values);
+        TEST_ASSERT_TRUE(flash_log_append(&s_log, t_us, values));
+        n_samples++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(16, s_log.n_used);
+    TEST_ASSERT_TRUE(flash_log_mount(&s_log, &s_io));
+    TEST_ASSERT_EQUAL_UINT32(16, s_log.n_used);
+
+    // Everything still held is read back in order, the oldest samples were dropped
+    read_ctx_t all = {0};
+    uint32_t   n_held = flash_log_read(&s_log, INT64_MIN, INT64_MAX, count_sample, &all);
+    TEST_ASSERT_TRUE(n_held > 0 && n_held < n_samples);
+    TEST_ASSERT_EQUAL_INT64(t_us, all.last_us);
+
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        int64_t start_us = all.first_us - 3600 * SECOND_US + (int64_t)(rand() % 200000) * 10 * SECOND_US;
+        int64_t end_us = start_us + (int64_t)(rand() % 100000) * 10 * SECOND_US;
+        // Reference: every sample of the range decoded
+        read_ctx_t          read = {0};
+        history_aggregate_t aggregate;
+        uint32_t            n_read = flash_log_read(&s_log, start_us, end_us, count_sample, &read);
+        bool is_found = flash_log_aggregate(&s_log, HISTORY_CH_TEMP, start_us, end_us, &aggregate);
+        TEST_ASSERT_EQUAL(n_read > 0, is_found);
+        TEST_ASSERT_EQUAL_UINT32(n_read, aggregate.n_samples);
+        if (!is_found) continue;
+        TEST_ASSERT_TRUE(read.first_us >= start_us && read.last_us < end_us);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, read.temp_sum / (float)n_read, aggregate.mean);
+    }
+}
+
+// Header of the sector at the logical index, for the linear seek reference
+static int64_t sector_start_us(uint32_t index)
+{
+    uint8_t  header[FLASH_LOG_HEADER_SIZE];
+    uint32_t sector = (s_log.oldest + index) % s_log.n_sectors;
+    s_log.n_reads++;
+    s_log.n_bytes_read += sizeof(header);
+    s_io.read(s_io.ctx, sector * FLASH_LOG_SECTOR_SIZE, header, sizeof(header));
+    int64_t start_us;
+    memcpy(&start_us, &header[8], sizeof(start_us));
+    return start_us;
+}
+
+// Reference seek: walk back the sector headers from the newest one
+static uint32_t linear_seek(int64_t timestamp_us)
+{
+    uint32_t index = s_log.n_used - 1U;
+    while (index > 0 && sector_start_us(index) > timestamp_us) index--;
+    return index;
+}
+
+static void decoded_sum(void *ctx, int64_t timestamp_us, const float values[HISTORY_N_CHANNELS])
+{
+    *(double *)ctx += values[HISTORY_CH_TEMP];
+}
+
+// 300 days of one sample every 30 s in a 4 MB partition (wrapped): seeks against a linear walk of the headers, and
+// aggregates from the sector summaries against decoding every sample of the range
+void test_bench_months_seek(void)
+{
+    init_image(1024);
+    const int64_t period_us = 30 * SECOND_US;
+    const int64_t start_us = 1700000000LL * SECOND_US;
+    const int64_t n_samples = 300LL * 86400LL * SECOND_US / period_us;
+    double        bench_start_s = now_s();
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)n_samples, fill(start_us, period_us, (uint32_t)n_samples));
+    int64_t end_us = start_us + n_samples * period_us;
+    read_ctx_t all = {0};
+    TEST_ASSERT_TRUE(flash_log_mount(&s_log, &s_io));
+    uint32_t n_held = flash_log_read(&s_log, INT64_MIN, INT64_MAX, count_sample, &all);
+    printf("Log of %u sectors: %u of %lld samples held (%.1f days), %.2f bytes per sample, filled in %.2f s\n",
+           (unsigned)s_log.n_sectors,
+           (unsigned)n_held,
+           (long long)n_samples,
+           (double)(end_us - all.first_us) / (86400.0 * SECOND_US),
+           (double)(s_log.n_used * (FLASH_LOG_FOOTER_OFFSET - FLASH_LOG_HEADER_SIZE)) / n_held,
+           now_s() - bench_start_s);
+
+    srand(3);
+    int64_t targets[BENCH_QUERIES];
+    for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+    {
+        targets[q] = all.first_us + (int64_t)((double)rand() / RAND_MAX * (double)(end_us - all.first_us));
+    }
+    uint32_t binary_reads = s_log.n_reads, index = 0;
+    double   seek_start_s = now_s();
+    for (uint32_t q = 0; q < BENCH_QUERIES; q++) flash_log_seek(&s_log, targets[q], &index);
+    double   binary_s = now_s() - seek_start_s;
+    binary_reads = s_log.n_reads - binary_reads;
+    uint32_t linear_reads = s_log.n_reads;
+    seek_start_s = now_s();
+    for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+    {
+        TEST_ASSERT_TRUE(flash_log_seek(&s_log, targets[q], &index));
+        TEST_ASSERT_EQUAL_UINT32(linear_seek(targets[q]), index);
+    }
+    double linear_s = now_s() - seek_start_s;
+    linear_reads = s_log.n_reads - linear_reads - binary_reads;
+    TEST_ASSERT_TRUE(binary_reads / BENCH_QUERIES <= 11U);
+    printf("Seek: %.2f header reads and %.2f us, %.1f header reads and %.2f us walking back from the newest\n",
+           (double)binary_reads / BENCH_QUERIES,
+           binary_s * 1e6 / BENCH_QUERIES,
+           (double)linear_reads / BENCH_QUERIES,
+           (linear_s - binary_s) * 1e6 / BENCH_QUERIES);
+
+    const struct
+    {
+        const char *name;
+        int64_t     span_s;
+    } spans[] = {{"day", 86400}, {"week", 7 * 86400}, {"month", 30 * 86400}};
+    for (uint8_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++)
+    {
+        uint64_t summary_bytes = 0, decoded_bytes = 0;
+        double   summary_s = 0.0, decoded_s = 0.0;
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+        {
+            int64_t query_start_us = all.first_us + (int64_t)((double)rand() / RAND_MAX
+                                                              * (double)(end_us - all.first_us - spans[s].span_s));
+            int64_t query_end_us = query_start_us + spans[s].span_s * SECOND_US;
+
+            history_aggregate_t aggregate;
+            uint32_t            n_bytes = s_log.n_bytes_read;
+            double              query_s = now_s();
+            flash_log_aggregate(&s_log, HISTORY_CH_TEMP, query_start_us, query_end_us, &aggregate);
+            summary_s += now_s() - query_s;
+            summary_bytes += s_log.n_bytes_read - n_bytes;
+
+            double sum = 0.0;
+            n_bytes = s_log.n_bytes_read;
+            query_s = now_s();
+            uint32_t n_read = flash_log_read(&s_log, query_start_us, query_end_us, decoded_sum, &sum);
+            decoded_s += now_s() - query_s;
+            decoded_bytes += s_log.n_bytes_read - n_bytes;
+
+            TEST_ASSERT_EQUAL_UINT32(n_read, aggregate.n_samples);
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, (float)(sum / n_read), aggregate.mean);
+        }
+        printf("Aggregate of a %s: %.2f us and %llu bytes read, %.2f us and %llu bytes decoding every sample\n",
+               spans[s].name,
+               summary_s * 1e6 / BENCH_QUERIES,
+               (unsigned long long)(summary_bytes / BENCH_QUERIES),
+               decoded_s * 1e6 / BENCH_QUERIES,
+               (unsigned long long)(decoded_bytes / BENCH_QUERIES));
+        TEST_ASSERT_TRUE(summary_bytes * 2 < decoded_bytes);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_remount);
+    RUN_TEST(test_wrap_matches_decoded);
+    RUN_TEST(test_bench_months_seek);
+    return UNITY_END();
+}
@@ -0,0 +1,243 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "history_store.h"
+
+#define PERIOD_US     1000000LL
+#define CACHE_LINE    32U
+#define WEEK_SAMPLES  (7U * 86400U)
+#define BENCH_QUERIES 1000U
+
+static history_store_t s_store;
+static void           *s_memory = NULL;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+    free(s_memory);
+    s_memory = NULL;
+}
+
+static void init_store(uint32_t capacity)
+{
+    size_t size = history_store_memory_size(capacity);
+    s_memory = malloc(size);
+    TEST_ASSERT_TRUE(history_store_init(&s_store, PERIOD_US, capacity, s_memory, size));
+}
+
+static void add_sample(int64_t timestamp_us, float temp_degc, float press_pa, float humid_pct)
+{
+    const float values[HISTORY_N_CHANNELS] = {temp_degc, press_pa, humid_pct};
+    history_store_add(&s_store, timestamp_us, values);
+}
+
+// Reference aggregate: every column value of the stored slots in the range
+static uint32_t naive_aggregate(history_channel_t channel, int64_t start_us, int64_t end_us, history_aggregate_t *agg)
+{
+    int64_t first_us, stored_end_us;
+    history_store_range(&s_store, &first_us, &stored_end_us);
+    int64_t start = (start_us > first_us ? start_us : first_us) / PERIOD_US;
+    int64_t end = (end_us < stored_end_us ? end_us : stored_end_us) / PERIOD_US;
+    int16_t min = INT16_MAX, max = INT16_MIN;
+    int64_t sum = 0;
+    agg->n_samples = 0;
+    for (int64_t slot = start; slot < end; slot++)
+    {
+        int16_t value = s_store.columns[channel][slot % s_store.capacity];
+        if (value == HISTORY_STORE_INVALID) continue;
+        if (value < min) min = value;
+        if (value > max) max = value;
+        sum += value;
+        agg->n_samples++;
+    }
+    agg->min = history_store_unpack(channel, min);
+    agg->max = history_store_unpack(channel, max);
+    agg->mean = history_store_unpack(channel, 0) + (float)((double)sum / agg->n_samples) * (channel == 1 ? 1 : 0.01f);
+    return (uint32_t)(end > start ? end - start : 0);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void test_period_average_and_gaps(void)
+{
+    init_store(1024);
+    history_aggregate_t aggregate;
+    TEST_ASSERT_FALSE(history_store_range(&s_store, NULL, NULL));
+
+    // 4 samples a second averaged, a missing second, a NaN humidity, then the current period is not stored yet
+    for (int64_t i = 0; i < 4; i++) add_sample(10 * PERIOD_US + i * 250000, 20.0f + i * 0.1f, 101300.0f, 40.0f);
+    add_sample(12 * PERIOD_US, 21.0f, 101250.0f, NAN);
+    add_sample(13 * PERIOD_US, 30.0f, 90000.0f, 90.0f);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, s_store.latest[HISTORY_CH_TEMP]);
+
+    int64_t first_us, end_us;
+    TEST_ASSERT_TRUE(history_store_range(&s_store, &first_us, &end_us));
+    TEST_ASSERT_EQUAL_INT64(10 * PERIOD_US, first_us);
+    TEST_ASSERT_EQUAL_INT64(13 * PERIOD_US, end_us);
+
+    TEST_ASSERT_TRUE(history_store_aggregate(&s_store, HISTORY_CH_TEMP, 0, 100 * PERIOD_US, &aggregate));
+    TEST_ASSERT_EQUAL_UINT32(2, aggregate.n_samples);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 20.15f, aggregate.min);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 21.0f, aggregate.max);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 20.575f, aggregate.mean);
+
+    TEST_ASSERT_TRUE(history_store_aggregate(&s_store, HISTORY_CH_PRESS, 0, 100 * PERIOD_US, &aggregate));
+    TEST_ASSERT_EQUAL_FLOAT(101250.0f, aggregate.min);
+    TEST_ASSERT_TRUE(history_store_aggregate(&s_store, HISTORY_CH_HUMID, 0, 100 * PERIOD_US, &aggregate));
+    TEST_ASSERT_EQUAL_UINT32(1, aggregate.n_samples);
+
+    // Range start rounded up to the next period
+    TEST_ASSERT_FALSE(
+        history_store_aggregate(&s_store, HISTORY_CH_TEMP, 10 * PERIOD_US + 1, 12 * PERIOD_US, &aggregate));
+}
+
+void test_matches_scan_after_wrap(void)
+{
+    init_store(1000); // Rounded up to 4 blocks of 256
+    TEST_ASSERT_EQUAL_UINT32(1024, s_store.capacity);
+    srand(42);
+    for (int64_t i = 0; i < 5000; i++)
+    {
+        if (i % 97 == 13) continue; // Gaps
+        add_sample(i * PERIOD_US, 15.0f + 5.0f * sinf((float)i * 0.01f), 101000.0f + (float)(rand() % 500), 55.0f);
+    }
+
+    // The oldest block still whole in the ring
+    int64_t first_us, end_us;
+    history_store_range(&s_store, &first_us, &end_us);
+    TEST_ASSERT_EQUAL_INT64((4999 / 256 - 3) * 256 * PERIOD_US, first_us);
+    TEST_ASSERT_EQUAL_INT64(4999 * PERIOD_US, end_us);
+
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        int64_t             start_us = (int64_t)(rand() % 5200) * PERIOD_US - 100 * PERIOD_US;
+        int64_t             span_us = (int64_t)(rand() % 1200) * PERIOD_US;
+        history_aggregate_t expected, aggregate;
+        naive_aggregate(HISTORY_CH_PRESS, start_us, start_us + span_us, &expected);
+        bool is_found = history_store_aggregate(&s_store, HISTORY_CH_PRESS, start_us, start_us + span_us, &aggregate);
+        TEST_ASSERT_EQUAL_UINT32(expected.n_samples, aggregate.n_samples);
+        TEST_ASSERT_EQUAL(expected.n_samples > 0, is_found);
+        if (!is_found) continue;
+        TEST_ASSERT_EQUAL_FLOAT(expected.min, aggregate.min);
+        TEST_ASSERT_EQUAL_FLOAT(expected.max, aggregate.max);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, expected.mean, aggregate.mean);
+    }
+}
+
+void test_decimate(void)
+{
+    init_store(4096);
+    for (int64_t i = 0; i < 3000; i++)
+    {
+        if (i >= 1000 && i < 1100) continue; // A gap as wide as a bucket
+        add_sample(i * PERIOD_US, (float)i * 0.01f, 100000.0f, 50.0f);
+    }
+
+    minmax_bucket_t buckets[30];
+    uint32_t n_read = history_store_decimate(&s_store, HISTORY_CH_TEMP, 0, 3000 * PERIOD_US, buckets, 30);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, buckets[0].min);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 9.99f, buckets[9].max);
+    TEST_ASSERT_TRUE(minmax_bucket_is_empty(&buckets[10]));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 11.0f, buckets[11].min);
+    // The last period is not stored until a later sample comes
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 29.98f, buckets[29].max);
+    TEST_ASSERT_LESS_THAN_UINT32(3000, n_read);
+}
+
+// A week of 1 s samples, aggregates over an hour, a day and the week at random offsets, against scanning the column
+void test_bench_week_aggregates(void)
+{
+    init_store(WEEK_SAMPLES);
+    for (uint32_t i = 0; i < WEEK_SAMPLES; i++)
+    {
+        add_sample((int64_t)i * PERIOD_US, 20.0f + 8.0f * sinf((float)i * 7.27e-5f), 101325.0f, 50.0f);
+    }
+    add_sample((int64_t)WEEK_SAMPLES * PERIOD_US, 20.0f, 101325.0f, 50.0f);
+    printf("Week store: %u bytes of columns and summaries\n", (unsigned)history_store_memory_size(WEEK_SAMPLES));
+
+    const struct
+    {
+        const char *name;
+        int64_t     span_s;
+    } spans[] = {{"hour", 3600}, {"day", 86400}, {"week", 7 * 86400}};
+    srand(7);
+    for (uint8_t s = 0; s < 3; s++)
+    {
+        int64_t  starts[BENCH_QUERIES];
+        uint64_t n_lines = 0, n_naive_lines = 0;
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+        {
+            int64_t max_start_s = WEEK_SAMPLES - spans[s].span_s;
+            starts[q] = ((max_start_s > 0) ? rand() % max_start_s : 0) * PERIOD_US;
+        }
+
+        history_aggregate_t aggregate, expected;
+        volatile float      sink = 0.0f;
+        double              start_s = now_s();
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+        {
+            history_store_aggregate(
+                &s_store, HISTORY_CH_TEMP, starts[q], starts[q] + spans[s].span_s * PERIOD_US, &aggregate);
+            sink += aggregate.mean;
+            n_lines += (aggregate.n_scanned * sizeof(int16_t) + aggregate.n_summaries * sizeof(history_block_t)
+                        + CACHE_LINE - 1) / CACHE_LINE;
+        }
+        double summary_s = now_s() - start_s;
+
+        start_s = now_s();
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+        {
+            uint32_t n_slots = naive_aggregate(
+                HISTORY_CH_TEMP, starts[q], starts[q] + spans[s].span_s * PERIOD_US, &expected);
+            sink += expected.mean;
+            n_naive_lines += (n_slots * sizeof(int16_t) + CACHE_LINE - 1) / CACHE_LINE;
+        }
+        double naive_s = now_s() - start_s;
+        (void)sink;
+
+        TEST_ASSERT_EQUAL_FLOAT(expected.max, aggregate.max);
+        TEST_ASSERT_TRUE(n_lines * 10 < n_naive_lines);
+        printf("Aggregate of a %s: %.2f us and %llu cache lines, %.2f us and %llu cache lines scanning\n",
+               spans[s].name,
+               summary_s * 1e6 / BENCH_QUERIES,
+               (unsigned long long)(n_lines / BENCH_QUERIES),
+               naive_s * 1e6 / BENCH_QUERIES,
+               (unsigned long long)(n_naive_lines / BENCH_QUERIES));
+    }
+
+    minmax_bucket_t buckets[MINMAX_SERIES_LEN];
+    double          start_s = now_s();
+    uint32_t        n_read = 0;
+    for (uint32_t q = 0; q < 100; q++)
+    {
+        n_read = history_store_decimate(
+            &s_store, HISTORY_CH_TEMP, 0, (int64_t)WEEK_SAMPLES * PERIOD_US, buckets, MINMAX_SERIES_LEN);
+    }
+    printf("Week chart decimation to %u columns: %.2f us, %u values read\n",
+           MINMAX_SERIES_LEN,
+           (now_s() - start_s) * 1e6 / 100,
+           (unsigned)n_read);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 28.0f, buckets[4].max); // Daily sine peak
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_period_average_and_gaps);
+    RUN_TEST(test_matches_scan_after_wrap);
+    RUN_TEST(test_decimate);
+    RUN_TEST(test_bench_week_aggregates);
+    return UNITY_END();
+}
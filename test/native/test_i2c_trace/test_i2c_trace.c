@@ -0,0 +1,240 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "i2c_trace.h"
+#include "meteo_frame.h"
+#include "window_stats.h"
+
+#define BME688_ADDR       0x76
+#define SSD1306_ADDR      0x3C
+#define BME688_CTRL_MEAS  0x74
+#define BME688_FIELD0     0x1D
+#define SAMPLE_PERIOD_US  250000LL
+#define SAMPLES_PER_DAY   (24LL * 3600 * 1000000 / SAMPLE_PERIOD_US)
+
+typedef struct
+{
+    uint8_t *data;
+    size_t   size;
+    size_t   capacity;
+} trace_buffer_t;
+
+static void trace_append(trace_buffer_t *trace, const i2c_trace_record_t *record)
+{
+    if (trace->size + I2C_TRACE_MAX_RECORD_SIZE > trace->capacity)
+    {
+        trace->capacity = (trace->capacity + I2C_TRACE_MAX_RECORD_SIZE) * 2;
+        trace->data = realloc(trace->data, trace->capacity);
+    }
+    trace->size += i2c_trace_encode(record, &trace->data[trace->size], trace->capacity - trace->size);
+}
+
+static void trace_init(trace_buffer_t *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+    trace->capacity = I2C_TRACE_HEADER_SIZE;
+    trace->data = malloc(trace->capacity);
+    trace->size = i2c_trace_encode_header(trace->data, trace->capacity);
+}
+
+// One forced measurement as the BME68x API issues it: the mode write, then the field data read
+static void trace_append_sample(trace_buffer_t *trace, int64_t timestamp_us, uint32_t temp_adc)
+{
+    const uint8_t forced_mode[] = {BME688_CTRL_MEAS, 0x41};
+    const uint8_t field_reg = BME688_FIELD0;
+    uint8_t       field_regs[METEO_RAW_FIELD_REGS_LEN] = {0x80};
+    field_regs[5] = (uint8_t)(temp_adc >> 12);
+    field_regs[6] = (uint8_t)(temp_adc >> 4);
+    field_regs[7] = (uint8_t)(temp_adc << 4);
+
+    const i2c_trace_record_t write = {timestamp_us, I2C_TRACE_WRITE, 0, BME688_ADDR, 2, 0, forced_mode, NULL};
+    const i2c_trace_record_t read = {
+        timestamp_us + 10000, I2C_TRACE_WRITE_READ, 0, BME688_ADDR, 1, sizeof(field_regs), &field_reg, field_regs};
+    trace_append(trace, &write);
+    trace_append(trace, &read);
+}
+
+void test_record_round_trip(void)
+{
+    const uint8_t      write_data[] = {0x1D};
+    const uint8_t      read_data[] = {0x80, 0x00, 0x51, 0x2B};
+    i2c_trace_record_t record = {86400LL * 1000000, I2C_TRACE_WRITE_READ, 0, BME688_ADDR, 1, 4, write_data, read_data};
+    uint8_t            buffer[I2C_TRACE_MAX_RECORD_SIZE];
+
+    size_t size = i2c_trace_encode(&record, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(2 + 6 + 1 + 1 + 1 + 4, size); // A day in us is a 6 bytes varint
+
+    i2c_trace_record_t decoded;
+    TEST_ASSERT_EQUAL(size, i2c_trace_decode(buffer, size, &decoded));
+    TEST_ASSERT_TRUE(decoded.timestamp_us == record.timestamp_us);
+    TEST_ASSERT_EQUAL(I2C_TRACE_WRITE_READ, decoded.kind);
+    TEST_ASSERT_EQUAL_HEX8(BME688_ADDR, decoded.address);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(read_data, decoded.read_data, 4);
+    TEST_ASSERT_EQUAL(0, i2c_trace_decode(buffer, size - 1, &decoded)); // Cut record
+
+    // Long display writes are truncated and flagged
+    static uint8_t page[300];
+    record = (i2c_trace_record_t){0, I2C_TRACE_WRITE, 0, SSD1306_ADDR, sizeof(page), 0, page, NULL};
+    size = i2c_trace_encode(&record, buffer, sizeof(buffer));
+    TEST_ASSERT_LESS_OR_EQUAL(I2C_TRACE_MAX_RECORD_SIZE, size);
+    TEST_ASSERT_EQUAL(size, i2c_trace_decode(buffer, size, &decoded));
+    TEST_ASSERT_EQUAL(I2C_TRACE_MAX_DATA, decoded.write_length);
+    TEST_ASSERT_TRUE(decoded.flags & I2C_TRACE_FLAG_TRUNCATED);
+}
+
+void test_replay_per_device(void)
+{
+    trace_buffer_t trace;
+    trace_init(&trace);
+    const uint8_t            pixels[] = {0xFF, 0x81};
+    const i2c_trace_record_t display = {5, I2C_TRACE_WRITE, 0, SSD1306_ADDR, 2, 0, pixels, NULL};
+    trace_append(&trace, &display);
+    trace_append_sample(&trace, 1000000, 0x7FFFF);
+    trace_append(&trace, &display);
+    trace_append_sample(&trace, 1250000, 0x12345);
+    const uint8_t            field_reg = BME688_FIELD0;
+    const i2c_trace_record_t failed = {1500000, I2C_TRACE_WRITE_READ, I2C_TRACE_FLAG_ERROR, BME688_ADDR, 1, 0, &field_reg, NULL};
+    trace_append(&trace, &failed);
+
+    i2c_trace_replay_t      replay;
+    i2c_trace_bme68x_intf_t intf = {&replay, BME688_ADDR};
+    uint8_t                 regs[METEO_RAW_FIELD_REGS_LEN];
+    meteo_raw_t             raw;
+    const uint8_t           forced_mode = 0x41;
+    TEST_ASSERT_TRUE(i2c_trace_replay_init(&replay, trace.data, trace.size));
+
+    // The display records are skipped, the sensor transactions come back in order with their time
+    TEST_ASSERT_EQUAL(0, i2c_trace_bme68x_write(BME688_CTRL_MEAS, &forced_mode, 1, &intf));
+    TEST_ASSERT_EQUAL(0, i2c_trace_bme68x_read(BME688_FIELD0, regs, sizeof(regs), &intf));
+    meteo_raw_decode(regs, &raw);
+    TEST_ASSERT_EQUAL_HEX32(0x7FFFF, raw.temp_adc);
+    TEST_ASSERT_EQUAL(1010000, (int32_t)i2c_trace_replay_now_us(&replay));
+
+    // A different configuration write is a mismatch
+    const uint8_t sleep_mode = 0x40;
+    TEST_ASSERT_EQUAL(-2, i2c_trace_bme68x_write(BME688_CTRL_MEAS, &sleep_mode, 1, &intf));
+    TEST_ASSERT_EQUAL(1, replay.n_mismatches);
+    TEST_ASSERT_EQUAL(0, i2c_trace_bme68x_read(BME688_FIELD0, regs, sizeof(regs), &intf));
+    meteo_raw_decode(regs, &raw);
+    TEST_ASSERT_EQUAL_HEX32(0x12345, raw.temp_adc);
+
+    // Recorded failure, then the end of the trace
+    TEST_ASSERT_FALSE(i2c_trace_bme68x_read(BME688_FIELD0, regs, 0, &intf) == 0);
+    TEST_ASSERT_TRUE(i2c_trace_replay_is_done(&replay, BME688_ADDR));
+    TEST_ASSERT_FALSE(i2c_trace_bme68x_read(BME688_FIELD0, regs, sizeof(regs), &intf) == 0);
+
+    // The display has its own cursor
+    uint8_t written[2] = {0xFF, 0x81};
+    TEST_ASSERT_FALSE(i2c_trace_replay_is_done(&replay, SSD1306_ADDR));
+    TEST_ASSERT_TRUE(i2c_trace_replay_transfer(&replay, SSD1306_ADDR, written, 2, NULL, 0));
+    free(trace.data);
+}
+
+void test_truncated_write_replays(void)
+{
+    // A write longer than the trace data, recorded as the ambient_sense port does: the whole length is given, the
+    // record keeps its first I2C_TRACE_MAX_DATA bytes and is flagged
+    static uint8_t bus_data[251];
+    for (size_t i = 0; i < sizeof(bus_data); i++) bus_data[i] = (uint8_t)(i * 31U);
+    trace_buffer_t trace;
+    trace_init(&trace);
+    const i2c_trace_record_t write = {1000, I2C_TRACE_WRITE, 0, BME688_ADDR, I2C_TRACE_MAX_DATA + 1, 0, bus_data, NULL};
+    trace_append(&trace, &write);
+    trace_append(&trace, &write);
+
+    i2c_trace_replay_t      replay;
+    i2c_trace_bme68x_intf_t intf = {&replay, BME688_ADDR};
+    TEST_ASSERT_TRUE(i2c_trace_replay_init(&replay, trace.data, trace.size));
+    i2c_trace_record_t decoded;
+    TEST_ASSERT_TRUE(i2c_trace_decode(replay.data, replay.size, &decoded) > 0);
+    TEST_ASSERT_TRUE(decoded.flags & I2C_TRACE_FLAG_TRUNCATED);
+    TEST_ASSERT_EQUAL(I2C_TRACE_MAX_DATA, decoded.write_length);
+
+    // The same write matches on the kept prefix, a write differing in it does not
+    TEST_ASSERT_EQUAL(0, i2c_trace_bme68x_write(bus_data[0], &bus_data[1], sizeof(bus_data) - 1, &intf));
+    bus_data[100] ^= 0xFF;
+    TEST_ASSERT_FALSE(i2c_trace_bme68x_write(bus_data[0], &bus_data[1], sizeof(bus_data) - 1, &intf) == 0);
+    TEST_ASSERT_EQUAL(1, replay.n_mismatches);
+    free(trace.data);
+}
+
+void test_invalid_header(void)
+{
+    i2c_trace_replay_t replay;
+    const uint8_t      not_a_trace[] = {'I', '2', 'C', 'X', 1};
+    TEST_ASSERT_FALSE(i2c_trace_replay_init(&replay, not_a_trace, sizeof(not_a_trace)));
+    TEST_ASSERT_FALSE(i2c_trace_replay_init(&replay, not_a_trace, 3));
+}
+
+// Replay a day of samples through the raw decode and the 24 h statistics, returns the replayed samples
+static uint32_t replay_day(const trace_buffer_t *trace, float *min, float *max)
+{
+    static window_stats_t   stats;
+    i2c_trace_replay_t      replay;
+    i2c_trace_bme68x_intf_t intf = {&replay, BME688_ADDR};
+    uint8_t                 regs[METEO_RAW_FIELD_REGS_LEN];
+    const uint8_t           forced_mode = 0x41;
+    meteo_raw_t             raw;
+    uint32_t                n_samples = 0;
+
+    i2c_trace_replay_init(&replay, trace->data, trace->size);
+    window_stats_init(&stats, 24LL * 3600 * 1000000, WINDOW_STATS_MAX_BUCKETS);
+    while (!i2c_trace_replay_is_done(&replay, BME688_ADDR))
+    {
+        if (i2c_trace_bme68x_write(BME688_CTRL_MEAS, &forced_mode, 1, &intf) != 0) break;
+        i2c_trace_bme68x_delay_us(10000, &intf); // Measurement duration, fast-forwarded
+        if (i2c_trace_bme68x_read(BME688_FIELD0, regs, sizeof(regs), &intf) != 0) break;
+        meteo_raw_decode(regs, &raw);
+        window_stats_add(&stats, i2c_trace_replay_now_us(&replay), (float)raw.temp_adc);
+        n_samples++;
+    }
+    TEST_ASSERT_EQUAL(0, replay.n_mismatches);
+    *min = window_stats_min(&stats);
+    *max = window_stats_max(&stats);
+    return n_samples;
+}
+
+void test_fast_forward_day_is_reproducible(void)
+{
+    trace_buffer_t trace;
+    trace_init(&trace);
+    for (int64_t i = 0; i < SAMPLES_PER_DAY; i++)
+    {
+        // Daily triangle wave with a bit of noise
+        int64_t  phase = i % SAMPLES_PER_DAY;
+        uint32_t wave = (uint32_t)((phase < SAMPLES_PER_DAY / 2) ? phase : SAMPLES_PER_DAY - phase);
+        trace_append_sample(&trace, i * SAMPLE_PERIOD_US, 400000 + wave + (uint32_t)(i * 7919 % 13));
+    }
+
+    float   min_1, max_1, min_2, max_2;
+    clock_t start = clock();
+    TEST_ASSERT_EQUAL(SAMPLES_PER_DAY, replay_day(&trace, &min_1, &max_1));
+    double elapsed_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+    TEST_ASSERT_EQUAL(SAMPLES_PER_DAY, replay_day(&trace, &min_2, &max_2));
+    printf("Replayed a day (%ld samples, %lu KB trace) in %.3f s\n",
+           (long)SAMPLES_PER_DAY,
+           (unsigned long)(trace.size / 1024),
+           elapsed_s);
+
+    TEST_ASSERT_EQUAL_FLOAT(min_1, min_2);
+    TEST_ASSERT_EQUAL_FLOAT(max_1, max_2);
+    TEST_ASSERT_FLOAT_WITHIN(13.0f, 400000.0f + SAMPLES_PER_DAY / 2, max_1);
+    free(trace.data);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_replay_per_device);
+    RUN_TEST(test_truncated_write_replays);
+    RUN_TEST(test_invalid_header);
+    RUN_TEST(test_fast_forward_day_is_reproducible);
+
+    return UNITY_END();
+}
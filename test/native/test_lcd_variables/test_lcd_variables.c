@@ -0,0 +1,94 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "lcd_variables.h"
+
+void test_initial_values(void)
+{
+    // Runs first, nothing was set yet
+    TEST_ASSERT_TRUE(isnan(get_var_amb_temp_degc()));
+    TEST_ASSERT_TRUE(isnan(get_var_amb_press_avg_kpa()));
+    TEST_ASSERT_FALSE(get_var_is_station_connected());
+    TEST_ASSERT_EQUAL(0, get_var_active_alerts());
+    TEST_ASSERT_EQUAL(0, lcd_variables_version(LCD_VAR_amb_temp_degc));
+}
+
+void test_version_counts_changes_only(void)
+{
+    uint32_t version = lcd_variables_version(LCD_VAR_amb_humid_avg_pct);
+
+    set_var_amb_humid_avg_pct(NAN); // Already NaN
+    TEST_ASSERT_EQUAL(version, lcd_variables_version(LCD_VAR_amb_humid_avg_pct));
+
+    set_var_amb_humid_avg_pct(55.5f);
+    TEST_ASSERT_EQUAL_FLOAT(55.5f, get_var_amb_humid_avg_pct());
+    TEST_ASSERT_EQUAL(version + 1, lcd_variables_version(LCD_VAR_amb_humid_avg_pct));
+
+    set_var_amb_humid_avg_pct(55.5f);
+    TEST_ASSERT_EQUAL(version + 1, lcd_variables_version(LCD_VAR_amb_humid_avg_pct));
+
+    // Other variables are not affected
+    uint32_t alerts_version = lcd_variables_version(LCD_VAR_active_alerts);
+    set_var_amb_humid_avg_pct(56.0f);
+    TEST_ASSERT_EQUAL(alerts_version, lcd_variables_version(LCD_VAR_active_alerts));
+}
+
+void test_set_frame_publishes_one_measurement(void)
+{
+    meteo_frame_t frame = {.temperature_degc = -2.5f, .humidity_pct = 81.0f, .pressure_pa = 99800.0f};
+    uint32_t      station_version = lcd_variables_version(LCD_VAR_is_station_connected);
+    uint32_t      sign_version = lcd_variables_version(LCD_VAR_is_amb_temp_negative);
+
+    lcd_variables_set_frame(&frame);
+
+    lcd_variables_t vars;
+    lcd_variables_snapshot(&vars);
+    TEST_ASSERT_EQUAL_FLOAT(-2.5f, vars.amb_temp_degc);
+    TEST_ASSERT_TRUE(vars.is_amb_temp_negative);
+    TEST_ASSERT_EQUAL_FLOAT(81.0f, vars.amb_humid_pct);
+    TEST_ASSERT_EQUAL_FLOAT(99.8f, vars.amb_press_kpa);
+    TEST_ASSERT_EQUAL(sign_version + 1, lcd_variables_version(LCD_VAR_is_amb_temp_negative));
+    TEST_ASSERT_EQUAL(station_version, lcd_variables_version(LCD_VAR_is_station_connected));
+
+    // Same sign, only the temperature changed
+    frame.temperature_degc = -1.0f;
+    lcd_variables_set_frame(&frame);
+    TEST_ASSERT_EQUAL(sign_version + 1, lcd_variables_version(LCD_VAR_is_amb_temp_negative));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, get_var_amb_temp_degc());
+}
+
+void test_format_and_infos(void)
+{
+    char text[24];
+
+    set_var_amb_temp_high_degc(21.46f);
+    TEST_ASSERT_EQUAL(8, lcd_variables_format(LCD_VAR_amb_temp_high_degc, text, sizeof(text))); // UTF-8 degree sign
+    TEST_ASSERT_EQUAL_STRING("21.5 °C", text);
+
+    set_var_amb_press_avg_kpa(101.3f);
+    lcd_variables_format(LCD_VAR_amb_press_avg_kpa, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("101.30 kPa", text);
+
+    set_var_active_alerts(5);
+    lcd_variables_format(LCD_VAR_active_alerts, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("5", text);
+
+    TEST_ASSERT_EQUAL(-1, lcd_variables_format(LCD_VAR_COUNT, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("amb_humid_pct", lcd_var_infos[LCD_VAR_amb_humid_pct].name);
+    TEST_ASSERT_EQUAL(LCD_VAR_TYPE_BOOLEAN, lcd_var_infos[LCD_VAR_is_station_connected].type);
+    TEST_ASSERT_EQUAL(LCD_VAR_TYPE_INTEGER, lcd_var_infos[LCD_VAR_active_alerts].type);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_initial_values);
+    RUN_TEST(test_version_counts_changes_only);
+    RUN_TEST(test_set_frame_publishes_one_measurement);
+    RUN_TEST(test_format_and_infos);
+
+    return UNITY_END();
+}
@@ -0,0 +1,518 @@
+#include <unity.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "modbus_server.h"
+
+#define UNIT_ID      17
+#define N_POLLS      2000U
+#define PUBLISH_US   1000 //< Publish period of the stand-in sensing thread, well above the station rate
+
+static modbus_snapshot_t s_snapshot;
+static modbus_server_t   s_server;
+static atomic_bool       s_is_running;
+
+void setUp(void)
+{
+    modbus_snapshot_init(&s_snapshot);
+    modbus_server_init_state(&s_server, &s_snapshot, UNIT_ID);
+}
+
+void tearDown(void)
+{
+}
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int64_t s_clock_us;
+
+static int64_t fake_clock_us(void)
+{
+    return s_clock_us;
+}
+
+static uint32_t get_u32(const uint16_t *registers)
+{
+    return ((uint32_t)registers[0] << 16) | registers[1];
+}
+
+static size_t rtu_request(uint8_t unit, uint8_t function, uint16_t address, uint16_t quantity, uint8_t *adu)
+{
+    const uint8_t pdu[] = {unit, function, address >> 8, address & 0xFF, quantity >> 8, quantity & 0xFF};
+    memcpy(adu, pdu, sizeof(pdu));
+    uint16_t crc = modbus_crc16(adu, sizeof(pdu));
+    adu[6] = crc & 0xFF;
+    adu[7] = crc >> 8;
+    return 8;
+}
+
+// Registers where every one holds the generation, the two words of 32 bit values included: a torn read mixes two
+static void publish_generation(uint16_t generation)
+{
+    uint16_t registers[MODBUS_N_REGISTERS];
+    for (uint8_t i = 0; i < MODBUS_N_REGISTERS; i++) registers[i] = generation;
+    modbus_snapshot_publish(&s_snapshot, registers);
+}
+
+// Publishes from generation 1, the map is published once before so that every read is consistent
+static void *publisher_thread(void *arg)
+{
+    uint16_t generation = 0;
+    while (atomic_load(&s_is_running))
+    {
+        publish_generation(++generation);
+        if (arg != NULL) usleep(PUBLISH_US);
+    }
+    return NULL;
+}
+
+static int compare_i64(const void *a, const void *b)
+{
+    int64_t lhs = *(const int64_t *)a, rhs = *(const int64_t *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static void print_latency(const char *name, int64_t *latencies_us, uint32_t n)
+{
+    qsort(latencies_us, n, sizeof(latencies_us[0]), compare_i64);
+    double sum = 0.0;
+    for (uint32_t i = 0; i < n; i++) sum += (double)latencies_us[i];
+    printf("%s: %u polls of the whole map, latency avg %.0f us, p99 %lld us, max %lld us\n",
+           name,
+           (unsigned)n,
+           sum / n,
+           (long long)latencies_us[n * 99 / 100],
+           (long long)latencies_us[n - 1]);
+}
+
+void test_register_map(void)
+{
+    meteo_frame_t frame = {
+        .sequence = 0x12345678,
+        .timestamp_us = 3723LL * 1000000 + 999999,
+        .temperature_degc = -12.345f,
+        .pressure_pa = 101325.4f,
+        .humidity_pct = 55.5f,
+        .gas_resistance_ohm = NAN,
+    };
+    lcd_variables_t variables = {
+        .amb_temp_high_degc = 25.0f,
+        .amb_temp_low_degc = -400.0f, // Saturated
+        .amb_temp_avg_degc = NAN,
+        .amb_humid_avg_pct = 50.0f,
+        .amb_press_avg_kpa = 101.3f,
+        .active_alerts = 0x5,
+    };
+    sense_recovery_stats_t recovery = {.n_faults = 3, .n_bus_resets = 70000, .n_samples_lost = 12, .max_recover_ms = 5};
+    uint16_t               registers[MODBUS_N_REGISTERS];
+    modbus_server_map(&frame, &variables, &recovery, registers);
+
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, get_u32(&registers[MODBUS_REG_SEQUENCE]));
+    TEST_ASSERT_EQUAL_UINT32(3723, get_u32(&registers[MODBUS_REG_UPTIME_S]));
+    TEST_ASSERT_EQUAL_INT16(-1235, (int16_t)registers[MODBUS_REG_TEMP]);
+    TEST_ASSERT_EQUAL_UINT16(5550, registers[MODBUS_REG_HUMID]);
+    TEST_ASSERT_EQUAL_UINT32(101325, get_u32(&registers[MODBUS_REG_PRESS]));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, get_u32(&registers[MODBUS_REG_GAS]));
+    TEST_ASSERT_EQUAL_INT16(2500, (int16_t)registers[MODBUS_REG_TEMP_HIGH]);
+    TEST_ASSERT_EQUAL_INT16(-32767, (int16_t)registers[MODBUS_REG_TEMP_LOW]);
+    TEST_ASSERT_EQUAL_HEX16(0x8000, registers[MODBUS_REG_TEMP_AVG]);
+    TEST_ASSERT_EQUAL_UINT32(101300, get_u32(&registers[MODBUS_REG_PRESS_AVG]));
+    // Dew point of -12.345 °C at 55.5 %RH: -19.44 °C
+    TEST_ASSERT_INT_WITHIN(2, -1944, (int16_t)registers[MODBUS_REG_DEW_POINT]);
+    TEST_ASSERT_EQUAL_UINT16(0x5, registers[MODBUS_REG_ALERTS]);
+    TEST_ASSERT_EQUAL_UINT32(70000, get_u32(&registers[MODBUS_REG_N_BUS_RESETS]));
+    TEST_ASSERT_EQUAL_UINT32(5, get_u32(&registers[MODBUS_REG_MAX_RECOVER_MS]));
+
+    // UTC time from the timebase, missing while the clock is unknown
+    const int64_t utc_us = 1767225600LL * 1000000 + 999999; // 2026-01-01T00:00:00.999999Z
+    modbus_server_map_utc(&utc_us, registers);
+    TEST_ASSERT_EQUAL_UINT32(1767225600, get_u32(&registers[MODBUS_REG_UTC_S]));
+    modbus_server_map_utc(NULL, registers);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, get_u32(&registers[MODBUS_REG_UTC_S]));
+
+    // Nothing published yet: every value missing
+    modbus_snapshot_read(&s_snapshot, registers);
+    TEST_ASSERT_EQUAL_HEX16(0x8000, registers[MODBUS_REG_TEMP]);
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, registers[MODBUS_REG_HUMID]);
+}
+
+void test_health_during_outage(void)
+{
+    meteo_frame_t          frame = {.sequence = 1, .timestamp_us = 100LL * 1000000, .temperature_degc = 20.0f};
+    lcd_variables_t        variables = {0};
+    sense_recovery_stats_t recovery = {0};
+    uint16_t               registers[MODBUS_N_REGISTERS];
+    s_server.clock_us = fake_clock_us;
+    s_clock_us = 0;
+
+    // No measurement yet: the age is missing
+    uint8_t       response[MODBUS_MAX_PDU_SIZE];
+    const uint8_t request[] = {MODBUS_FC_READ_INPUT, 0, MODBUS_REG_SAMPLE_AGE_S, 0, 3};
+    TEST_ASSERT_EQUAL(8, modbus_server_handle_pdu(&s_server, request, sizeof(request), response, sizeof(response)));
+    const uint8_t missing[] = {0xFF, 0xFF, 0xFF, 0xFF};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(missing, &response[2], sizeof(missing));
+
+    modbus_server_map(&frame, &variables, &recovery, registers);
+    modbus_snapshot_publish(&s_snapshot, registers);
+    s_clock_us = 100LL * 1000000 + 500000;
+    modbus_server_handle_pdu(&s_server, request, sizeof(request), response, sizeof(response));
+    TEST_ASSERT_EQUAL_UINT8(0, response[5]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_SENSOR_MEASURING, response[7]);
+
+    // The sensor fails: the recovery steps publish the counters and state, the measurement and its age keep going
+    recovery.n_faults = 1;
+    recovery.n_bus_resets = 2;
+    recovery.n_samples_lost = 4;
+    modbus_server_map_health(&recovery, true, registers);
+    modbus_snapshot_publish(&s_snapshot, registers);
+    s_clock_us = 142LL * 1000000;
+    modbus_server_handle_pdu(&s_server, request, sizeof(request), response, sizeof(response));
+    TEST_ASSERT_EQUAL_UINT8(42, response[5]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_SENSOR_RECOVERING, response[7]);
+    modbus_snapshot_read(&s_snapshot, registers);
+    TEST_ASSERT_EQUAL_UINT32(1, get_u32(&registers[MODBUS_REG_N_FAULTS]));
+    TEST_ASSERT_EQUAL_UINT32(2, get_u32(&registers[MODBUS_REG_N_BUS_RESETS]));
+    TEST_ASSERT_EQUAL_UINT32(4, get_u32(&registers[MODBUS_REG_N_SAMPLES_LOST]));
+    TEST_ASSERT_EQUAL_INT16(2000, (int16_t)registers[MODBUS_REG_TEMP]);
+    TEST_ASSERT_EQUAL_UINT32(1, get_u32(&registers[MODBUS_REG_SEQUENCE]));
+
+    // Measuring again
+    frame.sequence = 2;
+    frame.timestamp_us = s_clock_us;
+    modbus_server_map(&frame, &variables, &recovery, registers);
+    modbus_snapshot_publish(&s_snapshot, registers);
+    modbus_server_handle_pdu(&s_server, request, sizeof(request), response, sizeof(response));
+    TEST_ASSERT_EQUAL_UINT8(0, response[5]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_SENSOR_MEASURING, response[7]);
+}
+
+void test_pdu_and_exceptions(void)
+{
+    publish_generation(0x0102);
+    uint8_t response[MODBUS_MAX_PDU_SIZE];
+
+    const uint8_t read_input[] = {MODBUS_FC_READ_INPUT, 0, 24, 0, 2};
+    TEST_ASSERT_EQUAL(6, modbus_server_handle_pdu(&s_server, read_input, sizeof(read_input), response, sizeof(response)));
+    const uint8_t expected[] = {MODBUS_FC_READ_INPUT, 4, 0x01, 0x02, 0x01, 0x02};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+
+    const uint8_t read_holding[] = {MODBUS_FC_READ_HOLDING, 0, 0, 0, MODBUS_N_REGISTERS};
+    TEST_ASSERT_EQUAL(2 + 2 * MODBUS_N_REGISTERS,
+                      modbus_server_handle_pdu(&s_server, read_holding, sizeof(read_holding), response, sizeof(response)));
+
+    const struct
+    {
+        uint8_t pdu[5];
+        size_t  length;
+        uint8_t code;
+    } cases[] = {
+        // Past the map
+        {{MODBUS_FC_READ_INPUT, 0, MODBUS_N_REGISTERS - 1, 0, 2}, 5, MODBUS_EX_ILLEGAL_ADDRESS},
+        {{MODBUS_FC_READ_INPUT, 0xFF, 0xFF, 0, 1}, 5, MODBUS_EX_ILLEGAL_ADDRESS},
+        {{MODBUS_FC_READ_INPUT, 0, 0, 0, 0}, 5, MODBUS_EX_ILLEGAL_VALUE},   // No register
+        {{MODBUS_FC_READ_INPUT, 0, 0, 0, 126}, 5, MODBUS_EX_ILLEGAL_VALUE}, // Above the 125 register limit
+        {{MODBUS_FC_READ_HOLDING, 0, 0, 0}, 4, MODBUS_EX_ILLEGAL_VALUE},    // Truncated
+        {{0x06, 0, 4, 0, 1}, 5, MODBUS_EX_ILLEGAL_FUNCTION},                // Write single register
+    };
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        TEST_ASSERT_EQUAL(2, modbus_server_handle_pdu(&s_server, cases[i].pdu, cases[i].length, response, sizeof(response)));
+        TEST_ASSERT_EQUAL_HEX8(cases[i].pdu[0] | 0x80, response[0]);
+        TEST_ASSERT_EQUAL_HEX8(cases[i].code, response[1]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, s_server.n_requests);
+    TEST_ASSERT_EQUAL_UINT32(6, s_server.n_exceptions);
+}
+
+void test_rtu_framing(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(0x4B37, modbus_crc16((const uint8_t *)"123456789", 9)); // CRC-16/MODBUS check value
+    TEST_ASSERT_EQUAL_UINT32(2006, modbus_rtu_silence_us(19200)); // 3.5 x 11 bits, rounded up
+    TEST_ASSERT_EQUAL_UINT32(1750, modbus_rtu_silence_us(115200));
+    publish_generation(7);
+
+    modbus_rtu_rx_t rx;
+    uint8_t         adu[MODBUS_RTU_MAX_ADU_SIZE], response[MODBUS_RTU_MAX_ADU_SIZE];
+    modbus_rtu_rx_init(&rx, 19200);
+
+    // A read request is complete at its 8th byte, without waiting for the silence
+    size_t length = rtu_request(UNIT_ID, MODBUS_FC_READ_INPUT, 4, 2, adu);
+    modbus_rtu_rx_feed(&rx, adu, 3, 1000);
+    TEST_ASSERT_EQUAL(0, modbus_rtu_rx_poll(&rx, 1500));
+    modbus_rtu_rx_feed(&rx, &adu[3], length - 3, 1600);
+    TEST_ASSERT_EQUAL(8, modbus_rtu_rx_poll(&rx, 1600));
+    TEST_ASSERT_EQUAL(9, modbus_server_handle_rtu(&s_server, rx.buffer, 8, response, sizeof(response)));
+    const uint8_t expected[] = {UNIT_ID, MODBUS_FC_READ_INPUT, 4, 0, 7, 0, 7};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX16(modbus_crc16(response, 7), response[7] | (response[8] << 8));
+
+    // An unknown function code ends with the silence, and gets an exception
+    const uint8_t unknown[] = {UNIT_ID, 0x2B, 0x0E, 0x01, 0x00};
+    memcpy(adu, unknown, sizeof(unknown));
+    uint16_t crc = modbus_crc16(adu, sizeof(unknown));
+    adu[5] = crc & 0xFF;
+    adu[6] = crc >> 8;
+    modbus_rtu_rx_feed(&rx, adu, 7, 10000);
+    TEST_ASSERT_EQUAL(0, modbus_rtu_rx_poll(&rx, 10000 + 2005));
+    TEST_ASSERT_EQUAL(7, modbus_rtu_rx_poll(&rx, 10000 + 2006));
+    TEST_ASSERT_EQUAL(5, modbus_server_handle_rtu(&s_server, rx.buffer, 7, response, sizeof(response)));
+    TEST_ASSERT_EQUAL_HEX8(0xAB, response[1]);
+
+    // Garbage then a silence: the next request starts a new frame
+    modbus_rtu_rx_feed(&rx, (const uint8_t *)"\x55\x03", 2, 20000);
+    length = rtu_request(UNIT_ID, MODBUS_FC_READ_HOLDING, 0, 1, adu);
+    modbus_rtu_rx_feed(&rx, adu, length, 30000);
+    TEST_ASSERT_EQUAL(8, modbus_rtu_rx_poll(&rx, 30000));
+
+    // Another station on the bus, a broadcast and a corrupted frame get no response
+    length = rtu_request(UNIT_ID + 1, MODBUS_FC_READ_INPUT, 0, 1, adu);
+    TEST_ASSERT_EQUAL(0, modbus_server_handle_rtu(&s_server, adu, length, response, sizeof(response)));
+    length = rtu_request(0, MODBUS_FC_READ_INPUT, 0, 1, adu);
+    TEST_ASSERT_EQUAL(0, modbus_server_handle_rtu(&s_server, adu, length, response, sizeof(response)));
+    length = rtu_request(UNIT_ID, MODBUS_FC_READ_INPUT, 0, 1, adu);
+    adu[3] ^= 0x10;
+    TEST_ASSERT_EQUAL(0, modbus_server_handle_rtu(&s_server, adu, length, response, sizeof(response)));
+    TEST_ASSERT_EQUAL_UINT32(2, s_server.n_other_unit);
+    TEST_ASSERT_EQUAL_UINT32(1, s_server.n_crc_errors);
+}
+
+static void *reader_thread(void *arg)
+{
+    uint32_t *n_torn = arg;
+    uint16_t  registers[MODBUS_N_REGISTERS];
+    while (atomic_load(&s_is_running))
+    {
+        modbus_snapshot_read(&s_snapshot, registers);
+        for (uint8_t i = 1; i < MODBUS_N_REGISTERS; i++)
+        {
+            if (registers[i] != registers[0])
+            {
+                (*n_torn)++;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// A publisher without pause against two readers: every read is one generation
+void test_snapshot_is_never_torn(void)
+{
+    pthread_t publisher, readers[2];
+    uint32_t  n_torn[2] = {0};
+    publish_generation(0);
+    atomic_store(&s_is_running, true);
+    pthread_create(&publisher, NULL, publisher_thread, NULL);
+    for (uint8_t i = 0; i < 2; i++) pthread_create(&readers[i], NULL, reader_thread, &n_torn[i]);
+    usleep(300000);
+    atomic_store(&s_is_running, false);
+    pthread_join(publisher, NULL);
+    for (uint8_t i = 0; i < 2; i++) pthread_join(readers[i], NULL);
+    uint16_t registers[MODBUS_N_REGISTERS];
+    modbus_snapshot_read(&s_snapshot, registers);
+    printf("Snapshot: %u publishes, torn reads %u and %u\n", (unsigned)registers[0], n_torn[0], n_torn[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, n_torn[0] + n_torn[1]);
+}
+
+static void *rtu_server_thread(void *arg)
+{
+    modbus_rtu_port_t *port = arg;
+    while (atomic_load(&s_is_running)) modbus_rtu_port_poll(port, 10);
+    return NULL;
+}
+
+static bool read_exact(int fd, uint8_t *data, size_t length, int timeout_ms)
+{
+    size_t n_read = 0;
+    while (n_read < length)
+    {
+        fd_set         fds;
+        struct timeval timeout = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        if (select(fd + 1, &fds, NULL, NULL, &timeout) <= 0) return false;
+        ssize_t n = read(fd, &data[n_read], length - n_read);
+        if (n <= 0) return false;
+        n_read += (size_t)n;
+    }
+    return true;
+}
+
+// Checks a whole map response holds one generation
+static bool is_consistent(const uint8_t *registers)
+{
+    for (uint8_t i = 1; i < MODBUS_N_REGISTERS; i++)
+    {
+        if (registers[2 * i] != registers[0] || registers[2 * i + 1] != registers[1]) return false;
+    }
+    return true;
+}
+
+// The master polls the whole map through a pseudo-terminal while the registers are published every millisecond
+void test_rtu_over_pty(void)
+{
+    int master, slave;
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, NULL, NULL, NULL));
+    struct termios attrs;
+    tcgetattr(slave, &attrs);
+    cfmakeraw(&attrs);
+    tcsetattr(slave, TCSANOW, &attrs);
+    tcgetattr(master, &attrs);
+    cfmakeraw(&attrs);
+    tcsetattr(master, TCSANOW, &attrs);
+
+    modbus_rtu_port_t port;
+    modbus_rtu_port_init(&port, &s_server, slave, 115200);
+    pthread_t server, publisher;
+    publish_generation(0);
+    atomic_store(&s_is_running, true);
+    pthread_create(&server, NULL, rtu_server_thread, &port);
+    pthread_create(&publisher, NULL, publisher_thread, (void *)1);
+
+    static int64_t latencies_us[N_POLLS];
+    uint32_t       n_torn = 0, n_polls = 0;
+    bool           is_ok = true;
+    for (; is_ok && n_polls < N_POLLS; n_polls++)
+    {
+        uint8_t adu[8], response[5 + 2 * MODBUS_N_REGISTERS];
+        size_t  length = rtu_request(UNIT_ID, MODBUS_FC_READ_INPUT, 0, MODBUS_N_REGISTERS, adu);
+        int64_t start_us = now_us();
+        if (n_polls % 2 == 0)
+        {
+            is_ok = write(master, adu, length) == (ssize_t)length;
+        }
+        else // Split in two writes
+        {
+            is_ok = write(master, adu, 3) == 3 && write(master, &adu[3], length - 3) == (ssize_t)(length - 3);
+        }
+        is_ok = is_ok && read_exact(master, response, sizeof(response), 1000)
+                && modbus_crc16(response, sizeof(response) - 2)
+                       == (response[sizeof(response) - 2] | (response[sizeof(response) - 1] << 8));
+        latencies_us[n_polls] = now_us() - start_us;
+        if (is_ok && !is_consistent(&response[3])) n_torn++;
+    }
+    // Stop the threads before any assertion
+    atomic_store(&s_is_running, false);
+    pthread_join(server, NULL);
+    pthread_join(publisher, NULL);
+    close(master);
+    close(slave);
+
+    TEST_ASSERT_TRUE_MESSAGE(is_ok, "No valid RTU response");
+    print_latency("RTU over a pseudo-terminal", latencies_us, N_POLLS);
+    TEST_ASSERT_EQUAL_UINT32(0, n_torn);
+    TEST_ASSERT_EQUAL_UINT32(N_POLLS, s_server.n_requests);
+    TEST_ASSERT_EQUAL_UINT32(0, s_server.n_crc_errors);
+}
+
+static void *tcp_server_thread(void *arg)
+{
+    modbus_tcp_port_t *port = arg;
+    while (atomic_load(&s_is_running)) modbus_tcp_port_poll(port, 10);
+    return NULL;
+}
+
+static int tcp_connect(uint16_t number)
+{
+    int                fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(number)};
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&address, sizeof(address)));
+    return fd;
+}
+
+static size_t tcp_request(uint16_t transaction, uint16_t address, uint16_t quantity, uint8_t *adu)
+{
+    const uint8_t request[] = {transaction >> 8, transaction & 0xFF, 0, 0, 0, 6, UNIT_ID,
+                               MODBUS_FC_READ_INPUT, address >> 8, address & 0xFF, quantity >> 8, quantity & 0xFF};
+    memcpy(adu, request, sizeof(request));
+    return sizeof(request);
+}
+
+// Two clients over loopback: pipelined requests in one segment, a request split across segments, a whole map poll
+// under a 1 kHz publish load
+void test_tcp_loopback(void)
+{
+    modbus_tcp_port_t port;
+    TEST_ASSERT_TRUE(modbus_tcp_port_open(&port, &s_server, 0));
+    pthread_t server, publisher;
+    publish_generation(0);
+    atomic_store(&s_is_running, true);
+    pthread_create(&server, NULL, tcp_server_thread, &port);
+    pthread_create(&publisher, NULL, publisher_thread, (void *)1);
+    int client = tcp_connect(modbus_tcp_port_number(&port));
+    int other = tcp_connect(modbus_tcp_port_number(&port));
+
+    uint8_t request[24], response[MODBUS_TCP_MAX_ADU_SIZE];
+    size_t  length = tcp_request(0x1111, 0, 2, request);
+    length += tcp_request(0x2222, 4, 1, &request[length]);
+    TEST_ASSERT_EQUAL(length, send(client, request, length, 0));
+    TEST_ASSERT_TRUE(read_exact(client, response, 13 + 11, 1000));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((const uint8_t[]){0x11, 0x11, 0, 0, 0, 7, UNIT_ID, 0x04, 4}), response, 9);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((const uint8_t[]){0x22, 0x22, 0, 0, 0, 5, UNIT_ID, 0x04, 2}), &response[13], 9);
+
+    length = tcp_request(0x3333, MODBUS_N_REGISTERS - 5, 10, request); // Past the map
+    TEST_ASSERT_EQUAL(5, send(other, request, 5, 0));
+    usleep(2000);
+    TEST_ASSERT_EQUAL(length - 5, send(other, &request[5], length - 5, 0));
+    TEST_ASSERT_TRUE(read_exact(other, response, 9, 1000));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((const uint8_t[]){0x33, 0x33, 0, 0, 0, 3, UNIT_ID, 0x84, 0x02}), response, 9);
+
+    static int64_t latencies_us[N_POLLS];
+    uint32_t       n_torn = 0;
+    for (uint32_t i = 0; i < N_POLLS; i++)
+    {
+        length = tcp_request((uint16_t)i, 0, MODBUS_N_REGISTERS, request);
+        int64_t start_us = now_us();
+        TEST_ASSERT_EQUAL(length, send(client, request, length, 0));
+        TEST_ASSERT_TRUE_MESSAGE(read_exact(client, response, 9 + 2 * MODBUS_N_REGISTERS, 1000), "No TCP response");
+        latencies_us[i] = now_us() - start_us;
+        TEST_ASSERT_EQUAL_UINT16(i, (response[0] << 8) | response[1]);
+        if (!is_consistent(&response[9])) n_torn++;
+    }
+
+    // Not Modbus: the connection is closed
+    TEST_ASSERT_EQUAL(8, send(other, "GET / HT", 8, 0));
+    TEST_ASSERT_FALSE(read_exact(other, response, 1, 1000));
+
+    atomic_store(&s_is_running, false);
+    pthread_join(server, NULL);
+    pthread_join(publisher, NULL);
+    close(client);
+    close(other);
+    modbus_tcp_port_close(&port);
+
+    print_latency("TCP over loopback", latencies_us, N_POLLS);
+    TEST_ASSERT_EQUAL_UINT32(0, n_torn);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_register_map);
+    RUN_TEST(test_health_during_outage);
+    RUN_TEST(test_pdu_and_exceptions);
+    RUN_TEST(test_rtu_framing);
+    RUN_TEST(test_snapshot_is_never_torn);
+    RUN_TEST(test_rtu_over_pty);
+    RUN_TEST(test_tcp_loopback);
+    return UNITY_END();
+}
@@ -0,0 +1,275 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "minmax_series.h"
+#include "mono_chart.h"
+#include "mono_fb.h"
+
+#define BUCKET_PERIOD_US 1000000
+
+typedef struct
+{
+    size_t  n_bytes;
+    uint8_t panel[MONO_FB_SIZE]; //< Panel GRAM copy, to check the flushed content
+} flush_capture_t;
+
+static bool capture_write(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data)
+{
+    flush_capture_t *capture = (flush_capture_t *)ctx;
+    capture->n_bytes += col_end - col_start;
+    memcpy(&capture->panel[page * MONO_FB_WIDTH + col_start], data, col_end - col_start);
+    return true;
+}
+
+// One sample per bucket, a slow ramp which stays in the scale fitted to the first buckets
+static void add_buckets(minmax_series_t *series, uint32_t first, uint32_t n)
+{
+    for (uint32_t i = first; i < first + n; i++)
+    {
+        minmax_series_add(series, (int64_t)i * BUCKET_PERIOD_US, 20.0f + (float)(i % 8) * 0.5f);
+    }
+}
+
+void test_series_buckets_and_gaps(void)
+{
+    static minmax_series_t series;
+    minmax_bucket_t        bucket;
+    minmax_series_init(&series, BUCKET_PERIOD_US);
+    TEST_ASSERT_FALSE(minmax_series_get(&series, 0, &bucket));
+
+    TEST_ASSERT_EQUAL(1, minmax_series_add(&series, 0, 3.0f));
+    TEST_ASSERT_EQUAL(0, minmax_series_add(&series, 500000, -1.0f));
+    TEST_ASSERT_EQUAL(0, minmax_series_add(&series, 600000, NAN));
+    TEST_ASSERT_EQUAL(3, minmax_series_add(&series, 3200000, 7.0f)); // Buckets 1 and 2 without samples
+    TEST_ASSERT_EQUAL(4, series.n_buckets);
+
+    TEST_ASSERT_TRUE(minmax_series_get(&series, 0, &bucket));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, bucket.min);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, bucket.max);
+    TEST_ASSERT_TRUE(minmax_series_get(&series, 2, &bucket));
+    TEST_ASSERT_TRUE(minmax_bucket_is_empty(&bucket));
+    TEST_ASSERT_TRUE(minmax_series_get(&series, 3, &bucket));
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, bucket.min);
+
+    // A gap longer than the ring drops every bucket
+    minmax_series_add(&series, 1000 * (int64_t)BUCKET_PERIOD_US, 1.0f);
+    TEST_ASSERT_EQUAL(1001, series.n_buckets);
+    TEST_ASSERT_FALSE(minmax_series_get(&series, 3, &bucket));
+    TEST_ASSERT_TRUE(minmax_series_get(&series, 1000 - MINMAX_SERIES_LEN + 1, &bucket));
+    TEST_ASSERT_TRUE(minmax_bucket_is_empty(&bucket));
+    TEST_ASSERT_TRUE(minmax_series_get(&series, 1000, &bucket));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bucket.max);
+}
+
+void test_series_load_matches_samples(void)
+{
+    // Buckets decimated elsewhere (e.g. the history store) give the same series as the samples added one by one
+    static minmax_series_t sampled;
+    static minmax_series_t loaded;
+    static mono_fb_t       sampled_fb;
+    static mono_fb_t       loaded_fb;
+    minmax_bucket_t        buckets[MINMAX_SERIES_LEN];
+    minmax_series_init(&sampled, BUCKET_PERIOD_US);
+    add_buckets(&sampled, 0, 300);
+    for (uint32_t i = 0; i < MINMAX_SERIES_LEN; i++)
+    {
+        TEST_ASSERT_TRUE(minmax_series_get(&sampled, 300 - MINMAX_SERIES_LEN + i, &buckets[i]));
+    }
+    minmax_series_init(&loaded, BUCKET_PERIOD_US);
+    add_buckets(&loaded, 0, 10); // Replaced
+    minmax_series_load(&loaded, 299, 299 * (int64_t)BUCKET_PERIOD_US, buckets, MINMAX_SERIES_LEN);
+    TEST_ASSERT_EQUAL_UINT32(sampled.n_buckets, loaded.n_buckets);
+    TEST_ASSERT_TRUE(sampled.bucket_start_us == loaded.bucket_start_us);
+
+    mono_chart_t sampled_chart, loaded_chart;
+    mono_fb_clear(&sampled_fb);
+    mono_fb_clear(&loaded_fb);
+    mono_chart_init(&sampled_chart, 0, 3, 1.0f, MONO_CHART_SWEEP);
+    mono_chart_init(&loaded_chart, 0, 3, 1.0f, MONO_CHART_SWEEP);
+    mono_chart_redraw(&sampled_chart, &sampled_fb, &sampled);
+    mono_chart_redraw(&loaded_chart, &loaded_fb, &loaded);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sampled_fb.data, loaded_fb.data, MONO_FB_SIZE);
+
+    // Fewer buckets than the ring: the older slots are empty, the samples go on in the newest bucket
+    minmax_bucket_t bucket;
+    minmax_series_load(&loaded, 299, 299 * (int64_t)BUCKET_PERIOD_US, &buckets[MINMAX_SERIES_LEN - 2], 2);
+    TEST_ASSERT_TRUE(minmax_series_get(&loaded, 298, &bucket));
+    TEST_ASSERT_FALSE(minmax_bucket_is_empty(&bucket));
+    TEST_ASSERT_TRUE(minmax_series_get(&loaded, 297, &bucket));
+    TEST_ASSERT_TRUE(minmax_bucket_is_empty(&bucket));
+    TEST_ASSERT_EQUAL(1, minmax_series_add(&loaded, 300 * (int64_t)BUCKET_PERIOD_US, 5.0f));
+    TEST_ASSERT_TRUE(minmax_series_get(&loaded, 300, &bucket));
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, bucket.min);
+}
+
+void test_column_bar_spans_bucket_range(void)
+{
+    static mono_fb_t       fb;
+    static minmax_series_t series;
+    mono_chart_t           chart;
+    mono_fb_clear(&fb);
+    minmax_series_init(&series, BUCKET_PERIOD_US);
+    mono_chart_init(&chart, 1, 3, 1.0f, MONO_CHART_SWEEP);
+
+    // Scale 10..12 over 24 rows: 12 at row 0, 10 at row 23
+    minmax_series_add(&series, 0, 10.0f);
+    minmax_series_add(&series, 0, 12.0f);
+    minmax_series_add(&series, BUCKET_PERIOD_US, 11.0f);
+    mono_chart_update(&chart, &fb, &series);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, chart.scale_min);
+    TEST_ASSERT_EQUAL_FLOAT(12.0f, chart.scale_max);
+    for (int16_t y = 8; y < 32; y++)
+    {
+        TEST_ASSERT_TRUE(mono_fb_get_pixel(&fb, 0, y));
+        TEST_ASSERT_EQUAL(y == 8 + 11, mono_fb_get_pixel(&fb, 1, y)); // 23 - 11.5 rounded to 12
+    }
+    TEST_ASSERT_FALSE(mono_fb_get_pixel(&fb, 0, 7));
+    TEST_ASSERT_FALSE(mono_fb_get_pixel(&fb, 2, 20)); // Gap in front of the newest bucket
+}
+
+void test_bytes_per_update(void)
+{
+    static mono_fb_t       fb;
+    static minmax_series_t series;
+    static flush_capture_t capture;
+    mono_chart_t           sweep;
+    mono_chart_t           scroll;
+    mono_fb_clear(&fb);
+    minmax_series_init(&series, BUCKET_PERIOD_US);
+    mono_chart_init(&sweep, 0, 3, 1.0f, MONO_CHART_SWEEP);
+    mono_chart_init(&scroll, 4, 3, 1.0f, MONO_CHART_SCROLL);
+
+    add_buckets(&series, 0, 200);
+    mono_chart_update(&sweep, &fb, &series);
+    mono_chart_update(&scroll, &fb, &series);
+    memset(&capture, 0, sizeof(capture));
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, mono_fb_flush(&fb, capture_write, &capture)); // First frame
+    TEST_ASSERT_EQUAL(1, sweep.n_redraws);
+    TEST_ASSERT_EQUAL(1, scroll.n_redraws);
+
+    // No new sample, nothing to send
+    mono_chart_update(&sweep, &fb, &series);
+    mono_chart_update(&scroll, &fb, &series);
+    TEST_ASSERT_EQUAL(0, mono_fb_flush(&fb, capture_write, &capture));
+
+    size_t sweep_bytes = 0;
+    size_t scroll_bytes = 0;
+    for (uint32_t i = 200; i < 300; i++)
+    {
+        add_buckets(&series, i, 1);
+        mono_chart_update(&sweep, &fb, &series);
+        capture.n_bytes = 0;
+        mono_fb_flush(&fb, capture_write, &capture);
+        TEST_ASSERT_TRUE_MESSAGE(capture.n_bytes <= 2 * 3, "sweep: new column and gap of 3 pages");
+        sweep_bytes += capture.n_bytes;
+
+        mono_chart_update(&scroll, &fb, &series);
+        capture.n_bytes = 0;
+        mono_fb_flush(&fb, capture_write, &capture);
+        scroll_bytes += capture.n_bytes;
+    }
+    TEST_ASSERT_EQUAL(1, sweep.n_redraws);
+    TEST_ASSERT_EQUAL(1, scroll.n_redraws);
+    TEST_ASSERT_TRUE(sweep_bytes > 0);
+    TEST_ASSERT_TRUE(scroll_bytes > 10 * sweep_bytes); // The shifted plot is sent again
+}
+
+void test_incremental_matches_redraw(void)
+{
+    static mono_fb_t       incremental;
+    static mono_fb_t       redrawn;
+    static minmax_series_t series;
+    for (int mode = MONO_CHART_SWEEP; mode <= MONO_CHART_SCROLL; mode++)
+    {
+        mono_chart_t chart;
+        mono_chart_t reference;
+        mono_fb_clear(&incremental);
+        minmax_series_init(&series, BUCKET_PERIOD_US);
+        mono_chart_init(&chart, 2, 3, 1.0f, (mono_chart_mode_t)mode);
+
+        add_buckets(&series, 0, 50);
+        mono_chart_update(&chart, &incremental, &series);
+        for (uint32_t i = 50; i < 400; i += 3)
+        {
+            add_buckets(&series, i, 3);
+            mono_chart_update(&chart, &incremental, &series);
+        }
+        minmax_series_add(&series, 402 * (int64_t)BUCKET_PERIOD_US + 10, 21.0f); // Newest bucket still filling
+        mono_chart_update(&chart, &incremental, &series);
+        minmax_series_add(&series, 402 * (int64_t)BUCKET_PERIOD_US + 20, 20.2f);
+        mono_chart_update(&chart, &incremental, &series);
+
+        mono_fb_clear(&redrawn);
+        mono_chart_init(&reference, 2, 3, 1.0f, (mono_chart_mode_t)mode);
+        mono_chart_redraw(&reference, &redrawn, &series);
+        TEST_ASSERT_EQUAL_FLOAT(reference.scale_min, chart.scale_min);
+        TEST_ASSERT_EQUAL_FLOAT(reference.scale_max, chart.scale_max);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(redrawn.data, incremental.data, MONO_FB_SIZE);
+    }
+}
+
+void test_out_of_scale_redraws(void)
+{
+    static mono_fb_t       fb;
+    static minmax_series_t series;
+    mono_chart_t           chart;
+    mono_fb_clear(&fb);
+    minmax_series_init(&series, BUCKET_PERIOD_US);
+    mono_chart_init(&chart, 0, 3, 1.0f, MONO_CHART_SWEEP);
+
+    add_buckets(&series, 0, 20);
+    mono_chart_update(&chart, &fb, &series);
+    TEST_ASSERT_EQUAL_FLOAT(24.0f, chart.scale_max);
+
+    minmax_series_add(&series, 20 * (int64_t)BUCKET_PERIOD_US, 30.2f);
+    mono_chart_update(&chart, &fb, &series);
+    TEST_ASSERT_EQUAL(2, chart.n_redraws);
+    TEST_ASSERT_EQUAL_FLOAT(31.0f, chart.scale_max);
+    // 30.2 at row 23 - round(10.2 * 23 / 11) = 2
+    TEST_ASSERT_FALSE(mono_fb_get_pixel(&fb, 20, 1));
+    TEST_ASSERT_TRUE(mono_fb_get_pixel(&fb, 20, 2));
+}
+
+void test_screen_header_text(void)
+{
+    static mono_fb_t           fb;
+    static minmax_series_t     temp_series;
+    static minmax_series_t     press_series;
+    static mono_chart_screen_t screen;
+    static flush_capture_t     capture;
+    mono_fb_clear(&fb);
+    minmax_series_init(&temp_series, BUCKET_PERIOD_US);
+    minmax_series_init(&press_series, BUCKET_PERIOD_US);
+    mono_chart_screen_init(&screen, MONO_CHART_SWEEP);
+
+    minmax_series_add(&temp_series, 0, -2.5f);
+    minmax_series_add(&temp_series, 0, 4.0f);
+    minmax_series_add(&press_series, 0, 101.3f);
+    mono_chart_screen_draw(&screen, &fb, &temp_series, &press_series);
+    TEST_ASSERT_EQUAL_STRING("°C -2.5..4.0", screen.temp_text);
+    TEST_ASSERT_EQUAL_STRING("kpA 101.3..101.3", screen.press_text);
+    mono_fb_flush(&fb, capture_write, &capture);
+
+    // Same range, only the new bucket columns are sent
+    minmax_series_add(&temp_series, BUCKET_PERIOD_US, 1.0f);
+    minmax_series_add(&press_series, BUCKET_PERIOD_US, 101.3f);
+    mono_chart_screen_update(&screen, &fb, &temp_series, &press_series);
+    capture.n_bytes = 0;
+    mono_fb_flush(&fb, capture_write, &capture);
+    TEST_ASSERT_TRUE(capture.n_bytes <= 2 * 2 * 3);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_series_buckets_and_gaps);
+    RUN_TEST(test_series_load_matches_samples);
+    RUN_TEST(test_column_bar_spans_bucket_range);
+    RUN_TEST(test_bytes_per_update);
+    RUN_TEST(test_incremental_matches_redraw);
+    RUN_TEST(test_out_of_scale_redraws);
+    RUN_TEST(test_screen_header_text);
+    return UNITY_END();
+}
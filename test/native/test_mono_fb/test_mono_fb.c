@@ -0,0 +1,201 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "mono_fb.h"
+#include "mono_fonts.h"
+#include "mono_ui.h"
+
+typedef struct
+{
+    size_t  n_writes;
+    size_t  n_bytes;
+    uint8_t panel[MONO_FB_SIZE]; //< Panel GRAM copy, to check the flushed content
+} flush_capture_t;
+
+static bool capture_write(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data)
+{
+    flush_capture_t *capture = (flush_capture_t *)ctx;
+    capture->n_writes++;
+    capture->n_bytes += col_end - col_start;
+    memcpy(&capture->panel[page * MONO_FB_WIDTH + col_start], data, col_end - col_start);
+    return true;
+}
+
+static bool failing_write(void *ctx, uint8_t page, uint8_t col_start, uint8_t col_end, const uint8_t *data)
+{
+    return false;
+}
+
+void test_fill_rect_across_pages(void)
+{
+    static mono_fb_t fb;
+    mono_fb_clear(&fb);
+    mono_fb_fill_rect(&fb, 3, 5, 4, 10, true); // Rows 5 to 14, pages 0 and 1
+
+    for (int16_t y = 0; y < 20; y++)
+    {
+        for (int16_t x = 0; x < 10; x++)
+        {
+            bool expected = (x >= 3 && x < 7 && y >= 5 && y < 15);
+            TEST_ASSERT_EQUAL_MESSAGE(expected, mono_fb_get_pixel(&fb, x, y), "pixel");
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX8(0xE0, fb.data[3]);
+    TEST_ASSERT_EQUAL_HEX8(0x7F, fb.data[MONO_FB_WIDTH + 3]);
+}
+
+void test_unaligned_text_matches_aligned_text(void)
+{
+    static mono_fb_t aligned;
+    static mono_fb_t unaligned;
+    mono_fb_clear(&aligned);
+    mono_fb_clear(&unaligned);
+    mono_fb_draw_text(&aligned, &mono_font_10x14, 10, 16, MONO_FB_WIDTH, "-12.5");
+    mono_fb_draw_text(&unaligned, &mono_font_10x14, 10, 21, MONO_FB_WIDTH, "-12.5");
+
+    for (int16_t y = 16; y < 32; y++)
+    {
+        for (int16_t x = 0; x < MONO_FB_WIDTH; x++)
+        {
+            TEST_ASSERT_EQUAL(mono_fb_get_pixel(&aligned, x, y), mono_fb_get_pixel(&unaligned, x, y + 5));
+        }
+    }
+}
+
+void test_text_width_and_clipping(void)
+{
+    static mono_fb_t fb;
+    mono_fb_clear(&fb);
+
+    // Digits are 10 columns wide, the '.' 4 and the spacing 1: the EEZ temperature label width
+    TEST_ASSERT_EQUAL(37, mono_fb_text_width(&mono_font_10x14, "25.3"));
+    TEST_ASSERT_EQUAL(4 + 1 + 5, mono_fb_text_width(&mono_font_5x7, "°C"));
+    TEST_ASSERT_EQUAL(20, mono_fb_draw_text(&fb, &mono_font_10x14, 0, 0, 20, "888"));
+    for (int16_t y = 0; y < 16; y++)
+    {
+        TEST_ASSERT_FALSE(mono_fb_get_pixel(&fb, 20, y));
+    }
+}
+
+void test_pre_shifted_font_is_a_byte_copy(void)
+{
+    // Glyph pre-shifted by 3 rows in its page, like the generated subsets for a label at y 11 (or 3, 19, ...)
+    static const uint8_t      bitmap[] = {0x18, 0x38, 0x08, 0x08, 0x1C};
+    static const mono_glyph_t glyphs[] = {{'1', 5, 0}};
+    static const mono_font_t  font = {
+        .height_pages = 1,
+        .spacing = 0,
+        .y_offset = -3,
+        .n_glyphs = 1,
+        .glyphs = glyphs,
+        .bitmap = bitmap,
+    };
+    static mono_fb_t fb;
+    mono_fb_clear(&fb);
+
+    mono_fb_draw_text(&fb, &font, 20, 11, MONO_FB_WIDTH, "1");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bitmap, &fb.data[MONO_FB_WIDTH + 20], sizeof(bitmap));
+
+    // Anywhere else, the same pixels relative to the label top
+    mono_fb_clear(&fb);
+    mono_fb_draw_text(&fb, &font, 20, 14, MONO_FB_WIDTH, "1");
+    for (int16_t x = 0; x < 5; x++)
+    {
+        for (int16_t row = 0; row < 5; row++)
+        {
+            TEST_ASSERT_EQUAL((bitmap[x] >> (row + 3)) & 1U, mono_fb_get_pixel(&fb, 20 + x, 14 + row));
+        }
+    }
+}
+
+void test_flush_writes_only_dirty_columns(void)
+{
+    static mono_fb_t       fb;
+    static flush_capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    mono_fb_clear(&fb);
+
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, mono_fb_flush(&fb, capture_write, &capture));
+    TEST_ASSERT_EQUAL(0, mono_fb_flush(&fb, capture_write, &capture));
+
+    mono_fb_draw_text(&fb, &mono_font_5x7, 66, 36, 31, "101.3");
+    capture.n_writes = 0;
+    capture.n_bytes = 0;
+    // Rows 36 to 43 (pages 4 and 5), 26 columns but the first one of the "1" glyph is blank
+    TEST_ASSERT_EQUAL(2 * 25, mono_fb_flush(&fb, capture_write, &capture));
+    TEST_ASSERT_EQUAL(2, capture.n_writes);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(fb.data, capture.panel, MONO_FB_SIZE);
+
+    // Drawing the same text again does not change any byte
+    mono_fb_draw_text(&fb, &mono_font_5x7, 66, 36, 31, "101.3");
+    TEST_ASSERT_EQUAL(0, mono_fb_flush(&fb, capture_write, &capture));
+}
+
+void test_failed_flush_keeps_pages_dirty(void)
+{
+    static mono_fb_t       fb;
+    static flush_capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    mono_fb_clear(&fb);
+
+    TEST_ASSERT_EQUAL(0, mono_fb_flush(&fb, failing_write, NULL));
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, mono_fb_flush(&fb, capture_write, &capture));
+}
+
+void test_ui_redraws_only_changed_fields(void)
+{
+    static mono_ui_t       ui;
+    static flush_capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+
+    mono_ui_values_t values = {.amb_temp_degc = 21.4f, .amb_humid_pct = 45.2f, .amb_press_kpa = 101.3f};
+    mono_ui_init(&ui);
+    TEST_ASSERT_EQUAL(MONO_UI_FIELD_TEMP | MONO_UI_FIELD_HUMID | MONO_UI_FIELD_PRESS, mono_ui_update(&ui, &values));
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, mono_fb_flush(&ui.fb, capture_write, &capture));
+
+    // Same displayed values, nothing to send
+    values.amb_temp_degc = 21.41f;
+    TEST_ASSERT_EQUAL(0, mono_ui_update(&ui, &values));
+    TEST_ASSERT_EQUAL(0, mono_fb_flush(&ui.fb, capture_write, &capture));
+
+    // One humidity digit changed, a few columns of one page instead of the whole screen
+    values.amb_humid_pct = 45.3f;
+    TEST_ASSERT_EQUAL(MONO_UI_FIELD_HUMID, mono_ui_update(&ui, &values));
+    size_t n_bytes = mono_fb_flush(&ui.fb, capture_write, &capture);
+    TEST_ASSERT_GREATER_THAN(0, n_bytes);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * 5, n_bytes);
+
+    values.amb_temp_degc = -3.5f;
+    values.is_amb_temp_negative = true;
+    values.is_station_connected = true;
+    TEST_ASSERT_EQUAL(MONO_UI_FIELD_TEMP | MONO_UI_FIELD_TEMP_SIGN | MONO_UI_FIELD_LED, mono_ui_update(&ui, &values));
+    TEST_ASSERT_TRUE(mono_fb_get_pixel(&ui.fb, 6, 6));
+    TEST_ASSERT_EQUAL_STRING("3.5", ui.temp_text);
+
+    // Alert name shown, then cleared back to blank columns
+    values.alert_name = "FROST";
+    TEST_ASSERT_EQUAL(MONO_UI_FIELD_ALERT, mono_ui_update(&ui, &values));
+    TEST_ASSERT_EQUAL_STRING("FROST", ui.alert_text);
+    values.alert_name = NULL;
+    TEST_ASSERT_EQUAL(MONO_UI_FIELD_ALERT, mono_ui_update(&ui, &values));
+    for (int16_t x = 0; x < 64; x++)
+    {
+        TEST_ASSERT_FALSE(mono_fb_get_pixel(&ui.fb, x, 60));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fill_rect_across_pages);
+    RUN_TEST(test_unaligned_text_matches_aligned_text);
+    RUN_TEST(test_text_width_and_clipping);
+    RUN_TEST(test_pre_shifted_font_is_a_byte_copy);
+    RUN_TEST(test_flush_writes_only_dirty_columns);
+    RUN_TEST(test_failed_flush_keeps_pages_dirty);
+    RUN_TEST(test_ui_redraws_only_changed_fields);
+
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdint.h>
+
+#include "sense_optimizer.h"
+
+#define OS_1X         1U
+#define OS_2X         2U
+#define OS_4X         3U
+#define OS_16X        5U
+#define FILTER_OFF    0U
+#define FILTER_SIZE_7 3U
+
+static const sense_targets_t s_targets = {
+    .noise = {0.005f, 1.5f, 0.02f},
+    .max_meas_us = 45000,
+    .loop_period_us = 250000,
+    .max_response_us = 5000000,
+};
+
+static uint32_t s_rand_state = 12345;
+
+static float gaussian(void)
+{
+    // Box-Muller over a fixed seed LCG, reproducible
+    s_rand_state = s_rand_state * 1664525U + 1013904223U;
+    float u1 = ((s_rand_state >> 8) + 1.0f) / 16777217.0f;
+    s_rand_state = s_rand_state * 1664525U + 1013904223U;
+    float u2 = (s_rand_state >> 8) / 16777216.0f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+void test_meas_duration_matches_bme68x_api(void)
+{
+    // Previous fixed configuration: 2 + 1 + 16 cycles, bme68x_get_meas_dur() gives 42590 us
+    const uint8_t fixed[SENSE_N_CHANNELS] = {OS_2X, OS_1X, OS_16X};
+    const uint8_t shortest[SENSE_N_CHANNELS] = {OS_1X, OS_1X, OS_1X};
+    TEST_ASSERT_EQUAL(42590, sense_optimizer_meas_us(fixed));
+    TEST_ASSERT_EQUAL(3 * 1963 + 5293, sense_optimizer_meas_us(shortest));
+
+    // More oversampling or filtering is less noise
+    TEST_ASSERT_TRUE(sense_optimizer_noise(SENSE_CH_PRESS, OS_16X, FILTER_OFF) <
+                     sense_optimizer_noise(SENSE_CH_PRESS, OS_1X, FILTER_OFF));
+    TEST_ASSERT_TRUE(sense_optimizer_noise(SENSE_CH_PRESS, OS_1X, FILTER_SIZE_7) <
+                     sense_optimizer_noise(SENSE_CH_PRESS, OS_1X, FILTER_OFF));
+    TEST_ASSERT_EQUAL_FLOAT(sense_optimizer_noise(SENSE_CH_HUMID, OS_4X, FILTER_OFF),
+                            sense_optimizer_noise(SENSE_CH_HUMID, OS_4X, FILTER_SIZE_7));
+
+    // 75 % of a step after 11 samples with c = 7
+    TEST_ASSERT_EQUAL(11 * 250000, sense_optimizer_response_us(FILTER_SIZE_7, 250000));
+    TEST_ASSERT_EQUAL(250000, sense_optimizer_response_us(FILTER_OFF, 250000));
+}
+
+void test_pick_shortest_meeting_targets(void)
+{
+    sense_config_t config;
+    TEST_ASSERT_TRUE(sense_optimizer_pick(&s_targets, &config));
+    TEST_ASSERT_TRUE(config.is_target_met);
+
+    // Humidity is not filtered, its target needs 4x; the filter brings temperature and pressure down at 1x
+    TEST_ASSERT_EQUAL(OS_1X, config.os_codes[SENSE_CH_TEMP]);
+    TEST_ASSERT_EQUAL(OS_1X, config.os_codes[SENSE_CH_PRESS]);
+    TEST_ASSERT_EQUAL(OS_4X, config.os_codes[SENSE_CH_HUMID]);
+    TEST_ASSERT_EQUAL(FILTER_SIZE_7, config.filter_code); // The largest within the 5 s response
+    TEST_ASSERT_EQUAL(6 * 1963 + 5293, config.meas_us);
+    TEST_ASSERT_LESS_OR_EQUAL(s_targets.max_response_us, config.response_us);
+    for (uint8_t ch = 0; ch < SENSE_N_CHANNELS; ch++)
+    {
+        TEST_ASSERT_TRUE(config.noise[ch] <= s_targets.noise[ch]);
+    }
+
+    // Back to back measurements: shorter sample period, a larger filter fits in the same response time
+    sense_targets_t targets = s_targets;
+    targets.loop_period_us = 0;
+    TEST_ASSERT_TRUE(sense_optimizer_pick(&targets, &config));
+    TEST_ASSERT_EQUAL(6 * 1963 + 5293, config.meas_us);
+    TEST_ASSERT_TRUE(config.filter_code > FILTER_SIZE_7);
+}
+
+void test_pick_closest_when_targets_are_not_met(void)
+{
+    sense_targets_t targets = s_targets;
+    targets.noise[SENSE_CH_HUMID] = 0.001f; // Below the resolution floor
+    sense_config_t config;
+    TEST_ASSERT_FALSE(sense_optimizer_pick(&targets, &config));
+    TEST_ASSERT_FALSE(config.is_target_met);
+    TEST_ASSERT_EQUAL(OS_16X, config.os_codes[SENSE_CH_HUMID]);
+    TEST_ASSERT_LESS_OR_EQUAL(targets.max_meas_us, config.meas_us);
+
+    // No configuration fits in the duration budget: the shortest one
+    targets = s_targets;
+    targets.max_meas_us = 1000;
+    TEST_ASSERT_FALSE(sense_optimizer_pick(&targets, &config));
+    TEST_ASSERT_EQUAL(OS_1X, config.os_codes[SENSE_CH_HUMID]);
+    TEST_ASSERT_EQUAL(FILTER_OFF, config.filter_code);
+}
+
+void test_noise_meter_matches_filtered_noise(void)
+{
+    // Slow pressure ramp plus white noise through the sensor IIR filter (c = 7)
+    const float         sigma = 3.0f;
+    const uint32_t      coef = 7;
+    sense_noise_meter_t meter;
+    sense_noise_meter_reset(&meter);
+    TEST_ASSERT_TRUE(isnan(sense_noise_meter_rms(&meter, SENSE_CH_PRESS, FILTER_SIZE_7)));
+
+    float filtered = 101325.0f;
+    for (uint32_t i = 0; i < 20000; i++)
+    {
+        float raw = 101325.0f + 0.001f * (float)i + sigma * gaussian();
+        filtered += (raw - filtered) / (float)(coef + 1U);
+        const float values[SENSE_N_CHANNELS] = {21.0f + 0.01f * gaussian(), filtered, 45.0f};
+        sense_noise_meter_add(&meter, values, 17000);
+    }
+    float expected = sigma / sqrtf(2.0f * coef + 1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f * expected, expected, sense_noise_meter_rms(&meter, SENSE_CH_PRESS, FILTER_SIZE_7));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.01f, sense_noise_meter_rms(&meter, SENSE_CH_TEMP, FILTER_OFF));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, sense_noise_meter_rms(&meter, SENSE_CH_HUMID, FILTER_SIZE_7));
+    TEST_ASSERT_EQUAL(17000, sense_noise_meter_sample_us(&meter));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_meas_duration_matches_bme68x_api);
+    RUN_TEST(test_pick_shortest_meeting_targets);
+    RUN_TEST(test_pick_closest_when_targets_are_not_met);
+    RUN_TEST(test_noise_meter_matches_filtered_noise);
+
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sense_recovery.h"
+
+#define SAMPLE_PERIOD_US  250000
+#define MEASURE_US        17000
+#define BUS_RESET_US      1000
+#define SENSOR_RESET_US   12000
+#define I2C_TIMEOUT_US    20000
+#define MAX_BACKOFF_MS    8000
+
+// Simulated bus and sensor with fault injection, the time is simulated too
+typedef struct
+{
+    int64_t  now_us;
+    uint32_t n_nacks;          //< Next transactions NACKed, transient
+    bool     is_bus_stuck;     //< SDA held low, every transaction times out until a bus clear
+    bool     is_sensor_hung;   //< Measurements fail until a soft reset
+    int64_t  disconnected_until_us;
+    uint32_t n_samples;
+} sim_bus_t;
+
+static bool sim_transaction(sim_bus_t *sim)
+{
+    if (sim->now_us < sim->disconnected_until_us) return false; // NACK
+    if (sim->is_bus_stuck)
+    {
+        sim->now_us += I2C_TIMEOUT_US; // Bounded by the transaction timeout
+        return false;
+    }
+    if (sim->n_nacks > 0)
+    {
+        sim->n_nacks--;
+        return false;
+    }
+    return true;
+}
+
+static bool sim_run(sim_bus_t *sim, sense_recovery_action_t action)
+{
+    switch (action)
+    {
+    case SENSE_RECOVERY_MEASURE:
+        sim->now_us += MEASURE_US;
+        if (!sim_transaction(sim) || sim->is_sensor_hung) return false;
+        sim->n_samples++;
+        return true;
+    case SENSE_RECOVERY_RESET_BUS:
+        sim->now_us += BUS_RESET_US;
+        sim->is_bus_stuck = false;
+        return true;
+    case SENSE_RECOVERY_RESET_SENSOR:
+        sim->now_us += SENSOR_RESET_US;
+        if (!sim_transaction(sim)) return false;
+        sim->is_sensor_hung = false;
+        return true;
+    }
+    return false;
+}
+
+typedef struct
+{
+    uint32_t n_faults;
+    uint32_t n_recovered;
+    uint32_t max_wait_ms;
+} run_result_t;
+
+// Run the sensing loop as ambient_sense_task does until the time, returns the events seen
+static run_result_t run_until(sense_recovery_t *recovery, sim_bus_t *sim, int64_t end_us)
+{
+    run_result_t result = {0};
+    while (sim->now_us < end_us)
+    {
+        sense_recovery_action_t action = sense_recovery_action(recovery);
+        bool                    is_ok = sim_run(sim, action);
+        uint32_t                wait_ms;
+        sense_recovery_event_t  event = sense_recovery_report(recovery, sim->now_us, is_ok, &wait_ms);
+        if (event == SENSE_RECOVERY_EVENT_FAULT) result.n_faults++;
+        if (event == SENSE_RECOVERY_EVENT_RECOVERED) result.n_recovered++;
+        if (wait_ms > result.max_wait_ms) result.max_wait_ms = wait_ms;
+        sim->now_us += (int64_t)wait_ms * 1000;
+        if (action == SENSE_RECOVERY_MEASURE && is_ok) sim->now_us += SAMPLE_PERIOD_US - MEASURE_US;
+    }
+    return result;
+}
+
+static void init(sense_recovery_t *recovery, sim_bus_t *sim)
+{
+    const sense_recovery_config_t config = {
+        .max_retries = 1,
+        .initial_backoff_ms = 100,
+        .max_backoff_ms = MAX_BACKOFF_MS,
+        .sample_period_us = SAMPLE_PERIOD_US,
+    };
+    sense_recovery_init(recovery, &config);
+    memset(sim, 0, sizeof(*sim));
+}
+
+void test_transient_nack_is_retried(void)
+{
+    sense_recovery_t recovery;
+    sim_bus_t        sim;
+    init(&recovery, &sim);
+    run_until(&recovery, &sim, 1000000);
+    sim.n_nacks = 1;
+    run_result_t result = run_until(&recovery, &sim, 2000000);
+
+    TEST_ASSERT_EQUAL(1, result.n_faults);
+    TEST_ASSERT_EQUAL(1, result.n_recovered);
+    TEST_ASSERT_EQUAL(1, recovery.stats.n_retries);
+    TEST_ASSERT_EQUAL(0, recovery.stats.n_bus_resets);
+    TEST_ASSERT_EQUAL(1, recovery.stats.n_samples_lost);
+    TEST_ASSERT_EQUAL(MEASURE_US / 1000, recovery.stats.last_recover_ms);
+    TEST_ASSERT_EQUAL(SENSE_RECOVERY_MEASURE, sense_recovery_action(&recovery));
+}
+
+void test_stuck_bus_and_hung_sensor_are_reset(void)
+{
+    sense_recovery_t recovery;
+    sim_bus_t        sim;
+    init(&recovery, &sim);
+    run_until(&recovery, &sim, 1000000);
+    sim.is_bus_stuck = true;
+    sim.is_sensor_hung = true;
+    run_result_t result = run_until(&recovery, &sim, 2000000);
+
+    // Retry, then one bus reset and sensor reset cycle without waiting
+    TEST_ASSERT_EQUAL(1, result.n_faults);
+    TEST_ASSERT_EQUAL(1, result.n_recovered);
+    TEST_ASSERT_EQUAL(1, recovery.stats.n_bus_resets);
+    TEST_ASSERT_EQUAL(1, recovery.stats.n_sensor_resets);
+    TEST_ASSERT_EQUAL(0, result.max_wait_ms);
+    // From the first failure: the retry timing out, the resets and the measurement
+    TEST_ASSERT_EQUAL((MEASURE_US + I2C_TIMEOUT_US + BUS_RESET_US + SENSOR_RESET_US + MEASURE_US) / 1000,
+                      recovery.stats.last_recover_ms);
+}
+
+void test_failed_setup_is_recovered(void)
+{
+    sense_recovery_t recovery;
+    sim_bus_t        sim;
+    init(&recovery, &sim);
+    TEST_ASSERT_EQUAL(SENSE_RECOVERY_RESET_SENSOR, sense_recovery_action(&recovery));
+    sim.disconnected_until_us = 500000; // Sensor not powered yet
+    run_result_t result = run_until(&recovery, &sim, 2000000);
+
+    TEST_ASSERT_EQUAL(1, result.n_faults);
+    TEST_ASSERT_EQUAL(1, result.n_recovered);
+    TEST_ASSERT_EQUAL(0, recovery.stats.n_retries);
+    TEST_ASSERT_TRUE(sim.n_samples > 0);
+}
+
+void test_disconnected_sensor_backs_off_and_recovers(void)
+{
+    sense_recovery_t recovery;
+    sim_bus_t        sim;
+    init(&recovery, &sim);
+    run_until(&recovery, &sim, 1000000);
+    sim.disconnected_until_us = sim.now_us + 60 * 1000000LL;
+    uint32_t     n_samples = sim.n_samples;
+    run_result_t result = run_until(&recovery, &sim, sim.disconnected_until_us);
+
+    // Few attempts while disconnected, the back-off is capped
+    TEST_ASSERT_EQUAL(1, result.n_faults);
+    TEST_ASSERT_EQUAL(0, result.n_recovered);
+    TEST_ASSERT_EQUAL(MAX_BACKOFF_MS, result.max_wait_ms);
+    TEST_ASSERT_LESS_THAN(20, recovery.stats.n_sensor_resets);
+    TEST_ASSERT_EQUAL(n_samples, sim.n_samples);
+
+    // Measured again within the back-off and one cycle after the reconnection
+    int64_t reconnected_us = sim.now_us;
+    result = run_until(&recovery, &sim, reconnected_us + (MAX_BACKOFF_MS + 1000) * 1000LL);
+    TEST_ASSERT_EQUAL(1, result.n_recovered);
+    TEST_ASSERT_GREATER_THAN(n_samples, sim.n_samples);
+    TEST_ASSERT_TRUE(recovery.stats.last_recover_ms >= 60000);
+    TEST_ASSERT_TRUE(recovery.stats.last_recover_ms <= 60000 + MAX_BACKOFF_MS + 1000);
+    TEST_ASSERT_EQUAL(recovery.stats.last_recover_ms * 1000 / SAMPLE_PERIOD_US, recovery.stats.n_samples_lost);
+    printf("Disconnected 60 s: recovered in %lu ms, %lu samples lost, %lu sensor resets\n",
+           (unsigned long)recovery.stats.last_recover_ms,
+           (unsigned long)recovery.stats.n_samples_lost,
+           (unsigned long)recovery.stats.n_sensor_resets);
+
+    // The next fault starts again with a retry and no back-off
+    sim.n_nacks = 2;
+    result = run_until(&recovery, &sim, sim.now_us + 1000000);
+    TEST_ASSERT_EQUAL(1, result.n_recovered);
+    TEST_ASSERT_EQUAL(0, result.max_wait_ms);
+    TEST_ASSERT_TRUE(recovery.stats.max_recover_ms >= 60000);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_transient_nack_is_retried);
+    RUN_TEST(test_stuck_bus_and_hung_sensor_are_reset);
+    RUN_TEST(test_failed_setup_is_recovered);
+    RUN_TEST(test_disconnected_sensor_backs_off_and_recovers);
+
+    return UNITY_END();
+}
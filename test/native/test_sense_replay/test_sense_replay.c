@@ -0,0 +1,368 @@
+#include <unity.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bme68x.h"
+
+#include "alert_engine.h"
+#include "i2c_trace.h"
+#include "meteo_frame.h"
+#include "window_stats.h"
+
+// NOTE: End to end replay of the sensing pipeline. A simulated BME688 (register map with a calibration and a daily
+// signal) is driven by the BME68x API through interface ports which record the bus like the ambient_sense ones do.
+// The same driver calls then run on the i2c_trace BME68x ports over that trace, and must rebuild the same frames,
+// alerts and statistics. ambient_sense itself needs FreeRTOS, the pipeline below is its measure and recovery
+// sequence: the sensor setup (bme68x_init(), set_conf, set_heatr_conf), the forced measurement, the shared frame
+// fill (meteo_frame_set_sample()) and the per frame consumers.
+#define BME688_ADDR       0x76
+#define SAMPLE_PERIOD_US  10000000LL
+#define SAMPLES_PER_DAY   (24LL * 3600 * 1000000 / SAMPLE_PERIOD_US)
+#define DROPOUT_START     3000 //< The sensor NACKs these samples, the pipeline sets it up again afterwards
+#define DROPOUT_END       3010
+#define SIM_CHIP_ID       0x61
+#define SIM_VARIANT_ID    0x01 //< BME688
+#define SIM_REG_CHIP_ID   0xD0
+#define SIM_REG_VARIANT   0xF0
+#define SIM_REG_RESET     0xE0
+#define SIM_RESET_CMD     0xB6
+#define SIM_FORCED_MODE   0x01
+#define SIM_MODE_MSK      0x03
+
+// Calibration registers of a BME680 (0x8A to 0xA0, 0xE1 to 0xEE, 0x00 to 0x04), same layout as get_calib_data()
+static const uint8_t sim_calib_8a[23] = {0x73, 0x67, 0x03, 0x00, 0xF8, 0x8D, 0x3E, 0xD7, 0x58, 0x00, 0x87, 0x1B,
+                                         0xB6, 0xFF, 0x2C, 0x1E, 0x00, 0x00, 0x56, 0xF9, 0x29, 0xF0, 0x1E};
+static const uint8_t sim_calib_e1[14] = {0x3F, 0xD8, 0x30, 0x00, 0x2D, 0x14, 0x78,
+                                         0x9C, 0x9A, 0x66, 0xDE, 0x8F, 0xEC, 0x12};
+static const uint8_t sim_calib_00[5] = {0x30, 0x00, 0x2B, 0x00, 0x00};
+
+typedef struct
+{
+    uint8_t  regs[256];
+    int64_t  now_us;
+    uint32_t sample;  //< Index of the current sample, sets the measured signal
+    bool     is_nack; //< Sensor off the bus
+} sim_bme688_t;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t   size;
+    size_t   capacity;
+} trace_buffer_t;
+
+typedef struct
+{
+    sim_bme688_t   sim;
+    trace_buffer_t trace;
+} recorder_t;
+
+// Sensing pipeline over one BME68x interface, the recorder or the replay
+typedef struct
+{
+    struct bme68x_dev  dev;
+    struct bme68x_conf conf;
+    int64_t (*now_us)(void *intf_ptr);
+    bool           is_setup;
+    meteo_frame_t  frame;
+    alert_engine_t alerts;
+    window_stats_t temp_stats;
+    uint32_t       alert_changes;
+} pipeline_t;
+
+static uint8_t s_field_regs[METEO_RAW_FIELD_REGS_LEN];
+
+static void sim_reset(sim_bme688_t *sim)
+{
+    memset(sim->regs, 0, sizeof(sim->regs));
+    memcpy(&sim->regs[0x8A], sim_calib_8a, sizeof(sim_calib_8a));
+    memcpy(&sim->regs[0xE1], sim_calib_e1, sizeof(sim_calib_e1));
+    memcpy(&sim->regs[0x00], sim_calib_00, sizeof(sim_calib_00));
+    sim->regs[SIM_REG_CHIP_ID] = SIM_CHIP_ID;
+    sim->regs[SIM_REG_VARIANT] = SIM_VARIANT_ID;
+}
+
+// Forced measurement: the field data registers get the signal of the current sample, then the sensor sleeps again
+static void sim_measure(sim_bme688_t *sim)
+{
+    // Daily triangle wave with a bit of noise, humidity going the other way
+    uint32_t phase = sim->sample % SAMPLES_PER_DAY;
+    uint32_t wave = (phase < SAMPLES_PER_DAY / 2) ? phase : SAMPLES_PER_DAY - phase;
+    uint32_t temp_adc = 470000U + wave * 8U + (sim->sample * 7919U) % 13U;
+    uint32_t press_adc = 340000U + (sim->sample * 104729U) % 97U;
+    uint16_t hum_adc = (uint16_t)(30000U - wave * 2U);
+
+    uint8_t *field = &sim->regs[BME68X_REG_FIELD0];
+    field[0] = BME68X_NEW_DATA_MSK;
+    field[2] = (uint8_t)(press_adc >> 12);
+    field[3] = (uint8_t)(press_adc >> 4);
+    field[4] = (uint8_t)(press_adc << 4);
+    field[5] = (uint8_t)(temp_adc >> 12);
+    field[6] = (uint8_t)(temp_adc >> 4);
+    field[7] = (uint8_t)(temp_adc << 4);
+    field[8] = (uint8_t)(hum_adc >> 8);
+    field[9] = (uint8_t)hum_adc;
+}
+
+static void sim_write_reg(sim_bme688_t *sim, uint8_t reg, uint8_t value)
+{
+    if (reg == SIM_REG_RESET)
+    {
+        if (value == SIM_RESET_CMD) sim_reset(sim);
+        return;
+    }
+    if (reg == BME68X_REG_CTRL_MEAS && (value & SIM_MODE_MSK) == SIM_FORCED_MODE)
+    {
+        sim_measure(sim);
+        value &= (uint8_t)~SIM_MODE_MSK;
+    }
+    sim->regs[reg] = value;
+}
+
+static void trace_append(trace_buffer_t *trace, const i2c_trace_record_t *record)
+{
+    if (trace->size + I2C_TRACE_MAX_RECORD_SIZE > trace->capacity)
+    {
+        trace->capacity = (trace->capacity + I2C_TRACE_MAX_RECORD_SIZE) * 2;
+        trace->data = realloc(trace->data, trace->capacity);
+    }
+    trace->size += i2c_trace_encode(record, &trace->data[trace->size], trace->capacity - trace->size);
+}
+
+// Same copy as ambient_sense, the raw ADC values come from the last field data read
+static void keep_field_regs(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length)
+{
+    if (reg_addr == BME68X_REG_FIELD0 && length >= BME68X_LEN_FIELD) memcpy(s_field_regs, reg_data, BME68X_LEN_FIELD);
+}
+
+// Recording ports, the transactions of the ambient_sense BME68x ports: a register read is a write then read of the
+// register address, a register write is the address then the data
+static BME68X_INTF_RET_TYPE record_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    recorder_t *recorder = (recorder_t *)intf_ptr;
+    bool        is_ok = !recorder->sim.is_nack;
+    for (uint32_t i = 0; i < length; i++) reg_data[i] = is_ok ? recorder->sim.regs[(uint8_t)(reg_addr + i)] : 0xFF;
+
+    const i2c_trace_record_t record = {
+        .timestamp_us = recorder->sim.now_us,
+        .kind = I2C_TRACE_WRITE_READ,
+        .flags = is_ok ? 0 : I2C_TRACE_FLAG_ERROR,
+        .address = BME688_ADDR,
+        .write_length = 1,
+        .read_length = (uint16_t)length,
+        .write_data = &reg_addr,
+        .read_data = reg_data,
+    };
+    trace_append(&recorder->trace, &record);
+    if (is_ok) keep_field_regs(reg_addr, reg_data, length);
+    return is_ok ? BME68X_OK : BME68X_E_COM_FAIL;
+}
+
+static BME68X_INTF_RET_TYPE record_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    recorder_t *recorder = (recorder_t *)intf_ptr;
+    bool        is_ok = !recorder->sim.is_nack;
+    if (is_ok && length > 0)
+    {
+        // Burst of address and data pairs, see bme68x_set_regs()
+        sim_write_reg(&recorder->sim, reg_addr, reg_data[0]);
+        for (uint32_t i = 1; i + 1 < length; i += 2) sim_write_reg(&recorder->sim, reg_data[i], reg_data[i + 1]);
+    }
+
+    uint8_t write_data[1 + 2 * BME68X_LEN_FIELD];
+    TEST_ASSERT_LESS_THAN(sizeof(write_data), length);
+    write_data[0] = reg_addr;
+    memcpy(&write_data[1], reg_data, length);
+    const i2c_trace_record_t record = {
+        .timestamp_us = recorder->sim.now_us,
+        .kind = I2C_TRACE_WRITE,
+        .flags = is_ok ? 0 : I2C_TRACE_FLAG_ERROR,
+        .address = BME688_ADDR,
+        .write_length = (uint16_t)(length + 1),
+        .write_data = write_data,
+    };
+    trace_append(&recorder->trace, &record);
+    return is_ok ? BME68X_OK : BME68X_E_COM_FAIL;
+}
+
+static void record_delay_us(uint32_t period, void *intf_ptr)
+{
+    ((recorder_t *)intf_ptr)->sim.now_us += period;
+}
+
+static int64_t record_now_us(void *intf_ptr)
+{
+    return ((recorder_t *)intf_ptr)->sim.now_us;
+}
+
+static BME68X_INTF_RET_TYPE replay_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    int8_t ret = i2c_trace_bme68x_read(reg_addr, reg_data, length, intf_ptr);
+    if (ret == BME68X_OK) keep_field_regs(reg_addr, reg_data, length);
+    return ret;
+}
+
+static int64_t replay_now_us(void *intf_ptr)
+{
+    return i2c_trace_replay_now_us(((i2c_trace_bme68x_intf_t *)intf_ptr)->replay);
+}
+
+static void pipeline_init(pipeline_t *pipeline,
+                          void       *intf_ptr,
+                          bme68x_read_fptr_t read,
+                          bme68x_write_fptr_t write,
+                          bme68x_delay_us_fptr_t delay_us,
+                          int64_t (*now_us)(void *intf_ptr))
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->dev = (struct bme68x_dev){
+        .intf_ptr = intf_ptr,
+        .intf = BME68X_I2C_INTF,
+        .amb_temp = 25,
+        .read = read,
+        .write = write,
+        .delay_us = delay_us,
+    };
+    pipeline->conf = (struct bme68x_conf){
+        .os_hum = BME68X_OS_2X,
+        .os_temp = BME68X_OS_4X,
+        .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3,
+        .odr = BME68X_ODR_NONE,
+    };
+    pipeline->now_us = now_us;
+    alert_engine_init(&pipeline->alerts);
+    window_stats_init(&pipeline->temp_stats, 24LL * 3600 * 1000000, WINDOW_STATS_MAX_BUCKETS);
+}
+
+// One step of the ambient_sense loop: the sensor setup until it succeeds, then a forced measurement per step. A
+// failed measurement sets the sensor up again. Returns true when a frame was produced.
+static bool pipeline_step(pipeline_t *pipeline)
+{
+    struct bme68x_dev *dev = &pipeline->dev;
+    if (!pipeline->is_setup)
+    {
+        const struct bme68x_heatr_conf heatr_conf = {
+            .enable = BME68X_DISABLE,
+            .heatr_temp = 320,
+            .heatr_dur = 150,
+        };
+        int8_t ret = bme68x_init(dev);
+        if (ret == BME68X_OK) ret = bme68x_set_conf(&pipeline->conf, dev);
+        if (ret == BME68X_OK) ret = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, dev);
+        pipeline->is_setup = (ret == BME68X_OK);
+        return false;
+    }
+
+    struct bme68x_data data;
+    uint8_t            n_fields = 0;
+    int8_t             ret = bme68x_set_op_mode(BME68X_FORCED_MODE, dev);
+    if (ret == BME68X_OK)
+    {
+        dev->delay_us(bme68x_get_meas_dur(BME68X_FORCED_MODE, &pipeline->conf, dev), dev->intf_ptr);
+        ret = bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, dev);
+    }
+    if (ret != BME68X_OK || n_fields == 0)
+    {
+        pipeline->is_setup = false;
+        return false;
+    }
+
+    meteo_frame_set_sample(&pipeline->frame,
+                           pipeline->now_us(dev->intf_ptr),
+                           data.temperature,
+                           data.pressure,
+                           data.humidity,
+                           data.gas_resistance,
+                           s_field_regs);
+    pipeline->alert_changes += alert_engine_eval(&pipeline->alerts, &pipeline->frame) != 0;
+    window_stats_add(&pipeline->temp_stats, pipeline->frame.timestamp_us, pipeline->frame.temperature_degc);
+    return true;
+}
+
+static void assert_frames_equal(const meteo_frame_t *expected, const meteo_frame_t *actual)
+{
+    TEST_ASSERT_EQUAL_UINT32(expected->sequence, actual->sequence);
+    TEST_ASSERT_TRUE(expected->timestamp_us == actual->timestamp_us);
+    TEST_ASSERT_EQUAL_FLOAT(expected->temperature_degc, actual->temperature_degc);
+    TEST_ASSERT_EQUAL_FLOAT(expected->pressure_pa, actual->pressure_pa);
+    TEST_ASSERT_EQUAL_FLOAT(expected->humidity_pct, actual->humidity_pct);
+    TEST_ASSERT_EQUAL_FLOAT(expected->gas_resistance_ohm, actual->gas_resistance_ohm);
+    TEST_ASSERT_EQUAL_UINT32(expected->raw.temp_adc, actual->raw.temp_adc);
+    TEST_ASSERT_EQUAL_UINT32(expected->raw.press_adc, actual->raw.press_adc);
+    TEST_ASSERT_EQUAL_UINT16(expected->raw.hum_adc, actual->raw.hum_adc);
+}
+
+void setUp(void)
+{
+    memset(s_field_regs, 0, sizeof(s_field_regs));
+}
+
+void tearDown(void)
+{
+}
+
+void test_day_replays_through_driver(void)
+{
+    // Record a day, with a sensor dropout
+    static recorder_t recorder;
+    static pipeline_t recorded;
+    memset(&recorder, 0, sizeof(recorder));
+    sim_reset(&recorder.sim);
+    recorder.trace.capacity = I2C_TRACE_HEADER_SIZE;
+    recorder.trace.data = malloc(recorder.trace.capacity);
+    recorder.trace.size = i2c_trace_encode_header(recorder.trace.data, recorder.trace.capacity);
+    pipeline_init(&recorded, &recorder, record_read, record_write, record_delay_us, record_now_us);
+
+    meteo_frame_t *frames = calloc(SAMPLES_PER_DAY, sizeof(meteo_frame_t));
+    uint32_t       n_frames = 0;
+    for (uint32_t i = 0; i < SAMPLES_PER_DAY; i++)
+    {
+        int64_t release_us = (int64_t)i * SAMPLE_PERIOD_US;
+        if (recorder.sim.now_us < release_us) recorder.sim.now_us = release_us;
+        recorder.sim.sample = i;
+        recorder.sim.is_nack = (i >= DROPOUT_START && i < DROPOUT_END);
+        if (pipeline_step(&recorded)) frames[n_frames++] = recorded.frame;
+    }
+    // Setup step, then a frame per step but for the failed steps and the setup after the dropout
+    TEST_ASSERT_EQUAL_UINT32(SAMPLES_PER_DAY - 1 - (DROPOUT_END - DROPOUT_START) - 1, n_frames);
+    TEST_ASSERT_EQUAL_HEX8(BME68X_NEW_DATA_MSK, frames[0].raw.status & BME68X_NEW_DATA_MSK);
+
+    // Replay it through the same driver calls, with no sensor
+    static pipeline_t       replayed;
+    i2c_trace_replay_t      replay;
+    i2c_trace_bme68x_intf_t intf = {&replay, BME688_ADDR};
+    TEST_ASSERT_TRUE(i2c_trace_replay_init(&replay, recorder.trace.data, recorder.trace.size));
+    pipeline_init(&replayed, &intf, replay_read, i2c_trace_bme68x_write, i2c_trace_bme68x_delay_us, replay_now_us);
+
+    uint32_t n_replayed = 0;
+    while (!i2c_trace_replay_is_done(&replay, BME688_ADDR))
+    {
+        if (!pipeline_step(&replayed)) continue;
+        TEST_ASSERT_LESS_THAN_UINT32(n_frames, n_replayed);
+        assert_frames_equal(&frames[n_replayed], &replayed.frame);
+        n_replayed++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, replay.n_mismatches);
+    TEST_ASSERT_EQUAL_UINT32(n_frames, n_replayed);
+    TEST_ASSERT_EQUAL_UINT32(recorded.alert_changes, replayed.alert_changes);
+    TEST_ASSERT_EQUAL_HEX8(recorded.alerts.active_mask, replayed.alerts.active_mask);
+    TEST_ASSERT_EQUAL_UINT32(window_stats_count(&recorded.temp_stats), window_stats_count(&replayed.temp_stats));
+    TEST_ASSERT_EQUAL_FLOAT(window_stats_min(&recorded.temp_stats), window_stats_min(&replayed.temp_stats));
+    TEST_ASSERT_EQUAL_FLOAT(window_stats_max(&recorded.temp_stats), window_stats_max(&replayed.temp_stats));
+    TEST_ASSERT_EQUAL_FLOAT(window_stats_mean(&recorded.temp_stats), window_stats_mean(&replayed.temp_stats));
+
+    free(frames);
+    free(recorder.trace.data);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_day_replays_through_driver);
+
+    return UNITY_END();
+}
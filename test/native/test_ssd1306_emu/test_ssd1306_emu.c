@@ -0,0 +1,210 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mono_fb.h"
+#include "mono_ui.h"
+#include "ssd1306_emu.h"
+
+// Golden image of the main screen below (FNV-1a of its PBM), update it with the snapshot when the layout changes
+#define MAIN_SCREEN_PBM_FNV1A 0xCDF9AFBBU
+
+static uint32_t fnv1a(const uint8_t *data, size_t length)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619U;
+    return hash;
+}
+
+// Written in SSD1306_EMU_SNAPSHOT_DIR when set, e.g. to keep the snapshots as CI artifacts
+static void save_snapshot(const char *name, const uint8_t *data, size_t length)
+{
+    const char *dir = getenv("SSD1306_EMU_SNAPSHOT_DIR");
+    if (dir == NULL) return;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return;
+    fwrite(data, 1, length, file);
+    fclose(file);
+}
+
+void test_horizontal_addressing_wraps_in_the_window(void)
+{
+    static ssd1306_emu_t emu;
+    ssd1306_emu_init(&emu);
+    ssd1306_emu_panel_init(&emu);
+    TEST_ASSERT_TRUE(emu.is_on);
+    TEST_ASSERT_EQUAL(SSD1306_EMU_ADDRESSING_HORIZONTAL, emu.addressing);
+
+    // 3 columns x 2 pages window, 7 bytes: the last one wraps to the window start
+    const uint8_t window[] = {0x00, 0x21, 10, 12, 0x22, 2, 3};
+    const uint8_t pixels[] = {0x40, 1, 2, 3, 4, 5, 6, 7};
+    TEST_ASSERT_TRUE(ssd1306_emu_transfer(&emu, window, sizeof(window)));
+    TEST_ASSERT_TRUE(ssd1306_emu_transfer(&emu, pixels, sizeof(pixels)));
+    TEST_ASSERT_EQUAL_HEX8(7, emu.gram[2 * SSD1306_EMU_WIDTH + 10]);
+    TEST_ASSERT_EQUAL_HEX8(3, emu.gram[2 * SSD1306_EMU_WIDTH + 12]);
+    TEST_ASSERT_EQUAL_HEX8(4, emu.gram[3 * SSD1306_EMU_WIDTH + 10]);
+    TEST_ASSERT_EQUAL_HEX8(6, emu.gram[3 * SSD1306_EMU_WIDTH + 12]);
+    TEST_ASSERT_EQUAL_HEX8(0, emu.gram[2 * SSD1306_EMU_WIDTH + 13]);
+
+    // Bit 0 of a page byte is the top row of the page
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, 10, 16 + 0));
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, 10, 16 + 1));
+    TEST_ASSERT_FALSE(ssd1306_emu_get_pixel(&emu, 10, 16 + 3));
+    TEST_ASSERT_EQUAL(0, emu.stats.n_unknown_commands);
+}
+
+void test_page_addressing_and_single_byte_controls(void)
+{
+    static ssd1306_emu_t emu;
+    ssd1306_emu_init(&emu);
+
+    // Co set: one command byte per control byte, column 0x25 of page 5, then data up to the stop condition
+    const uint8_t position[] = {0x80, 0xB5, 0x80, 0x05, 0x80, 0x12, 0x80, 0xAF};
+    const uint8_t pixels[] = {0x40, 0xAA, 0x55};
+    TEST_ASSERT_TRUE(ssd1306_emu_transfer(&emu, position, sizeof(position)));
+    TEST_ASSERT_TRUE(ssd1306_emu_transfer(&emu, pixels, sizeof(pixels)));
+    TEST_ASSERT_EQUAL_HEX8(0xAA, emu.gram[5 * SSD1306_EMU_WIDTH + 0x25]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, emu.gram[5 * SSD1306_EMU_WIDTH + 0x26]);
+    TEST_ASSERT_TRUE(emu.is_on);
+
+    // A command split over transfers takes its arguments from the next command bytes
+    const uint8_t contrast[] = {0x00, 0x81};
+    const uint8_t level[] = {0x00, 0xCF};
+    ssd1306_emu_transfer(&emu, contrast, sizeof(contrast));
+    ssd1306_emu_transfer(&emu, level, sizeof(level));
+    TEST_ASSERT_EQUAL_HEX8(0xCF, emu.contrast);
+
+    ssd1306_emu_stats_t stats;
+    ssd1306_emu_take_stats(&emu, &stats);
+    TEST_ASSERT_EQUAL(4, stats.n_transfers);
+    TEST_ASSERT_EQUAL(4 + 1 + 2, stats.n_control_bytes);
+    TEST_ASSERT_EQUAL(4 + 2, stats.n_command_bytes);
+    TEST_ASSERT_EQUAL(2, stats.n_data_bytes);
+    TEST_ASSERT_FALSE(ssd1306_emu_transfer(&emu, pixels, 0));
+}
+
+void test_display_state_applies_to_the_image(void)
+{
+    static ssd1306_emu_t emu;
+    ssd1306_emu_init(&emu);
+    ssd1306_emu_panel_init(&emu);
+    const uint8_t corner[] = {0x01};
+    ssd1306_emu_panel_draw_bitmap(&emu, 0, 0, 1, 8, corner);
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, 0, 0));
+
+    const uint8_t mirror[] = {0x00, 0xA1, 0xC8};
+    ssd1306_emu_transfer(&emu, mirror, sizeof(mirror));
+    TEST_ASSERT_FALSE(ssd1306_emu_get_pixel(&emu, 0, 0));
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, SSD1306_EMU_WIDTH - 1, SSD1306_EMU_HEIGHT - 1));
+
+    const uint8_t invert[] = {0x00, 0xA0, 0xC0, 0xA7};
+    ssd1306_emu_transfer(&emu, invert, sizeof(invert));
+    TEST_ASSERT_FALSE(ssd1306_emu_get_pixel(&emu, 0, 0));
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, 1, 0));
+
+    const uint8_t start_line[] = {0x00, 0xA6, 0x40 | 63};
+    ssd1306_emu_transfer(&emu, start_line, sizeof(start_line));
+    TEST_ASSERT_TRUE(ssd1306_emu_get_pixel(&emu, 0, 1)); // GRAM row 63 is shown first
+
+    const uint8_t off[] = {0x00, 0xAE};
+    ssd1306_emu_transfer(&emu, off, sizeof(off));
+    TEST_ASSERT_FALSE(ssd1306_emu_get_pixel(&emu, 0, 1));
+}
+
+void test_snapshot_encoding(void)
+{
+    static ssd1306_emu_t emu;
+    ssd1306_emu_init(&emu);
+    ssd1306_emu_panel_init(&emu);
+    const uint8_t corner[] = {0x01};
+    ssd1306_emu_panel_draw_bitmap(&emu, 0, 0, 1, 8, corner);
+
+    uint8_t pbm[SSD1306_EMU_PBM_SIZE];
+    TEST_ASSERT_EQUAL(SSD1306_EMU_PBM_SIZE, ssd1306_emu_encode_pbm(&emu, pbm, sizeof(pbm)));
+    TEST_ASSERT_EQUAL_MEMORY("P4\n128 64\n", pbm, 10);
+    TEST_ASSERT_EQUAL_HEX8(0x7F, pbm[10]); // Lit pixel white (0), the others black
+    TEST_ASSERT_EQUAL_HEX8(0xFF, pbm[10 + 16]);
+    TEST_ASSERT_EQUAL(0, ssd1306_emu_encode_pbm(&emu, pbm, sizeof(pbm) - 1));
+
+    static uint8_t png[SSD1306_EMU_PNG_SIZE];
+    TEST_ASSERT_EQUAL(SSD1306_EMU_PNG_SIZE, ssd1306_emu_encode_png(&emu, png, sizeof(png)));
+    TEST_ASSERT_EQUAL_MEMORY("\x89PNG\r\n\x1A\n", png, 8);
+    TEST_ASSERT_EQUAL_MEMORY("IHDR", &png[12], 4);
+    TEST_ASSERT_EQUAL_MEMORY("\x00\x00\x00\x00IEND\xAE\x42\x60\x82", &png[SSD1306_EMU_PNG_SIZE - 12], 12);
+    TEST_ASSERT_EQUAL_HEX8(0x80, png[33 + 8 + 7 + 1]); // First row, after its filter byte
+    save_snapshot("corner.png", png, sizeof(png));
+}
+
+void test_main_screen_frame_cost(void)
+{
+    static mono_ui_t     ui;
+    static ssd1306_emu_t emu;
+    ssd1306_emu_init(&emu);
+    ssd1306_emu_panel_init(&emu);
+    mono_ui_init(&ui);
+
+    mono_ui_values_t values = {
+        .amb_temp_degc = 21.5f,
+        .amb_humid_pct = 45.2f,
+        .amb_press_kpa = 101.3f,
+        .is_amb_temp_negative = false,
+        .is_station_connected = true,
+        .alert_name = NULL,
+    };
+    mono_ui_update(&ui, &values);
+    ssd1306_emu_stats_t stats;
+    ssd1306_emu_take_stats(&emu, &stats);
+    size_t n_bytes = mono_fb_flush(&ui.fb, ssd1306_emu_write_page, &emu);
+    ssd1306_emu_take_stats(&emu, &stats);
+
+    // The panel shows the framebuffer, a full frame is 3 transfers and 1 KB of pixels per page
+    for (int16_t y = 0; y < MONO_FB_HEIGHT; y++)
+    {
+        for (int16_t x = 0; x < MONO_FB_WIDTH; x++)
+        {
+            TEST_ASSERT_EQUAL_MESSAGE(mono_fb_get_pixel(&ui.fb, x, y), ssd1306_emu_get_pixel(&emu, x, y), "pixel");
+        }
+    }
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, n_bytes);
+    TEST_ASSERT_EQUAL(MONO_FB_SIZE, stats.n_data_bytes);
+    TEST_ASSERT_EQUAL(3 * MONO_FB_N_PAGES, stats.n_transfers);
+    TEST_ASSERT_EQUAL(6 * MONO_FB_N_PAGES, stats.n_command_bytes);
+    uint32_t full_frame_us = ssd1306_emu_bus_time_us(&stats, 400000);
+
+    uint8_t pbm[SSD1306_EMU_PBM_SIZE];
+    ssd1306_emu_encode_pbm(&emu, pbm, sizeof(pbm));
+    save_snapshot("main_screen.pbm", pbm, sizeof(pbm));
+    printf("Main screen PBM FNV-1a 0x%08lX\n", (unsigned long)fnv1a(pbm, sizeof(pbm)));
+    TEST_ASSERT_EQUAL_HEX32(MAIN_SCREEN_PBM_FNV1A, fnv1a(pbm, sizeof(pbm)));
+
+    // A humidity digit change only sends the columns of the changed glyphs
+    values.amb_humid_pct = 45.3f;
+    mono_ui_update(&ui, &values);
+    mono_fb_flush(&ui.fb, ssd1306_emu_write_page, &emu);
+    ssd1306_emu_take_stats(&emu, &stats);
+    uint32_t update_us = ssd1306_emu_bus_time_us(&stats, 400000);
+    printf("Full frame %lu us, humidity update %lu us (%lu transfers, %lu data bytes) at 400 kHz\n",
+           (unsigned long)full_frame_us,
+           (unsigned long)update_us,
+           (unsigned long)stats.n_transfers,
+           (unsigned long)stats.n_data_bytes);
+    TEST_ASSERT_LESS_OR_EQUAL(3 * 2, stats.n_transfers);
+    TEST_ASSERT_LESS_THAN(full_frame_us / 10, update_us);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_horizontal_addressing_wraps_in_the_window);
+    RUN_TEST(test_page_addressing_and_single_byte_controls);
+    RUN_TEST(test_display_state_applies_to_the_image);
+    RUN_TEST(test_snapshot_encoding);
+    RUN_TEST(test_main_screen_frame_cost);
+
+    return UNITY_END();
+}
@@ -0,0 +1,360 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "station_link.h"
+
+#define SECOND_US         1000000LL
+#define MAX_LATENCY_US    (2 * SECOND_US)
+#define SIM_DURATION_US   (600 * SECOND_US)
+#define SIM_MAX_NODES     20U
+#define SIM_MAX_ATTEMPTS  4U  //< ESP-NOW unicast: the frame and its MAC retries
+#define SIM_AIRTIME_US    962 //< 1 Mbps: 14 payload bytes in the 57 byte frame, preamble, SIFS and ACK
+#define SIM_TICK_US       50000LL
+
+static station_link_coordinator_t s_coordinator;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static uint8_t encode_at(station_link_leaf_t *leaf, int64_t leaf_time_us, float temp_degc, uint8_t *frame)
+{
+    meteo_frame_t measurement = {
+        .timestamp_us = leaf_time_us, .temperature_degc = temp_degc, .pressure_pa = 101325.0f, .humidity_pct = 50.0f};
+    return (uint8_t)station_link_encode_frame(leaf, &measurement, frame, STATION_LINK_FRAME_SIZE);
+}
+
+void test_frame_round_trip(void)
+{
+    station_link_leaf_t   leaf = {.node_id = 7, .next_sequence = 65535};
+    uint8_t               frame[STATION_LINK_FRAME_SIZE];
+    station_link_sample_t sample;
+    TEST_ASSERT_EQUAL(STATION_LINK_FRAME_SIZE, encode_at(&leaf, 123456789LL, -12.34f, frame));
+    TEST_ASSERT_EQUAL_UINT16(0, leaf.next_sequence); // Wrapped
+    TEST_ASSERT_TRUE(station_link_decode_frame(frame, sizeof(frame), &sample));
+    TEST_ASSERT_EQUAL_UINT8(7, sample.node_id);
+    TEST_ASSERT_EQUAL_UINT16(65535, sample.sequence);
+    TEST_ASSERT_EQUAL_UINT32(123456, sample.leaf_time_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, -12.34f, history_store_unpack(HISTORY_CH_TEMP, sample.values[HISTORY_CH_TEMP]));
+    TEST_ASSERT_EQUAL_FLOAT(101325.0f, history_store_unpack(HISTORY_CH_PRESS, sample.values[HISTORY_CH_PRESS]));
+
+    TEST_ASSERT_FALSE(station_link_decode_frame(frame, sizeof(frame) - 1, &sample));
+    frame[1] = 0; // The coordinator id
+    TEST_ASSERT_FALSE(station_link_decode_frame(frame, sizeof(frame), &sample));
+    frame[1] = 7;
+    frame[0] = STATION_LINK_VERSION + 1;
+    TEST_ASSERT_FALSE(station_link_decode_frame(frame, sizeof(frame), &sample));
+}
+
+static bool receive_seq(station_link_leaf_t *leaf, uint16_t sequence, int64_t leaf_time_us, int64_t rx_us)
+{
+    uint8_t               frame[STATION_LINK_FRAME_SIZE];
+    station_link_record_t record;
+    leaf->next_sequence = sequence;
+    encode_at(leaf, leaf_time_us, 20.0f, frame);
+    return station_link_receive(&s_coordinator, frame, sizeof(frame), rx_us, &record);
+}
+
+void test_dedup_window_and_restart(void)
+{
+    station_link_init_coordinator(&s_coordinator, MAX_LATENCY_US);
+    station_link_leaf_t        leaf = {.node_id = 3};
+    station_link_node_stats_t *stats = &s_coordinator.nodes[3].stats;
+
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 65530, 1000 * SECOND_US, 5 * SECOND_US));
+    TEST_ASSERT_FALSE(receive_seq(&leaf, 65530, 1000 * SECOND_US, 5 * SECOND_US + 900)); // Lost ACK, resent
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 65533, 1003 * SECOND_US, 8 * SECOND_US));
+    TEST_ASSERT_EQUAL_UINT32(2, stats->n_lost);
+    // A frame resent by the leaf after its MAC retries gave up comes late, once
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 65531, 1001 * SECOND_US, 9 * SECOND_US));
+    TEST_ASSERT_FALSE(receive_seq(&leaf, 65531, 1001 * SECOND_US, 9 * SECOND_US + 900));
+    TEST_ASSERT_EQUAL_UINT32(1, stats->n_lost);
+    TEST_ASSERT_EQUAL_UINT32(1, stats->n_late);
+
+    // Across the sequence wrap
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 2, 1005 * SECOND_US, 10 * SECOND_US));
+    TEST_ASSERT_FALSE(receive_seq(&leaf, 65533, 1003 * SECOND_US, 10 * SECOND_US + 100));
+    TEST_ASSERT_EQUAL_UINT32(1 + 4, stats->n_lost);
+    TEST_ASSERT_EQUAL_UINT32(3, stats->n_duplicates);
+
+    // Rebooted leaf: sequence and clock from 0
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 0, 2 * SECOND_US, 20 * SECOND_US));
+    TEST_ASSERT_EQUAL_UINT32(1, stats->n_restarts);
+    TEST_ASSERT_TRUE(receive_seq(&leaf, 1, 3 * SECOND_US, 21 * SECOND_US));
+    TEST_ASSERT_EQUAL_UINT32(6, stats->n_received);
+}
+
+// Leaf clock 40 ppm fast, its time wrapping in ms, delays of 1 to 20 ms: the aligned time follows the least delayed
+// frames, against stamping each sample with its reception time
+void test_time_alignment_follows_drift(void)
+{
+    station_link_init_coordinator(&s_coordinator, MAX_LATENCY_US);
+    station_link_leaf_t leaf = {.node_id = 1};
+    const int64_t       leaf_boot_us = (int64_t)(UINT32_MAX - 7000U) * 1000; // 7 s before the 32 bit ms wrap
+    double              max_error_us = 0.0, sum_error_us = 0.0, sum_rx_error_us = 0.0;
+    uint32_t            n_errors = 0;
+    srand(5);
+    for (int64_t i = 0; i < 86400; i++)
+    {
+        int64_t               true_us = 1000 * SECOND_US + i * SECOND_US;
+        int64_t               leaf_us = leaf_boot_us + (int64_t)((double)(i * SECOND_US) * (1.0 + 40e-6));
+        int64_t               rx_us = true_us + 1000 + rand() % 19000;
+        uint8_t               frame[STATION_LINK_FRAME_SIZE];
+        station_link_record_t record;
+        encode_at(&leaf, leaf_us, 20.0f, frame);
+        TEST_ASSERT_TRUE(station_link_receive(&s_coordinator, frame, sizeof(frame), rx_us, &record));
+        if (i < 60) continue; // Settling
+        double error_us = fabs((double)(record.timestamp_us - true_us));
+        if (error_us > max_error_us) max_error_us = error_us;
+        sum_error_us += error_us;
+        sum_rx_error_us += (double)(rx_us - true_us);
+        n_errors++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, s_coordinator.nodes[1].stats.n_restarts);
+    printf("Alignment over a day at 40 ppm: error mean %.0f us max %.0f us, %.0f us mean stamping on reception\n",
+           sum_error_us / n_errors,
+           max_error_us,
+           sum_rx_error_us / n_errors);
+    TEST_ASSERT_TRUE(max_error_us < 10000.0);
+    TEST_ASSERT_TRUE(sum_error_us * 2.0 < sum_rx_error_us);
+}
+
+void test_batching(void)
+{
+    station_link_init_coordinator(&s_coordinator, MAX_LATENCY_US);
+    uint8_t payload[STATION_LINK_BATCH_SIZE];
+    TEST_ASSERT_FALSE(station_link_batch_ready(&s_coordinator, 0));
+    TEST_ASSERT_EQUAL(0, station_link_encode_batch(&s_coordinator, payload, sizeof(payload)));
+
+    station_link_record_t record = {.node_id = 0, .sequence = 9, .timestamp_us = 50 * SECOND_US, .values = {2000}};
+    station_link_add(&s_coordinator, &record, 50 * SECOND_US);
+    TEST_ASSERT_FALSE(station_link_batch_ready(&s_coordinator, 50 * SECOND_US + MAX_LATENCY_US - 1));
+    TEST_ASSERT_TRUE(station_link_batch_ready(&s_coordinator, 50 * SECOND_US + MAX_LATENCY_US));
+    record.node_id = 4;
+    record.timestamp_us -= 1500000; // A late record, older than the batch base
+    station_link_add(&s_coordinator, &record, 51 * SECOND_US);
+    TEST_ASSERT_EQUAL(STATION_LINK_BATCH_HEADER_SIZE + 2 * STATION_LINK_RECORD_SIZE,
+                      station_link_encode_batch(&s_coordinator, payload, sizeof(payload)));
+    TEST_ASSERT_EQUAL_UINT8(2, payload[8]);
+    TEST_ASSERT_EQUAL_UINT8(4, payload[9 + STATION_LINK_RECORD_SIZE]);
+    int32_t delta_ms;
+    memcpy(&delta_ms, &payload[9 + STATION_LINK_RECORD_SIZE + 3], sizeof(delta_ms));
+    TEST_ASSERT_EQUAL_INT32(-1500, delta_ms);
+    TEST_ASSERT_EQUAL(0, s_coordinator.n_records);
+
+    for (uint8_t i = 0; i < STATION_LINK_BATCH_LEN; i++) station_link_add(&s_coordinator, &record, 60 * SECOND_US);
+    TEST_ASSERT_TRUE(station_link_batch_ready(&s_coordinator, 60 * SECOND_US));
+    TEST_ASSERT_EQUAL(STATION_LINK_BATCH_SIZE, station_link_encode_batch(&s_coordinator, payload, sizeof(payload)));
+}
+
+// Simulated site: leaves sampling at 1 Hz on their own clocks (boot time, +/-40 ppm), ESP-NOW unicast to the
+// coordinator with MAC retries (frame or ACK lost with the loss rate, a lost ACK makes a duplicate), and the leaf
+// sending again with its next sample the frames whose retries all failed
+typedef struct
+{
+    int64_t  rx_us;
+    int64_t  true_us; //< Sampling time on the coordinator clock
+    uint8_t  kind;    //< 0: leaf frame, 1: coordinator sample, 2: coordinator tick
+    uint8_t  frame[STATION_LINK_FRAME_SIZE];
+    uint32_t unique_id;
+} sim_event_t;
+
+typedef struct
+{
+    uint32_t n_sent, n_delivered, n_uplinked, n_duplicates_uplinked, n_batches, n_bytes, n_attempts;
+    double   max_align_us, sum_latency_us, max_latency_us;
+} sim_result_t;
+
+static sim_event_t *s_events;
+static uint32_t     s_n_events;
+static int64_t     *s_sample_true_us; //< Per unique sample id
+static uint8_t     *s_uplinked;
+static int64_t      s_batch_true_us[STATION_LINK_BATCH_LEN];
+
+static void sim_push(sim_event_t event)
+{
+    s_events[s_n_events++] = event;
+}
+
+static int compare_events(const void *a, const void *b)
+{
+    const sim_event_t *lhs = a, *rhs = b;
+    return (lhs->rx_us > rhs->rx_us) - (lhs->rx_us < rhs->rx_us);
+}
+
+static double sim_uniform(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+static void sim_flush(sim_result_t *result, int64_t now_us)
+{
+    uint8_t payload[STATION_LINK_BATCH_SIZE];
+    size_t  size = station_link_encode_batch(&s_coordinator, payload, sizeof(payload));
+    if (size == 0) return;
+    result->n_batches++;
+    result->n_bytes += (uint32_t)size + 6U; // Data stream frame header and CRC
+    uint8_t n_records = payload[STATION_LINK_BATCH_HEADER_SIZE - 1];
+    for (uint8_t i = 0; i < n_records; i++)
+    {
+        double latency_us = (double)(now_us - s_batch_true_us[i]);
+        result->sum_latency_us += latency_us;
+        if (latency_us > result->max_latency_us) result->max_latency_us = latency_us;
+    }
+}
+
+static void sim_run(uint8_t n_nodes, double loss, sim_result_t *result)
+{
+    const uint32_t max_events = (uint32_t)(SIM_DURATION_US / SECOND_US) * (n_nodes * 2U * SIM_MAX_ATTEMPTS + 2U)
+                                + (uint32_t)(SIM_DURATION_US / SIM_TICK_US) + 16U;
+    const uint32_t max_samples = (uint32_t)(SIM_DURATION_US / SECOND_US + 2) * (n_nodes + 1U);
+    s_events = malloc(max_events * sizeof(sim_event_t));
+    s_sample_true_us = malloc(max_samples * sizeof(int64_t));
+    s_uplinked = calloc(max_samples, 1);
+    s_n_events = 0;
+    memset(result, 0, sizeof(*result));
+    station_link_init_coordinator(&s_coordinator, MAX_LATENCY_US);
+
+    uint32_t unique_id = 0;
+    for (uint8_t n = 1; n <= n_nodes; n++)
+    {
+        station_link_leaf_t leaf = {.node_id = n, .next_sequence = (uint16_t)rand()};
+        int64_t             boot_us = (int64_t)(sim_uniform() * 3600.0 * SECOND_US);
+        double              drift = (sim_uniform() * 2.0 - 1.0) * 40e-6;
+        int64_t             phase_us = (int64_t)(sim_uniform() * SECOND_US);
+        sim_event_t         pending[8];
+        uint8_t             n_pending = 0;
+        for (int64_t t_us = phase_us; t_us < SIM_DURATION_US; t_us += SECOND_US)
+        {
+            // Leaf sampling time on the coordinator clock
+            int64_t     true_us = (int64_t)((double)t_us * (1.0 + drift));
+            sim_event_t event = {.true_us = true_us, .kind = 0, .unique_id = unique_id};
+            encode_at(&leaf, boot_us + t_us, 20.0f, event.frame);
+            s_sample_true_us[unique_id++] = true_us;
+            result->n_sent++;
+            if (n_pending < 8) pending[n_pending++] = event;
+
+            // The new frame first, then the ones whose retries failed at the previous periods
+            int64_t send_us = true_us + 500 + rand() % 1500; // Measurement and Wi-Fi task scheduling
+            uint8_t n_kept = 0;
+            for (uint8_t p = 0; p < n_pending; p++)
+            {
+                sim_event_t *frame = &pending[(n_pending - 1U + p) % n_pending];
+                bool         is_acked = false;
+                for (uint8_t attempt = 0; attempt < SIM_MAX_ATTEMPTS && !is_acked; attempt++)
+                {
+                    send_us += SIM_AIRTIME_US + (rand() % (16 << attempt)) * 9; // Contention window slots
+                    result->n_attempts++;
+                    if (sim_uniform() < loss) continue; // Frame lost
+                    frame->rx_us = send_us;
+                    sim_push(*frame);
+                    is_acked = sim_uniform() >= loss; // ACK lost: sent again, a duplicate
+                }
+                if (!is_acked && p < 4) pending[n_kept++] = *frame; // At most 4 frames kept for later
+            }
+            n_pending = n_kept;
+        }
+    }
+    // The coordinator own samples and the batch deadline checks of its task
+    for (int64_t t_us = 0; t_us < SIM_DURATION_US; t_us += SECOND_US)
+    {
+        s_sample_true_us[unique_id] = t_us;
+        sim_push((sim_event_t){.rx_us = t_us + 300, .true_us = t_us, .kind = 1, .unique_id = unique_id++});
+        result->n_sent++;
+    }
+    for (int64_t t_us = 0; t_us < SIM_DURATION_US + MAX_LATENCY_US; t_us += SIM_TICK_US)
+    {
+        sim_push((sim_event_t){.rx_us = t_us, .kind = 2});
+    }
+    qsort(s_events, s_n_events, sizeof(sim_event_t), compare_events);
+
+    uint16_t own_sequence = 0;
+    for (uint32_t e = 0; e < s_n_events; e++)
+    {
+        const sim_event_t    *event = &s_events[e];
+        station_link_record_t record;
+        bool                  is_new = false;
+        if (event->kind == 0)
+        {
+            is_new = station_link_receive(&s_coordinator, event->frame, sizeof(event->frame), event->rx_us, &record);
+        }
+        else if (event->kind == 1)
+        {
+            record = (station_link_record_t){.node_id = 0, .sequence = own_sequence++, .timestamp_us = event->true_us};
+            is_new = true;
+        }
+        if (is_new)
+        {
+            if (s_uplinked[event->unique_id]) result->n_duplicates_uplinked++;
+            s_uplinked[event->unique_id] = 1;
+            result->n_uplinked++;
+            double align_us = fabs((double)(record.timestamp_us - event->true_us));
+            if (event->kind == 0 && align_us > result->max_align_us) result->max_align_us = align_us;
+            if (s_coordinator.n_records == STATION_LINK_BATCH_LEN) sim_flush(result, event->rx_us);
+            s_batch_true_us[s_coordinator.n_records] = event->true_us;
+            station_link_add(&s_coordinator, &record, event->rx_us);
+        }
+        if (station_link_batch_ready(&s_coordinator, event->rx_us)) sim_flush(result, event->rx_us);
+    }
+    sim_flush(result, SIM_DURATION_US + MAX_LATENCY_US);
+    for (uint32_t i = 0; i < unique_id; i++) result->n_delivered += s_uplinked[i];
+
+    free(s_events);
+    free(s_sample_true_us);
+    free(s_uplinked);
+}
+
+void test_simulated_sites(void)
+{
+    static const uint8_t s_node_counts[] = {1, 2, 5, 10, 20};
+    static const double  s_loss_rates[] = {0.1, 0.3};
+    srand(2024);
+    printf("Nodes | loss | delivered | uplink records/s | uplink B/s | batches/s | latency avg/max ms | "
+           "align max ms | airtime\n");
+    for (uint8_t i = 0; i < 2 * sizeof(s_node_counts) / sizeof(s_node_counts[0]); i++)
+    {
+        uint8_t      n_nodes = s_node_counts[i % 5];
+        double       loss = s_loss_rates[i / 5];
+        sim_result_t result;
+        sim_run(n_nodes, loss, &result);
+        double duration_s = (double)SIM_DURATION_US / SECOND_US;
+        printf("%5u | %3.0f%% | %8.2f%% | %16.1f | %10.0f | %9.2f | %9.0f / %5.0f | %12.2f | %6.2f%%\n",
+               n_nodes,
+               loss * 100.0,
+               100.0 * result.n_delivered / result.n_sent,
+               result.n_uplinked / duration_s,
+               result.n_bytes / duration_s,
+               result.n_batches / duration_s,
+               result.sum_latency_us / result.n_uplinked / 1000.0,
+               result.max_latency_us / 1000.0,
+               result.max_align_us / 1000.0,
+               100.0 * result.n_attempts * SIM_AIRTIME_US / (double)SIM_DURATION_US);
+
+        // Each sample uplinked once, on the coordinator time base within the delay of the least delayed frame
+        TEST_ASSERT_EQUAL_UINT32(0, result.n_duplicates_uplinked);
+        TEST_ASSERT_EQUAL_UINT32(result.n_delivered, result.n_uplinked);
+        TEST_ASSERT_TRUE(result.n_delivered > result.n_sent * 0.99);
+        TEST_ASSERT_TRUE(result.max_align_us < 20000.0); // Resent late frames carry their sampling time
+        // Up to the batch latency after the reception, a sample resent by its leaf comes a few periods late
+        TEST_ASSERT_TRUE(result.max_latency_us <= (double)(MAX_LATENCY_US + SIM_TICK_US + 5 * SECOND_US));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_dedup_window_and_restart);
+    RUN_TEST(test_time_alignment_follows_drift);
+    RUN_TEST(test_batching);
+    RUN_TEST(test_simulated_sites);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "task_jitter.h"
+
+#define PERIOD_US    10000
+#define THRESHOLD_US 500
+
+static task_jitter_t s_jitter;
+
+void setUp(void)
+{
+    task_jitter_init(&s_jitter, "test", PERIOD_US, THRESHOLD_US);
+}
+
+void tearDown(void)
+{
+}
+
+void test_release_latency(void)
+{
+    // Ideal releases at 1 s + n * 10 ms, the latency of each one is measured from its ideal time
+    const int32_t latencies_us[] = {0, 100, 40, 700, 0, 20};
+    for (uint8_t i = 0; i < sizeof(latencies_us) / sizeof(latencies_us[0]); i++)
+    {
+        task_jitter_on_release(&s_jitter, 1000000 + (int64_t)i * PERIOD_US + latencies_us[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, s_jitter.release.n_samples); // The first release is the reference
+    TEST_ASSERT_EQUAL_INT32(0, s_jitter.release.min_us);
+    TEST_ASSERT_EQUAL_INT32(700, s_jitter.release.max_us);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 172.0f, s_jitter.release.mean_us);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions); // 700 us > 500 us
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 297.5f, task_jitter_stats_stddev(&s_jitter.release));
+
+    // A sample stamped 2 ms after the last ideal release
+    task_jitter_on_sample(&s_jitter, 1000000 + 5 * PERIOD_US + 2000);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.sample.n_samples);
+    TEST_ASSERT_EQUAL_INT32(2000, s_jitter.sample.max_us);
+}
+
+void test_overrun_restarts_schedule(void)
+{
+    task_jitter_on_release(&s_jitter, 0);
+    task_jitter_on_release(&s_jitter, PERIOD_US);
+    // Two and a half periods late: counted once, the schedule restarts from this release
+    task_jitter_on_release(&s_jitter, 4 * PERIOD_US + PERIOD_US / 2);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.release.n_samples);
+    task_jitter_on_release(&s_jitter, 5 * PERIOD_US + PERIOD_US / 2 + 10);
+    TEST_ASSERT_EQUAL_UINT32(2, s_jitter.release.n_samples);
+    TEST_ASSERT_EQUAL_INT32(10, s_jitter.release.max_us);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions);
+}
+
+void test_short_period_restarts_schedule(void)
+{
+    // Released every 9 ms on a 10 ms schedule: the releases drift early, the schedule restarts before the latency
+    // leaves the period (an unbounded drift would overflow the 32 bit statistics)
+    int64_t now_us = 0;
+    for (uint32_t i = 0; i < 1000000; i++)
+    {
+        task_jitter_on_release(&s_jitter, now_us);
+        now_us += 9000;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.preemptions);
+    TEST_ASSERT_TRUE(s_jitter.n_periods <= 10);
+    TEST_ASSERT_TRUE(s_jitter.release.min_us >= -PERIOD_US);
+    TEST_ASSERT_TRUE(s_jitter.release.max_us <= 0);
+}
+
+void test_set_period(void)
+{
+    task_jitter_on_release(&s_jitter, 0);
+    task_jitter_on_release(&s_jitter, PERIOD_US + 700);
+    task_jitter_on_section(&s_jitter, 1000);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions);
+
+    // Restarted on the new period, the name and threshold kept
+    task_jitter_set_period(&s_jitter, 2 * PERIOD_US);
+    TEST_ASSERT_EQUAL_STRING("test", s_jitter.name);
+    TEST_ASSERT_EQUAL_UINT32(THRESHOLD_US, s_jitter.preempt_threshold_us);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.preemptions);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.release.n_samples);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, s_jitter.section_min_us);
+    task_jitter_on_release(&s_jitter, 5 * PERIOD_US);
+    task_jitter_on_release(&s_jitter, 7 * PERIOD_US + 100);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.release.n_samples);
+    TEST_ASSERT_EQUAL_INT32(100, s_jitter.release.max_us);
+}
+
+void test_section_preemption(void)
+{
+    // The shortest run is the uninterrupted duration, a run longer by more than the threshold was preempted
+    task_jitter_on_section(&s_jitter, 1200);
+    task_jitter_on_section(&s_jitter, 1000);
+    task_jitter_on_section(&s_jitter, 1400);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.preemptions);
+    task_jitter_on_section(&s_jitter, 1600);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions);
+    TEST_ASSERT_EQUAL_INT32(1000, s_jitter.section_min_us);
+}
+
+void test_free_running(void)
+{
+    // Back to back releases of a free running task are not late on any schedule
+    task_jitter_init(&s_jitter, "test", 0, THRESHOLD_US);
+    int64_t now_us = 1000000;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        task_jitter_on_release(&s_jitter, now_us);
+        task_jitter_on_sample(&s_jitter, now_us + 17000);
+        now_us += 17000 + (int64_t)(i % 7) * 300;
+    }
+    TEST_ASSERT_EQUAL_UINT32(99, s_jitter.n_periods);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.preemptions);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.release.n_samples);
+    TEST_ASSERT_EQUAL_UINT32(0, s_jitter.sample.n_samples);
+
+    // The sections are still checked
+    task_jitter_on_section(&s_jitter, 1000);
+    task_jitter_on_section(&s_jitter, 2000);
+    TEST_ASSERT_EQUAL_UINT32(1, s_jitter.preemptions);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_release_latency);
+    RUN_TEST(test_overrun_restarts_schedule);
+    RUN_TEST(test_short_period_restarts_schedule);
+    RUN_TEST(test_set_period);
+    RUN_TEST(test_section_preemption);
+    RUN_TEST(test_free_running);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timebase.h"
+
+#define SECOND_US      1000000LL
+#define HOUR_US        (3600 * SECOND_US)
+#define UTC_2026_US    (1767225600LL * SECOND_US) //< 2026-01-01T00:00:00Z
+#define SNTP_JITTER_US 2000                       //< Network delay asymmetry of a sync, +-
+
+static timebase_t s_tb;
+
+void setUp(void)
+{
+    timebase_reset(&s_tb);
+    srand(1);
+}
+
+void tearDown(void)
+{
+}
+
+// Simulated UTC of the monotonic clock: an offset, a crystal drift and the steps applied so far
+typedef struct
+{
+    int64_t utc_at_zero_us;
+    double  drift_ppm; //< Of the monotonic clock, the UTC rate error seen from the board is the opposite
+    int64_t step_us;
+} sim_clock_t;
+
+static int64_t sim_utc_us(const sim_clock_t *clock, int64_t mono_us)
+{
+    return clock->utc_at_zero_us + mono_us - (int64_t)llround((double)mono_us * clock->drift_ppm * 1e-6)
+           + clock->step_us;
+}
+
+static int64_t sim_jitter_us(void)
+{
+    return (int64_t)(rand() % (2 * SNTP_JITTER_US + 1)) - SNTP_JITTER_US;
+}
+
+static int64_t utc_error_us(const sim_clock_t *clock, int64_t mono_us)
+{
+    int64_t utc_us;
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, mono_us, &utc_us));
+    return utc_us - sim_utc_us(clock, mono_us);
+}
+
+void test_unknown_before_sync(void)
+{
+    int64_t utc_us = 42;
+    TEST_ASSERT_FALSE(timebase_is_valid(&s_tb));
+    TEST_ASSERT_FALSE(timebase_to_utc_us(&s_tb, 1000, &utc_us));
+    TEST_ASSERT_EQUAL_INT64(42, utc_us);
+
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED, timebase_sync(&s_tb, 5 * SECOND_US, UTC_2026_US, TIMEBASE_SOURCE_RTC));
+    TEST_ASSERT_TRUE(timebase_is_valid(&s_tb));
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, 5 * SECOND_US, &utc_us));
+    TEST_ASSERT_EQUAL_INT64(UTC_2026_US, utc_us);
+    // Stamps before the sync convert too, e.g. the samples of a batch taken before it
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, 2 * SECOND_US, &utc_us));
+    TEST_ASSERT_EQUAL_INT64(UTC_2026_US - 3 * SECOND_US, utc_us);
+}
+
+void test_build_date(void)
+{
+    // The day before, a build just after midnight east of UTC is still covered
+    TEST_ASSERT_EQUAL_INT64(1767139200LL * SECOND_US, timebase_date_utc_us("Jan  1 2026"));
+    TEST_ASSERT_EQUAL_INT64(1709078400LL * SECOND_US, timebase_date_utc_us("Feb 29 2024"));
+    TEST_ASSERT_EQUAL_INT64(1709164800LL * SECOND_US, timebase_date_utc_us("Mar  1 2024"));
+    TEST_ASSERT_EQUAL_INT64(946512000LL * SECOND_US, timebase_date_utc_us("Dec 31 1999"));
+    TEST_ASSERT_EQUAL_INT64(0, timebase_date_utc_us("Foo  1 2026"));
+    TEST_ASSERT_EQUAL_INT64(0, timebase_date_utc_us("Jan 1 2026"));
+    TEST_ASSERT_EQUAL_INT64(0, timebase_date_utc_us(NULL));
+    TEST_ASSERT_TRUE(timebase_date_utc_us(__DATE__) > 0);
+}
+
+void test_rtc_before_build_rejected(void)
+{
+    // RTC never set: it counts from the epoch, no UTC time
+    s_tb.min_utc_us = timebase_date_utc_us("Jan  1 2026");
+    TEST_ASSERT_EQUAL(TIMEBASE_REJECTED, timebase_sync(&s_tb, 5 * SECOND_US, 5 * SECOND_US, TIMEBASE_SOURCE_RTC));
+    TEST_ASSERT_FALSE(timebase_is_valid(&s_tb));
+    TEST_ASSERT_EQUAL_UINT32(1, s_tb.n_rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, s_tb.n_syncs);
+
+    // A clock resumed past the build (flash log), then SNTP, are taken
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED, timebase_sync(&s_tb, 6 * SECOND_US, UTC_2026_US, TIMEBASE_SOURCE_RTC));
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED,
+                      timebase_sync(&s_tb, 7 * SECOND_US, UTC_2026_US + HOUR_US, TIMEBASE_SOURCE_SNTP));
+    int64_t utc_us;
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, 7 * SECOND_US, &utc_us));
+    TEST_ASSERT_EQUAL_INT64(UTC_2026_US + HOUR_US, utc_us);
+
+    // SNTP is never checked against the build date
+    timebase_reset(&s_tb);
+    s_tb.min_utc_us = UTC_2026_US;
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED, timebase_sync(&s_tb, SECOND_US, UTC_2026_US - HOUR_US, TIMEBASE_SOURCE_SNTP));
+}
+
+void test_slew_keeps_stamps_in_order(void)
+{
+    timebase_sync(&s_tb, 0, UTC_2026_US, TIMEBASE_SOURCE_RTC);
+    // The reference is 50 ms ahead of the model at 100 s: slewed in at 500 ppm, 100 s to absorb it
+    int64_t utc_us = UTC_2026_US + 100 * SECOND_US + 50000;
+    TEST_ASSERT_EQUAL(TIMEBASE_SLEWED, timebase_sync(&s_tb, 100 * SECOND_US, utc_us, TIMEBASE_SOURCE_RTC));
+    TEST_ASSERT_EQUAL_INT64(50000, s_tb.last_error_us);
+    int64_t last_utc_us;
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, 99 * SECOND_US - 10000, &last_utc_us));
+    for (int64_t mono_us = 99 * SECOND_US; mono_us <= 300 * SECOND_US; mono_us += 10000)
+    {
+        TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, mono_us, &utc_us));
+        TEST_ASSERT_TRUE(utc_us > last_utc_us);
+        TEST_ASSERT_TRUE(utc_us - last_utc_us <= 10000 + 10000 / TIMEBASE_SLEW_RATIO);
+        last_utc_us = utc_us;
+    }
+    TEST_ASSERT_EQUAL_INT64(UTC_2026_US + 300 * SECOND_US + 50000, last_utc_us);
+
+    // Backwards too
+    TEST_ASSERT_EQUAL(TIMEBASE_SLEWED,
+                      timebase_sync(&s_tb, 400 * SECOND_US, UTC_2026_US + 400 * SECOND_US, TIMEBASE_SOURCE_RTC));
+    TEST_ASSERT_TRUE(timebase_to_utc_us(&s_tb, 450 * SECOND_US, &utc_us));
+    TEST_ASSERT_EQUAL_INT64(UTC_2026_US + 450 * SECOND_US + 25000, utc_us);
+    TEST_ASSERT_EQUAL_UINT32(1, s_tb.n_steps);
+}
+
+void test_step_correction(void)
+{
+    sim_clock_t clock = {.utc_at_zero_us = 0}; // RTC never set: counts from the epoch
+    timebase_sync(&s_tb, 10 * SECOND_US, sim_utc_us(&clock, 10 * SECOND_US), TIMEBASE_SOURCE_RTC);
+    TEST_ASSERT_EQUAL_INT64(0, utc_error_us(&clock, 20 * SECOND_US));
+
+    // First SNTP sync: the whole offset at once
+    clock.utc_at_zero_us = UTC_2026_US;
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED,
+                      timebase_sync(&s_tb, 30 * SECOND_US, sim_utc_us(&clock, 30 * SECOND_US), TIMEBASE_SOURCE_SNTP));
+    TEST_ASSERT_EQUAL_INT64(0, utc_error_us(&clock, 40 * SECOND_US));
+    TEST_ASSERT_EQUAL(TIMEBASE_SOURCE_SNTP, s_tb.source);
+
+    // The RTC reads the clock SNTP set, it is not used anymore
+    TEST_ASSERT_EQUAL(TIMEBASE_IGNORED, timebase_sync(&s_tb, 50 * SECOND_US, 0, TIMEBASE_SOURCE_RTC));
+
+    // A step of the reference (e.g. another server) larger than the threshold is applied at once, without changing
+    // the drift
+    clock.step_us = -10 * SECOND_US;
+    TEST_ASSERT_EQUAL(TIMEBASE_STEPPED,
+                      timebase_sync(&s_tb, 2 * HOUR_US, sim_utc_us(&clock, 2 * HOUR_US), TIMEBASE_SOURCE_SNTP));
+    TEST_ASSERT_EQUAL_INT64(-10 * SECOND_US, s_tb.last_error_us);
+    TEST_ASSERT_EQUAL_INT32(0, s_tb.drift_ppb);
+    TEST_ASSERT_EQUAL_INT64(0, utc_error_us(&clock, 3 * HOUR_US));
+    TEST_ASSERT_EQUAL_UINT32(3, s_tb.n_steps);
+}
+
+// SNTP every period with jitter, returns the largest conversion error over the last hour of syncs, checked every
+// minute between them
+static int64_t sim_discipline(const sim_clock_t *clock, int64_t period_us, uint32_t n_syncs)
+{
+    int64_t max_error_us = 0;
+    for (uint32_t i = 0; i < n_syncs; i++)
+    {
+        int64_t mono_us = SECOND_US + (int64_t)i * period_us;
+        timebase_sync(&s_tb, mono_us, sim_utc_us(clock, mono_us) + sim_jitter_us(), TIMEBASE_SOURCE_SNTP);
+        if ((int64_t)(n_syncs - 1 - i) * period_us >= HOUR_US) continue;
+        for (int64_t t_us = mono_us; t_us < mono_us + period_us; t_us += 60 * SECOND_US)
+        {
+            int64_t error_us = llabs(utc_error_us(clock, t_us));
+            if (error_us > max_error_us) max_error_us = error_us;
+        }
+    }
+    return max_error_us;
+}
+
+void test_drift_converges(void)
+{
+    const double drifts_ppm[] = {40.0, -75.0, 0.0, 150.0};
+    for (uint8_t d = 0; d < sizeof(drifts_ppm) / sizeof(drifts_ppm[0]); d++)
+    {
+        timebase_reset(&s_tb);
+        sim_clock_t clock = {.utc_at_zero_us = UTC_2026_US, .drift_ppm = drifts_ppm[d]};
+        int64_t     max_error_us = sim_discipline(&clock, HOUR_US, 24);
+        printf("crystal %+6.1f ppm, SNTP every hour: drift %+8ld ppb, error of the last hour %4lld us (%6lld us "
+               "without the drift)\n",
+               drifts_ppm[d],
+               (long)s_tb.drift_ppb,
+               (long long)max_error_us,
+               (long long)llround(fabs(drifts_ppm[d]) * 3600.0));
+        // The UTC rate error is the opposite of the crystal one
+        TEST_ASSERT_TRUE(llabs(s_tb.drift_ppb + llround(drifts_ppm[d] * 1000.0)) <= 2000);
+        TEST_ASSERT_TRUE(max_error_us < 3 * SNTP_JITTER_US);
+    }
+}
+
+void test_drift_out_of_range(void)
+{
+    // A rate beyond the drift range is a jump: the drift stays bounded, each sync steps
+    sim_clock_t clock = {.utc_at_zero_us = UTC_2026_US, .drift_ppm = 400.0};
+    sim_discipline(&clock, HOUR_US, 6);
+    TEST_ASSERT_EQUAL_INT32(0, s_tb.drift_ppb);
+    TEST_ASSERT_EQUAL_UINT32(6, s_tb.n_steps);
+    TEST_ASSERT_EQUAL_INT64(0, utc_error_us(&clock, 5 * HOUR_US + SECOND_US) / SNTP_JITTER_US / 2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_before_sync);
+    RUN_TEST(test_build_date);
+    RUN_TEST(test_rtc_before_build_rejected);
+    RUN_TEST(test_slew_keeps_stamps_in_order);
+    RUN_TEST(test_step_correction);
+    RUN_TEST(test_drift_converges);
+    RUN_TEST(test_drift_out_of_range);
+    return UNITY_END();
+}
@@ -0,0 +1,263 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tuning.h"
+
+static tuning_values_t s_values;
+
+void setUp(void)
+{
+    tuning_defaults(&s_values);
+}
+
+void tearDown(void)
+{
+}
+
+// Runs a console line split on spaces, as esp_console does
+static tuning_status_t run(const char *line, char *reply, size_t size, uint32_t *changed_mask)
+{
+    char  buffer[128];
+    char *argv[8];
+    int   argc = 0;
+    strncpy(buffer, line, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    for (char *token = strtok(buffer, " "); token != NULL && argc < 8; token = strtok(NULL, " ")) argv[argc++] = token;
+    return tuning_command(&s_values, argc, argv, reply, size, changed_mask);
+}
+
+void test_param_table(void)
+{
+    for (uint8_t i = 0; i < TUNING_N_PARAMS; i++)
+    {
+        const tuning_param_info_t *info = &tuning_param_infos[i];
+        TEST_ASSERT_TRUE_MESSAGE(strlen(info->name) <= 15, info->name); // NVS key length
+        TEST_ASSERT_TRUE_MESSAGE(tuning_is_valid((tuning_param_t)i, info->init), info->name);
+        TEST_ASSERT_EQUAL(i, tuning_find(info->name));
+    }
+    TEST_ASSERT_EQUAL(TUNING_N_PARAMS, tuning_find("sense_period"));
+    TEST_ASSERT_EQUAL_UINT32(250, s_values.values[TUNING_sense_period_ms]);
+    TEST_ASSERT_EQUAL_UINT32(400000, s_values.values[TUNING_lcd_i2c_hz]);
+}
+
+void test_parse_value(void)
+{
+    uint32_t value = 0;
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_parse_value(TUNING_sense_period_ms, "1000", &value));
+    TEST_ASSERT_EQUAL_UINT32(1000, value);
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_parse_value(TUNING_sense_period_ms, "0", &value));
+    TEST_ASSERT_EQUAL_UINT32(0, value);
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_parse_value(TUNING_sense_i2c_hz, "100k", &value));
+    TEST_ASSERT_EQUAL_UINT32(100000, value);
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_parse_value(TUNING_lcd_i2c_hz, "1M", &value));
+    TEST_ASSERT_EQUAL_UINT32(1000000, value);
+
+    value = 7;
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_sense_period_ms, "", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_sense_period_ms, "-1", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_sense_period_ms, "25O", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_sense_i2c_hz, "400kk", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_parse_value(TUNING_sense_period_ms, "60001", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_parse_value(TUNING_ui_period_ms, "5", &value));
+    // Periods in whole ticks, pdMS_TO_TICKS() would truncate the others
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_sense_period_ms, "255", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_ui_period_ms, "15", &value));
+    TEST_ASSERT_FALSE(tuning_is_valid(TUNING_sense_period_ms, 1));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_parse_value(TUNING_sense_i2c_hz, "99999999999", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_parse_value(TUNING_sense_i2c_hz, "5000M", &value));
+    TEST_ASSERT_EQUAL_UINT32(7, value); // Untouched on errors
+
+    // Oversampling: powers of two up to 16, 0 for the picked one
+    const uint32_t oversamplings[] = {0, 1, 2, 4, 8, 16};
+    const uint8_t  codes[] = {0, 1, 2, 3, 4, 5};
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        char text[4];
+        snprintf(text, sizeof(text), "%u", (unsigned)oversamplings[i]);
+        TEST_ASSERT_EQUAL(TUNING_OK, tuning_parse_value(TUNING_os_press, text, &value));
+        TEST_ASSERT_EQUAL_UINT8(codes[i], tuning_os_code(value));
+    }
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_parse_value(TUNING_os_temp, "3", &value));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_parse_value(TUNING_os_temp, "32", &value));
+    TEST_ASSERT_FALSE(tuning_is_valid(TUNING_os_humid, 12));
+    TEST_ASSERT_FALSE(tuning_is_valid(TUNING_N_PARAMS, 0));
+}
+
+void test_tune_command(void)
+{
+    char     reply[512];
+    uint32_t changed_mask;
+
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_UINT32(0, changed_mask);
+    for (uint8_t i = 0; i < TUNING_N_PARAMS; i++) TEST_ASSERT_NOT_NULL(strstr(reply, tuning_param_infos[i].name));
+    printf("%s", reply);
+
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune sense_i2c_hz", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "400000"));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "BME688"));
+
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune sense_i2c_hz 1M", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_HEX32(1U << TUNING_sense_i2c_hz, changed_mask);
+    TEST_ASSERT_EQUAL_UINT32(1000000, s_values.values[TUNING_sense_i2c_hz]);
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune sense_i2c_hz 1000000", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_HEX32(0, changed_mask); // Same value, nothing to apply or save
+
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune os_temp 8", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_HEX32(1U << TUNING_os_temp, changed_mask);
+
+    // Errors leave the values as they were
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, run("tune ui_period_ms 2000", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "[10..1000]"));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, run("tune os_humid 6", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL(TUNING_ERR_UNKNOWN_PARAM, run("tune cpu_mhz 240", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL(TUNING_ERR_USAGE, run("tune os_temp 8 now", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_HEX32(0, changed_mask);
+    TEST_ASSERT_EQUAL_UINT32(10, s_values.values[TUNING_ui_period_ms]);
+    TEST_ASSERT_EQUAL_UINT32(0, s_values.values[TUNING_os_humid]);
+
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune defaults", reply, sizeof(reply), &changed_mask));
+    TEST_ASSERT_EQUAL_HEX32((1U << TUNING_sense_i2c_hz) | (1U << TUNING_os_temp), changed_mask);
+    tuning_values_t defaults;
+    tuning_defaults(&defaults);
+    TEST_ASSERT_EQUAL_MEMORY(&defaults, &s_values, sizeof(defaults));
+
+    // A reply longer than the buffer is truncated and terminated
+    char short_reply[40];
+    memset(short_reply, 'x', sizeof(short_reply));
+    TEST_ASSERT_EQUAL(TUNING_OK, run("tune", short_reply, sizeof(short_reply), &changed_mask));
+    TEST_ASSERT_EQUAL(sizeof(short_reply) - 1, strlen(short_reply));
+}
+
+void test_perf_parse(void)
+{
+    uint32_t window_ms;
+    char    *none[] = {"perf"};
+    char    *five[] = {"perf", "5"};
+    char    *zero[] = {"perf", "0"};
+    char    *long_window[] = {"perf", "600"};
+    char    *text[] = {"perf", "2s"};
+    char    *extra[] = {"perf", "2", "3"};
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_perf_parse(1, none, &window_ms));
+    TEST_ASSERT_EQUAL_UINT32(2000, window_ms);
+    TEST_ASSERT_EQUAL(TUNING_OK, tuning_perf_parse(2, five, &window_ms));
+    TEST_ASSERT_EQUAL_UINT32(5000, window_ms);
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_perf_parse(2, zero, &window_ms));
+    TEST_ASSERT_EQUAL(TUNING_ERR_OUT_OF_RANGE, tuning_perf_parse(2, long_window, &window_ms));
+    TEST_ASSERT_EQUAL(TUNING_ERR_INVALID_VALUE, tuning_perf_parse(2, text, &window_ms));
+    TEST_ASSERT_EQUAL(TUNING_ERR_USAGE, tuning_perf_parse(3, extra, &window_ms));
+}
+
+// I2C traffic of the pipeline (BME68x API forced mode measurement and minimal renderer value updates)
+#define SENSE_TRANSFERS_PER_SAMPLE 8U  //< Op mode write, status and field reads as write-read pairs
+#define SENSE_BYTES_PER_SAMPLE     34U //< Register addresses, op mode and the 17 field data bytes
+#define LCD_PAGES_PER_SECOND       4U  //< Pages of the changed value labels
+#define LCD_BYTES_PER_PAGE         (4U + 4U + 1U + 40U) //< Column and page commands, a 40 column label
+
+// Counters of a window of the simulated pipeline at the given settings
+static void simulate(const tuning_values_t *values, uint32_t window_s, tuning_perf_counters_t *counters)
+{
+    uint32_t n_samples = window_s * 1000U / (values->values[TUNING_sense_period_ms]);
+    uint32_t n_ticks = window_s * 1000U / values->values[TUNING_ui_period_ms];
+    uint32_t n_pages = window_s * LCD_PAGES_PER_SECOND;
+    *counters = (tuning_perf_counters_t){
+        .time_us = (int64_t)window_s * 1000000,
+        .n_samples = n_samples,
+        .sense_busy_us = (uint64_t)n_samples * 12000U,
+        .sense_n_transfers = n_samples * SENSE_TRANSFERS_PER_SAMPLE,
+        .sense_n_bytes = (uint64_t)n_samples * SENSE_BYTES_PER_SAMPLE,
+        .n_ui_ticks = n_ticks,
+        .ui_busy_us = (uint64_t)n_ticks * 150U + (uint64_t)n_pages * 600U,
+        .lcd_n_transfers = n_pages * 3U,
+        .lcd_n_bytes = (uint64_t)n_pages * LCD_BYTES_PER_PAGE,
+        .is_idle_known = true,
+        .idle_us = {(uint32_t)(window_s * 900000U), (uint32_t)(window_s * 990000U)},
+    };
+}
+
+void test_perf_compute(void)
+{
+    TEST_ASSERT_EQUAL_UINT64(0, tuning_i2c_busy_us(0, 0, 400000));
+    TEST_ASSERT_EQUAL_UINT64(50, tuning_i2c_busy_us(1, 1, 400000)); // 9 + 11 clocks at 2.5 us
+    TEST_ASSERT_EQUAL_UINT64(0, tuning_i2c_busy_us(1, 1, 0));
+
+    tuning_perf_counters_t start = {.time_us = 0, .is_idle_known = true}, end;
+    tuning_perf_t          perf;
+    simulate(&s_values, 10, &end);
+    tuning_perf_compute(&start, &end, &s_values, &perf);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, perf.sample_rate_hz);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 12000.0f, perf.sense_loop_us);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 150.0f + 4.0f * 600.0f / 100.0f, perf.ui_loop_us);
+    // 4 samples/s x (34 x 9 + 8 x 11) clocks at 400 kHz
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 100.0f * 4.0f * 394.0f / 400000.0f, perf.sense_bus_pct);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 10.0f, perf.cpu_load_pct[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 1.0f, perf.cpu_load_pct[1]);
+
+    // Idle counters wrapping during the window
+    tuning_perf_counters_t wrapped_start = start, wrapped_end = end;
+    wrapped_start.idle_us[0] = UINT32_MAX - 1000U;
+    wrapped_end.idle_us[0] = end.idle_us[0] - 1001U;
+    tuning_perf_compute(&wrapped_start, &wrapped_end, &s_values, &perf);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 10.0f, perf.cpu_load_pct[0]);
+
+    // No run time stats, and an empty window
+    end.is_idle_known = false;
+    tuning_perf_compute(&start, &end, &s_values, &perf);
+    TEST_ASSERT_TRUE(isnan(perf.cpu_load_pct[0]));
+    char reply[512];
+    TEST_ASSERT_TRUE(tuning_perf_format(&perf, &s_values, reply, sizeof(reply)) > 0);
+    TEST_ASSERT_NOT_NULL(strstr(reply, "CPU load: unknown"));
+    tuning_perf_compute(&start, &start, &s_values, &perf);
+    TEST_ASSERT_TRUE(isnan(perf.sample_rate_hz));
+}
+
+// The settings sweep run on a unit with "tune" and "perf": the bus share drops with the clocks and rises with the rates
+void test_perf_sweep(void)
+{
+    const uint32_t periods_ms[] = {1000, 250, 50};
+    const uint32_t clocks_hz[] = {100000, 400000, 1000000};
+    float          last_bus_pct = 0.0f;
+    for (uint8_t p = 0; p < 3; p++)
+    {
+        float prev_clock_pct = INFINITY;
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            s_values.values[TUNING_sense_period_ms] = periods_ms[p];
+            s_values.values[TUNING_sense_i2c_hz] = clocks_hz[c];
+            s_values.values[TUNING_lcd_i2c_hz] = clocks_hz[c];
+            tuning_perf_counters_t start = {.is_idle_known = true}, end;
+            tuning_perf_t          perf;
+            char                   reply[512];
+            simulate(&s_values, 60, &end);
+            tuning_perf_compute(&start, &end, &s_values, &perf);
+            tuning_perf_format(&perf, &s_values, reply, sizeof(reply));
+            float bus_pct = perf.sense_bus_pct + perf.lcd_bus_pct;
+            printf("period %4lu ms, I2C %4lu kHz: bus %.3f %%\n",
+                   (unsigned long)periods_ms[p],
+                   (unsigned long)(clocks_hz[c] / 1000U),
+                   bus_pct);
+            TEST_ASSERT_TRUE(bus_pct < prev_clock_pct);
+            prev_clock_pct = bus_pct;
+            if (c == 1)
+            {
+                TEST_ASSERT_TRUE(bus_pct > last_bus_pct);
+                last_bus_pct = bus_pct;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_param_table);
+    RUN_TEST(test_parse_value);
+    RUN_TEST(test_tune_command);
+    RUN_TEST(test_perf_parse);
+    RUN_TEST(test_perf_compute);
+    RUN_TEST(test_perf_sweep);
+    return UNITY_END();
+}
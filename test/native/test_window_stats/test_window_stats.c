@@ -0,0 +1,167 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "window_stats.h"
+
+#define WINDOW_US   (60 * 1000000LL)
+#define N_BUCKETS   12
+#define PERIOD_US   (WINDOW_US / N_BUCKETS)
+#define MAX_SAMPLES 20000
+
+typedef struct
+{
+    int64_t timestamp_us;
+    float   value;
+} sample_t;
+
+static sample_t s_samples[MAX_SAMPLES];
+static size_t   s_n_samples;
+
+// Brute force over every sample: the window is the bucket of now and the N_BUCKETS - 1 buckets before it
+static void brute_force(int64_t first_us, int64_t now_us, float *min, float *max, float *mean, uint32_t *count)
+{
+    int64_t current = (now_us - first_us) / PERIOD_US;
+    double  sum = 0.0;
+    *min = NAN;
+    *max = NAN;
+    *count = 0;
+    for (size_t i = 0; i < s_n_samples; i++)
+    {
+        int64_t bucket = (s_samples[i].timestamp_us - first_us) / PERIOD_US;
+        if (bucket < current - (N_BUCKETS - 1) || bucket > current || isnan(s_samples[i].value)) continue;
+        float value = s_samples[i].value;
+        if (*count == 0 || value < *min) *min = value;
+        if (*count == 0 || value > *max) *max = value;
+        sum += value;
+        (*count)++;
+    }
+    *mean = (*count > 0) ? (float)(sum / *count) : NAN;
+}
+
+static void assert_matches_brute_force(const window_stats_t *stats, int64_t first_us, int64_t now_us)
+{
+    float    min;
+    float    max;
+    float    mean;
+    uint32_t count;
+    brute_force(first_us, now_us, &min, &max, &mean, &count);
+    TEST_ASSERT_EQUAL_UINT32(count, window_stats_count(stats));
+    if (count == 0)
+    {
+        TEST_ASSERT_TRUE(isnan(window_stats_min(stats)));
+        TEST_ASSERT_TRUE(isnan(window_stats_max(stats)));
+        TEST_ASSERT_TRUE(isnan(window_stats_mean(stats)));
+        return;
+    }
+    TEST_ASSERT_EQUAL_FLOAT(min, window_stats_min(stats));
+    TEST_ASSERT_EQUAL_FLOAT(max, window_stats_max(stats));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, mean, window_stats_mean(stats));
+}
+
+void test_empty_window(void)
+{
+    static window_stats_t stats;
+    window_stats_init(&stats, WINDOW_US, N_BUCKETS);
+    TEST_ASSERT_EQUAL_UINT32(0, window_stats_count(&stats));
+    TEST_ASSERT_TRUE(isnan(window_stats_min(&stats)));
+    TEST_ASSERT_TRUE(isnan(window_stats_mean(&stats)));
+
+    window_stats_add(&stats, 1000, NAN);
+    TEST_ASSERT_EQUAL_UINT32(0, window_stats_count(&stats));
+}
+
+void test_samples_leave_the_window(void)
+{
+    static window_stats_t stats;
+    window_stats_init(&stats, WINDOW_US, N_BUCKETS);
+
+    window_stats_add(&stats, 0, -5.0f);
+    window_stats_add(&stats, PERIOD_US, 10.0f);
+    window_stats_add(&stats, 2 * PERIOD_US, 1.0f);
+    TEST_ASSERT_EQUAL_FLOAT(-5.0f, window_stats_min(&stats));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, window_stats_max(&stats));
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, window_stats_mean(&stats));
+
+    // Bucket 0 leaves when bucket N_BUCKETS starts, bucket 1 one bucket later
+    window_stats_advance(&stats, N_BUCKETS * PERIOD_US);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, window_stats_min(&stats));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, window_stats_max(&stats));
+    window_stats_advance(&stats, (N_BUCKETS + 1) * PERIOD_US);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, window_stats_max(&stats));
+
+    // A gap longer than the window empties it
+    window_stats_advance(&stats, 100 * PERIOD_US);
+    TEST_ASSERT_EQUAL_UINT32(0, window_stats_count(&stats));
+    window_stats_add(&stats, 100 * PERIOD_US + 1, 7.0f);
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, window_stats_min(&stats));
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, window_stats_mean(&stats));
+}
+
+void test_random_stream_matches_brute_force(void)
+{
+    static window_stats_t stats;
+    srand(1234);
+    for (int run = 0; run < 4; run++)
+    {
+        window_stats_init(&stats, WINDOW_US, N_BUCKETS);
+        s_n_samples = 0;
+        int64_t first_us = 0; // The first bucket starts at the first sample
+        int64_t now_us = 1000000LL * run;
+        float   value = 20.0f;
+        for (int i = 0; i < 5000; i++)
+        {
+            // Mostly 1 s steps, with some bursts and gaps up to longer than the window
+            int r = rand() % 100;
+            if (r < 5) now_us += (int64_t)(rand() % 80) * 1000000LL;
+            else if (r < 20) now_us += rand() % 1000;
+            else now_us += 1000000LL;
+            value += (float)(rand() % 201 - 100) / 100.0f;
+            float sample = (rand() % 50 == 0) ? NAN : value;
+
+            if (i == 0) first_us = now_us;
+            window_stats_add(&stats, now_us, sample);
+            s_samples[s_n_samples].timestamp_us = now_us;
+            s_samples[s_n_samples].value = sample;
+            s_n_samples++;
+            assert_matches_brute_force(&stats, first_us, now_us);
+
+            if (r == 99)
+            {
+                now_us += PERIOD_US / 2 + rand() % (int)PERIOD_US; // Window slides without a sample
+                window_stats_advance(&stats, now_us);
+                assert_matches_brute_force(&stats, first_us, now_us);
+            }
+        }
+    }
+}
+
+void test_monotonic_stream_keeps_deques_bounded(void)
+{
+    static window_stats_t stats;
+    window_stats_init(&stats, WINDOW_US, WINDOW_STATS_MAX_BUCKETS);
+    TEST_ASSERT_EQUAL(WINDOW_STATS_MAX_BUCKETS, stats.n_buckets);
+
+    // Rising values: the max deque keeps one entry, the min deque every bucket of the window
+    int64_t period_us = WINDOW_US / WINDOW_STATS_MAX_BUCKETS;
+    for (int i = 0; i < 10 * WINDOW_STATS_MAX_BUCKETS; i++)
+    {
+        window_stats_add(&stats, i * period_us, (float)i);
+        TEST_ASSERT_TRUE(stats.min_deque.len <= WINDOW_STATS_MAX_BUCKETS - 1);
+        TEST_ASSERT_TRUE(stats.max_deque.len <= 1);
+    }
+    int last = 10 * WINDOW_STATS_MAX_BUCKETS - 1;
+    TEST_ASSERT_EQUAL_FLOAT((float)(last - (WINDOW_STATS_MAX_BUCKETS - 1)), window_stats_min(&stats));
+    TEST_ASSERT_EQUAL_FLOAT((float)last, window_stats_max(&stats));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_samples_leave_the_window);
+    RUN_TEST(test_random_stream_matches_brute_force);
+    RUN_TEST(test_monotonic_stream_keeps_deques_bounded);
+    return UNITY_END();
+}
@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+"""Generate the minimal renderer glyph subsets (CONFIG_METEO_UI_MINIMAL) from the EEZ Studio project.
+
+Every label of the project is read with its font and position: literal texts contribute their characters and
+numeric variable bindings the digits, '.' and '-'. The glyphs are taken from the LVGL built-in Montserrat font
+sources (same glyphs as the LVGL renderer), thresholded to 1 bpp and packed in the SSD1306 page layout, already
+shifted to the label row inside its first page: drawing a glyph at its label position is a plain byte copy.
+
+Usage: gen_mono_fonts.py project.eez-project lvgl/src/font --output-dir build [--default-font-size 14]
+Writes mono_fonts_eez.c and mono_fonts_eez.h, prints the flash used by the subsets and by the full fonts.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+NUMERIC_TYPES = ("float", "double", "integer")
+NUMERIC_CHARS = "0123456789.-"
+ALPHA_THRESHOLD = 8  # 4 bpp coverage from which a pixel is on
+LVGL_GLYPH_DSC_SIZE = 8  # sizeof(lv_font_fmt_txt_glyph_dsc_t)
+MONO_GLYPH_SIZE = 4  # sizeof(mono_glyph_t)
+MONO_FONT_SIZE = 16  # sizeof(mono_font_t) on a 32 bits target
+
+
+class FontError(Exception):
+    pass
+
+
+class Label:
+    def __init__(self, identifier, x, y, font_size, chars):
+        self.identifier = identifier
+        self.x = x
+        self.y = y
+        self.font_size = font_size
+        self.chars = chars
+
+    @property
+    def c_name(self):
+        return "MONO_FONT_EEZ_" + re.sub(r"\W+", "_", self.identifier).strip("_").upper()
+
+
+def _walk(node):
+    if isinstance(node, dict):
+        yield node
+        for value in node.values():
+            yield from _walk(value)
+    elif isinstance(node, list):
+        for value in node:
+            yield from _walk(value)
+
+
+def read_labels(project, default_font_size):
+    """Labels of the project with the characters they can show."""
+    variables = {var["name"]: var["type"] for var in project.get("variables", {}).get("globalVariables", [])}
+    labels = []
+    for widget in _walk(project):
+        if widget.get("type") != "LVGLLabelWidget":
+            continue
+        definition = (widget.get("localStyles") or {}).get("definition") or {}
+        style = (definition.get("MAIN") or {}).get("DEFAULT") or {}
+
+        font = style.get("text_font")
+        if font is None:
+            font_size = default_font_size
+        else:
+            match = re.fullmatch(r"MONTSERRAT_(\d+)", font)
+            if match is None:
+                raise FontError(f"Label '{widget.get('identifier')}': unsupported font {font}")
+            font_size = int(match.group(1))
+
+        text = widget.get("text", "")
+        if widget.get("textType") == "expression":
+            if variables.get(text) not in NUMERIC_TYPES:
+                raise FontError(f"Label '{widget.get('identifier')}': only numeric variable bindings are supported")
+            chars = NUMERIC_CHARS
+        else:
+            chars = text
+        identifier = widget.get("identifier") or f"label_{widget.get('left')}_{widget.get('top')}"
+        labels.append(Label(identifier, widget["left"], widget["top"], font_size, chars))
+    return labels
+
+
+class LvglFont:
+    """Glyphs of an LVGL font source generated by lv_font_conv (uncompressed bitmaps)."""
+
+    def __init__(self, source, name="font"):
+        self.name = name
+        self.line_height = self._field(source, "line_height")
+        self.base_line = self._field(source, "base_line")
+        self.bpp = self._field(source, "bpp")
+        if self.bpp != 4:
+            raise FontError(f"{name}: {self.bpp} bpp fonts are not supported")
+        if self._field(source, "bitmap_format", 0) != 0:
+            raise FontError(f"{name}: compressed fonts are not supported")
+
+        bitmap_start = source.index("glyph_bitmap[] = {")
+        bitmap_end = source.index("};", bitmap_start)
+        bitmap_source = source[bitmap_start:bitmap_end]
+        # Glyph ids follow the bitmap order, the first id (0) is reserved
+        self.glyph_ids = {}
+        for glyph_id, match in enumerate(re.finditer(r'/\* U\+([0-9A-Fa-f]+) ', bitmap_source), start=1):
+            self.glyph_ids[int(match.group(1), 16)] = glyph_id
+        bitmap_source = re.sub(r"/\*.*?\*/", "", bitmap_source[bitmap_source.index("{") + 1 :], flags=re.S)
+        self.bitmap = bytes(int(value, 16) for value in re.findall(r"0x[0-9a-fA-F]+", bitmap_source))
+
+        dsc_start = source.index("glyph_dsc[] = {")
+        dsc_end = source.index("};", dsc_start)
+        self.glyph_dsc = [
+            {key: int(value) for key, value in re.findall(r"\.(\w+) = (-?\d+)", entry)}
+            for entry in re.findall(r"\{([^{}]*)\}", source[dsc_start + len("glyph_dsc[] = {") : dsc_end])
+        ]
+
+    @staticmethod
+    def _field(source, name, default=None):
+        match = re.search(r"\." + name + r"\s*=\s*(-?\d+)", source)
+        if match is None:
+            if default is None:
+                raise FontError(f"No .{name} in the font source")
+            return default
+        return int(match.group(1))
+
+    def full_size(self):
+        """Bytes of the glyph bitmaps and descriptors (the cmaps and kerning tables come on top)."""
+        return len(self.bitmap) + LVGL_GLYPH_DSC_SIZE * len(self.glyph_dsc)
+
+    def glyph(self, char):
+        """Advance, and the pixel rows (list of lists of 0/1) positioned in the line box: (top_row, left_col)."""
+        glyph_id = self.glyph_ids.get(ord(char))
+        if glyph_id is None or glyph_id >= len(self.glyph_dsc):
+            raise FontError(f"{self.name}: no glyph for {char!r}")
+        dsc = self.glyph_dsc[glyph_id]
+        box_w, box_h = dsc["box_w"], dsc["box_h"]
+        pixels = []
+        bit = dsc["bitmap_index"] * 8
+        for _ in range(box_h):
+            row = []
+            for _ in range(box_w):
+                byte = self.bitmap[bit // 8]
+                alpha = (byte >> 4) if bit % 8 == 0 else (byte & 0x0F)
+                row.append(1 if alpha >= ALPHA_THRESHOLD else 0)
+                bit += 4
+            pixels.append(row)
+        # Same placement as the LVGL label draw: rows from the line top, columns from the pen position
+        top = (self.line_height - self.base_line) - box_h - dsc["ofs_y"]
+        advance = (dsc["adv_w"] + 8) >> 4
+        return advance, top, dsc["ofs_x"], pixels
+
+
+class Subset:
+    """Glyphs of one font for the labels sharing the same row inside their first page."""
+
+    def __init__(self, font, font_size, row_phase_key, labels):
+        self.font = font
+        self.font_size = font_size
+        self.labels = labels
+        self.name = f"mono_font_eez_montserrat_{font_size}_r{row_phase_key}"
+        self.chars = sorted(set("".join(label.chars for label in labels)), key=ord)
+
+        glyphs = {char: font.glyph(char) for char in self.chars}
+        inked = [(top, len(pixels)) for (_, top, _, pixels) in glyphs.values() if pixels]
+        top_min = min((top for top, _ in inked), default=0)
+        bottom_max = max((top + height for top, height in inked), default=1)
+        label_y = labels[0].y
+        phase = (label_y + top_min) % 8
+        # Rows from the label top to the first bitmap row, the bitmap starts on a page boundary at the label row
+        self.y_offset = top_min - phase
+        self.height_pages = (bottom_max - self.y_offset + 7) // 8
+
+        self.glyphs = []  # (code, width, offset)
+        self.bitmap = bytearray()
+        for char in self.chars:
+            advance, top, left, pixels = glyphs[char]
+            columns = []
+            for page in range(self.height_pages):
+                for col in range(advance):
+                    byte = 0
+                    for bit in range(8):
+                        row = page * 8 + bit + self.y_offset - top
+                        pixel_col = col - left
+                        if 0 <= row < len(pixels) and 0 <= pixel_col < len(pixels[row]) and pixels[row][pixel_col]:
+                            byte |= 1 << bit
+                    columns.append(byte)
+            self.glyphs.append((ord(char), advance, len(self.bitmap)))
+            self.bitmap += bytes(columns)
+
+    def size(self):
+        return len(self.bitmap) + MONO_GLYPH_SIZE * len(self.glyphs) + MONO_FONT_SIZE
+
+
+def build_subsets(labels, font_loader):
+    """Group the labels by font and row inside the page, one subset per group."""
+    groups = {}
+    for label in labels:
+        groups.setdefault((label.font_size, label.y % 8), []).append(label)
+    fonts = {}
+    subsets = []
+    for (font_size, row_phase_key), group in sorted(groups.items()):
+        if font_size not in fonts:
+            fonts[font_size] = font_loader(font_size)
+        subsets.append(Subset(fonts[font_size], font_size, row_phase_key, group))
+    return fonts, subsets
+
+
+def _char_comment(code):
+    char = chr(code)
+    return "space" if char == " " else char
+
+
+def _code_literal(code):
+    char = chr(code)
+    if code < 0x80 and char not in "'\\":
+        return f"'{char}'"
+    return f"0x{code:02X}"
+
+
+def render_c(subsets, fonts, project_name):
+    lines = [
+        f"// Generated by tools/gen_mono_fonts.py from {project_name}, do not edit.",
+        "// Glyph subsets of the EEZ Studio labels, 1 bpp in the SSD1306 page layout (top row in the LSB).",
+        "",
+        '#include "mono_fonts_eez.h"',
+        "",
+    ]
+    for subset in subsets:
+        lines.append(f"static const uint8_t s_{subset.name}_bitmap[] = {{")
+        rows = []
+        for code, width, offset in subset.glyphs:
+            for page in range(subset.height_pages):
+                start = offset + page * width
+                data = subset.bitmap[start : start + width]
+                row = ("    " + "".join(f"0x{b:02X}, " for b in data)).rstrip()
+                rows.append((row, f"{_char_comment(code)} page {page}"))
+        comment_col = max(len(row) for row, _ in rows) + 1
+        lines += [row.ljust(comment_col) + "// " + comment for row, comment in rows]
+        lines += ["};", ""]
+        lines.append(f"static const mono_glyph_t s_{subset.name}_glyphs[] = {{")
+        lines += [f"    {{{_code_literal(code)}, {width}, {offset}}}," for code, width, offset in subset.glyphs]
+        lines += ["};", ""]
+        lines += [
+            f"const mono_font_t {subset.name} = {{",
+            f"    .height_pages = {subset.height_pages},",
+            "    .spacing = 0,",
+            f"    .y_offset = {subset.y_offset},",
+            f"    .n_glyphs = {len(subset.glyphs)},",
+            f"    .glyphs = s_{subset.name}_glyphs,",
+            f"    .bitmap = s_{subset.name}_bitmap,",
+            "};",
+            "",
+        ]
+    return "\n".join(lines).rstrip() + "\n"
+
+
+def render_h(subsets):
+    lines = [
+        "// Generated by tools/gen_mono_fonts.py, do not edit.",
+        "#ifndef MONO_FONTS_EEZ__H__",
+        "#define MONO_FONTS_EEZ__H__",
+        "",
+        '#include "mono_fb.h"',
+        "",
+    ]
+    lines += [f"extern const mono_font_t {subset.name};" for subset in subsets]
+    lines.append("")
+    lines.append("// Font of each label, drawn at the label position it is a byte copy")
+    defines = [(label.c_name, subset.name) for subset in subsets for label in subset.labels]
+    width = max(len(name) for name, _ in defines)
+    lines += [f"#define {name.ljust(width)} (&{font})" for name, font in defines]
+    lines += ["", "#endif // MONO_FONTS_EEZ__H__"]
+    return "\n".join(lines) + "\n"
+
+
+def report(subsets, fonts):
+    subsets_size = sum(subset.size() for subset in subsets)
+    fonts_size = sum(font.full_size() for font in fonts.values())
+    lines = []
+    for subset in subsets:
+        lines.append(
+            f"{subset.name}: {len(subset.glyphs)} glyphs, {subset.height_pages} pages, {subset.size()} bytes "
+            f"({', '.join(label.identifier for label in subset.labels)})"
+        )
+    lines.append(
+        f"Glyph data: {subsets_size} bytes for the subsets, {fonts_size} bytes for the full "
+        f"{'/'.join(f'Montserrat {size}' for size in sorted(fonts))} fonts ({fonts_size - subsets_size} bytes saved)"
+    )
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("project", help="EEZ Studio project (.eez-project)")
+    parser.add_argument("font_dir", help="LVGL font sources directory (lvgl/src/font)")
+    parser.add_argument("--output-dir", required=True)
+    parser.add_argument("--default-font-size", type=int, default=14, help="CONFIG_LV_FONT_DEFAULT_MONTSERRAT_<size>")
+    args = parser.parse_args()
+
+    def load_font(size):
+        path = os.path.join(args.font_dir, f"lv_font_montserrat_{size}.c")
+        with open(path, encoding="utf-8") as source:
+            return LvglFont(source.read(), os.path.basename(path))
+
+    try:
+        with open(args.project, encoding="utf-8") as project_file:
+            labels = read_labels(json.load(project_file), args.default_font_size)
+        fonts, subsets = build_subsets(labels, load_font)
+    except (FontError, OSError) as error:
+        print(f"gen_mono_fonts: {error}", file=sys.stderr)
+        return 1
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    with open(os.path.join(args.output_dir, "mono_fonts_eez.c"), "w", encoding="utf-8") as out:
+        out.write(render_c(subsets, fonts, os.path.basename(args.project)))
+    with open(os.path.join(args.output_dir, "mono_fonts_eez.h"), "w", encoding="utf-8") as out:
+        out.write(render_h(subsets))
+    for line in report(subsets, fonts):
+        print(f"gen_mono_fonts: {line}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""Receive and decode the meteo station binary sample stream (CONFIG_METEO_STREAM).
+
+Frame layout (little endian), see include/data_stream.h:
+| 0xA5 | 0x5A | type (1) | payload length (1) | payload (n) | CRC-16/CCITT-FALSE of type..payload (2) |
+
+Usage: meteo_stream_rx.py /dev/ttyACM0 [--duration 60] [--csv samples.csv] [--trace i2c.trace] [--stations nodes.csv]
+Reports sustained samples/s, dropped frames (sequence gaps) and CRC errors, and prints the alert changes.
+The frames carry monotonic stamps, converted to UTC ("utc_us", empty until then) with the last time frame.
+A coordinator station (CONFIG_METEO_STATION_COORDINATOR) also sends the samples of its ESP-NOW leaf stations.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+SYNC = b"\xA5\x5A"
+TYPE_SAMPLE = 0x01
+SAMPLE_FORMAT = "<IQIIHHBBffff"
+SAMPLE_PAYLOAD_SIZE = struct.calcsize(SAMPLE_FORMAT)
+SAMPLE_FIELDS = (
+    "sequence",
+    "timestamp_us",
+    "temp_adc",
+    "press_adc",
+    "hum_adc",
+    "gas_adc",
+    "gas_range",
+    "status",
+    "temperature_degc",
+    "pressure_pa",
+    "humidity_pct",
+    "gas_resistance_ohm",
+)
+TYPE_ALERT = 0x02
+ALERT_FORMAT = "<IQBB"
+ALERT_PAYLOAD_SIZE = struct.calcsize(ALERT_FORMAT)
+ALERT_FIELDS = ("sequence", "timestamp_us", "active_mask", "changed_mask")
+ALERT_NAMES = ("FROST", "HUMID", "STORM")  # Bit order of the ALERT_RULES table in include/alert_engine.h
+TYPE_I2C_TRACE = 0x03
+TRACE_HEADER = b"I2CT\x01"  # Trace file header, the records follow as sent (see include/i2c_trace.h)
+TYPE_STATION_BATCH = 0x04
+BATCH_HEADER_FORMAT = "<qB"  # Base timestamp, record count (see include/station_link.h)
+RECORD_FORMAT = "<BHihhh"  # Node id, sequence, ms from the base, packed temperature, pressure, humidity
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+STATION_FIELDS = (
+    "node_id",
+    "sequence",
+    "timestamp_us",
+    "utc_us",
+    "temperature_degc",
+    "pressure_pa",
+    "humidity_pct",
+)
+PACKED_INVALID = -0x8000
+TYPE_TIME = 0x05
+TIME_FORMAT = "<qq"  # Monotonic and UTC time of the same instant, us (see data_stream_encode_time())
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, same as data_stream_crc16()."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def encode_sample(sample):
+    """Encode a sample dict, same as data_stream_encode_sample(). Used by the tests as the device stand-in."""
+    payload = struct.pack(SAMPLE_FORMAT, *(sample[field] for field in SAMPLE_FIELDS))
+    body = bytes((TYPE_SAMPLE, len(payload))) + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+
+def encode_alert(alert):
+    """Encode an alert dict, same as data_stream_encode_alert()."""
+    payload = struct.pack(ALERT_FORMAT, *(alert[field] for field in ALERT_FIELDS))
+    body = bytes((TYPE_ALERT, len(payload))) + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+
+def encode_time(mono_us, utc_us):
+    """Encode a time frame, same as data_stream_encode_time()."""
+    payload = struct.pack(TIME_FORMAT, mono_us, utc_us)
+    body = bytes((TYPE_TIME, len(payload))) + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+
+def decode_station_batch(payload):
+    """Records of a station batch payload (station_link_encode_batch()), values unpacked as history_store_unpack()."""
+    base_us, count = struct.unpack_from(BATCH_HEADER_FORMAT, payload)
+    offset = struct.calcsize(BATCH_HEADER_FORMAT)
+    if len(payload) != offset + count * RECORD_SIZE:
+        return []
+    records = []
+    for node_id, sequence, delta_ms, temp, press, humid in struct.iter_unpack(RECORD_FORMAT, payload[offset:]):
+        records.append(
+            {
+                "node_id": node_id,
+                "sequence": sequence,
+                "timestamp_us": base_us + delta_ms * 1000,
+                "temperature_degc": float("nan") if temp == PACKED_INVALID else temp * 0.01,
+                "pressure_pa": float("nan") if press == PACKED_INVALID else 100000.0 + press,
+                "humidity_pct": float("nan") if humid == PACKED_INVALID else humid * 0.01,
+            }
+        )
+    return records
+
+
+def csv_value(value):
+    return "" if value is None else str(value)
+
+
+def alert_names(mask):
+    return [name for bit, name in enumerate(ALERT_NAMES) if mask >> bit & 1]
+
+
+class StreamDecoder:
+    """Incremental frame decoder, resynchronizes on the sync bytes after garbage or corrupted frames."""
+
+    def __init__(self):
+        self._buffer = bytearray()
+        self.frames = 0
+        self.dropped = 0
+        self.crc_errors = 0
+        self.skipped_bytes = 0
+        self.alerts = []  # Decoded alert frames, not counted in frames (they carry the sequence of their sample)
+        self.trace_records = []  # I2C trace records (bytes), to be drained by the caller
+        self.station_records = []  # Decoded station batch records (dicts), to be drained by the caller
+        self.time_reference = None  # (monotonic us, UTC us) of the last time frame
+        self._last_sequence = None
+
+    def utc_us(self, timestamp_us):
+        """UTC time of a monotonic stamp from the last time frame, None before the first one."""
+        if self.time_reference is None:
+            return None
+        mono_us, utc_us = self.time_reference
+        return utc_us + timestamp_us - mono_us
+
+    def feed(self, data):
+        """Feed received bytes, returns the list of decoded samples (dicts)."""
+        self._buffer += data
+        samples = []
+        while True:
+            start = self._buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing first sync byte, it can be the start of the next frame
+                keep = 1 if self._buffer[-1:] == SYNC[:1] else 0
+                self.skipped_bytes += len(self._buffer) - keep
+                del self._buffer[: len(self._buffer) - keep]
+                return samples
+            if start > 0:
+                self.skipped_bytes += start
+                del self._buffer[:start]
+            if len(self._buffer) < 4:
+                return samples
+            frame_type, length = self._buffer[2], self._buffer[3]
+            frame_size = 4 + length + 2
+            if len(self._buffer) < frame_size:
+                return samples
+            body = bytes(self._buffer[2 : 4 + length])
+            (crc,) = struct.unpack_from("<H", self._buffer, 4 + length)
+            if crc != crc16(body):
+                # Not a frame (or a corrupted one), skip the sync bytes and search again
+                self.crc_errors += 1
+                self.skipped_bytes += 2
+                del self._buffer[:2]
+                continue
+            del self._buffer[:frame_size]
+            if frame_type == TYPE_SAMPLE and length == SAMPLE_PAYLOAD_SIZE:
+                sample = dict(zip(SAMPLE_FIELDS, struct.unpack(SAMPLE_FORMAT, body[2:])))
+                sample["utc_us"] = self.utc_us(sample["timestamp_us"])
+                self._track_sequence(sample["sequence"])
+                samples.append(sample)
+            elif frame_type == TYPE_ALERT and length == ALERT_PAYLOAD_SIZE:
+                alert = dict(zip(ALERT_FIELDS, struct.unpack(ALERT_FORMAT, body[2:])))
+                alert["utc_us"] = self.utc_us(alert["timestamp_us"])
+                self.alerts.append(alert)
+            elif frame_type == TYPE_I2C_TRACE:
+                self.trace_records.append(bytes(body[2:]))
+            elif frame_type == TYPE_STATION_BATCH and length >= struct.calcsize(BATCH_HEADER_FORMAT):
+                for record in decode_station_batch(bytes(body[2:])):
+                    record["utc_us"] = self.utc_us(record["timestamp_us"])
+                    self.station_records.append(record)
+            elif frame_type == TYPE_TIME and length == struct.calcsize(TIME_FORMAT):
+                self.time_reference = struct.unpack(TIME_FORMAT, body[2:])
+
+    def _track_sequence(self, sequence):
+        self.frames += 1
+        if self._last_sequence is not None:
+            gap = (sequence - self._last_sequence - 1) & 0xFFFFFFFF
+            if gap < 0x80000000:  # Ignore a device restart (sequence going back)
+                self.dropped += gap
+        self._last_sequence = sequence
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY | os.O_NONBLOCK)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = termios.B115200  # Ignored by USB CDC, needed by some pseudo-terminals
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def receive(
+    fd, decoder, duration_s=None, report_period_s=1.0, on_sample=None, on_trace=None, on_station=None, out=sys.stdout
+):
+    """Read and decode until the duration elapses or the port closes, returns the sustained samples/s."""
+    start = last_report = time.monotonic()
+    last_frames = 0
+    while duration_s is None or time.monotonic() - start < duration_s:
+        ready, _, _ = select.select([fd], [], [], 0.1)
+        if ready:
+            try:
+                data = os.read(fd, 4096)
+            except BlockingIOError:
+                continue
+            except OSError:
+                break  # Device (or pseudo-terminal) gone
+            if not data:
+                break
+            n_alerts = len(decoder.alerts)
+            for sample in decoder.feed(data):
+                if on_sample is not None:
+                    on_sample(sample)
+            if on_trace is not None:
+                for record in decoder.trace_records:
+                    on_trace(record)
+            decoder.trace_records.clear()
+            if on_station is not None:
+                for record in decoder.station_records:
+                    on_station(record)
+            decoder.station_records.clear()
+            for alert in decoder.alerts[n_alerts:]:
+                active = ", ".join(alert_names(alert["active_mask"])) or "none"
+                print(f"Alerts at {alert['timestamp_us'] / 1e6:.1f} s: {active}", file=out)
+        now = time.monotonic()
+        if report_period_s and now - last_report >= report_period_s:
+            rate = (decoder.frames - last_frames) / (now - last_report)
+            print(
+                f"{rate:8.1f} samples/s, {decoder.frames} frames, {decoder.dropped} dropped, "
+                f"{decoder.crc_errors} CRC errors",
+                file=out,
+            )
+            last_report, last_frames = now, decoder.frames
+    elapsed = time.monotonic() - start
+    return decoder.frames / elapsed if elapsed > 0 else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="USB-Serial/JTAG device, e.g. /dev/ttyACM0")
+    parser.add_argument("--duration", type=float, default=None, help="stop after this many seconds")
+    parser.add_argument("--csv", help="write every decoded sample to this CSV file")
+    parser.add_argument("--trace", help="write the I2C trace records (CONFIG_METEO_I2C_TRACE) to this file")
+    parser.add_argument("--stations", help="write the ESP-NOW station records of a coordinator to this CSV file")
+    args = parser.parse_args()
+
+    csv_file = open(args.csv, "w") if args.csv else None
+    if csv_file:
+        csv_file.write(",".join(SAMPLE_FIELDS + ("utc_us",)) + "\n")
+
+    def write_csv(sample):
+        csv_file.write(",".join(csv_value(sample[field]) for field in SAMPLE_FIELDS + ("utc_us",)) + "\n")
+
+    trace_file = open(args.trace, "wb") if args.trace else None
+    if trace_file:
+        trace_file.write(TRACE_HEADER)
+
+    stations_file = open(args.stations, "w") if args.stations else None
+    if stations_file:
+        stations_file.write(",".join(STATION_FIELDS) + "\n")
+
+    def write_station(record):
+        stations_file.write(",".join(csv_value(record[field]) for field in STATION_FIELDS) + "\n")
+
+    decoder = StreamDecoder()
+    fd = open_port(args.port)
+    try:
+        rate = receive(
+            fd,
+            decoder,
+            args.duration,
+            on_sample=write_csv if csv_file else None,
+            on_trace=trace_file.write if trace_file else None,
+            on_station=write_station if stations_file else None,
+        )
+    except KeyboardInterrupt:
+        rate = None
+    finally:
+        os.close(fd)
+        if csv_file:
+            csv_file.close()
+        if trace_file:
+            trace_file.close()
+        if stations_file:
+            stations_file.close()
+
+    summary = f"{decoder.frames} frames, {decoder.dropped} dropped, {decoder.crc_errors} CRC errors"
+    if rate is not None:
+        summary = f"Sustained {rate:.1f} samples/s, " + summary
+    print(summary)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Tests of the glyph subset generator, with a small font source in the lv_font_conv output format.
+
+Run: python3 -m unittest discover -s tools
+"""
+
+import unittest
+
+import gen_mono_fonts as gen
+
+# 'I' is a 2x4 block, '-' a 3x1 bar and the space has no pixel. Line height 10, base line 2.
+FONT_SOURCE = """
+static LV_ATTRIBUTE_LARGE_CONST const uint8_t glyph_bitmap[] = {
+    /* U+0020 " " */
+
+    /* U+002D "-" */
+    0xff, 0xf0,
+
+    /* U+0049 "I" */
+    0xff, 0xff, 0xff, 0xf7
+};
+
+static const lv_font_fmt_txt_glyph_dsc_t glyph_dsc[] = {
+    {.bitmap_index = 0, .adv_w = 0, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0} /* id = 0 reserved */,
+    {.bitmap_index = 0, .adv_w = 48, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0},
+    {.bitmap_index = 0, .adv_w = 64, .box_w = 3, .box_h = 1, .ofs_x = 0, .ofs_y = 3},
+    {.bitmap_index = 2, .adv_w = 64, .box_w = 2, .box_h = 4, .ofs_x = 1, .ofs_y = 0}
+};
+
+static lv_font_fmt_txt_dsc_t font_dsc = {
+    .glyph_bitmap = glyph_bitmap,
+    .glyph_dsc = glyph_dsc,
+    .bpp = 4,
+    .bitmap_format = 0,
+};
+
+const lv_font_t lv_font_montserrat_10 = {
+    .line_height = 10,
+    .base_line = 2,
+};
+"""
+
+
+def make_project(labels):
+    widgets = []
+    for identifier, left, top, text, text_type, font in labels:
+        style = {"text_font": font} if font else {}
+        widgets.append(
+            {
+                "type": "LVGLLabelWidget",
+                "identifier": identifier,
+                "left": left,
+                "top": top,
+                "text": text,
+                "textType": text_type,
+                "localStyles": {"definition": {"MAIN": {"DEFAULT": style}}},
+            }
+        )
+    return {
+        "variables": {"globalVariables": [{"name": "value", "type": "float"}, {"name": "flag", "type": "boolean"}]},
+        "userPages": [{"components": [{"type": "LVGLPanelWidget", "children": widgets}]}],
+    }
+
+
+def pixel(subset, char, x, y):
+    """Pixel of the glyph cell, y from the label top."""
+    for code, width, offset in subset.glyphs:
+        if code == ord(char):
+            row = y - subset.y_offset
+            return (subset.bitmap[offset + (row // 8) * width + x] >> (row % 8)) & 1
+    raise KeyError(char)
+
+
+class TestGenMonoFonts(unittest.TestCase):
+    def test_parse_font_source(self):
+        font = gen.LvglFont(FONT_SOURCE)
+        self.assertEqual({0x20: 1, 0x2D: 2, 0x49: 3}, font.glyph_ids)
+        advance, top, left, pixels = font.glyph("I")
+        self.assertEqual((4, 4, 1), (advance, top, left))  # Top row 10 - 2 - 4 - 0
+        self.assertEqual([[1, 1], [1, 1], [1, 1], [1, 0]], pixels)  # 0x7 coverage is below the threshold
+        with self.assertRaises(gen.FontError):
+            font.glyph("A")
+
+    def test_label_chars(self):
+        project = make_project(
+            [("Value", 0, 0, "value", "expression", "MONTSERRAT_10"), ("Unit", 40, 3, "I-", "literal", None)]
+        )
+        labels = gen.read_labels(project, default_font_size=10)
+        self.assertEqual(["Value", "Unit"], [label.identifier for label in labels])
+        self.assertEqual(gen.NUMERIC_CHARS, labels[0].chars)
+        self.assertEqual((40, 3, 10, "I-"), (labels[1].x, labels[1].y, labels[1].font_size, labels[1].chars))
+        self.assertEqual("MONO_FONT_EEZ_UNIT", labels[1].c_name)
+
+        with self.assertRaises(gen.FontError):
+            gen.read_labels(make_project([("Flag", 0, 0, "flag", "expression", None)]), 10)
+
+    def test_subset_is_page_aligned_at_the_label_row(self):
+        project = make_project([("A", 0, 13, "I-", "literal", None), ("B", 60, 29, "-", "literal", None)])
+        fonts, subsets = gen.build_subsets(gen.read_labels(project, 10), lambda size: gen.LvglFont(FONT_SOURCE))
+        self.assertEqual(1, len(subsets))  # Same font and same row in the page (13 % 8 == 29 % 8)
+        subset = subsets[0]
+        self.assertEqual("mono_font_eez_montserrat_10_r5", subset.name)
+        self.assertEqual(["-", "I"], subset.chars)
+        # The first inked row (4) lands on row 17 of the screen, the bitmap starts at the page boundary 16
+        self.assertEqual(0, (13 + subset.y_offset) % 8)
+        self.assertEqual(0, (29 + subset.y_offset) % 8)
+        self.assertEqual(1, subset.height_pages)
+
+        # Same pixels as the LVGL placement, the 'I' is shifted right by its ofs_x
+        self.assertEqual([0, 1, 1, 0], [pixel(subset, "I", x, 4) for x in range(4)])
+        self.assertEqual([1, 1, 1], [pixel(subset, "I", 1, y) for y in range(4, 7)])
+        self.assertEqual(0, pixel(subset, "I", 2, 7))
+        self.assertEqual([1, 1, 1, 0], [pixel(subset, "-", x, 4) for x in range(4)])
+
+    def test_render_and_report(self):
+        project = make_project([("Temp", 0, 0, "value", "expression", None), ("Unit", 40, 0, "I", "literal", None)])
+        font_source = FONT_SOURCE.replace("/* U+0049", "/* U+0030").replace("0x49", "0x30")
+        digits = "".join(f'    /* U+{ord(c):04X} "{c}" */\n    0xff, 0xff, 0xff, 0xff,\n' for c in "123456789.I")
+        dsc = "".join(
+            "    {.bitmap_index = %d, .adv_w = 64, .box_w = 2, .box_h = 4, .ofs_x = 1, .ofs_y = 0},\n" % (6 + 4 * i)
+            for i in range(11)
+        )
+        font_source = font_source.replace("0xff, 0xff, 0xff, 0xf7\n", "0xff, 0xff, 0xff, 0xf7,\n" + digits)
+        font_source = font_source.replace(".ofs_x = 1, .ofs_y = 0}\n};", ".ofs_x = 1, .ofs_y = 0},\n" + dsc + "};")
+        fonts, subsets = gen.build_subsets(gen.read_labels(project, 10), lambda size: gen.LvglFont(font_source))
+
+        source = gen.render_c(subsets, fonts, "test.eez-project")
+        self.assertIn("const mono_font_t mono_font_eez_montserrat_10_r0 = {", source)
+        self.assertIn("{'I', 4, ", source)
+        header = gen.render_h(subsets)
+        self.assertIn("#define MONO_FONT_EEZ_TEMP (&mono_font_eez_montserrat_10_r0)", header)
+        self.assertIn("#define MONO_FONT_EEZ_UNIT (&mono_font_eez_montserrat_10_r0)", header)
+
+        summary = gen.report(subsets, fonts)[-1]
+        self.assertIn(f"{subsets[0].size()} bytes for the subsets", summary)
+        self.assertIn(f"{fonts[10].full_size()} bytes for the full Montserrat 10 fonts", summary)
+
+
+if __name__ == "__main__":
+    unittest.main()
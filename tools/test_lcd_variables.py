@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Check the LCD_VARIABLES table (include/lcd_variables.h) against the EEZ Studio project native variables.
+
+The generated native_vars[] table is indexed by the EEZ variable index, so both lists must have the same order.
+
+Run: python3 -m unittest discover -s tools
+"""
+
+import json
+import os
+import re
+import unittest
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+HEADER = os.path.join(ROOT, "include", "lcd_variables.h")
+PROJECT = os.path.join(ROOT, "eez_studio", "EEZ_SSD1306_Test.eez-project")
+
+# X(name, type, eez_type, init, unit, precision)
+ENTRY = re.compile(r"^\s*X\((\w+),\s*(\w+),\s*(\w+),", re.MULTILINE)
+
+
+def table_variables():
+    with open(HEADER, encoding="utf-8") as header:
+        source = header.read()
+    table = source[source.index("#define LCD_VARIABLES(X)") :]
+    table = table[: table.index("\n\n")]
+    return [(name, eez_type.lower()) for name, _, eez_type in ENTRY.findall(table)]
+
+
+def project_variables():
+    with open(PROJECT, encoding="utf-8") as project:
+        variables = json.load(project)["variables"]["globalVariables"]
+    return [(variable["name"], variable["type"]) for variable in variables if variable.get("native")]
+
+
+class TestLcdVariables(unittest.TestCase):
+    def test_table_matches_project(self):
+        self.assertGreater(len(table_variables()), 0)
+        self.assertEqual(project_variables(), table_variables())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Tests of the stream receiver, a pseudo-terminal stands in for the USB-Serial/JTAG port.
+
+Run: python3 -m unittest discover -s tools
+"""
+
+import io
+import os
+import threading
+import time
+import unittest
+
+import meteo_stream_rx as rx
+
+
+def make_sample(sequence):
+    return {
+        "sequence": sequence,
+        "timestamp_us": sequence * 10000,
+        "temp_adc": 500000 + sequence,
+        "press_adc": 400000,
+        "hum_adc": 24000,
+        "gas_adc": 512,
+        "gas_range": 4,
+        "status": 0x80,
+        "temperature_degc": 21.5,
+        "pressure_pa": 101325.0,
+        "humidity_pct": 40.25,
+        "gas_resistance_ohm": 12000.0,
+    }
+
+
+class TestDecoder(unittest.TestCase):
+    def test_crc_check_value(self):
+        self.assertEqual(0x29B1, rx.crc16(b"123456789"))
+
+    def test_round_trip_split_chunks(self):
+        stream = b"".join(rx.encode_sample(make_sample(i)) for i in range(10))
+        decoder = rx.StreamDecoder()
+        samples = []
+        for i in range(0, len(stream), 7):
+            samples += decoder.feed(stream[i : i + 7])
+        self.assertEqual(list(range(10)), [s["sequence"] for s in samples])
+        self.assertEqual(21.5, samples[3]["temperature_degc"])
+        self.assertEqual(500003, samples[3]["temp_adc"])
+        self.assertEqual(0, decoder.dropped)
+
+    def test_sequence_gaps_are_dropped_frames(self):
+        decoder = rx.StreamDecoder()
+        decoder.feed(b"".join(rx.encode_sample(make_sample(i)) for i in (1, 2, 5, 6, 10)))
+        self.assertEqual(5, decoder.frames)
+        self.assertEqual(5, decoder.dropped)
+
+    def test_resync_after_log_lines_and_corruption(self):
+        corrupted = bytearray(rx.encode_sample(make_sample(2)))
+        corrupted[10] ^= 0xFF
+        stream = (
+            b"I (1234) main: log line on the same port\n\xA5"
+            + rx.encode_sample(make_sample(1))
+            + bytes(corrupted)
+            + rx.encode_sample(make_sample(3))
+        )
+        decoder = rx.StreamDecoder()
+        samples = decoder.feed(stream)
+        self.assertEqual([1, 3], [s["sequence"] for s in samples])
+        self.assertEqual(1, decoder.crc_errors)
+        self.assertEqual(1, decoder.dropped)
+
+    def test_alert_frames_between_samples(self):
+        alert = {"sequence": 2, "timestamp_us": 20000, "active_mask": 0x05, "changed_mask": 0x04}
+        stream = rx.encode_sample(make_sample(1)) + rx.encode_sample(make_sample(2)) + rx.encode_alert(alert)
+        decoder = rx.StreamDecoder()
+        samples = decoder.feed(stream + rx.encode_sample(make_sample(3)))
+        self.assertEqual([1, 2, 3], [s["sequence"] for s in samples])
+        self.assertEqual([dict(alert, utc_us=None)], decoder.alerts)
+        self.assertEqual(["FROST", "STORM"], rx.alert_names(alert["active_mask"]))
+        self.assertEqual(0, decoder.dropped)
+
+    def test_trace_records_are_kept_as_sent(self):
+        record = bytes((0x02, 0x76, 0x81, 0x01, 0x01, 0x02, 0x1D, 0x80, 0x00))
+        body = bytes((rx.TYPE_I2C_TRACE, len(record))) + record
+        frame = rx.SYNC + body + rx.struct.pack("<H", rx.crc16(body))
+        decoder = rx.StreamDecoder()
+        samples = decoder.feed(rx.encode_sample(make_sample(1)) + frame + rx.encode_sample(make_sample(2)))
+        self.assertEqual([1, 2], [s["sequence"] for s in samples])
+        self.assertEqual([record], decoder.trace_records)
+
+    def test_station_batch_records(self):
+        # Coordinator sample, then a late leaf record 1.5 s older with a missing humidity
+        records = rx.struct.pack(rx.RECORD_FORMAT, 0, 9, 0, 2150, 1325, 4025)
+        records += rx.struct.pack(rx.RECORD_FORMAT, 4, 65535, -1500, -1234, -200, rx.PACKED_INVALID)
+        payload = rx.struct.pack(rx.BATCH_HEADER_FORMAT, 50_000_000, 2) + records
+        body = bytes((rx.TYPE_STATION_BATCH, len(payload))) + payload
+        frame = rx.SYNC + body + rx.struct.pack("<H", rx.crc16(body))
+        decoder = rx.StreamDecoder()
+        samples = decoder.feed(frame + rx.encode_sample(make_sample(1)))
+        self.assertEqual([1], [s["sequence"] for s in samples])
+        self.assertEqual([0, 4], [r["node_id"] for r in decoder.station_records])
+        leaf = decoder.station_records[1]
+        self.assertEqual(65535, leaf["sequence"])
+        self.assertEqual(48_500_000, leaf["timestamp_us"])
+        self.assertAlmostEqual(-12.34, leaf["temperature_degc"])
+        self.assertEqual(99800.0, leaf["pressure_pa"])
+        self.assertNotEqual(leaf["humidity_pct"], leaf["humidity_pct"])  # NaN
+        self.assertAlmostEqual(40.25, decoder.station_records[0]["humidity_pct"])
+
+    def test_time_frames_convert_stamps(self):
+        utc_2026_us = 1767225600 * 1000000
+        alert = {"sequence": 2, "timestamp_us": 20000, "active_mask": 0x01, "changed_mask": 0x01}
+        record = rx.struct.pack(rx.RECORD_FORMAT, 3, 1, -10, 0, 0, 0)  # 10 ms before the base
+        payload = rx.struct.pack(rx.BATCH_HEADER_FORMAT, 30000, 1) + record
+        body = bytes((rx.TYPE_STATION_BATCH, len(payload))) + payload
+        batch = rx.SYNC + body + rx.struct.pack("<H", rx.crc16(body))
+        decoder = rx.StreamDecoder()
+        samples = decoder.feed(
+            rx.encode_sample(make_sample(1))  # Before the first time frame: no UTC time
+            + rx.encode_time(15000, utc_2026_us)
+            + rx.encode_sample(make_sample(2))
+            + rx.encode_alert(alert)
+            + batch
+        )
+        self.assertEqual([None, utc_2026_us + 5000], [s["utc_us"] for s in samples])
+        self.assertEqual(utc_2026_us + 5000, decoder.alerts[0]["utc_us"])
+        self.assertEqual(utc_2026_us + 5000, decoder.station_records[0]["utc_us"])
+        self.assertEqual(2, decoder.frames)  # Time frames are not samples
+        self.assertEqual(0, decoder.dropped)
+
+
+class TestPseudoTerminal(unittest.TestCase):
+    def test_receive_over_pty(self):
+        master, slave = os.openpty()
+        n_frames = 500
+
+        def device():
+            for i in range(n_frames):
+                if i != 100:  # One frame dropped on the device side
+                    os.write(master, rx.encode_sample(make_sample(i)))
+                if i % 50 == 0:
+                    time.sleep(0.005)
+
+        fd = rx.open_port(os.ttyname(slave))
+        writer = threading.Thread(target=device)
+        writer.start()
+        decoder = rx.StreamDecoder()
+        report = io.StringIO()
+        deadline = time.monotonic() + 5.0
+        while decoder.frames + decoder.dropped < n_frames - 1 and time.monotonic() < deadline:
+            rate = rx.receive(fd, decoder, duration_s=0.2, report_period_s=0.1, out=report)
+        writer.join()
+        os.close(fd)
+        os.close(slave)
+        os.close(master)
+
+        self.assertEqual(n_frames - 1, decoder.frames)
+        self.assertEqual(1, decoder.dropped)
+        self.assertEqual(0, decoder.crc_errors)
+        self.assertGreater(rate, 0.0)
+        self.assertIn("samples/s", report.getvalue())
+
+
+if __name__ == "__main__":
+    unittest.main()